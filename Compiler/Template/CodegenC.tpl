@@ -3662,13 +3662,22 @@ template function_HPCOM_Task(list<SimEqSystem> derivativEquations, String name,
       let odeEqs = task.eqIdc |> eq => equationNamesHPCOM_Thread_(eq,derivativEquations,contextSimulationNonDiscrete,modelNamePrefixStr); separator="\n"
       <<
       // Task <%task.index%>
-      <%odeEqs%>
+      {
+        /* the pool of a worker thread is only released here */
+        omc_pool_mark_t poolMark = omc_pool_mark();
+        <%odeEqs%>
+        omc_pool_release(poolMark);
+      }
       // End Task <%task.index%>
       >>
     case (task as CALCTASK_LEVEL(__)) then
       let odeEqs = task.eqIdc |> eq => equationNamesHPCOM_Thread_(eq,derivativEquations,contextSimulationNonDiscrete,modelNamePrefixStr); separator="\n"
       <<
-      <%odeEqs%>
+      {
+        omc_pool_mark_t poolMark = omc_pool_mark();
+        <%odeEqs%>
+        omc_pool_release(poolMark);
+      }
       >>
     case(task as DEPTASK(outgoing=false)) then
       let assLck = function_HPCOM_assignLockByDepTask(task, "lock", iType); separator="\n"
@@ -238,6 +238,7 @@ case SIMCODE(__) then
   <<
   void eventUpdate(ModelInstance* comp, fmi2EventInfo* eventInfo);
   fmi2Real getReal(ModelInstance* comp, const fmi2ValueReference vr);
+  unsigned int getRealEvaluationBlocks(const fmi2ValueReference vr);
   fmi2Status setReal(ModelInstance* comp, const fmi2ValueReference vr, const fmi2Real value);
   fmi2Integer getInteger(ModelInstance* comp, const fmi2ValueReference vr);
   fmi2Status setInteger(ModelInstance* comp, const fmi2ValueReference vr, const fmi2Integer value);
@@ -287,6 +288,7 @@ case SIMCODE(__) then
   <<
   <%eventUpdateFunction2(simCode)%>
   <%getRealFunction2(simCode, modelInfo)%>
+  <%getRealEvaluationBlocksFunction2(simCode)%>
   <%setRealFunction2(simCode, modelInfo)%>
   <%getIntegerFunction2(simCode, modelInfo)%>
   <%setIntegerFunction2(simCode, modelInfo)%>
@@ -748,6 +750,30 @@ case MODELINFO(vars=SIMVARS(__),varInfo=VARINFO(numAlgAliasVars=numAlgAliasVars,
   >>
 end getRealFunction2;
 
+template getRealEvaluationBlocksFunction2(SimCode simCode)
+ "Generates the function that returns the blocks of the model equations fmi2GetReal has to evaluate for a variable."
+::=
+  match getFMIRealEvaluationBlocks(simCode)
+  case {} then
+    <<
+    unsigned int getRealEvaluationBlocks(const fmi2ValueReference vr) {
+      return FMU2_BLOCK_ALL;
+    }
+
+    >>
+  case blocks then
+    <<
+    static const unsigned char realEvaluationBlocks[<%listLength(blocks)%>] = {
+      <%blocks |> b => b ;separator=", "; align=20; alignSeparator=",\n" %>
+    };
+
+    unsigned int getRealEvaluationBlocks(const fmi2ValueReference vr) {
+      return vr < <%listLength(blocks)%> ? realEvaluationBlocks[vr] : FMU2_BLOCK_ALL;
+    }
+
+    >>
+end getRealEvaluationBlocksFunction2;
+
 template setRealFunction2(SimCode simCode, ModelInfo modelInfo)
  "Generates setReal function for c file."
 ::=
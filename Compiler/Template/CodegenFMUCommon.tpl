@@ -61,7 +61,9 @@ case SIMCODE(__) then
   let pdd = providesDirectionalDerivative(simCode)
   <<
   <ModelExchange
-    modelIdentifier="<%modelIdentifier%>"<% if not pdd then '>' %>
+    modelIdentifier="<%modelIdentifier%>"
+    canGetAndSetFMUstate="true"
+    canSerializeFMUstate="true"<% if not pdd then '>' %>
     <% if pdd then 'providesDirectionalDerivative="' + pdd + '">' %>
   </ModelExchange>
   >>
@@ -39,6 +39,9 @@ typedef struct {
   struct csv_data *csvReader;
 } SimulationResult_Globals;
 
+/* Bound on the decoded columns kept by the (memory-mapped) result file reader */
+#define MATLAB4_CACHE_SIZE (256*1024*1024)
+
 static SimulationResult_Globals simresglob = {
   UNKNOWN_PLOT,
   0
@@ -80,6 +83,7 @@ static PlotFormat SimulationResultsImpl__openFile(const char *filename, Simulati
 
   if (len < 5) format = UNKNOWN_PLOT;
   else if (0 == strcmp(filename+len-4, ".mat")) format = MATLAB4;
+  else if (0 == strcmp(filename+len-5, ".matc")) format = MATLAB4; /* chunked; same reader */
   else if (0 == strcmp(filename+len-4, ".plt")) format = PLT;
   else if (0 == strcmp(filename+len-4, ".csv")) format = CSV;
   else {
@@ -89,7 +93,7 @@ static PlotFormat SimulationResultsImpl__openFile(const char *filename, Simulati
   }
   switch (format) {
   case MATLAB4:
-    if (0!=(msg[0]=omc_new_matlab4_reader(filename,&simresglob->matReader))) {
+    if (0!=(msg[0]=omc_new_matlab4_reader_lazy(filename,&simresglob->matReader,MATLAB4_CACHE_SIZE))) {
       msg[1] = filename;
       c_add_message(NULL,-1, ErrorType_scripting, ErrorLevel_error, gettext("Failed to open simulation result %s: %s"), msg, 2);
       return UNKNOWN_PLOT;
@@ -447,7 +451,6 @@ int SimulationResults_filterSimulationResults(const char *inFile, const char *ou
     parameter_indexes[0] = 1; /* time */
     omc_matlab4_read_all_vals(&simresglob.matReader);
     if (endsWith(outFile,".csv")) {
-      double **vals = omc_alloc_interface.malloc(sizeof(double*)*numToFilter);
       FILE *fout = NULL;
       for (i=0; i<numToFilter; i++) {
         const char *var = MMC_STRINGDATA(MMC_CAR(vars));
@@ -463,8 +466,6 @@ int SimulationResults_filterSimulationResults(const char *inFile, const char *ou
           msg[0] = var;
           c_add_message(NULL,-1, ErrorType_scripting, ErrorLevel_error, gettext("Could not filter parameter %s since the output format is CSV (only variables are allowed)."), msg, 1);
           return 0;
-        } else {
-          vals[i] = omc_matlab4_read_vals(&simresglob.matReader, mat_var[i]->index);
         }
       }
       fout = fopen(outFile, "w");
@@ -473,10 +474,18 @@ int SimulationResults_filterSimulationResults(const char *inFile, const char *ou
         fprintf(fout, ",\"%s\"", mat_var[i]->name);
       }
       fprintf(fout, ",nrows=%d\n", simresglob.matReader.nrows);
+      /* Row by row; the lazy reader serves this straight from the mapped data_2 matrix */
       for (i=0; i<simresglob.matReader.nrows; i++) {
-        fprintf(fout, "%.15g", vals[0][i]);
-        for (j=1; j<numToFilter; j++) {
-          fprintf(fout, ",%.15g", vals[j][i]);
+        for (j=0; j<numToFilter; j++) {
+          double val;
+          if (omc_matlab4_read_single_val(&val, &simresglob.matReader, mat_var[j]->index, i)) {
+            fclose(fout);
+            msg[0] = SystemImpl__basename(inFile);
+            msg[1] = mat_var[j]->name;
+            c_add_message(NULL,-1, ErrorType_scripting, ErrorLevel_error, gettext("Could not read variable %s in file %s."), msg, 2);
+            return 0;
+          }
+          fprintf(fout, j ? ",%.15g" : "%.15g", val);
         }
         fprintf(fout, "\n");
       }
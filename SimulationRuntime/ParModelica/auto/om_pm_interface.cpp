@@ -36,6 +36,9 @@
 
 
 #include <iostream>
+#include <cstring>
+
+#include <simulation/options.h>
 
 #include "om_pm_interface.hpp"
 #include "om_pm_model.hpp"
@@ -49,6 +52,13 @@ typedef Equation::FunctionType FunctionType;
 OMModel pm_om_model;
 
 void PM_Model_init(const char* model_name, DATA* data, threadData_t* threadData, FunctionType* ode_system) {
+    if(omc_flag[FLAG_PARMODAUTO_SCHEDULER]) {
+        const char* scheduler = omc_flagValue[FLAG_PARMODAUTO_SCHEDULER];
+        if(std::strcmp(scheduler, "worksteal") == 0)
+            pm_om_model.ode_work_stealing = true;
+        else if(std::strcmp(scheduler, "levels") != 0)
+            utility::warning() << "Unknown ParModelica scheduler '" << scheduler << "'. Using levels." << newl;
+    }
     pm_om_model.initialize(model_name, data, threadData, ode_system);
 }
 
@@ -79,7 +89,10 @@ void PM_functionDAE(int size, DATA* data, threadData_t* threadData, FunctionType
 
 void PM_functionODE(int size, DATA* data, threadData_t* threadData, FunctionType* functionODE_systems) {
 
-    pm_om_model.ODE_scheduler.execute();
+    if(pm_om_model.ode_work_stealing)
+        pm_om_model.ODE_ws_scheduler.execute();
+    else
+        pm_om_model.ODE_scheduler.execute();
 
   // pm_om_model.ODE_scheduler.execution_timer.start_timer();
     // for(int i = 0; i < size; ++i)
@@ -106,8 +119,14 @@ void PM_functionAlg(int size, DATA* data, threadData_t* threadData, FunctionType
 void dump_times() {
     utility::log("") << "Total INI: " << pm_om_model.INI_scheduler.execution_timer.get_elapsed_time() << std::endl;
     utility::log("") << "Total DAE: " << pm_om_model.DAE_scheduler.execution_timer.get_elapsed_time() << std::endl;
-    utility::log("") << "Total ODE: " << pm_om_model.ODE_scheduler.execution_timer.get_elapsed_time() << std::endl;
-    utility::log("") << "Total ODE: " << pm_om_model.ODE_scheduler.clustering_timer.get_elapsed_time() << std::endl;
+    if(pm_om_model.ode_work_stealing) {
+        utility::log("") << "Total ODE: " << pm_om_model.ODE_ws_scheduler.execution_timer.get_elapsed_time() << std::endl;
+        utility::log("") << "Total ODE: " << pm_om_model.ODE_ws_scheduler.clustering_timer.get_elapsed_time() << std::endl;
+    }
+    else {
+        utility::log("") << "Total ODE: " << pm_om_model.ODE_scheduler.execution_timer.get_elapsed_time() << std::endl;
+        utility::log("") << "Total ODE: " << pm_om_model.ODE_scheduler.clustering_timer.get_elapsed_time() << std::endl;
+    }
     utility::log("") << "Total ALG: " << pm_om_model.total_alg_time.get_elapsed_time() << std::endl;
 }
 
@@ -77,16 +77,22 @@ bool Equation::depends_on(const TaskNode& other_b) const {
 
 
 void Equation::execute() {
+    // the temporaries of the equation are dead once it is evaluated, and
+    // the pool of a worker thread is not reset by anybody else
+    omc_pool_mark_t mark = omc_pool_mark();
     function_system[task_id](data, threadData);
+    omc_pool_release(mark);
 }
 
 
 OMModel::OMModel() :
     INI_scheduler(INI_system),
     DAE_scheduler(DAE_system),
-    ODE_scheduler(ODE_system)
+    ODE_scheduler(ODE_system),
+    ODE_ws_scheduler(ODE_system)
 {
     intialized = false;
+    ode_work_stealing = false;
 }
 
 
@@ -43,6 +43,7 @@
 #include "pm_task_system.hpp"
 #include "pm_cluster_level_scheduler.hpp"
 #include "pm_cluster_dynamic_scheduler.hpp"
+#include "pm_cluster_worksteal_scheduler.hpp"
 
 #include "pm_level_scheduler.hpp"
 #include "pm_dynamic_scheduler.hpp"
@@ -95,6 +96,7 @@ class OMModel
 
     typedef StepLevels<Equation> SchedulerT;
     // typedef ClusterDynamicScheduler<Equation> SchedulerT;
+    typedef WorkStealingScheduler<Equation> WorkStealingSchedulerT;
     typedef TaskSystem_v2<Equation> TaskSystemT;
 
 
@@ -120,6 +122,9 @@ public:
     FunctionType* ode_system_funcs;
     TaskSystemT ODE_system;
     SchedulerT ODE_scheduler;
+    /*! used instead of ODE_scheduler with -parmodautoScheduler=worksteal. */
+    WorkStealingSchedulerT ODE_ws_scheduler;
+    bool ode_work_stealing;
 
     PMTimer total_alg_time;
     TaskSystemT ALG_system;
@@ -98,6 +98,12 @@ public:
         , task_system(task_system)
     {
     }
+
+    ~ClusterDynamicScheduler() {
+        typename std::map<ClusterIdType, tbb::flow::continue_node<tbb::flow::continue_msg>* >::iterator f_iter;
+        for(f_iter = cluster_flow_id_map.begin(); f_iter != cluster_flow_id_map.end(); ++f_iter)
+            delete f_iter->second;
+    }
     
     void schedule() {
 		clustering_timer.start_timer();
@@ -109,6 +115,9 @@ public:
 
     void construct_flow_graph()
     {
+        /*! the flow graph is built once and reused by every execution. */
+        if(flow_graph_created)
+            return;
 
         using namespace tbb;
         GraphType& sys_graph = task_system.sys_graph;
@@ -38,6 +38,9 @@
  Mahder.Gebremedhin@liu.se  2014-03-13
 */
 
+#include <cmath>
+#include <sstream>
+
 #include <tbb/parallel_for.h>
 #include <tbb/task_scheduler_init.h>
 
@@ -63,9 +66,11 @@ struct TBBConcurrentStepExecutor {
 
 private:
     GraphType& sys_graph;
+    /*! if > 0 the clusters are timed and their costs updated with this weight. */
+    double profile_weight;
 
 public:
-    TBBConcurrentStepExecutor(GraphType& g) : sys_graph(g) {}
+    TBBConcurrentStepExecutor(GraphType& g, double w = 0) : sys_graph(g), profile_weight(w) {}
 
     void operator()( tbb::blocked_range<ClusteIdIter>& range ) const {
 
@@ -73,7 +78,10 @@ public:
             ClusterIdType& curr_clust_id = *clustid_iter;
             ClusterType& curr_clust = sys_graph[curr_clust_id];
 
-            curr_clust.execute();
+            if(profile_weight > 0)
+                curr_clust.profile_execute(profile_weight);
+            else
+                curr_clust.execute();
         }
     }
 
@@ -105,6 +113,12 @@ private:
     TaskSystemType& task_system;
     bool profiled;
     bool schedule_valid;
+    bool clustered;
+    int profiled_steps;
+    long nr_of_executions;
+    long last_profile;
+    long last_recluster;
+    int nr_of_reclusterings;
 
     tbb::task_scheduler_init tbb_system;
     TBBConcurrentStepExecutor<TaskType> step_executor;
@@ -115,6 +129,18 @@ public:
 	PMTimer clustering_timer;
     // PMTimer extra_timer;
 
+    /*! Number of sequential, timed steps before the first clustering. Costs are averaged over them.*/
+    int profile_steps;
+    /*! Every this many steps one step is timed while running in parallel. 0 disables it.*/
+    long reprofile_interval;
+    /*! Weight of a runtime sample in the running cost estimate of a task.*/
+    double reprofile_weight;
+    /*! Recluster when the cluster costs drift by more than this fraction from the
+      costs the current clustering was made with ... */
+    double recluster_threshold;
+    /*! ... but not more often than every this many steps.*/
+    long min_recluster_interval;
+
     StepLevels(TaskSystemType& ts) :
       task_system(ts)
       , tbb_system(4)
@@ -122,6 +148,18 @@ public:
     {
         profiled = false;
         schedule_valid = false;
+        clustered = false;
+        profiled_steps = 0;
+        nr_of_executions = 0;
+        last_profile = 0;
+        last_recluster = 0;
+        nr_of_reclusterings = 0;
+
+        profile_steps = 5;
+        reprofile_interval = 500;
+        reprofile_weight = 0.25;
+        recluster_threshold = 0.3;
+        min_recluster_interval = 5000;
     }
 
     void estimate_speedup() {
@@ -160,6 +198,10 @@ public:
 
         clustering_timer.start_timer();
 
+        /*! start over from single task clusters, with the current costs. */
+        if(clustered)
+            task_system.split_clusters();
+
         if(task_system.levels_valid == false)
             task_system.update_node_levels();
 
@@ -181,8 +223,16 @@ public:
 		clustetring5::dump_graph(task_system);
 
         schedule_valid = true;
+        clustered = true;
         task_system.levels_valid = false;
 
+        GraphType& sys_graph = task_system.sys_graph;
+        typename GraphType::vertex_iterator vert_iter, vert_end;
+        boost::tie(vert_iter, vert_end) = vertices(sys_graph);
+        for ( ; vert_iter != vert_end; ++vert_iter) {
+            sys_graph[*vert_iter].scheduled_cost = sys_graph[*vert_iter].cost;
+        }
+
         estimate_speedup();
 		clustering_timer.stop_timer();
 
@@ -195,9 +245,24 @@ public:
         if(!this->profiled)
             return profile_execute();
 
+        ++nr_of_executions;
+        if(reprofile_interval > 0 && nr_of_executions - last_profile >= reprofile_interval)
+            return sample_execute();
+
         execution_timer.start_timer();
         // extra_timer.start_timer();
+        execute_levels(step_executor);
+        execution_timer.stop_timer();
+        // extra_timer.stop_timer();
+        // double step_cost = extra_timer.get_elapsed_time();
+        // std::cout << "E: " << step_cost << std::endl;
+        // extra_timer.reset_timer();
+
+    }
+
 
+    void execute_levels(const TBBConcurrentStepExecutor<TaskType>& executor)
+    {
         // GraphType& sys_graph = task_system.sys_graph;
 
         if(task_system.levels_valid == false)
@@ -214,7 +279,7 @@ public:
                 tbb::parallel_for(
                     tbb::blocked_range<typename SameLevelClusterIdsType::iterator>(
                     current_level.begin(), current_level.end())
-                    , step_executor);
+                    , executor);
             // }
             // else {
                 // typename SameLevelClusterIdsType::iterator clustid_iter = current_level.begin();
@@ -227,20 +292,64 @@ public:
                 // }
             // }
         }
+    }
+
 
+    /*! A normal parallel step that also times every task. If the costs have
+      drifted too far from the ones the clustering was made with, recluster.*/
+    void sample_execute()
+    {
+        execution_timer.start_timer();
+        TBBConcurrentStepExecutor<TaskType> step_profiler(task_system.sys_graph, reprofile_weight);
+        execute_levels(step_profiler);
         execution_timer.stop_timer();
-        // extra_timer.stop_timer();
-        // double step_cost = extra_timer.get_elapsed_time();
-        // std::cout << "E: " << step_cost << std::endl;
-        // extra_timer.reset_timer();
 
+        last_profile = nr_of_executions;
+
+        if(nr_of_executions - last_recluster < min_recluster_interval)
+            return;
+
+        GraphType& sys_graph = task_system.sys_graph;
+        double drift = 0;
+        double scheduled_total = 0;
+        typename GraphType::vertex_iterator vert_iter, vert_end;
+        boost::tie(vert_iter, vert_end) = vertices(sys_graph);
+        /*! skip the root node. */
+        ++vert_iter;
+        for ( ; vert_iter != vert_end; ++vert_iter) {
+            ClusterType& curr_clust = sys_graph[*vert_iter];
+            drift += std::fabs(curr_clust.cost - curr_clust.scheduled_cost);
+            scheduled_total += curr_clust.scheduled_cost;
+        }
+
+        if(scheduled_total <= 0 || drift/scheduled_total < recluster_threshold)
+            return;
+
+        ++nr_of_reclusterings;
+        utility::log("") << "Reclustering after " << nr_of_executions << " steps, cost drift: "
+                         << drift/scheduled_total << std::endl;
+
+        std::ostringstream dump_name;
+        dump_name << "recluster_" << nr_of_reclusterings;
+        task_system.dump_graphml(dump_name.str() + "_before");
+
+        this->schedule_valid = false;
+        schedule();
+        task_system.dump_graphml(dump_name.str() + "_after");
+
+        last_recluster = nr_of_executions;
     }
 
 
+    /*! Sequential, timed step. The costs are averaged over the first profile_steps
+      steps, then the system is clustered with them.*/
     void profile_execute()
     {
         execution_timer.start_timer();
 
+        ++profiled_steps;
+        double weight = 1.0/profiled_steps;
+
 
         GraphType& sys_graph = task_system.sys_graph;
 
@@ -249,7 +358,7 @@ public:
         /*! skip the root node. */
         ++vert_iter;
         for ( ; vert_iter != vert_end; ++vert_iter) {
-            sys_graph[*vert_iter].profile_execute();
+            sys_graph[*vert_iter].profile_execute(weight);
         }
 
         execution_timer.stop_timer();
@@ -257,6 +366,9 @@ public:
         // std::cout << "P: " << step_cost << std::endl;
         // execution_timer.reset_timer();
 
+        if(profiled_steps < profile_steps)
+            return;
+
         this->profiled = true;
         this->schedule_valid = false;
         schedule();
@@ -88,6 +88,8 @@ public:
     long level;
     std::string index_list;
     int group;
+    /*! cost of the cluster when the current clustering was made. */
+    double scheduled_cost;
 
     TaskCluster()
     {
@@ -95,6 +97,7 @@ public:
         level = 0;
         index_list = "$";
         group = 0;
+        scheduled_cost = 0;
     }
 
     TaskType& add_task(const TaskType& task) {
@@ -134,7 +137,9 @@ public:
         }
     }
 
-    void profile_execute()
+    /*! Time every task. The new cost is weight*measured + (1-weight)*old cost,
+      so weight 1 replaces the old cost and smaller weights average over steps.*/
+    void profile_execute(double weight = 1.0)
     {
         this->cost = 0;
         double elapsed = 0;
@@ -149,7 +154,7 @@ public:
             // if(elapsed == 0)
                 // t_iter->cost = 0.0005;
             // else
-                t_iter->cost = elapsed;
+                t_iter->cost = (1 - weight)*t_iter->cost + weight*elapsed;
 
             this->cost += t_iter->cost;
 
@@ -233,6 +238,8 @@ public:
 
 private:
     long node_count;
+    /*! task ids each task depended on when it was added. Used to undo clustering. */
+    std::vector<std::vector<long> > task_parents;
 
 public:
 
@@ -265,6 +272,7 @@ public:
         ++node_count;
 
         int parent_count = 0;
+        task_parents.push_back(std::vector<long>());
         vertex_iterator vert_iter, vert_end;
         boost::tie(vert_iter, vert_end) = vertices(sys_graph);
         /*! skip the root node. */
@@ -279,6 +287,10 @@ public:
             if(found_dep) {
                 boost::add_edge(prev_clust_id,new_clust_id,sys_graph);
                 ++parent_count;
+
+                typename ClusterType::const_iterator task_iter;
+                for(task_iter = prev_clust.begin(); task_iter != prev_clust.end(); ++task_iter)
+                    task_parents.back().push_back(task_iter->task_id);
             }
         }
 
@@ -291,6 +303,50 @@ public:
 
     }
 
+    /*! Undo all clustering. Every task gets its own cluster again with the
+      dependencies it had when it was added. Task costs are kept, so the
+      clustering policies can be rerun on measured costs.*/
+    void split_clusters() {
+
+        std::vector<TaskType> tasks(node_count);
+        vertex_iterator vert_iter, vert_end;
+        boost::tie(vert_iter, vert_end) = vertices(sys_graph);
+        for ( ; vert_iter != vert_end; ++vert_iter) {
+            ClusterType& curr_clust = sys_graph[*vert_iter];
+            typename ClusterType::iterator task_iter;
+            for(task_iter = curr_clust.begin(); task_iter != curr_clust.end(); ++task_iter) {
+                if(task_iter->task_id >= 0)
+                    tasks[task_iter->task_id] = *task_iter;
+            }
+        }
+
+        sys_graph.clear();
+        active_nodes.clear();
+        clusters_by_level.clear();
+        total_cost = 0;
+
+        root_node_id = boost::add_vertex(sys_graph);
+        TaskType& root_node = sys_graph[root_node_id].add_task(TaskType());
+        root_node.task_id = -1;
+
+        std::vector<ClusterIdType> task_clusters(node_count);
+        for(long task_id = 0; task_id < node_count; ++task_id) {
+            ClusterIdType new_clust_id = boost::add_vertex(sys_graph);
+            active_nodes.insert(new_clust_id);
+            sys_graph[new_clust_id].add_task(tasks[task_id]);
+            task_clusters[task_id] = new_clust_id;
+            total_cost += tasks[task_id].cost;
+
+            const std::vector<long>& parents = task_parents[task_id];
+            if(parents.empty())
+                boost::add_edge(root_node_id, new_clust_id, sys_graph);
+            for(size_t i = 0; i < parents.size(); ++i)
+                boost::add_edge(task_clusters[parents[i]], new_clust_id, sys_graph);
+        }
+
+        levels_valid = false;
+    }
+
 public:
 
     void concat_same_level_clusters(const ClusterIdType& dest_id, const ClusterIdType& src_id) {
@@ -0,0 +1,499 @@
+#pragma once
+#ifndef idC4F55427_3BE6_4420_A8D11099003BA4BF
+#define idC4F55427_3BE6_4420_A8D11099003BA4BF
+
+/*
+ * This file is part of OpenModelica.
+ *
+ * Copyright (c) 1998-CurrentYear, Linköping University,
+ * Department of Computer and Information Science,
+ * SE-58183 Linköping, Sweden.
+ *
+ * All rights reserved.
+ *
+ * THIS PROGRAM IS PROVIDED UNDER THE TERMS OF GPL VERSION 3
+ * AND THIS OSMC PUBLIC LICENSE (OSMC-PL).
+ * ANY USE, REPRODUCTION OR DISTRIBUTION OF THIS PROGRAM CONSTITUTES RECIPIENT'S
+ * ACCEPTANCE OF THE OSMC PUBLIC LICENSE.
+ *
+ * The OpenModelica software and the Open Source Modelica
+ * Consortium (OSMC) Public License (OSMC-PL) are obtained
+ * from Linköping University, either from the above address,
+ * from the URLs: http://www.ida.liu.se/projects/OpenModelica or
+ * http://www.openmodelica.org, and in the OpenModelica distribution.
+ * GNU version 3 is obtained from: http://www.gnu.org/copyleft/gpl.html.
+ *
+ * This program is distributed WITHOUT ANY WARRANTY; without
+ * even the implied warranty of  MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE, EXCEPT AS EXPRESSLY SET FORTH
+ * IN THE BY RECIPIENT SELECTED SUBSIDIARY LICENSE CONDITIONS
+ * OF OSMC-PL.
+ *
+ * See the full OSMC Public License conditions for more details.
+ *
+ */
+
+
+
+
+/*
+ A light weight executor for clustered task systems. The clustered graph is
+ flattened once into CSR arrays. A fixed set of worker threads then runs the
+ ready clusters from per thread deques and steals from each other when idle.
+ Nothing is allocated or rebuilt per execution.
+*/
+
+#include <map>
+#include <vector>
+
+#include <tbb/atomic.h>
+#include <tbb/mutex.h>
+#include <tbb/spin_mutex.h>
+#include <tbb/compat/condition_variable>
+#include <tbb/tbb_thread.h>
+#include <tbb/tick_count.h>
+#include <tbb/task_scheduler_init.h>
+
+#include "pm_clustering.hpp"
+
+
+namespace openmodelica {
+namespace parmodelica {
+
+
+/*! Ready queue of one worker. The owner pushes and pops at the back, thieves
+  take from the front. Every cluster is pushed at most once per execution, so
+  the buffer never wraps and is just rewound before each execution.*/
+struct WorkStealingDeque :
+  boost::noncopyable {
+
+    tbb::spin_mutex lock;
+    std::vector<int> items;
+    tbb::atomic<int> head;
+    tbb::atomic<int> tail;
+
+    WorkStealingDeque(int capacity) :
+      items(capacity > 0 ? capacity : 1)
+    {
+        head = 0;
+        tail = 0;
+    }
+
+    void rewind() {
+        tbb::spin_mutex::scoped_lock l(lock);
+        head = 0;
+        tail = 0;
+    }
+
+    void push(int id) {
+        tbb::spin_mutex::scoped_lock l(lock);
+        items[tail] = id;
+        ++tail;
+    }
+
+    bool pop(int& id) {
+        if(head == tail)
+            return false;
+        tbb::spin_mutex::scoped_lock l(lock);
+        if(head == tail)
+            return false;
+        --tail;
+        id = items[tail];
+        return true;
+    }
+
+    bool steal(int& id) {
+        if(head == tail)
+            return false;
+        tbb::spin_mutex::scoped_lock l(lock);
+        if(head == tail)
+            return false;
+        id = items[head];
+        ++head;
+        return true;
+    }
+};
+
+
+
+template<typename TaskType,
+         typename clustetring1 = cluster_merge_common /* for now default here*/
+        >
+class WorkStealingScheduler :
+  boost::noncopyable {
+public:
+
+    typedef TaskSystem_v2<TaskType> TaskSystemType;
+    typedef typename TaskSystemType::GraphType GraphType;
+    typedef typename TaskSystemType::ClusterType ClusterType;
+    typedef typename TaskSystemType::ClusterIdType ClusterIdType;
+    typedef typename TaskSystemType::adjacency_iterator adjacency_iterator;
+    typedef typename TaskSystemType::inv_adjacency_iterator inv_adjacency_iterator;
+
+private:
+    struct WorkerLauncher {
+        WorkStealingScheduler* scheduler;
+        int worker_id;
+
+        WorkerLauncher(WorkStealingScheduler* s, int id) :
+          scheduler(s)
+          , worker_id(id)
+        {}
+
+        void operator()() const {
+            scheduler->worker_loop(worker_id);
+        }
+    };
+
+    TaskSystemType& task_system;
+    bool profiled;
+    bool schedule_valid;
+    int nr_of_workers;
+
+    /*! CSR form of the clustered graph. Clusters are numbered in topological order.*/
+    std::vector<ClusterType*> clusters;
+    std::vector<double> cluster_costs;
+    std::vector<int> succ_offsets;
+    std::vector<int> succ_ids;
+    std::vector<int> initial_pending;
+    std::vector<int> root_ids;
+    double total_cost;
+
+    /*! Number of unfinished parents per cluster. The thread that finishes the
+      last parent re-arms the counter, so there is no reset pass per execution.*/
+    std::vector<tbb::atomic<int> > pending;
+    tbb::atomic<long> remaining;
+    tbb::atomic<long> round;
+    tbb::atomic<bool> shutdown;
+
+    /*! idle workers block here once they have spun for idle_spin_time. */
+    tbb::mutex sleep_lock;
+    tbb::interface5::condition_variable wake_up;
+    tbb::atomic<int> nr_of_sleepers;
+
+    std::vector<WorkStealingDeque*> deques;
+    std::vector<tbb::tbb_thread*> workers;
+
+public:
+
+    PMTimer execution_timer;
+    PMTimer clustering_timer;
+
+    /*! Clusters cheaper than this (seconds, after profiling) are run directly by the
+      thread that made them ready instead of going through a deque.*/
+    double inline_cost_cutoff;
+    /*! Systems cheaper than this are run sequentially by the calling thread.*/
+    double sequential_cost_cutoff;
+    /*! How long (seconds) an idle worker keeps polling for the next execution
+      before it blocks. The solver usually asks again right away.*/
+    double idle_spin_time;
+
+    WorkStealingScheduler(TaskSystemType& ts) :
+      task_system(ts)
+      , nr_of_workers(tbb::task_scheduler_init::default_num_threads())
+    {
+        profiled = false;
+        schedule_valid = false;
+        total_cost = 0;
+        remaining = 0;
+        round = 0;
+        shutdown = false;
+        nr_of_sleepers = 0;
+        inline_cost_cutoff = 5e-6;
+        sequential_cost_cutoff = 2e-5;
+        idle_spin_time = 5e-5;
+    }
+
+    ~WorkStealingScheduler() {
+        stop_workers();
+        for(size_t i = 0; i < deques.size(); ++i)
+            delete deques[i];
+    }
+
+    void estimate_speedup() {
+
+        /*! longest cost weighted path through the graph. */
+        std::vector<double> start_cost(clusters.size(), 0.0);
+        double critical_path_cost = 0;
+        for(size_t i = 0; i < clusters.size(); ++i) {
+            double finish_cost = start_cost[i] + cluster_costs[i];
+            if(finish_cost > critical_path_cost)
+                critical_path_cost = finish_cost;
+            for(int s = succ_offsets[i]; s < succ_offsets[i + 1]; ++s) {
+                if(finish_cost > start_cost[succ_ids[s]])
+                    start_cost[succ_ids[s]] = finish_cost;
+            }
+        }
+
+        utility::log("") << "clusters: " << clusters.size() << ", edges: " << succ_ids.size()
+                         << ", workers: " << nr_of_workers << std::endl;
+        utility::log("") << "total_system_cost: " << total_cost << std::endl;
+        utility::log("") << "critical_path_cost: " << critical_path_cost << std::endl;
+        if(critical_path_cost > 0)
+            utility::log("") << "speedup: " << total_cost/critical_path_cost << std::endl;
+    }
+
+    void schedule() {
+
+        if(schedule_valid)
+            return;
+
+        clustering_timer.start_timer();
+
+        clustetring1::apply(task_system);
+        clustetring1::dump_graph(task_system);
+
+        /*! the CSR arrays point into the graph. Keep the workers away while they change. */
+        stop_workers();
+        flatten_graph();
+        start_workers();
+
+        schedule_valid = true;
+
+        estimate_speedup();
+        clustering_timer.stop_timer();
+    }
+
+
+    void execute()
+    {
+        if(!this->profiled)
+            return profile_execute();
+
+        execution_timer.start_timer();
+
+        if(workers.empty() || total_cost < sequential_cost_cutoff) {
+            /*! the clusters are in topological order. */
+            for(size_t i = 0; i < clusters.size(); ++i)
+                clusters[i]->execute();
+        }
+        else {
+            for(size_t i = 0; i < deques.size(); ++i)
+                deques[i]->rewind();
+
+            remaining = clusters.size();
+            for(size_t i = 0; i < root_ids.size(); ++i)
+                deques[i % deques.size()]->push(root_ids[i]);
+
+            ++round;
+            wake_workers();
+            /*! the calling thread is worker 0. */
+            run_worker(0);
+        }
+
+        execution_timer.stop_timer();
+    }
+
+
+    void profile_execute()
+    {
+        execution_timer.start_timer();
+
+        GraphType& sys_graph = task_system.sys_graph;
+
+        typename GraphType::vertex_iterator vert_iter, vert_end;
+        boost::tie(vert_iter, vert_end) = vertices(sys_graph);
+        /*! skip the root node. */
+        ++vert_iter;
+        for ( ; vert_iter != vert_end; ++vert_iter) {
+            sys_graph[*vert_iter].profile_execute();
+        }
+
+        execution_timer.stop_timer();
+
+        this->profiled = true;
+        this->schedule_valid = false;
+        schedule();
+    }
+
+private:
+
+    void flatten_graph() {
+
+        GraphType& sys_graph = task_system.sys_graph;
+        const ClusterIdType& root_node_id = task_system.root_node_id;
+
+        std::map<ClusterIdType, int> parent_counts;
+        std::map<ClusterIdType, int> unfinished_parents;
+        std::vector<ClusterIdType> order;
+
+        typename GraphType::vertex_iterator vert_iter, vert_end;
+        boost::tie(vert_iter, vert_end) = vertices(sys_graph);
+        for ( ; vert_iter != vert_end; ++vert_iter) {
+            const ClusterIdType& curr_clust_id = *vert_iter;
+            if(curr_clust_id == root_node_id)
+                continue;
+
+            int nr_of_parents = 0;
+            inv_adjacency_iterator par_iter, par_end;
+            boost::tie(par_iter, par_end) = inv_adjacent_vertices(curr_clust_id, sys_graph);
+            for(; par_iter != par_end; ++par_iter) {
+                if(*par_iter != root_node_id)
+                    ++nr_of_parents;
+            }
+
+            parent_counts[curr_clust_id] = nr_of_parents;
+            unfinished_parents[curr_clust_id] = nr_of_parents;
+            if(nr_of_parents == 0)
+                order.push_back(curr_clust_id);
+        }
+
+        /*! topological numbering (Kahn). order grows while we walk it. */
+        for(size_t i = 0; i < order.size(); ++i) {
+            ClusterIdType curr_clust_id = order[i];
+            adjacency_iterator child_iter, child_end;
+            boost::tie(child_iter, child_end) = adjacent_vertices(curr_clust_id, sys_graph);
+            for(; child_iter != child_end; ++child_iter) {
+                if(--unfinished_parents[*child_iter] == 0)
+                    order.push_back(*child_iter);
+            }
+        }
+
+        std::map<ClusterIdType, int> cluster_index;
+        for(size_t i = 0; i < order.size(); ++i)
+            cluster_index[order[i]] = i;
+
+        clusters.clear();
+        cluster_costs.clear();
+        succ_offsets.assign(1, 0);
+        succ_ids.clear();
+        initial_pending.clear();
+        root_ids.clear();
+        total_cost = 0;
+
+        for(size_t i = 0; i < order.size(); ++i) {
+            ClusterType& curr_clust = sys_graph[order[i]];
+            clusters.push_back(&curr_clust);
+            cluster_costs.push_back(curr_clust.cost);
+            total_cost += curr_clust.cost;
+
+            initial_pending.push_back(parent_counts[order[i]]);
+            if(initial_pending.back() == 0)
+                root_ids.push_back(i);
+
+            adjacency_iterator child_iter, child_end;
+            boost::tie(child_iter, child_end) = adjacent_vertices(order[i], sys_graph);
+            for(; child_iter != child_end; ++child_iter)
+                succ_ids.push_back(cluster_index[*child_iter]);
+            succ_offsets.push_back(succ_ids.size());
+        }
+
+        pending.resize(clusters.size());
+        for(size_t i = 0; i < clusters.size(); ++i)
+            pending[i] = initial_pending[i];
+
+        for(size_t i = 0; i < deques.size(); ++i)
+            delete deques[i];
+        deques.clear();
+        for(int i = 0; i < nr_of_workers; ++i)
+            deques.push_back(new WorkStealingDeque(clusters.size()));
+    }
+
+    void start_workers() {
+        shutdown = false;
+        for(int i = 1; i < nr_of_workers; ++i)
+            workers.push_back(new tbb::tbb_thread(WorkerLauncher(this, i)));
+    }
+
+    void stop_workers() {
+        shutdown = true;
+        wake_workers();
+        for(size_t i = 0; i < workers.size(); ++i) {
+            workers[i]->join();
+            delete workers[i];
+        }
+        workers.clear();
+    }
+
+    /*! Only pays for the lock when a worker actually went to sleep. round and
+      shutdown are changed before this, and a worker counts itself as a sleeper
+      before it checks them, so no wake up is lost.*/
+    void wake_workers() {
+        if(nr_of_sleepers > 0) {
+            tbb::interface5::unique_lock<tbb::mutex> l(sleep_lock);
+            wake_up.notify_all();
+        }
+    }
+
+    /*! Idle workers poll for a short while after an execution and then block
+      until the next one, so they do not compete with the solver between
+      evaluations and still start without a sleep quantum of delay.*/
+    void worker_loop(int worker_id) {
+        long seen_round = round;
+        while(!shutdown) {
+            if(round != seen_round) {
+                seen_round = round;
+                run_worker(worker_id);
+                continue;
+            }
+
+            tbb::tick_count idle_start = tbb::tick_count::now();
+            while(round == seen_round && !shutdown
+                  && (tbb::tick_count::now() - idle_start).seconds() < idle_spin_time)
+                tbb::this_tbb_thread::yield();
+
+            tbb::interface5::unique_lock<tbb::mutex> l(sleep_lock);
+            ++nr_of_sleepers;
+            while(round == seen_round && !shutdown)
+                wake_up.wait(l);
+            --nr_of_sleepers;
+        }
+    }
+
+    void run_worker(int worker_id) {
+        WorkStealingDeque& own = *deques[worker_id];
+        int nr_of_deques = deques.size();
+        int cluster_id;
+
+        while(remaining > 0) {
+            if(own.pop(cluster_id)) {
+                run_cluster(worker_id, cluster_id);
+                continue;
+            }
+
+            bool found = false;
+            for(int i = 1; i < nr_of_deques && !found; ++i)
+                found = deques[(worker_id + i) % nr_of_deques]->steal(cluster_id);
+
+            if(found)
+                run_cluster(worker_id, cluster_id);
+            else
+                tbb::this_tbb_thread::yield();
+        }
+    }
+
+    void run_cluster(int worker_id, int cluster_id) {
+        WorkStealingDeque& own = *deques[worker_id];
+
+        while(cluster_id >= 0) {
+            clusters[cluster_id]->execute();
+
+            int next_id = -1;
+            for(int s = succ_offsets[cluster_id]; s < succ_offsets[cluster_id + 1]; ++s) {
+                int succ_id = succ_ids[s];
+                if(pending[succ_id].fetch_and_decrement() == 1) {
+                    pending[succ_id] = initial_pending[succ_id];
+                    /*! tiny clusters are not worth a trip through the deque. */
+                    if(next_id < 0 && cluster_costs[succ_id] < inline_cost_cutoff)
+                        next_id = succ_id;
+                    else
+                        own.push(succ_id);
+                }
+            }
+
+            --remaining;
+            cluster_id = next_id;
+        }
+    }
+
+};
+
+
+
+} // parmodelica
+} // openmodelica
+
+
+
+
+#endif // header
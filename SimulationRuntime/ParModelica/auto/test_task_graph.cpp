@@ -44,10 +44,42 @@
 
 #include "pm_cluster_system.hpp"
 #include "pm_cluster_level_scheduler.hpp"
+#include "pm_cluster_dynamic_scheduler.hpp"
+#include "pm_cluster_worksteal_scheduler.hpp"
+
+#include <cmath>
+#include <cstdlib>
 
 
 using namespace openmodelica::parmodelica;
 
+/*! Work done by each stand-in equation. Set with the third argument. */
+static int equation_work = 200;
+
+/*! Stand-in for a generated equation function, so the schedulers can be run
+  without a compiled model.*/
+static void synthetic_equation(DATA*, threadData_t*) {
+    volatile double acc = 0;
+    for(int i = 0; i < equation_work; ++i)
+        acc += std::sqrt((double)i);
+}
+
+/*! Average time of one execution, after the scheduler has profiled and
+  clustered the system in its first executions.*/
+template<typename SchedulerType>
+double time_executions(SchedulerType& scheduler, int nr_of_runs) {
+    for(int i = 0; i < 20; ++i)
+        scheduler.execute();
+
+    PMTimer timer;
+    timer.start_timer();
+    for(int i = 0; i < nr_of_runs; ++i)
+        scheduler.execute();
+    timer.stop_timer();
+
+    return timer.get_elapsed_time()/nr_of_runs;
+}
+
 
 int main(int argc, char** argv) {
 
@@ -57,15 +89,20 @@ int main(int argc, char** argv) {
     std::cout << "Reading file: " << xml_file << std::endl;
 
     std::string eq_to_read;
-    if(argc == 3) {
+    if(argc >= 3) {
         eq_to_read = argv[2];
         std::cout << "Reading eqs: " << eq_to_read << std::endl;
     }
     else
         eq_to_read = "ode-equations";
 
+    if(argc >= 4)
+        equation_work = std::atoi(argv[3]);
+
     TaskSystem_v2<Equation> task_system;
     task_system.load_from_xml(xml_file, eq_to_read);
+    /*! one equation per vertex, except the root, before anything is clustered. */
+    std::vector<Equation::FunctionType> functions(num_vertices(task_system.sys_graph) - 1, synthetic_equation);
 
     // task_system.cluster_merge_level_parents();
     // task_system.cluster_merge_single_parent();
@@ -89,6 +126,52 @@ int main(int argc, char** argv) {
     // level_scheduler.schedule(4);
     // level_scheduler.print_schedule(std::cout);
 
+    /*! Run the same graph with every cluster scheduler. The equations are
+      loaded through OMModel, which expects the <Model>_tasks.xml the compiler
+      writes.*/
+    const std::string suffix = "_tasks.xml";
+    if(xml_file.size() <= suffix.size() || xml_file.compare(xml_file.size() - suffix.size(), suffix.size(), suffix) != 0) {
+        std::cout << "Execution benchmark skipped, expected a <Model>" << suffix << " file." << std::endl;
+        std::cout << utility::log_stream.str();
+        return 0;
+    }
+    std::string model_name = xml_file.substr(0, xml_file.size() - suffix.size());
+
+    OMModel model;
+    model.initialize(model_name.c_str(), NULL, NULL, &functions[0]);
+    const int nr_of_runs = 1000;
+
+    PMTimer seq_timer;
+    seq_timer.start_timer();
+    for(int i = 0; i < nr_of_runs; ++i)
+        for(size_t f = 0; f < functions.size(); ++f)
+            functions[f](NULL, NULL);
+    seq_timer.stop_timer();
+
+    TaskSystem_v2<Equation> exec_task_system;
+    model.load_from_xml(exec_task_system, eq_to_read, &functions[0]);
+    StepLevels<Equation> exec_level_scheduler(exec_task_system);
+    double level_time = time_executions(exec_level_scheduler, nr_of_runs);
+
+    TaskSystem_v2<Equation> tbb_task_system;
+    model.load_from_xml(tbb_task_system, eq_to_read, &functions[0]);
+    ClusterDynamicScheduler<Equation> tbb_scheduler(tbb_task_system);
+    tbb_scheduler.schedule();
+    double tbb_time = time_executions(tbb_scheduler, nr_of_runs);
+
+    TaskSystem_v2<Equation> ws_task_system;
+    model.load_from_xml(ws_task_system, eq_to_read, &functions[0]);
+    WorkStealingScheduler<Equation> ws_scheduler(ws_task_system);
+    double ws_time = time_executions(ws_scheduler, nr_of_runs);
+
+    utility::log("") << "Sequential execution: " << seq_timer.get_elapsed_time()/nr_of_runs << std::endl;
+    utility::log("") << "Level scheduler execution: " << level_time
+                     << ", setup: " << exec_level_scheduler.clustering_timer.get_elapsed_time() << std::endl;
+    utility::log("") << "TBB flow graph scheduler execution: " << tbb_time
+                     << ", setup: " << tbb_scheduler.clustering_timer.get_elapsed_time() << std::endl;
+    utility::log("") << "Work stealing scheduler execution: " << ws_time
+                     << ", setup: " << ws_scheduler.clustering_timer.get_elapsed_time() << std::endl;
+
     std::cout << utility::log_stream.str();
     // std::cout << "system cost = " << task_system.total_cost << std::endl;
     // std::cout << "scheduler cost = " << level_scheduler.total_parallel_cost << std::endl;
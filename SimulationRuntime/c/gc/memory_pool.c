@@ -47,90 +47,240 @@ static int GC_collect_a_little_or_not(void)
   return 0;
 }
 
-typedef struct list_s {
-  void *memory;
+/* Every thread allocates from its own arena, a stack of chunks that is
+ * grown on demand and rolled back by omc_pool_release. Chunk sizes are
+ * rounded up to size classes (POOL_MIN_CHUNK << class) and chunks that are
+ * released are kept per class, so a function that marks and releases the
+ * pool in a loop reuses the same memory without calling malloc again.
+ *
+ * collect_a_little (pool_free) only resets the arena of the calling thread,
+ * so simulations running on other threads of the process are not affected.
+ * Threads that evaluate equations for someone else (HPCOM, ParModelica and
+ * Jacobian workers) never call it; they release their temporaries with a
+ * mark around each task instead.
+ */
+#define POOL_MIN_CHUNK (64*1024)
+#define POOL_NUM_CLASSES 16
+#define POOL_MAX_FREE_PER_CLASS 2
+
+typedef struct pool_chunk_s {
+  struct pool_chunk_s *next; /* chunk below in the arena, or next cached chunk of the same class */
+  size_t size;               /* usable bytes after the header */
   size_t used;
-  size_t size;
-  struct list_s *next;
-} list;
+  int sizeClass;             /* -1 for chunks larger than the largest class */
+} pool_chunk;
+
+typedef struct {
+  pool_chunk *current;
+  pool_chunk *freeChunks[POOL_NUM_CLASSES];
+  int nFreeChunks[POOL_NUM_CLASSES];
+  size_t inUse;
+  size_t highWater;
+  size_t reserved;
+  unsigned long chunkAllocations;
+  unsigned long epoch;       /* number of resets, marks of an older epoch are void */
+} pool_arena;
+
+static inline size_t round_up(size_t num, size_t factor)
+{
+  return num + factor - 1 - (num - 1) % factor;
+}
+
+#define POOL_HEADER_SIZE round_up(sizeof(pool_chunk), 16)
+#define POOL_CHUNK_MEMORY(chunk) ((char*)(chunk) + POOL_HEADER_SIZE)
+
+static void pool_arena_free(void *ptr)
+{
+  pool_arena *arena = (pool_arena*) ptr;
+  pool_chunk *chunk, *next;
+  int i;
+  for (chunk = arena->current; chunk; chunk = next) {
+    next = chunk->next;
+    free(chunk);
+  }
+  for (i=0; i<POOL_NUM_CLASSES; i++) {
+    for (chunk = arena->freeChunks[i]; chunk; chunk = next) {
+      next = chunk->next;
+      free(chunk);
+    }
+  }
+  free(arena);
+}
 
 #if !defined(OMC_NO_THREADS)
-static pthread_mutex_t memory_pool_mutex = PTHREAD_MUTEX_INITIALIZER;
-#endif
-static list *memory_pools = NULL;
+static pthread_key_t pool_arena_key;
+static pthread_once_t pool_arena_once = PTHREAD_ONCE_INIT;
 
-static void pool_init(void)
+static void pool_create_key(void)
 {
-  memory_pools = (list*) malloc(sizeof(list));
-  memory_pools->used = 0;
-  memory_pools->size = 2*1024*1024; /* 2MB pool by default */
-  memory_pools->memory = malloc(memory_pools->size);
-  memory_pools->next = NULL;
+  pthread_key_create(&pool_arena_key, pool_arena_free);
 }
+#else
+static pool_arena *pool_arena_global = NULL;
+#endif
 
-static unsigned long upper_power_of_two(unsigned long v)
+/* returns the arena of the calling thread, allocating it on first use */
+static pool_arena* pool_get_arena(void)
 {
-  v--;
-  v |= v >> 1;
-  v |= v >> 2;
-  v |= v >> 4;
-  v |= v >> 8;
-  v |= v >> 16;
-  v++;
-  return v;
+  pool_arena *arena;
+#if !defined(OMC_NO_THREADS)
+  pthread_once(&pool_arena_once, pool_create_key);
+  arena = (pool_arena*) pthread_getspecific(pool_arena_key);
+#else
+  arena = pool_arena_global;
+#endif
+  if (arena) {
+    return arena;
+  }
+  arena = (pool_arena*) mmc_check_out_of_memory(calloc(1, sizeof(pool_arena)));
+#if !defined(OMC_NO_THREADS)
+  pthread_setspecific(pool_arena_key, arena);
+#else
+  pool_arena_global = arena;
+#endif
+  return arena;
 }
 
-static inline size_t round_up(size_t num, size_t factor)
+static void pool_init(void)
 {
-  return num + factor - 1 - (num - 1) % factor;
+  pool_get_arena();
 }
 
-static inline void pool_expand(size_t len)
+/* removes the top chunk from the arena and caches or frees it */
+static void pool_pop_chunk(pool_arena *arena)
 {
-  list *newlist = NULL;
-  if (0==memory_pools) {
-    pool_init();
+  pool_chunk *chunk = arena->current;
+  arena->current = chunk->next;
+  if (chunk->sizeClass >= 0 && arena->nFreeChunks[chunk->sizeClass] < POOL_MAX_FREE_PER_CLASS) {
+    chunk->next = arena->freeChunks[chunk->sizeClass];
+    arena->freeChunks[chunk->sizeClass] = chunk;
+    arena->nFreeChunks[chunk->sizeClass]++;
+  } else {
+    arena->reserved -= chunk->size;
+    free(chunk);
   }
+}
+
+static inline void pool_expand(pool_arena *arena, size_t len)
+{
+  pool_chunk *chunk;
+  int sizeClass = arena->current ? arena->current->sizeClass + 1 : 0;
   /* Check if we have enough memory already */
-  if (memory_pools->size - memory_pools->used >= len) {
+  if (arena->current && arena->current->size - arena->current->used >= len) {
     return;
   }
-  newlist = (list*) malloc(sizeof(list));
-  newlist->next = memory_pools;
-  memory_pools = newlist;
-  memory_pools->used = 0;
-  memory_pools->size = upper_power_of_two(3*memory_pools->next->size/2 + len); /* expand by 1.5x the old memory pool. More if we request a very large array. */
-  memory_pools->memory = malloc(memory_pools->size);
+  /* double the chunk size each time, more if we request a very large array */
+  if (sizeClass < 0 || sizeClass >= POOL_NUM_CLASSES) {
+    sizeClass = POOL_NUM_CLASSES-1;
+  }
+  while (sizeClass < POOL_NUM_CLASSES && ((size_t)POOL_MIN_CHUNK << sizeClass) < len) {
+    sizeClass++;
+  }
+  if (sizeClass < POOL_NUM_CLASSES && arena->freeChunks[sizeClass]) {
+    chunk = arena->freeChunks[sizeClass];
+    arena->freeChunks[sizeClass] = chunk->next;
+    arena->nFreeChunks[sizeClass]--;
+  } else {
+    size_t size = sizeClass < POOL_NUM_CLASSES ? ((size_t)POOL_MIN_CHUNK << sizeClass) : len;
+    chunk = (pool_chunk*) mmc_check_out_of_memory(malloc(POOL_HEADER_SIZE + size));
+    chunk->size = size;
+    chunk->sizeClass = sizeClass < POOL_NUM_CLASSES ? sizeClass : -1;
+    arena->reserved += size;
+    arena->chunkAllocations++;
+  }
+  chunk->used = 0;
+  chunk->next = arena->current;
+  arena->current = chunk;
 }
 
-static void* pool_malloc(size_t sz)
+static inline void* pool_alloc(size_t sz)
 {
+  pool_arena *arena = pool_get_arena();
   void *res;
   sz = round_up(sz,8);
-#if !defined(OMC_NO_THREADS)
-  pthread_mutex_lock(&memory_pool_mutex);
-#endif
-  pool_expand(sz);
-  res = (void*)((char*)memory_pools->memory + memory_pools->used);
-  memory_pools->used += sz;
-#if !defined(OMC_NO_THREADS)
-  pthread_mutex_unlock(&memory_pool_mutex);
-#endif
-  memset(res,0,sz);
+  pool_expand(arena, sz);
+  res = (void*)(POOL_CHUNK_MEMORY(arena->current) + arena->current->used);
+  arena->current->used += sz;
+  arena->inUse += sz;
+  if (arena->inUse > arena->highWater) {
+    arena->highWater = arena->inUse;
+  }
   return res;
 }
 
-static int pool_free(void)
+/* like GC_malloc: the memory may hold pointers and is cleared */
+static void* pool_malloc(size_t sz)
+{
+  void *res = pool_alloc(sz);
+  memset(res,0,round_up(sz,8));
+  return res;
+}
+
+/* like GC_malloc_atomic: the caller initializes the memory */
+static void* pool_malloc_atomic(size_t sz)
+{
+  return pool_alloc(sz);
+}
+
+omc_pool_mark_t omc_pool_mark(void)
 {
-  list *freelist = memory_pools->next;
-  while (freelist) {
-    list *next = freelist->next;
-    free(freelist->memory);
-    free(freelist);
-    freelist = next;
+  pool_arena *arena = pool_get_arena();
+  omc_pool_mark_t mark;
+  mark.chunk = arena->current;
+  mark.used = arena->current ? arena->current->used : 0;
+  mark.inUse = arena->inUse;
+  mark.epoch = arena->epoch;
+  return mark;
+}
+
+void omc_pool_release(omc_pool_mark_t mark)
+{
+  pool_arena *arena = pool_get_arena();
+  if (arena->epoch != mark.epoch) {
+    /* everything allocated after the mark is already gone */
+    return;
   }
-  memory_pools->used = 0;
-  memory_pools->next = 0;
+  while (arena->current && arena->current != mark.chunk) {
+    pool_pop_chunk(arena);
+  }
+  if (arena->current) {
+    arena->current->used = mark.used;
+  }
+  arena->inUse = mark.inUse;
+}
+
+void omc_pool_statistics(size_t *inUse, size_t *highWater, size_t *reserved, unsigned long *chunkAllocations)
+{
+  pool_arena *arena = pool_get_arena();
+  if (inUse) *inUse = arena->inUse;
+  if (highWater) *highWater = arena->highWater;
+  if (reserved) *reserved = arena->reserved;
+  if (chunkAllocations) *chunkAllocations = arena->chunkAllocations;
+}
+
+/* releases everything allocated from the arena, but keeps the largest chunk
+ * for the next round */
+static void pool_reset_arena(pool_arena *arena)
+{
+  pool_chunk *largest = arena->current;
+  arena->epoch++;
+  if (!largest) {
+    return;
+  }
+  arena->current = largest->next;
+  while (arena->current) {
+    pool_pop_chunk(arena);
+  }
+  largest->next = NULL;
+  largest->used = 0;
+  arena->current = largest;
+  arena->inUse = 0;
+}
+
+/* releases everything the calling thread allocated from its pool */
+static int pool_free(void)
+{
+  pool_reset_arena(pool_get_arena());
   return 0;
 }
 
@@ -145,7 +295,7 @@ static void* malloc_zero(size_t sz) {
 omc_alloc_interface_t omc_alloc_interface_pooled = {
   pool_init,
   pool_malloc,
-  pool_malloc,
+  pool_malloc_atomic,
   (char*(*)(size_t)) malloc,
   strdup,
   pool_free,
@@ -212,7 +362,7 @@ omc_alloc_interface_t omc_alloc_interface = {
 #else
   pool_init,
   pool_malloc,
-  pool_malloc,
+  pool_malloc_atomic,
   (char*(*)(size_t)) malloc,
   strdup,
   pool_free,
@@ -48,6 +48,27 @@ extern _index_t** index_alloc(int n);
 
 void* generic_alloc(int n, size_t sze);
 
+/* Mark/release scopes of the pooled allocator (omc_alloc_interface_pooled).
+ * Each thread has its own pool; a mark is only valid in the thread that
+ * took it and releases have to be nested like the marks. A mark taken
+ * before collect_a_little is void, releasing it does nothing:
+ *
+ *   omc_pool_mark_t mark = omc_pool_mark();
+ *   ... temporaries from real_alloc, generic_alloc, ...
+ *   omc_pool_release(mark);
+ */
+typedef struct {
+  void *chunk;
+  size_t used;
+  size_t inUse;
+  unsigned long epoch;
+} omc_pool_mark_t;
+
+omc_pool_mark_t omc_pool_mark(void);
+void omc_pool_release(omc_pool_mark_t mark);
+/* bytes currently handed out, their maximum so far, bytes held in chunks and number of chunk mallocs of the calling thread */
+void omc_pool_statistics(size_t *inUse, size_t *highWater, size_t *reserved, unsigned long *chunkAllocations);
+
 #if defined(__cplusplus)
 } /* end extern "C" */
 #endif
@@ -0,0 +1,207 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "util/real_array.h"
+#include "util/rtclock.h"
+
+/* Compares the matrix kernels of real_array.c with the plain triple loops they
+ * replaced, over a range of sizes. Returns non-zero if the results differ. */
+
+#define POWER 12
+
+/* forward declarations */
+static void ref_matrix_product(const real_array_t *a, const real_array_t *b, real_array_t *dest);
+static void ref_matrix_vector(const real_array_t *a, const real_array_t *b, real_array_t *dest);
+static void ref_transpose(const real_array_t *a, const real_array_t *unused, real_array_t *dest);
+static void ref_matrix_power(const real_array_t *a, const real_array_t *scratch, real_array_t *dest);
+static void fill_random(real_array_t *a, double scale);
+static double max_rel_diff(const real_array_t *a, const real_array_t *b);
+static int bench_size(int n);
+
+/* main */
+int main()
+{
+  static const int sizes[] = {3, 8, 16, 32, 64, 128, 256, 512};
+  int i;
+  int rc;
+
+  omc_alloc_interface.init();
+  srand(42);
+  printf("%-16s %6s %12s %12s %8s\n", "kernel", "n", "old [s]", "new [s]", "speedup");
+  for (i = 0; i < (int)(sizeof(sizes)/sizeof(sizes[0])); ++i) {
+    if ((rc = bench_size(sizes[i])) != 0) return 1000*(i+1)+rc;
+  }
+
+  /* everything OK */
+  return 0;
+}
+
+/* number of repetitions for about 2e8 floating point operations */
+static int repetitions(double flops)
+{
+  int reps = (int)(2e8 / flops);
+  return reps < 1 ? 1 : reps;
+}
+
+/* Seconds per call. The kernel is called through a volatile pointer, so the
+ * reference loops in this file are not inlined while the runtime kernels are
+ * plain calls into the library. */
+static double time_kernel(void (*volatile kernel)(const real_array_t*, const real_array_t*, real_array_t*),
+                          const real_array_t *a, const real_array_t *b, real_array_t *dest, int reps)
+{
+  rtclock_t clock;
+  int r;
+
+  rt_ext_tp_tick(&clock);
+  for (r = 0; r < reps; ++r) kernel(a, b, dest);
+  return rt_ext_tp_tock(&clock)/reps;
+}
+
+static void report(const char *kernel, int n, double t_old, double t_new)
+{
+  printf("%-16s %6d %12.3e %12.3e %8.2f\n", kernel, n, t_old, t_new, t_old/t_new);
+}
+
+static void new_transpose(const real_array_t *a, const real_array_t *unused, real_array_t *dest)
+{
+  transpose_real_array(a, dest);
+}
+
+static void new_matrix_power(const real_array_t *a, const real_array_t *unused, real_array_t *dest)
+{
+  exp_real_array(a, POWER, dest);
+}
+
+static int bench_size(int n)
+{
+  real_array_t a, b, c_old, c_new, v, w_old, w_new;
+  double t_old, t_new;
+  int reps;
+
+  simple_alloc_2d_real_array(&a, n, n);
+  simple_alloc_2d_real_array(&b, n, n);
+  simple_alloc_2d_real_array(&c_old, n, n);
+  simple_alloc_2d_real_array(&c_new, n, n);
+  simple_alloc_1d_real_array(&v, n);
+  simple_alloc_1d_real_array(&w_old, n);
+  simple_alloc_1d_real_array(&w_new, n);
+  /* keep A^POWER bounded */
+  fill_random(&a, 1.0/n);
+  fill_random(&b, 1.0);
+  fill_random(&v, 1.0);
+
+  /* A*B */
+  reps = repetitions(2.0*n*n*n);
+  t_old = time_kernel(ref_matrix_product, &a, &b, &c_old, reps);
+  t_new = time_kernel(mul_real_matrix_product, &a, &b, &c_new, reps);
+  report("matrix*matrix", n, t_old, t_new);
+  /* same summation order */
+  if (max_rel_diff(&c_old, &c_new) != 0) return 1;
+
+  /* A*v */
+  reps = repetitions(2.0*n*n);
+  t_old = time_kernel(ref_matrix_vector, &a, &v, &w_old, reps);
+  t_new = time_kernel(mul_real_matrix_vector, &a, &v, &w_new, reps);
+  report("matrix*vector", n, t_old, t_new);
+  if (max_rel_diff(&w_old, &w_new) > 1e-12) return 2;
+
+  /* transpose(B) */
+  reps = repetitions(1.0*n*n);
+  t_old = time_kernel(ref_transpose, &b, NULL, &c_old, reps);
+  t_new = time_kernel(new_transpose, &b, NULL, &c_new, reps);
+  report("transpose", n, t_old, t_new);
+  if (max_rel_diff(&c_old, &c_new) != 0) return 3;
+
+  /* A^POWER, b is the scratch matrix of the old loop */
+  reps = repetitions(2.0*n*n*n*(POWER-1));
+  t_old = time_kernel(ref_matrix_power, &a, &b, &c_old, reps);
+  t_new = time_kernel(new_matrix_power, &a, NULL, &c_new, reps);
+  report("matrix^12", n, t_old, t_new);
+  /* squaring rounds differently */
+  if (max_rel_diff(&c_old, &c_new) > 1e-9) return 4;
+
+  /* the arrays are collected by the GC */
+  return 0;
+}
+
+/* the loops of real_array.c before the kernels were blocked */
+static void ref_matrix_product(const real_array_t *a, const real_array_t *b, real_array_t *dest)
+{
+  size_t i, j, k;
+  size_t i_size = dest->dim_size[0];
+  size_t j_size = dest->dim_size[1];
+  size_t k_size = a->dim_size[1];
+  modelica_real tmp;
+
+  for (i = 0; i < i_size; ++i) {
+    for (j = 0; j < j_size; ++j) {
+      tmp = 0;
+      for (k = 0; k < k_size; ++k) {
+        tmp += real_get(*a, (i * k_size) + k)*real_get(*b, (k * j_size) + j);
+      }
+      ((modelica_real *) dest->data)[(i * j_size) + j] = tmp;
+    }
+  }
+}
+
+static void ref_matrix_vector(const real_array_t *a, const real_array_t *b, real_array_t *dest)
+{
+  size_t i, j;
+  size_t i_size = a->dim_size[0];
+  size_t j_size = a->dim_size[1];
+  modelica_real tmp;
+
+  for (i = 0; i < i_size; ++i) {
+    tmp = 0;
+    for (j = 0; j < j_size; ++j) {
+      tmp += real_get(*a, (i * j_size) + j) * real_get(*b, j);
+    }
+    ((modelica_real *) dest->data)[i] = tmp;
+  }
+}
+
+static void ref_transpose(const real_array_t *a, const real_array_t *unused, real_array_t *dest)
+{
+  size_t i, j;
+  size_t n = a->dim_size[0];
+  size_t m = a->dim_size[1];
+
+  for (i = 0; i < n; ++i) {
+    for (j = 0; j < m; ++j) {
+      ((modelica_real *) dest->data)[(j * n) + i] = real_get(*a, (i * m) + j);
+    }
+  }
+}
+
+/* A^POWER as POWER-1 products, which the old exp_real_array did */
+static void ref_matrix_power(const real_array_t *a, const real_array_t *scratch, real_array_t *dest)
+{
+  int p;
+
+  copy_real_array_data(*a, dest);
+  for (p = 1; p < POWER; ++p) {
+    ref_matrix_product(dest, a, (real_array_t *) scratch);
+    copy_real_array_data(*scratch, dest);
+  }
+}
+
+static void fill_random(real_array_t *a, double scale)
+{
+  size_t i, n = base_array_nr_of_elements(*a);
+  for (i = 0; i < n; ++i) {
+    ((modelica_real *) a->data)[i] = scale * ((double)rand()/RAND_MAX - 0.5);
+  }
+}
+
+static double max_rel_diff(const real_array_t *a, const real_array_t *b)
+{
+  size_t i, n = base_array_nr_of_elements(*a);
+  double diff = 0, scale = 0;
+  for (i = 0; i < n; ++i) {
+    double x = real_get(*a, i), y = real_get(*b, i);
+    if (fabs(x - y) > diff) diff = fabs(x - y);
+    if (fabs(x) > scale) scale = fabs(x);
+  }
+  return scale > 0 ? diff/scale : diff;
+}
@@ -41,21 +41,85 @@
 #include "util/omc_error.h"
 #include "simulation_result_csv.h"
 #include "util/rtclock.h"
+#include "util/omc_dtoa.h"
+#include "util/libcsv.h"
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <errno.h>
 #include <string.h>
 #include <time.h>
 
 extern "C" {
 
+/* Rows are formatted into one large buffer that is written with a single
+ * fwrite on an unbuffered stream whenever there is no room left for
+ * another row.
+ */
+#define CSV_BLOCK_SIZE (1024*1024)
+
+typedef struct csv_writer {
+  FILE *fout;
+  char *buffer;
+  size_t size;
+  size_t used;
+  size_t maxLineLength;  /* upper bound for the length of one row */
+} csv_writer;
+
+static void csv_flush(csv_writer *csvData)
+{
+  if (csvData->used) {
+    fwrite(csvData->buffer, 1, csvData->used, csvData->fout);
+    csvData->used = 0;
+  }
+}
+
+/* make room for n more characters */
+static void csv_reserve(csv_writer *csvData, size_t n)
+{
+  if (csvData->size - csvData->used >= n) {
+    return;
+  }
+  csv_flush(csvData);
+  if (csvData->size < n) {
+    csvData->size = n;
+    csvData->buffer = (char*) realloc(csvData->buffer, n);
+  }
+}
+
+static inline void csv_real(csv_writer *csvData, double value)
+{
+  csvData->buffer[csvData->used++] = ',';
+  csvData->used += omc_dtoa_shortest(value, csvData->buffer + csvData->used);
+}
+
+static inline void csv_int(csv_writer *csvData, int value)
+{
+  csvData->buffer[csvData->used++] = ',';
+  csvData->used += omc_itoa(value, csvData->buffer + csvData->used);
+}
+
+static inline void csv_bool(csv_writer *csvData, int value)
+{
+  csvData->buffer[csvData->used++] = ',';
+  csvData->buffer[csvData->used++] = value ? '1' : '0';
+}
+
+/* quoted and escaped like libcsv */
+static void csv_name(csv_writer *csvData, const char *name, int first)
+{
+  size_t len = strlen(name);
+  size_t n = csv_write(NULL, 0, name, len);
+  csv_reserve(csvData, n+1);
+  if (!first) {
+    csvData->buffer[csvData->used++] = ',';
+  }
+  csvData->used += csv_write(csvData->buffer + csvData->used, n, name, len);
+}
+
 void omc_csv_emit(simulation_result *self, DATA *data, threadData_t *threadData)
 {
-  FILE *fout = (FILE*) self->storage;
-  const char* format = ",%.16g";
-  const char* formatint = ",%i";
-  const char* formatbool = ",%i";
-  const char* formatstring = ",\"%s\"";
+  csv_writer *csvData = (csv_writer*) self->storage;
   int i;
   modelica_real value = 0;
   double cpuTimeValue = 0;
@@ -65,17 +129,16 @@ void omc_csv_emit(simulation_result *self, DATA *data, threadData_t *threadData)
   cpuTimeValue = rt_accumulated(SIM_TIMER_TOTAL);
   rt_tick(SIM_TIMER_TOTAL);
 
-  fprintf(fout, "%.16g", data->localData[0]->timeValue);
+  csv_reserve(csvData, csvData->maxLineLength);
+  csvData->used += omc_dtoa_shortest(data->localData[0]->timeValue, csvData->buffer + csvData->used);
   if(self->cpuTime)
-    fprintf(fout, format, cpuTimeValue);
+    csv_real(csvData, cpuTimeValue);
   for(i = 0; i < data->modelData->nVariablesReal; i++) if(!data->modelData->realVarsData[i].filterOutput)
-    fprintf(fout, format, (data->localData[0])->realVars[i]);
+    csv_real(csvData, (data->localData[0])->realVars[i]);
   for(i = 0; i < data->modelData->nVariablesInteger; i++) if(!data->modelData->integerVarsData[i].filterOutput)
-    fprintf(fout, formatint, (data->localData[0])->integerVars[i]);
+    csv_int(csvData, (data->localData[0])->integerVars[i]);
   for(i = 0; i < data->modelData->nVariablesBoolean; i++) if(!data->modelData->booleanVarsData[i].filterOutput)
-    fprintf(fout, formatbool, (data->localData[0])->booleanVars[i]);
-  //for(i = 0; i < data->modelData->nVariablesString; i++) if(!data->modelData->stringVarsData[i].filterOutput)
-  //  fprintf(fout, formatstring, MMC_STRINGDATA((data->localData[0])->stringVars[i]));
+    csv_bool(csvData, (data->localData[0])->booleanVars[i]);
 
   for(i = 0; i < data->modelData->nAliasReal; i++) if(!data->modelData->realAlias[i].filterOutput && data->modelData->realAlias[i].aliasType != 1) {
     if (data->modelData->realAlias[i].aliasType == 2) {
@@ -83,31 +146,23 @@ void omc_csv_emit(simulation_result *self, DATA *data, threadData_t *threadData)
     } else {
       value = (data->localData[0])->realVars[data->modelData->realAlias[i].nameID];
     }
-    if (data->modelData->realAlias[i].negate) {
-      fprintf(fout, format, -value);
-    } else {
-      fprintf(fout, format, value);
-    }
+    csv_real(csvData, data->modelData->realAlias[i].negate ? -value : value);
   }
   for(i = 0; i < data->modelData->nAliasInteger; i++) if(!data->modelData->integerAlias[i].filterOutput && data->modelData->integerAlias[i].aliasType != 1) {
     if (data->modelData->integerAlias[i].negate) {
-      fprintf(fout, formatint, -(data->localData[0])->integerVars[data->modelData->integerAlias[i].nameID]);
+      csv_int(csvData, -(data->localData[0])->integerVars[data->modelData->integerAlias[i].nameID]);
     } else {
-      fprintf(fout, formatint, (data->localData[0])->integerVars[data->modelData->integerAlias[i].nameID]);
+      csv_int(csvData, (data->localData[0])->integerVars[data->modelData->integerAlias[i].nameID]);
     }
   }
   for(i = 0; i < data->modelData->nAliasBoolean; i++) if(!data->modelData->booleanAlias[i].filterOutput && data->modelData->booleanAlias[i].aliasType != 1) {
     if (data->modelData->booleanAlias[i].negate) {
-      fprintf(fout, formatbool, (data->localData[0])->booleanVars[data->modelData->booleanAlias[i].nameID]==1?0:1);
+      csv_bool(csvData, (data->localData[0])->booleanVars[data->modelData->booleanAlias[i].nameID]==1?0:1);
     } else {
-      fprintf(fout, formatbool, (data->localData[0])->booleanVars[data->modelData->booleanAlias[i].nameID]);
+      csv_bool(csvData, (data->localData[0])->booleanVars[data->modelData->booleanAlias[i].nameID]);
     }
   }
-  //for(i = 0; i < data->modelData->nAliasString; i++) if(!data->modelData->stringAlias[i].filterOutput && data->modelData->stringAlias[i].aliasType != 1) {
-  //  /* there would no negation of a string happen */
-  //  fprintf(fout, formatstring, MMC_STRINGDATA((data->localData[0])->stringVars[data->modelData->stringAlias[i].nameID]));
-  //}
-  fprintf(fout, "\n");
+  csvData->buffer[csvData->used++] = '\n';
   rt_accumulate(SIM_TIMER_OUTPUT);
 }
 
@@ -115,41 +170,72 @@ void omc_csv_init(simulation_result *self, DATA *data, threadData_t *threadData)
 {
   int i;
   const MODEL_DATA *mData = data->modelData;
-
-  const char* format = ",\"%s\"";
+  csv_writer *csvData;
+  size_t nColumns = 1;
   FILE *fout = fopen(self->filename, "w");
 
   assertStreamPrint(threadData, 0!=fout, "Error, couldn't create output file: [%s] because of %s", self->filename, strerror(errno));
+  /* every flush is already one large block */
+  setvbuf(fout, NULL, _IONBF, 0);
 
-  fprintf(fout, "\"time\"");
-  if(self->cpuTime)
-    fprintf(fout, format, "$cpuTime");
-  for(i = 0; i < mData->nVariablesReal; i++) if(!mData->realVarsData[i].filterOutput)
-    fprintf(fout, format, mData->realVarsData[i].info.name);
-  for(i = 0; i < mData->nVariablesInteger; i++) if(!mData->integerVarsData[i].filterOutput)
-    fprintf(fout, format, mData->integerVarsData[i].info.name);
-  for(i = 0; i < mData->nVariablesBoolean; i++) if(!mData->booleanVarsData[i].filterOutput)
-    fprintf(fout, format, mData->booleanVarsData[i].info.name);
-  //for(i = 0; i < mData->nVariablesString; i++) if(!mData->stringVarsData[i].filterOutput)
-  //  fprintf(fout, format, mData->stringVarsData[i].info.name);
-
-  for(i = 0; i < mData->nAliasReal; i++) if(!mData->realAlias[i].filterOutput && data->modelData->realAlias[i].aliasType != 1)
-    fprintf(fout, format, mData->realAlias[i].info.name);
-  for(i = 0; i < mData->nAliasInteger; i++) if(!mData->integerAlias[i].filterOutput && data->modelData->integerAlias[i].aliasType != 1)
-    fprintf(fout, format, mData->integerAlias[i].info.name);
-  for(i = 0; i < mData->nAliasBoolean; i++) if(!mData->booleanAlias[i].filterOutput && data->modelData->booleanAlias[i].aliasType != 1)
-    fprintf(fout, format, mData->booleanAlias[i].info.name);
-  //for(i = 0; i < mData->nAliasString; i++) if(!mData->stringAlias[i].filterOutput && data->modelData->stringAlias[i].aliasType != 1)
-  //  fprintf(fout, format, mData->stringAlias[i].info.name);
-  fprintf(fout, "\n");
-  self->storage = fout;
+  csvData = (csv_writer*) malloc(sizeof(csv_writer));
+  csvData->fout = fout;
+  csvData->size = CSV_BLOCK_SIZE;
+  csvData->used = 0;
+  csvData->buffer = (char*) malloc(csvData->size);
+
+  csv_name(csvData, "time", 1);
+  if(self->cpuTime) {
+    csv_name(csvData, "$cpuTime", 0);
+    nColumns++;
+  }
+  for(i = 0; i < mData->nVariablesReal; i++) if(!mData->realVarsData[i].filterOutput) {
+    csv_name(csvData, mData->realVarsData[i].info.name, 0);
+    nColumns++;
+  }
+  for(i = 0; i < mData->nVariablesInteger; i++) if(!mData->integerVarsData[i].filterOutput) {
+    csv_name(csvData, mData->integerVarsData[i].info.name, 0);
+    nColumns++;
+  }
+  for(i = 0; i < mData->nVariablesBoolean; i++) if(!mData->booleanVarsData[i].filterOutput) {
+    csv_name(csvData, mData->booleanVarsData[i].info.name, 0);
+    nColumns++;
+  }
+
+  for(i = 0; i < mData->nAliasReal; i++) if(!mData->realAlias[i].filterOutput && data->modelData->realAlias[i].aliasType != 1) {
+    csv_name(csvData, mData->realAlias[i].info.name, 0);
+    nColumns++;
+  }
+  for(i = 0; i < mData->nAliasInteger; i++) if(!mData->integerAlias[i].filterOutput && data->modelData->integerAlias[i].aliasType != 1) {
+    csv_name(csvData, mData->integerAlias[i].info.name, 0);
+    nColumns++;
+  }
+  for(i = 0; i < mData->nAliasBoolean; i++) if(!mData->booleanAlias[i].filterOutput && data->modelData->booleanAlias[i].aliasType != 1) {
+    csv_name(csvData, mData->booleanAlias[i].info.name, 0);
+    nColumns++;
+  }
+  csv_reserve(csvData, 1);
+  csvData->buffer[csvData->used++] = '\n';
+
+  /* separator and the longest number for every column, plus the newline */
+  csvData->maxLineLength = nColumns * (1 + OMC_DTOA_MAX_LENGTH) + 1;
+  if (csvData->size < 2*csvData->maxLineLength) {
+    csv_flush(csvData);
+    csvData->size = 2*csvData->maxLineLength;
+    csvData->buffer = (char*) realloc(csvData->buffer, csvData->size);
+  }
+  self->storage = csvData;
 }
 
 void omc_csv_free(simulation_result *self, DATA *data, threadData_t *threadData)
 {
-  FILE *fout = (FILE*) self->storage;
+  csv_writer *csvData = (csv_writer*) self->storage;
   rt_tick(SIM_TIMER_OUTPUT);
-  fclose(fout);
+  csv_flush(csvData);
+  fclose(csvData->fout);
+  free(csvData->buffer);
+  free(csvData);
+  self->storage = NULL;
   rt_accumulate(SIM_TIMER_OUTPUT);
 }
 
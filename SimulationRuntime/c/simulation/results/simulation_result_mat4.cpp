@@ -30,7 +30,9 @@
 
 #include "MatVer4.h"
 #include "util/omc_error.h"
+#include "util/read_matlab4.h"
 #include "util/rtclock.h"
+#include "util/write_matlab4.h"
 #include "simulation/options.h"
 #include "simulation_result_mat4.h"
 
@@ -43,9 +45,32 @@
 #include <cstdlib>
 #include <stdint.h>
 #include <assert.h>
+#if !defined(OMC_NO_THREADS)
+#include <pthread.h>
+#endif
 
 extern "C" {
 
+/* target size of one block of rows handed to the background writer */
+#define MAT_ASYNC_CHUNK_SIZE (1024*1024)
+#define MAT_ASYNC_PAGE_SIZE 4096
+
+/* output points per chunk of the chunked format and the memory limit for the column buffer */
+#define MAT_CHUNK_MAX_ROWS 1024
+#define MAT_CHUNK_MIN_ROWS 16
+#define MAT_CHUNK_BUFFER_SIZE (32*1024*1024)
+
+struct mat_async_writer;
+
+/* column buffer of the chunked format, see read_matlab4.h */
+typedef struct mat_chunk {
+  double *columns;   /* nData2 columns of chunkRows values each */
+  size_t chunkRows;
+  size_t nRows;      /* rows in the current chunk */
+  uint8_t *encoded;  /* scratch space for one encoded column */
+  uint32_t *offsets;
+} mat_chunk;
+
 typedef struct mat_data {
   FILE *pFile;
   long data2HdrPos; /* position of data_2 matrix's header in a file */
@@ -57,8 +82,233 @@ typedef struct mat_data {
   size_t sync;
   void* data_2;
   MatVer4Type_t type;
+  struct mat_async_writer *async; /* NULL unless -mat_async is used */
+  int chunked;                    /* chunked format ("matc") instead of data_2 */
+  mat_chunk chunk;
 } mat_data;
 
+#if !defined(OMC_NO_THREADS)
+/* One block of consecutive data_2 rows. A block is owned either by the
+ * solver thread (while it is filled) or by the writer thread (while it is
+ * queued or written). */
+typedef struct mat_async_block {
+  void *data;
+  size_t nRows;
+} mat_async_block;
+
+/* Bounded ring of row blocks drained by a background thread. The solver
+ * thread fills block `tail`, the writer thread writes blocks
+ * head, head+1, ..., head+nFull-1 to the file. */
+typedef struct mat_async_writer {
+  mat_data *matData;
+  pthread_t thread;
+  pthread_mutex_t mutex;
+  pthread_cond_t notEmpty; /* signalled by the solver thread when a block was queued */
+  pthread_cond_t notFull;  /* signalled by the writer thread when a block was released */
+
+  mat_async_block *blocks;
+  size_t nBlocks;
+  size_t rowsPerBlock;
+  size_t head;
+  size_t tail;
+  size_t nFull;
+  int stop;
+
+  /* writer side (only touched by the writer thread until it is joined) */
+  size_t nEmits;        /* rows written since the data_2 header was patched last */
+  size_t nChunks;       /* number of blocks written */
+  double writeTime;     /* time spent in fwrite and header updates */
+
+  /* solver side */
+  size_t nStalls;       /* number of times the ring was full */
+  double stallTime;     /* time the solver thread waited for a free block */
+} mat_async_writer;
+
+static void* mat4_async_writerThread(void *arg)
+{
+  mat_async_writer *w = (mat_async_writer*) arg;
+  mat_data *matData = w->matData;
+  size_t size = sizeofMatVer4Type(matData->type);
+  rtclock_t tick;
+
+  pthread_mutex_lock(&w->mutex);
+  while (1) {
+    mat_async_block *block;
+
+    while (0 == w->nFull && !w->stop)
+      pthread_cond_wait(&w->notEmpty, &w->mutex);
+    if (0 == w->nFull)
+      break; /* stopped and drained */
+    block = &w->blocks[w->head];
+    pthread_mutex_unlock(&w->mutex);
+
+    rt_ext_tp_tick(&tick);
+    fwrite(block->data, size, matData->nData2 * block->nRows, matData->pFile);
+    w->nEmits += block->nRows;
+    if (matData->sync > 0 && w->nEmits >= matData->sync)
+    {
+      updateHeader_matVer4(matData->pFile, matData->data2HdrPos, "data_2", matData->nData2, w->nEmits, matData->type);
+      w->nEmits = 0;
+    }
+    w->writeTime += rt_ext_tp_tock(&tick);
+
+    pthread_mutex_lock(&w->mutex);
+    block->nRows = 0;
+    w->head = (w->head + 1) % w->nBlocks;
+    w->nFull--;
+    w->nChunks++;
+    pthread_cond_signal(&w->notFull);
+  }
+  pthread_mutex_unlock(&w->mutex);
+  return NULL;
+}
+
+/* frees the blocks and the writer, which may be partially allocated */
+static void mat4_async_free(mat_async_writer *w)
+{
+  if (w->blocks) {
+    for (size_t i=0; i < w->nBlocks; i++)
+      free(w->blocks[i].data);
+    free(w->blocks);
+  }
+  free(w);
+}
+
+static void mat4_async_start(mat_data *matData, size_t nBlocks, threadData_t *threadData)
+{
+  mat_async_writer *w = (mat_async_writer*) calloc(1, sizeof(mat_async_writer));
+  size_t rowSize = sizeofMatVer4Type(matData->type) * matData->nData2;
+  size_t pageRows, a = rowSize, b = MAT_ASYNC_PAGE_SIZE;
+
+  if (!w)
+    throwStreamPrint(threadData, "Cannot allocate the mat file writer");
+  w->matData = matData;
+
+  /* rows per block: about MAT_ASYNC_CHUNK_SIZE bytes, rounded down to a
+   * multiple of whole pages if the rows are small enough for that */
+  while (b) { size_t t = a % b; a = b; b = t; }
+  pageRows = MAT_ASYNC_PAGE_SIZE / a;
+  w->rowsPerBlock = MAT_ASYNC_CHUNK_SIZE / rowSize;
+  if (w->rowsPerBlock >= pageRows)
+    w->rowsPerBlock -= w->rowsPerBlock % pageRows;
+  if (w->rowsPerBlock < 1)
+    w->rowsPerBlock = 1;
+  /* hand blocks over early enough to honour -mat_sync */
+  if (matData->sync > 0 && matData->sync < w->rowsPerBlock)
+    w->rowsPerBlock = matData->sync;
+
+  w->nBlocks = nBlocks < 2 ? 2 : nBlocks;
+  w->blocks = (mat_async_block*) calloc(w->nBlocks, sizeof(mat_async_block));
+  for (size_t i=0; i < w->nBlocks; i++) {
+    if (!w->blocks || !(w->blocks[i].data = malloc(rowSize * w->rowsPerBlock))) {
+      mat4_async_free(w);
+      throwStreamPrint(threadData, "Cannot allocate %lu bytes for the mat file writer", (unsigned long) (rowSize * w->rowsPerBlock));
+    }
+  }
+
+  pthread_mutex_init(&w->mutex, NULL);
+  pthread_cond_init(&w->notEmpty, NULL);
+  pthread_cond_init(&w->notFull, NULL);
+
+  if (pthread_create(&w->thread, NULL, mat4_async_writerThread, w)) {
+    pthread_mutex_destroy(&w->mutex);
+    pthread_cond_destroy(&w->notEmpty);
+    pthread_cond_destroy(&w->notFull);
+    mat4_async_free(w);
+    throwStreamPrint(threadData, "Cannot start the mat file writer thread");
+  }
+  /* only a running writer is stopped by mat4_async_stop */
+  matData->async = w;
+}
+
+/* queue the block currently filled by the solver thread and wait for the next free one */
+static void mat4_async_push(mat_async_writer *w)
+{
+  pthread_mutex_lock(&w->mutex);
+  w->nFull++;
+  w->tail = (w->tail + 1) % w->nBlocks;
+  pthread_cond_signal(&w->notEmpty);
+  if (w->nFull == w->nBlocks) {
+    rtclock_t tick;
+    rt_ext_tp_tick(&tick);
+    while (w->nFull == w->nBlocks)
+      pthread_cond_wait(&w->notFull, &w->mutex);
+    w->stallTime += rt_ext_tp_tock(&tick);
+    w->nStalls++;
+  }
+  pthread_mutex_unlock(&w->mutex);
+}
+
+/* flush the partially filled block, stop the writer thread and release the ring */
+static void mat4_async_stop(mat_data *matData)
+{
+  mat_async_writer *w = matData->async;
+
+  if (w->blocks[w->tail].nRows > 0)
+    mat4_async_push(w);
+
+  pthread_mutex_lock(&w->mutex);
+  w->stop = 1;
+  pthread_cond_signal(&w->notEmpty);
+  pthread_mutex_unlock(&w->mutex);
+  pthread_join(w->thread, NULL);
+
+  /* the remaining rows are accounted for in the final header update */
+  matData->nEmits += w->nEmits;
+
+  infoStreamPrint(LOG_STATS, 0, "mat file writer thread: %gs writing %lu chunks of up to %lu rows, solver stalled %lu times for %gs",
+                  w->writeTime, (unsigned long) w->nChunks, (unsigned long) w->rowsPerBlock, (unsigned long) w->nStalls, w->stallTime);
+
+  pthread_mutex_destroy(&w->mutex);
+  pthread_cond_destroy(&w->notEmpty);
+  pthread_cond_destroy(&w->notFull);
+  mat4_async_free(w);
+  matData->async = NULL;
+}
+#endif
+
+/* Writes the buffered rows as one chunk. The sizes in the matrix header are
+ * only filled in after all columns are written, so readers ignore a chunk
+ * that was not completed. */
+static void mat4_writeChunk(mat_data *matData)
+{
+  mat_chunk *chunk = &matData->chunk;
+  uint32_t info[2];
+  double times[2];
+  long hdrPos, chunkPos, eof;
+
+  if (0 == chunk->nRows)
+    return;
+
+  info[0] = (uint32_t) chunk->nRows;
+  info[1] = (uint32_t) matData->nData2;
+  times[0] = chunk->columns[0];
+  times[1] = chunk->columns[chunk->nRows-1];
+
+  hdrPos = ftell(matData->pFile);
+  writeMatrix_matVer4(matData->pFile, "chunk", 0, 1, NULL, MatVer4Type_CHAR);
+  chunkPos = ftell(matData->pFile);
+  fwrite(info, sizeof(uint32_t), 2, matData->pFile);
+  fwrite(times, sizeof(double), 2, matData->pFile);
+  fwrite(chunk->offsets, sizeof(uint32_t), matData->nData2+1, matData->pFile);
+
+  chunk->offsets[0] = 0;
+  for (size_t i=0; i < matData->nData2; i++) {
+    size_t len = omc_matc_encode_column(chunk->columns + i*chunk->chunkRows, chunk->nRows, chunk->encoded);
+    fwrite(chunk->encoded, 1, len, matData->pFile);
+    chunk->offsets[i+1] = chunk->offsets[i] + (uint32_t) len;
+  }
+
+  eof = ftell(matData->pFile);
+  fseek(matData->pFile, chunkPos + OMC_MATC_CHUNK_HEADER_SIZE, SEEK_SET);
+  fwrite(chunk->offsets, sizeof(uint32_t), matData->nData2+1, matData->pFile);
+  fseek(matData->pFile, hdrPos, SEEK_SET);
+  writeMatrix_matVer4(matData->pFile, "chunk", eof - chunkPos, 1, NULL, MatVer4Type_CHAR);
+  fseek(matData->pFile, eof, SEEK_SET);
+
+  chunk->nRows = 0;
+}
+
 static const char timeName[] = "time";
 static const char timeDesc[] = "Simulation time [s]";
 static const char cpuTimeName[] = "$cpuTime";
@@ -66,11 +316,12 @@ static const char cpuTimeDesc[] = "cpu time [s]";
 static const char solverStepsName[] = "$solverSteps";
 static const char solverStepsDesc[] = "number of steps taken by the integrator";
 
-void mat4_init4(simulation_result *self, DATA *data, threadData_t *threadData)
+static void mat4_init(simulation_result *self, DATA *data, threadData_t *threadData, int chunked)
 {
   const MODEL_DATA *mData = data->modelData;
   mat_data *matData = new mat_data();
   self->storage = matData;
+  matData->chunked = chunked;
 
   assert(sizeof(char) == 1);
 
@@ -90,7 +341,8 @@ void mat4_init4(simulation_result *self, DATA *data, threadData_t *threadData)
   // Class Type: Character Array
   //  Data Type: 8-bit, unsigned integer
   const char Aclass[] = "A1\0bt.\0ir1\0na\0\0Tj\0\0re\0\0ac\0\0nt\0\0so\0\0\0r\0\0\0y\0\0\0";
-  writeMatrix_matVer4(matData->pFile, "Aclass", 4, 11, Aclass, MatVer4Type_CHAR);
+  const char AclassChunk[] = "A1\0bt.\0ir1\0na\0\0Cj\0\0he\0\0uc\0\0nt\0\0ko\0\0\0r\0\0\0y\0\0\0";
+  writeMatrix_matVer4(matData->pFile, "Aclass", 4, 11, chunked ? AclassChunk : Aclass, MatVer4Type_CHAR);
 
   /* Find the longest var name and description. */
   size_t maxLengthName = strlen(timeName) + 1;
@@ -388,6 +640,16 @@ void mat4_init4(simulation_result *self, DATA *data, threadData_t *threadData)
   rt_accumulate(SIM_TIMER_OUTPUT);
 }
 
+void mat4_init4(simulation_result *self, DATA *data, threadData_t *threadData)
+{
+  mat4_init(self, data, threadData, 0);
+}
+
+void mat4_initChunked4(simulation_result *self, DATA *data, threadData_t *threadData)
+{
+  mat4_init(self, data, threadData, 1);
+}
+
 #define WRITE_REAL_VALUE(data, offset, value) {if (omc_flag[FLAG_SINGLE_PRECISION]) {float f=(value); memcpy(((uint8_t*)(data)) + (offset)*sizeof(float), &f, sizeof(float));} else {double d=(value); memcpy(((uint8_t*)(data)) + (offset)*sizeof(double), &d, sizeof(double));}}
 
 /* write the parameter data after updateBoundParameters is called */
@@ -704,9 +966,30 @@ void mat4_writeParameterData4(simulation_result *self, DATA *data, threadData_t
   // Dimensions: nSeries x nPoints
   // Class Type: Double Precision Array
   //  Data Type: IEEE 754 double-precision
-  matData->data2HdrPos = ftell(matData->pFile);
   matData->data_2 = malloc(size * matData->nData2);
+  if (matData->chunked) {
+    /* the rows are collected column by column and written as "chunk" matrices */
+    mat_chunk *chunk = &matData->chunk;
+    chunk->chunkRows = MAT_CHUNK_BUFFER_SIZE / (sizeof(double) * matData->nData2);
+    if (chunk->chunkRows > MAT_CHUNK_MAX_ROWS) chunk->chunkRows = MAT_CHUNK_MAX_ROWS;
+    if (chunk->chunkRows < MAT_CHUNK_MIN_ROWS) chunk->chunkRows = MAT_CHUNK_MIN_ROWS;
+    chunk->nRows = 0;
+    chunk->columns = (double*) malloc(sizeof(double) * matData->nData2 * chunk->chunkRows);
+    chunk->encoded = (uint8_t*) malloc(OMC_MATC_MAX_COLUMN_SIZE(chunk->chunkRows));
+    chunk->offsets = (uint32_t*) calloc(matData->nData2+1, sizeof(uint32_t));
+    if (!chunk->columns || !chunk->encoded || !chunk->offsets)
+      throwStreamPrint(threadData, "Cannot allocate memory for the chunked result file %s", self->filename);
+    rt_accumulate(SIM_TIMER_OUTPUT);
+    return;
+  }
+
+  matData->data2HdrPos = ftell(matData->pFile);
   writeMatrix_matVer4(matData->pFile, "data_2", matData->nData2, 0, NULL, matData->type);
+
+#if !defined(OMC_NO_THREADS)
+  if (omc_flag[FLAG_MAT_ASYNC] && atoi(omc_flagValue[FLAG_MAT_ASYNC]) > 0)
+    mat4_async_start(matData, atoi(omc_flagValue[FLAG_MAT_ASYNC]), threadData);
+#endif
   rt_accumulate(SIM_TIMER_OUTPUT);
 }
 
@@ -724,39 +1007,68 @@ void mat4_emit4(simulation_result *self, DATA *data, threadData_t *threadData)
   double cpuTimeValue = rt_accumulated(SIM_TIMER_TOTAL);
   rt_tick(SIM_TIMER_TOTAL);
 
+  /* the row is either written directly or filled in place into the current block of the ring */
+  void *row = matData->data_2;
+#if !defined(OMC_NO_THREADS)
+  mat_async_block *block = NULL;
+  if (matData->async) {
+    block = &matData->async->blocks[matData->async->tail];
+    row = (uint8_t*)block->data + block->nRows * matData->nData2 * sizeofMatVer4Type(matData->type);
+  }
+#endif
+
   size_t cur = 0;
   /* time */
-  WRITE_REAL_VALUE(matData->data_2, cur++, data->localData[0]->timeValue);
+  WRITE_REAL_VALUE(row, cur++, data->localData[0]->timeValue);
 
   if (self->cpuTime)
-    WRITE_REAL_VALUE(matData->data_2, cur++, cpuTimeValue);
+    WRITE_REAL_VALUE(row, cur++, cpuTimeValue);
 
   if (omc_flag[FLAG_SOLVER_STEPS])
-    WRITE_REAL_VALUE(matData->data_2, cur++, data->simulationInfo->solverSteps);
+    WRITE_REAL_VALUE(row, cur++, data->simulationInfo->solverSteps);
 
   for (int i=0; i < mData->nVariablesReal; i++)
     if (!mData->realVarsData[i].filterOutput && !mData->realVarsData[i].time_unvarying)
-      WRITE_REAL_VALUE(matData->data_2, cur++, data->localData[0]->realVars[i]);
+      WRITE_REAL_VALUE(row, cur++, data->localData[0]->realVars[i]);
 
   if (omc_flag[FLAG_IDAS])
     for (int i=mData->nSensitivityParamVars; i < mData->nSensitivityVars; i++)
-      WRITE_REAL_VALUE(matData->data_2, cur++, data->simulationInfo->sensitivityMatrix[i]);
+      WRITE_REAL_VALUE(row, cur++, data->simulationInfo->sensitivityMatrix[i]);
 
   for (int i=0; i < mData->nVariablesInteger; i++)
     if (!mData->integerVarsData[i].filterOutput && !mData->integerVarsData[i].time_unvarying)
-      WRITE_REAL_VALUE(matData->data_2, cur++, data->localData[0]->integerVars[i]);
+      WRITE_REAL_VALUE(row, cur++, data->localData[0]->integerVars[i]);
 
   for (int i=0; i < mData->nVariablesBoolean; i++)
     if (!mData->booleanVarsData[i].filterOutput && !mData->booleanVarsData[i].time_unvarying)
-      WRITE_REAL_VALUE(matData->data_2, cur++, data->localData[0]->booleanVars[i]);
+      WRITE_REAL_VALUE(row, cur++, data->localData[0]->booleanVars[i]);
 
   for (int i=0; i < mData->nAliasBoolean; i++)
     if (!mData->booleanAlias[i].filterOutput)
       if (mData->booleanAlias[i].aliasType == 0)
         if (mData->booleanAlias[i].negate)
-          WRITE_REAL_VALUE(matData->data_2, cur++, (1-data->localData[0]->booleanVars[mData->booleanAlias[i].nameID]));
+          WRITE_REAL_VALUE(row, cur++, (1-data->localData[0]->booleanVars[mData->booleanAlias[i].nameID]));
+
+  if (matData->chunked) {
+    mat_chunk *chunk = &matData->chunk;
+    for (size_t i=0; i < matData->nData2; i++)
+      chunk->columns[i*chunk->chunkRows + chunk->nRows] = matData->type == MatVer4Type_SINGLE ? ((float*)row)[i] : ((double*)row)[i];
+    if (++chunk->nRows == chunk->chunkRows)
+      mat4_writeChunk(matData);
+    rt_accumulate(SIM_TIMER_OUTPUT);
+    return;
+  }
+
+#if !defined(OMC_NO_THREADS)
+  if (block) {
+    if (++block->nRows == matData->async->rowsPerBlock)
+      mat4_async_push(matData->async);
+    rt_accumulate(SIM_TIMER_OUTPUT);
+    return;
+  }
+#endif
 
-  fwrite(matData->data_2, sizeofMatVer4Type(matData->type), matData->nData2, matData->pFile);
+  fwrite(row, sizeofMatVer4Type(matData->type), matData->nData2, matData->pFile);
   matData->nEmits++;
 
   if (matData->sync > 0 && matData->nEmits > matData->sync)
@@ -779,6 +1091,19 @@ void mat4_free4(simulation_result *self, DATA *data, threadData_t *threadData)
     return;
   }
 
+#if !defined(OMC_NO_THREADS)
+  if (matData->async)
+    mat4_async_stop(matData);
+#endif
+
+  if (matData->chunked) {
+    mat4_writeChunk(matData);
+    free(matData->chunk.columns);
+    free(matData->chunk.encoded);
+    free(matData->chunk.offsets);
+    memset(&matData->chunk, 0, sizeof(mat_chunk));
+  }
+
   if (matData->nEmits > 0) {
     updateHeader_matVer4(matData->pFile, matData->data2HdrPos, "data_2", matData->nData2, matData->nEmits, matData->type);
     matData->nEmits = 0;
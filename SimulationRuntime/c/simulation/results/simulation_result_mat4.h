@@ -49,6 +49,7 @@ extern "C" {
 #endif
 
 void mat4_init4(simulation_result *self, DATA *data, threadData_t *threadData);
+void mat4_initChunked4(simulation_result *self, DATA *data, threadData_t *threadData);
 void mat4_emit4(simulation_result *self, DATA *data, threadData_t *threadData);
 void mat4_writeParameterData4(simulation_result *self, DATA *data, threadData_t *threadData);
 void mat4_free4(simulation_result *self, DATA *data, threadData_t *threadData);
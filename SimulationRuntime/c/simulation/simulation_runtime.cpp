@@ -36,6 +36,7 @@
 #include <sstream>
 #include <limits>
 #include <list>
+#include <vector>
 #include <cmath>
 #include <iomanip>
 #include <ctime>
@@ -50,6 +51,12 @@
   #include <regex.h>
 #endif
 
+#if !defined(OMC_MINIMAL_RUNTIME) && !defined(_MSC_VER) && !defined(__MINGW32__)
+  #include <unistd.h>
+  #include <sys/wait.h>
+  #define OMC_BATCH_FORK
+#endif
+
 
 /* ppriv - NO_INTERACTIVE_DEPENDENCY - for simpler debugging in Visual Studio
  *
@@ -86,6 +93,7 @@
 #include "simulation/solver/initialization/initialization.h"
 #include "simulation/solver/dae_mode.h"
 #include "dataReconciliation/dataReconciliation.h"
+#include "util/read_csv.h"
 
 #ifdef _OMC_QSS_LIB
   #include "solver_qss/solver_qss.h"
@@ -356,6 +364,218 @@ void initializeOutputFilter(MODEL_DATA *modelData, const char *variableFilter, i
   return;
 }
 
+#if !defined(OMC_MINIMAL_RUNTIME)
+/*! \struct BATCH_COLUMN
+ *
+ * One column of the -batch file, resolved to the value it overrides.
+ * Exactly one of the pointers is set.
+ */
+typedef struct BATCH_COLUMN
+{
+  modelica_real *real;
+  modelica_integer *integer;
+  modelica_boolean *boolean;
+} BATCH_COLUMN;
+
+static BATCH_COLUMN resolveBatchColumn(DATA *data, threadData_t *threadData, const char *name)
+{
+  MODEL_DATA *mData = data->modelData;
+  SIMULATION_INFO *sInfo = data->simulationInfo;
+  BATCH_COLUMN col = {NULL, NULL, NULL};
+  long i;
+
+  if(0 == strcmp(name, "startTime")) {
+    col.real = &sInfo->startTime;
+  } else if(0 == strcmp(name, "stopTime")) {
+    col.real = &sInfo->stopTime;
+  } else if(0 == strcmp(name, "stepSize")) {
+    col.real = &sInfo->stepSize;
+  } else if(0 == strcmp(name, "tolerance")) {
+    col.real = &sInfo->tolerance;
+  }
+  for(i=0; !col.real && i<mData->nVariablesReal; ++i) {
+    if(0 == strcmp(name, mData->realVarsData[i].info.name)) {
+      col.real = &mData->realVarsData[i].attribute.start;
+    }
+  }
+  for(i=0; !col.real && i<mData->nParametersReal; ++i) {
+    if(0 == strcmp(name, mData->realParameterData[i].info.name)) {
+      col.real = &mData->realParameterData[i].attribute.start;
+    }
+  }
+  for(i=0; !col.integer && i<mData->nVariablesInteger; ++i) {
+    if(0 == strcmp(name, mData->integerVarsData[i].info.name)) {
+      col.integer = &mData->integerVarsData[i].attribute.start;
+    }
+  }
+  for(i=0; !col.integer && i<mData->nParametersInteger; ++i) {
+    if(0 == strcmp(name, mData->integerParameterData[i].info.name)) {
+      col.integer = &mData->integerParameterData[i].attribute.start;
+    }
+  }
+  for(i=0; !col.boolean && i<mData->nVariablesBoolean; ++i) {
+    if(0 == strcmp(name, mData->booleanVarsData[i].info.name)) {
+      col.boolean = &mData->booleanVarsData[i].attribute.start;
+    }
+  }
+  for(i=0; !col.boolean && i<mData->nParametersBoolean; ++i) {
+    if(0 == strcmp(name, mData->booleanParameterData[i].info.name)) {
+      col.boolean = &mData->booleanParameterData[i].attribute.start;
+    }
+  }
+
+  if(!col.real && !col.integer && !col.boolean) {
+    throwStreamPrint(threadData, "-batch: column '%s' is neither a variable, a parameter nor an experiment setting of the model", name);
+  }
+  return col;
+}
+
+/*! \fn resetBatchRun
+ *
+ * Brings an already simulated model back to the state it had after
+ * initRuntimeAndSimulation, without reading the xml file again.
+ */
+static void resetBatchRun(DATA *data, threadData_t *threadData)
+{
+  freeMixedSystems(data, threadData);
+  freeLinearSystems(data, threadData);
+  freeNonlinearSystems(data, threadData);
+
+  /* the destructors release the array of external objects as well */
+  data->callback->callExternalObjectDestructors(data, threadData);
+  data->simulationInfo->extObjs = (void**) calloc(data->modelData->nExtObjs, sizeof(void*));
+  assertStreamPrint(threadData, 0 == data->modelData->nExtObjs || 0 != data->simulationInfo->extObjs, "error allocating external objects");
+
+  resetDataStruc(data);
+
+  initializeMixedSystems(data, threadData);
+  initializeLinearSystems(data, threadData);
+  initializeNonlinearSystems(data, threadData);
+}
+
+/*! \fn runBatchSimulation
+ *
+ * Simulates every row of the -batch file with the already loaded model.
+ * Run k (counting from 1) writes <result>_k.<format>. With -batchWorkers=N
+ * the process forks N workers after loading the model; worker w simulates
+ * the runs k with (k-1) mod N == w.
+ *
+ * \return number of failed runs (or failed workers), 0 on success
+ */
+static int runBatchSimulation(DATA *data, threadData_t *threadData, const string& init_initMethod, const string& init_file,
+      double init_time, const string& outputVariablesAtEnd, int cpuTime, const char *argv_0)
+{
+  const char *batchFile = omc_flagValue[FLAG_BATCH];
+  SIMULATION_INFO *sInfo = data->simulationInfo;
+  struct csv_data *runs = read_csv(batchFile);
+  std::vector<BATCH_COLUMN> columns;
+  const string resultFile = data->modelData->resultFileName;
+  const size_t dot = resultFile.find_last_of('.');
+  const size_t slash = resultFile.find_last_of("/\\");
+  const size_t extPos = (dot == string::npos || (slash != string::npos && dot < slash)) ? resultFile.size() : dot;
+  const modelica_real startTime = sInfo->startTime;
+  const modelica_real stopTime = sInfo->stopTime;
+  const modelica_real stepSize = sInfo->stepSize;
+  const modelica_real tolerance = sInfo->tolerance;
+  int nWorkers = omc_flag[FLAG_BATCH_WORKERS] ? atoi(omc_flagValue[FLAG_BATCH_WORKERS]) : 1;
+  int firstWorker = 0, lastWorker, nSimulated = 0, failed = 0;
+  int run, i;
+#if defined(OMC_BATCH_FORK)
+  std::vector<pid_t> workers;
+  int isWorker = 0;
+#endif
+
+  if(!runs || runs->numsteps < 1) {
+    throwStreamPrint(threadData, "-batch: could not read any run from %s", batchFile);
+  }
+  for(i=0; i<runs->numvars; ++i) {
+    columns.push_back(resolveBatchColumn(data, threadData, runs->variables[i]));
+  }
+  nWorkers = nWorkers < 1 ? 1 : (nWorkers > runs->numsteps ? runs->numsteps : nWorkers);
+  lastWorker = nWorkers - 1;
+  infoStreamPrint(LOG_STDOUT, 0, "batch simulation of %d runs from %s with %d worker(s)", runs->numsteps, batchFile, nWorkers);
+
+#if defined(OMC_BATCH_FORK)
+  if(nWorkers > 1) {
+    fflush(NULL);
+    for(firstWorker=0; firstWorker<nWorkers; ++firstWorker) {
+      pid_t pid = fork();
+      if(0 == pid) {
+        isWorker = 1;
+        lastWorker = firstWorker;
+        workers.clear();
+        break;
+      } else if(pid < 0) {
+        /* simulate the runs of the missing workers in this process */
+        warningStreamPrint(LOG_STDOUT, 0, "-batchWorkers: could not fork worker %d: %s", firstWorker+1, strerror(errno));
+        break;
+      }
+      workers.push_back(pid);
+    }
+  }
+#else
+  if(nWorkers > 1) {
+    warningStreamPrint(LOG_STDOUT, 0, "-batchWorkers: worker processes are not supported on this platform, simulating all runs sequentially");
+    nWorkers = 1;
+    lastWorker = 0;
+  }
+#endif
+
+  for(run=0; run<runs->numsteps; ++run) {
+    const int worker = run % nWorkers;
+    std::stringstream resultName;
+    if(worker < firstWorker || worker > lastWorker) {
+      continue;
+    }
+    if(nSimulated++) {
+      resetBatchRun(data, threadData);
+    }
+
+    sInfo->startTime = startTime;
+    sInfo->stopTime = stopTime;
+    sInfo->stepSize = stepSize;
+    sInfo->tolerance = tolerance;
+    for(i=0; i<runs->numvars; ++i) {
+      const double value = runs->data[i*runs->numsteps + run];
+      if(columns[i].real) {
+        *columns[i].real = value;
+      } else if(columns[i].integer) {
+        *columns[i].integer = (modelica_integer) value;
+      } else {
+        *columns[i].boolean = value != 0.0;
+      }
+    }
+    sInfo->numSteps = static_cast<modelica_integer>(round((sInfo->stopTime - sInfo->startTime)/sInfo->stepSize));
+
+    resultName << resultFile.substr(0, extPos) << "_" << (run+1) << resultFile.substr(extPos);
+    data->modelData->resultFileName = GC_strdup(resultName.str().c_str());
+    infoStreamPrint(LOG_STDOUT, 0, "batch run %d of %d: %s", run+1, runs->numsteps, data->modelData->resultFileName);
+
+    if(callSolver(data, threadData, init_initMethod, init_file, init_time, outputVariablesAtEnd, cpuTime, argv_0)) {
+      warningStreamPrint(LOG_STDOUT, 0, "batch run %d of %d failed", run+1, runs->numsteps);
+      failed++;
+    }
+  }
+  omc_free_csv_reader(runs);
+
+#if defined(OMC_BATCH_FORK)
+  if(isWorker) {
+    data->callback->callExternalObjectDestructors(data, threadData);
+    fflush(NULL);
+    _exit(failed ? 1 : 0);
+  }
+  for(i=0; i<(int) workers.size(); ++i) {
+    int status;
+    if(waitpid(workers[i], &status, 0) < 0 || !WIFEXITED(status) || 0 != WEXITSTATUS(status)) {
+      warningStreamPrint(LOG_STDOUT, 0, "batch worker %d failed", i+1);
+      failed++;
+    }
+  }
+#endif
+  return failed;
+}
+#endif
+
 /**
  * Starts a non-interactive simulation
  */
@@ -511,6 +731,11 @@ int startNonInteractiveSimulation(int argc, char**argv, DATA* data, threadData_t
     outputVariablesAtEnd = omc_flagValue[FLAG_OUTPUT];
   }
 
+#if !defined(OMC_MINIMAL_RUNTIME)
+  if(omc_flag[FLAG_BATCH]) {
+    retVal = runBatchSimulation(data, threadData, init_initMethod, init_file, init_time, outputVariablesAtEnd, cpuTime, argv[0]);
+  } else
+#endif
   retVal = callSolver(data, threadData, init_initMethod, init_file, init_time, outputVariablesAtEnd, cpuTime, argv[0]);
 
   if (omc_flag[FLAG_ALARM]) {
@@ -584,6 +809,12 @@ int initializeResultData(DATA* simData, threadData_t *threadData, int cpuTime)
     sim_result.writeParameterData = mat4_writeParameterData4;
     sim_result.free = mat4_free4;
     resultFormatHasCheapAliasesAndParameters = 1;
+  } else if(0 == strcmp("matc", simData->simulationInfo->outputFormat)) {
+    sim_result.init = mat4_initChunked4;
+    sim_result.emit = mat4_emit4;
+    sim_result.writeParameterData = mat4_writeParameterData4;
+    sim_result.free = mat4_free4;
+    resultFormatHasCheapAliasesAndParameters = 1;
 #if !defined(OMC_MINIMAL_RUNTIME)
   } else if(0 == strcmp("wall", simData->simulationInfo->outputFormat)) {
     sim_result.init = recon_wall_init;
@@ -910,6 +1141,13 @@ int initRuntimeAndSimulation(int argc, char**argv, DATA *data, threadData_t *thr
     nonlinearSparseSolverMinSize = atoi(omc_flagValue[FLAG_NLS_MIN_SIZE]);
     infoStreamPrint(LOG_STDOUT, 0, "Maximum system size for using non-linear sparse solver changed to %d", nonlinearSparseSolverMinSize);
   }
+  if(omc_flag[FLAG_NLS_EXTRAPOLATION_ORDER]) {
+    nonlinearExtrapolationOrder = atoi(omc_flagValue[FLAG_NLS_EXTRAPOLATION_ORDER]);
+    if(nonlinearExtrapolationOrder < 0 || nonlinearExtrapolationOrder > 8) {
+      warningStreamPrint(LOG_STDOUT, 0, "Extrapolation order %d of non-linear systems is out of range [0,8]; using 1", nonlinearExtrapolationOrder);
+      nonlinearExtrapolationOrder = 1;
+    }
+  }
   if(omc_flag[FLAG_NEWTON_XTOL]) {
     newtonXTol = atof(omc_flagValue[FLAG_NEWTON_XTOL]);
     infoStreamPrint(LOG_STDOUT, 0, "Tolerance for updating solution vector in Newton solver changed to %g", newtonXTol);
@@ -349,6 +349,13 @@ int dassl_initial(DATA* data, threadData_t *threadData, SOLVER_INFO* solverInfo,
   }
   infoStreamPrint(LOG_SOLVER, 0, "jacobian is calculated by %s", JACOBIAN_METHOD_DESC[dasslData->dasslJacobian]);
 
+  /* evaluate the color groups in parallel if -jacobianThreads is set */
+  dasslData->parallelJacobian = NULL;
+  if (dasslData->dasslJacobian == COLOREDNUMJAC || dasslData->dasslJacobian == COLOREDSYMJAC)
+  {
+    dasslData->parallelJacobian = allocParallelJacobian(data, threadData, data->callback->INDEX_JAC_A, N);
+  }
+
   /* if FLAG_NO_ROOTFINDING is set, choose dassl with out internal root finding */
   if(omc_flag[FLAG_NO_ROOTFINDING])
   {
@@ -405,6 +412,9 @@ int dassl_deinitial(DASSL_DATA *dasslData)
   free(dasslData->states);
   free(dasslData->stateDer);
 
+  printParallelJacobianStatistics(dasslData->parallelJacobian);
+  freeParallelJacobian(dasslData->parallelJacobian);
+
   free(dasslData);
 
   TRACE_POP
@@ -841,6 +851,120 @@ int function_ZeroCrossingsDASSL(int *neqm, double *t, double *y, double *yp,
   return 0;
 }
 
+/* arguments of a Jacobian evaluation shared by the workers of the
+ * parallel colored Jacobian */
+typedef struct DASSL_JACOBIAN_JOB
+{
+  double *t;
+  double *y;
+  double *yprime;
+  double *delta;
+  double *matrixA;
+  double *cj;
+  double *h;
+  double *wt;
+  int *ipar;
+  DASSL_DATA *dasslData;
+} DASSL_JACOBIAN_JOB;
+
+/* \fn jacA_symColoredGroup(JACOBIAN_WORKER *worker, unsigned int color, void *userData)
+ *
+ * Evaluates one color group of the symbolical jacobian on the private data of a worker.
+ */
+static int jacA_symColoredGroup(JACOBIAN_WORKER *worker, unsigned int color, void *userData)
+{
+  DASSL_JACOBIAN_JOB *job = (DASSL_JACOBIAN_JOB*) userData;
+  DATA* data = &(worker->data);
+  ANALYTIC_JACOBIAN* jacobian = &(data->simulationInfo->analyticJacobians[data->callback->INDEX_JAC_A]);
+  unsigned int j,l,ii;
+
+  for(ii=0; ii < jacobian->sizeCols; ii++)
+    if(jacobian->sparsePattern.colorCols[ii]-1 == color)
+      jacobian->seedVars[ii] = 1;
+
+  data->callback->functionJacA_column(data, &(worker->threadData), jacobian, NULL);
+
+  increaseJacContext(data);
+
+  for(j = 0; j < jacobian->sizeCols; j++)
+  {
+    if(jacobian->seedVars[j] == 1)
+    {
+      for(ii = jacobian->sparsePattern.leadindex[j]; ii < jacobian->sparsePattern.leadindex[j+1]; ii++)
+      {
+        l = jacobian->sparsePattern.index[ii];
+        job->matrixA[j*jacobian->sizeRows + l] = jacobian->resultVars[l];
+      }
+      jacobian->seedVars[j] = 0;
+    }
+  }
+
+  return 0;
+}
+
+/* \fn jacA_numColoredGroup(JACOBIAN_WORKER *worker, unsigned int color, void *userData)
+ *
+ * Evaluates one color group of the numerical jacobian on the private data of a worker.
+ * The residual function expects y to be the states in localData[0], so the worker
+ * perturbs its private copy of them.
+ */
+static int jacA_numColoredGroup(JACOBIAN_WORKER *worker, unsigned int color, void *userData)
+{
+  DASSL_JACOBIAN_JOB *job = (DASSL_JACOBIAN_JOB*) userData;
+  DASSL_DATA* dasslData = job->dasslData;
+  DATA* data = &(worker->data);
+  ANALYTIC_JACOBIAN* jacobian = &(data->simulationInfo->analyticJacobians[data->callback->INDEX_JAC_A]);
+  double *y = data->localData[0]->realVars;
+  double *rpar[3];
+
+  double delta_h = numericalDifferentiationDeltaXsolver;
+  double delta_hhh;
+  /* the color groups are disjoint, so the workers share delta_hh */
+  double* delta_hh = dasslData->delta_hh;
+  int ires = 0;
+
+  unsigned int j,l,ii;
+
+  rpar[0] = (double*) (void*) data;
+  rpar[1] = (double*) (void*) dasslData;
+  rpar[2] = (double*) (void*) &(worker->threadData);
+
+  memcpy(y, job->y, dasslData->N*sizeof(double));
+
+  for(ii=0; ii < jacobian->sizeCols; ii++)
+  {
+    if(jacobian->sparsePattern.colorCols[ii]-1 == color)
+    {
+      delta_hhh = *job->h * job->yprime[ii];
+      delta_hh[ii] = delta_h * fmax(fmax(fabs(y[ii]),fabs(delta_hhh)),fabs(1./job->wt[ii]));
+      delta_hh[ii] = (delta_hhh >= 0 ? delta_hh[ii] : -delta_hh[ii]);
+      delta_hh[ii] = y[ii] + delta_hh[ii] - y[ii];
+
+      y[ii] += delta_hh[ii];
+
+      delta_hh[ii] = 1. / delta_hh[ii];
+    }
+  }
+
+  (*dasslData->residualFunction)(job->t, y, job->yprime, job->cj, worker->newdelta, &ires, (double*) (void*) rpar, job->ipar);
+
+  increaseJacContext(data);
+
+  for(ii = 0; ii < jacobian->sizeCols; ii++)
+  {
+    if(jacobian->sparsePattern.colorCols[ii]-1 == color)
+    {
+      for(j = jacobian->sparsePattern.leadindex[ii]; j < jacobian->sparsePattern.leadindex[ii+1]; j++)
+      {
+        l = jacobian->sparsePattern.index[j];
+        job->matrixA[l + ii*jacobian->sizeRows] = (worker->newdelta[l] - job->delta[l]) * delta_hh[ii];
+      }
+    }
+  }
+
+  return 0;
+}
+
 /* \fn jacA_symColored(double *t, double *y, double *yprime, double *deltaD, double *pd, double *cj, double *h, double *wt,
    double *rpar, int* ipar)
  *
@@ -863,6 +987,14 @@ int jacA_symColored(double *t, double *y, double *yprime, double *delta, double
    * in the Linear loops of  functionJacA_column */
   setContext(data, t, CONTEXT_SYM_JACOBIAN);
 
+  if(dasslData->parallelJacobian)
+  {
+    DASSL_JACOBIAN_JOB job = {t, y, yprime, delta, matrixA, cj, h, wt, ipar, dasslData};
+    int ret = evalParallelJacobian(dasslData->parallelJacobian, data, threadData, jacobian->sparsePattern.maxColors, jacA_symColoredGroup, &job);
+    TRACE_POP
+    return ret;
+  }
+
   for(i=0; i < jacobian->sparsePattern.maxColors; i++)
   {
     for(ii=0; ii < jacobian->sizeCols; ii++)
@@ -1024,6 +1156,14 @@ int jacA_numColored(double *t, double *y, double *yprime, double *delta, double
   /* set context for the start values extrapolation of non-linear algebraic loops */
   setContext(data, t, CONTEXT_JACOBIAN);
 
+  if(dasslData->parallelJacobian)
+  {
+    DASSL_JACOBIAN_JOB job = {t, y, yprime, delta, matrixA, cj, h, wt, ipar, dasslData};
+    int ret = evalParallelJacobian(dasslData->parallelJacobian, data, threadData, jacobian->sparsePattern.maxColors, jacA_numColoredGroup, &job);
+    TRACE_POP
+    return ret;
+  }
+
   for(i = 0; i < jacobian->sparsePattern.maxColors; i++)
   {
     for(ii=0; ii < jacobian->sizeCols; ii++)
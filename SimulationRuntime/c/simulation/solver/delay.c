@@ -36,15 +36,57 @@
 #include "simulation/solver/delay.h"
 #include "util/omc_error.h"
 #include "simulation_data.h"
-#include "util/ringbuffer.h"
 #include "openmodelica.h"
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <math.h>
 
+#define DELAY_LINE_INITIAL_CAPACITY 1024
+#define DELAY_CURSOR_STEPS 8 /* samples the cursor walks before falling back to bisection */
 
-/* the delayStructure looks like a matrix (rows = expressionNumber+currentColumnIndex, columns={time, value}) */
+/*
+ * Each delay expression owns a line of slots in one shared arena. New samples
+ * are appended; samples older than time-delayMax are only dropped once the
+ * line is full (by moving the remaining samples to the start of the line), and
+ * the line is only grown if that did not free at least half of it. Lookups
+ * start at the sample found by the previous lookup.
+ */
 
+void allocDelayArena(DELAY_ARENA *arena, long nLines)
+{
+  long i;
+  arena->nLines = nLines;
+  arena->size = nLines * DELAY_LINE_INITIAL_CAPACITY;
+  arena->lines = nLines ? (DELAY_LINE*) calloc(nLines, sizeof(DELAY_LINE)) : NULL;
+  arena->samples = nLines ? (TIME_AND_VALUE*) malloc(arena->size * sizeof(TIME_AND_VALUE)) : NULL;
+  assertStreamPrint(NULL, 0 == nLines || (0 != arena->lines && 0 != arena->samples), "out of memory");
+  for(i=0; i<nLines; i++) {
+    arena->lines[i].offset = i * DELAY_LINE_INITIAL_CAPACITY;
+    arena->lines[i].capacity = DELAY_LINE_INITIAL_CAPACITY;
+  }
+}
+
+/* empties all lines but keeps their slots */
+void resetDelayArena(DELAY_ARENA *arena)
+{
+  long i;
+  for(i=0; i<arena->nLines; i++) {
+    arena->lines[i].nSamples = 0;
+    arena->lines[i].cursor = 0;
+  }
+}
+
+void freeDelayArena(DELAY_ARENA *arena)
+{
+  free(arena->lines);
+  free(arena->samples);
+  arena->lines = NULL;
+  arena->samples = NULL;
+  arena->nLines = 0;
+  arena->size = 0;
+}
 
 void initDelay(DATA* data, double startTime)
 {
@@ -52,62 +94,149 @@ void initDelay(DATA* data, double startTime)
   data->simulationInfo->tStart = startTime;
 }
 
+static inline TIME_AND_VALUE* lineSamples(DELAY_ARENA *arena, DELAY_LINE *line)
+{
+  return arena->samples + line->offset;
+}
+
 /*
- * Find row with greatest time that is smaller than or equal to 'time'
- * Conditions:
- *  the buffer in 'delayStruct' is not empty
- *  'time' is smaller than the last entry in 'delayStruct'
+ * Returns the last sample with s[k].t <= time, or 0 if there is none.
+ * Conditions: the line is not empty
  */
-static int findTime(double time, RINGBUFFER *delayStruct)
+static long findSample(DELAY_LINE *line, const TIME_AND_VALUE *s, double time)
 {
-  int start = 0;
-  int end = ringBufferLength(delayStruct);
-  double t;
+  long n = line->nSamples;
+  long k = line->cursor < n ? line->cursor : n-1;
+  long start, end;
+  int step;
 
+  for(step=0; step<DELAY_CURSOR_STEPS; step++) {
+    if(s[k].t > time) {
+      if(k == 0) {
+        return 0;
+      }
+      k--;
+    } else if(k+1 < n && s[k+1].t <= time) {
+      k++;
+    } else {
+      line->cursor = k;
+      return k;
+    }
+  }
 
-  infoStreamPrint(LOG_EVENTS_V, 0, "findTime %e", time);
-  do
-  {
-    int i = (start + end) / 2;
-    t = ((TIME_AND_VALUE*)getRingData(delayStruct, i))->t;
-    infoStreamPrint(LOG_EVENTS_V, 0, "time(%d, %d)[%d] = %e", start, end, i, t);
-    if(t > time)
+  /* bisection: s[start].t <= time < s[end].t */
+  if(s[0].t > time) {
+    line->cursor = 0;
+    return 0;
+  }
+  start = 0;
+  end = n;
+  while(end > start + 1) {
+    long i = start + (end - start) / 2;
+    if(s[i].t > time) {
       end = i;
-    else
+    } else {
       start = i;
-  }while(t != time && end > start + 1);
-  infoStreamPrint(LOG_EVENTS_V, 0, "return time[%d, %d] = %e", start, end, t);
-  return (start);
+    }
+  }
+  line->cursor = start;
+  return start;
+}
+
+/* Moves the samples still needed at time-delayMax to the start of the line */
+static void trimDelayLine(DELAY_ARENA *arena, DELAY_LINE *line, double time, double delayMax)
+{
+  TIME_AND_VALUE *s = lineSamples(arena, line);
+  long k = findSample(line, s, time - delayMax);
+  /* keep one more sample before the interval for the interpolation slope */
+  long drop = k > 1 ? k - 1 : 0;
+
+  if(drop > 0) {
+    memmove(s, s + drop, (line->nSamples - drop) * sizeof(TIME_AND_VALUE));
+    line->nSamples -= drop;
+  }
+  line->cursor = line->cursor > drop ? line->cursor - drop : 0;
+}
+
+/* Doubles the capacity of line exprNumber; the lines behind it are moved */
+static void growDelayLine(DELAY_ARENA *arena, long exprNumber)
+{
+  DELAY_LINE *line = arena->lines + exprNumber;
+  long extra = line->capacity;
+  long end = line->offset + line->capacity;
+  long i;
+
+  arena->samples = (TIME_AND_VALUE*) realloc(arena->samples, (arena->size + extra) * sizeof(TIME_AND_VALUE));
+  assertStreamPrint(NULL, 0 != arena->samples, "out of memory");
+  memmove(arena->samples + end + extra, arena->samples + end, (arena->size - end) * sizeof(TIME_AND_VALUE));
+  arena->size += extra;
+  line->capacity += extra;
+  for(i=exprNumber+1; i<arena->nLines; i++) {
+    arena->lines[i].offset += extra;
+  }
 }
 
 void storeDelayedExpression(DATA* data, threadData_t *threadData, int exprNumber, double exprValue, double time, double delayTime, double delayMax)
 {
-  int i;
-  TIME_AND_VALUE tpl;
+  DELAY_ARENA *arena = &data->simulationInfo->delayArena;
+  DELAY_LINE *line;
+  TIME_AND_VALUE *tpl;
 
-  /* Allocate more space for expressions */
   assertStreamPrint(threadData, exprNumber < data->modelData->nDelayExpressions, "storeDelayedExpression: invalid expression number %d", exprNumber);
   assertStreamPrint(threadData, 0 <= exprNumber, "storeDelayedExpression: invalid expression number %d", exprNumber);
   assertStreamPrint(threadData, data->simulationInfo->tStart <= time, "storeDelayedExpression: time is smaller than starting time. Value ignored");
 
-  tpl.t = time;
-  tpl.value = exprValue;
-  appendRingData(data->simulationInfo->delayStructure[exprNumber], &tpl);
-  infoStreamPrint(LOG_EVENTS_V, 0, "storeDelayed[%d] %g:%g position=%d", exprNumber, time, exprValue,ringBufferLength(data->simulationInfo->delayStructure[exprNumber]));
-
-  /* dequeue not longer needed values */
-  i = findTime(time-delayMax+DBL_EPSILON,data->simulationInfo->delayStructure[exprNumber]);
-  if(i > 0){
-    dequeueNFirstRingDatas(data->simulationInfo->delayStructure[exprNumber], i-1);
-    infoStreamPrint(LOG_EVENTS_V, 0, "delayImpl: dequeueNFirstRingDatas[%d] %g = %g", i, time-delayMax+DBL_EPSILON, delayTime);
+  line = arena->lines + exprNumber;
+  if(line->nSamples == line->capacity) {
+    /* batch trimming: only drop the old samples once the line is full */
+    trimDelayLine(arena, line, time, delayMax);
+    if(2 * line->nSamples > line->capacity) {
+      growDelayLine(arena, exprNumber);
+      line = arena->lines + exprNumber;
+    }
+    infoStreamPrint(LOG_EVENTS_V, 0, "storeDelayed[%d]: trimmed to %ld samples, capacity %ld", exprNumber, line->nSamples, line->capacity);
   }
+
+  tpl = lineSamples(arena, line) + line->nSamples;
+  tpl->t = time;
+  tpl->value = exprValue;
+  line->nSamples++;
+  infoStreamPrint(LOG_EVENTS_V, 0, "storeDelayed[%d] %g:%g position=%ld", exprNumber, time, exprValue, line->nSamples);
 }
 
+/*
+ * Cubic Hermite interpolation of the interval (t1,v1)-(t2,v2) at time. The
+ * slopes are central differences with the neighbouring samples (t0,v0) and
+ * (t3,v3), where there are any, limited such that monotone data stays
+ * monotone (Fritsch-Carlson). Samples with equal time stamps are events; the
+ * slope does not reach across them.
+ */
+static double hermiteInterpolation(const TIME_AND_VALUE *p0, const TIME_AND_VALUE *p1, const TIME_AND_VALUE *p2, const TIME_AND_VALUE *p3, double time)
+{
+  double h = p2->t - p1->t;
+  double d = (p2->value - p1->value) / h;
+  double m1 = (p0 && p0->t < p1->t) ? (p2->value - p0->value) / (p2->t - p0->t) : d;
+  double m2 = (p3 && p3->t > p2->t) ? (p3->value - p1->value) / (p3->t - p1->t) : d;
+  double s = (time - p1->t) / h;
+  double s2 = s * s, s3 = s2 * s;
+
+  if(d == 0.0) {
+    m1 = m2 = 0.0;
+  } else {
+    if(m1 * d <= 0.0) m1 = 0.0; else if(fabs(m1) > 3.0 * fabs(d)) m1 = 3.0 * d;
+    if(m2 * d <= 0.0) m2 = 0.0; else if(fabs(m2) > 3.0 * fabs(d)) m2 = 3.0 * d;
+  }
+
+  return (2.0*s3 - 3.0*s2 + 1.0) * p1->value + (s3 - 2.0*s2 + s) * h * m1
+       + (-2.0*s3 + 3.0*s2) * p2->value + (s3 - s2) * h * m2;
+}
 
 double delayImpl(DATA* data, threadData_t *threadData, int exprNumber, double exprValue, double time, double delayTime, double delayMax)
 {
-  RINGBUFFER* delayStruct = data->simulationInfo->delayStructure[exprNumber];
-  int length = ringBufferLength(delayStruct);
+  DELAY_ARENA *arena = &data->simulationInfo->delayArena;
+  DELAY_LINE *line;
+  TIME_AND_VALUE *s;
+  long length;
 
   infoStreamPrint(LOG_EVENTS_V, 0, "delayImpl: exprNumber = %d, exprValue = %g, time = %g, delayTime = %g", exprNumber, exprValue, time, delayTime);
 
@@ -116,6 +245,10 @@ double delayImpl(DATA* data, threadData_t *threadData, int exprNumber, double ex
   assertStreamPrint(threadData, 0 <= exprNumber, "invalid exprNumber = %d", exprNumber);
   assertStreamPrint(threadData, exprNumber < data->modelData->nDelayExpressions, "invalid exprNumber = %d", exprNumber);
 
+  line = arena->lines + exprNumber;
+  s = lineSamples(arena, line);
+  length = line->nSamples;
+
   if(time <= data->simulationInfo->tStart)
   {
     infoStreamPrint(LOG_EVENTS_V, 0, "delayImpl: Entered at time < starting time: %g.", exprValue);
@@ -146,67 +279,52 @@ double delayImpl(DATA* data, threadData_t *threadData, int exprNumber, double ex
    */
   if(time <= data->simulationInfo->tStart + delayTime)
   {
-    double res = ((TIME_AND_VALUE*)getRingData(delayStruct, 0))->value;
-    infoStreamPrint(LOG_EVENTS_V, 0, "findTime: time <= tStart + delayTime: [%d] = %g",exprNumber, res);
-    return res;
+    infoStreamPrint(LOG_EVENTS_V, 0, "delayImpl: time <= tStart + delayTime: [%d] = %g", exprNumber, s[0].value);
+    return s[0].value;
   }
   else
   {
     /* return expr(time-delayTime) */
     double timeStamp = time - delayTime;
-    double time0, time1, value0, value1;
-    int i;
+    TIME_AND_VALUE current;
+    const TIME_AND_VALUE *p0, *p1, *p2, *p3;
+    long i;
 
-    assertStreamPrint(threadData, 0.0 <= delayTime, "Negative delay requested: delayTime = %g", delayTime);
-
-    /* find the row for the lower limit */
-    if(timeStamp > ((TIME_AND_VALUE*)getRingData(delayStruct, length - 1))->t)
+    if(timeStamp >= s[length-1].t)
     {
-      infoStreamPrint(LOG_EVENTS_V, 0, "delayImpl: find the row  %g = %g", timeStamp, ((TIME_AND_VALUE*)getRingData(delayStruct, length - 1))->t);
       /* delay between the last accepted time step and the current time */
-      time0 = ((TIME_AND_VALUE*)getRingData(delayStruct, length - 1))->t;
-      value0 = ((TIME_AND_VALUE*)getRingData(delayStruct, length - 1))->value;
-      time1 = time;
-      value1 = exprValue;
-      infoStreamPrint(LOG_EVENTS_V, 0, "delayImpl: times %g and %g", time0, time1);
-      infoStreamPrint(LOG_EVENTS_V, 0, "delayImpl: values %g and  %g", value0, value1);
+      if(timeStamp == s[length-1].t || time == s[length-1].t) {
+        return s[length-1].value;
+      }
+      current.t = time;
+      current.value = exprValue;
+      i = length - 1;
+      p2 = &current;
+      p3 = NULL;
     }
     else
     {
-      i = findTime(timeStamp, delayStruct);
-      assertStreamPrint(threadData, i < length, "%d = i < length = %d", i, length);
-      time0 = ((TIME_AND_VALUE*)getRingData(delayStruct, i))->t;
-      value0 = ((TIME_AND_VALUE*)getRingData(delayStruct, i))->value;
-
-      /* was it the last value? */
-      if(i+1 == length)
-      {
-        return value0;
+      i = findSample(line, s, timeStamp);
+      if(s[i].t > timeStamp) {
+        /* before the first stored sample */
+        return s[0].value;
       }
-      time1 = ((TIME_AND_VALUE*)getRingData(delayStruct, i+1))->t;
-      value1 = ((TIME_AND_VALUE*)getRingData(delayStruct, i+1))->value;
+      p2 = s + i + 1;
+      p3 = i + 2 < length ? s + i + 2 : NULL;
     }
-    /* was it an exact match?*/
-    if(time0 == timeStamp){
-      infoStreamPrint(LOG_EVENTS_V, 0, "delayImpl: Exact match at %g = %g", timeStamp, value0);
+    p1 = s + i;
+    p0 = i > 0 ? s + i - 1 : NULL;
 
-      return value0;
-    } else if(time1 == timeStamp) {
-      infoStreamPrint(LOG_EVENTS_V, 0, "delayImpl: Exact match at %g = %g", timeStamp, value1);
-
-      return value1;
+    /* was it an exact match?*/
+    if(p1->t == timeStamp) {
+      infoStreamPrint(LOG_EVENTS_V, 0, "delayImpl: Exact match at %g = %g", timeStamp, p1->value);
+      return p1->value;
     } else {
-      /* linear interpolation */
-      double timedif = time1 - time0;
-      double dt0 = time1 - timeStamp;
-      double dt1 = timeStamp - time0;
-      double retVal = (value0 * dt0 + value1 * dt1) / timedif;
-      infoStreamPrint(LOG_EVENTS_V, 0, "delayImpl: Linear interpolation of %g between %g and %g", timeStamp, time0, time1);
-      infoStreamPrint(LOG_EVENTS_V, 0, "delayImpl: Linear interpolation of %g value: %g and %g = %g", timeStamp, value0, value1, retVal);
+      double retVal = hermiteInterpolation(p0, p1, p2, p3, timeStamp);
+      infoStreamPrint(LOG_EVENTS_V, 0, "delayImpl: Hermite interpolation of %g between %g and %g = %g", timeStamp, p1->t, p2->t, retVal);
       return retVal;
     }
   }
-
 }
 
 #endif
@@ -36,12 +36,6 @@
 
 #include "simulation_data.h"
 
-typedef struct TIME_AND_VALUE
-{
-  double t; /* time; not named that due to macros */
-  double value;
-} TIME_AND_VALUE;
-
 typedef struct EXPRESSION_DELAY_BUFFER
 {
   long currentIndex;
@@ -53,6 +47,9 @@ typedef struct EXPRESSION_DELAY_BUFFER
   extern "C" {
 #endif
 
+  void allocDelayArena(DELAY_ARENA *arena, long nLines);
+  void resetDelayArena(DELAY_ARENA *arena);
+  void freeDelayArena(DELAY_ARENA *arena);
   void initDelay(DATA* data, double startTime);
   double delayImpl(DATA* data, threadData_t *threadData, int exprNumber, double exprValue, double t, double delayTime, double maxDelay);
   void storeDelayedExpression(DATA* data, threadData_t *threadData, int exprNumber, double exprValue, double t, double delayTime, double delayMax);
@@ -51,7 +51,7 @@ extern "C" {
 #endif
 
 int maxBisectionIterations = 0;
-double bisection(DATA* data, threadData_t *threadData, double*, double*, double*, double*, LIST*, LIST*);
+double bisection(DATA* data, threadData_t *threadData, double*, double*, const double*, LIST*, LIST*);
 int checkZeroCrossings(DATA *data, LIST *list, LIST*);
 void saveZeroCrossingsAfterEvent(DATA *data, threadData_t *threadData);
 
@@ -83,6 +83,48 @@ void checkForSampleEvent(DATA *data, SOLVER_INFO* solverInfo)
   TRACE_POP
 }
 
+/* zero-crossings are scanned in blocks of this size */
+#define ZERO_CROSSING_SCAN_BLOCK 64
+
+/*! \fn scanZeroCrossings
+ *
+ *  \param [in]  [zc] current zero-crossing values
+ *  \param [in]  [zcPre] previous zero-crossing values
+ *  \param [in]  [n] number of zero-crossings
+ *  \param [out] [changed] indexes of the zero-crossings that changed sign
+ *  \return number of entries written to changed
+ *
+ *  The test of a block is free of branches, so that the compiler can
+ *  vectorise it. It may also flag a block with a zero value; only flagged
+ *  blocks are searched element by element for a real sign change.
+ */
+static long scanZeroCrossings(const modelica_real *zc, const modelica_real *zcPre, long n, long *changed)
+{
+  long nChanged = 0;
+  long start, end, i;
+
+  for(start=0; start<n; start=end)
+  {
+    int any = 0;
+    end = (start + ZERO_CROSSING_SCAN_BLOCK < n) ? start + ZERO_CROSSING_SCAN_BLOCK : n;
+    for(i=start; i<end; i++)
+    {
+      any |= (zc[i]*zcPre[i] <= 0.0);
+    }
+    if(any)
+    {
+      for(i=start; i<end; i++)
+      {
+        if(sign(zc[i]) != sign(zcPre[i]))
+        {
+          changed[nChanged++] = i;
+        }
+      }
+    }
+  }
+  return nChanged;
+}
+
 /*! \fn checkForStateEvent
  *
  *  \param [ref] [data]
@@ -96,39 +138,39 @@ int checkForStateEvent(DATA* data, LIST *eventList)
 {
   TRACE_PUSH
   long i=0;
+  long *changed = data->simulationInfo->zeroCrossingsChanged;
+  const long nChanged = scanZeroCrossings(data->simulationInfo->zeroCrossings, data->simulationInfo->zeroCrossingsPre, data->modelData->nZeroCrossings, changed);
 
-  debugStreamPrint(LOG_EVENTS, 1, "check state-event zerocrossing at time %g",  data->localData[0]->timeValue);
-
-  for(i=0; i<data->modelData->nZeroCrossings; i++)
+  if (DEBUG_STREAM(LOG_EVENTS))
   {
-    int *eq_indexes;
-    const char *exp_str = data->callback->zeroCrossingDescription(i,&eq_indexes);
-    debugStreamPrintWithEquationIndexes(LOG_EVENTS, 1, eq_indexes, "%s", exp_str);
+    debugStreamPrint(LOG_EVENTS, 1, "check state-event zerocrossing at time %g",  data->localData[0]->timeValue);
 
-    if(sign(data->simulationInfo->zeroCrossings[i]) != sign(data->simulationInfo->zeroCrossingsPre[i]))
-    {
-      debugStreamPrint(LOG_EVENTS, 0, "changed:   %s", (data->simulationInfo->zeroCrossingsPre[i] > 0) ? "TRUE -> FALSE" : "FALSE -> TRUE");
-      listPushFront(eventList, &(data->simulationInfo->zeroCrossingIndex[i]));
-    }
-    else
+    for(i=0; i<data->modelData->nZeroCrossings; i++)
     {
-      debugStreamPrint(LOG_EVENTS, 0, "unchanged: %s", (data->simulationInfo->zeroCrossingsPre[i] > 0) ? "TRUE -- TRUE" : "FALSE -- FALSE");
-    }
+      int *eq_indexes;
+      const char *exp_str = data->callback->zeroCrossingDescription(i,&eq_indexes);
+      debugStreamPrintWithEquationIndexes(LOG_EVENTS, 1, eq_indexes, "%s", exp_str);
 
-    if (DEBUG_STREAM(LOG_EVENTS))
+      if(sign(data->simulationInfo->zeroCrossings[i]) != sign(data->simulationInfo->zeroCrossingsPre[i]))
+      {
+        debugStreamPrint(LOG_EVENTS, 0, "changed:   %s", (data->simulationInfo->zeroCrossingsPre[i] > 0) ? "TRUE -> FALSE" : "FALSE -> TRUE");
+      }
+      else
+      {
+        debugStreamPrint(LOG_EVENTS, 0, "unchanged: %s", (data->simulationInfo->zeroCrossingsPre[i] > 0) ? "TRUE -- TRUE" : "FALSE -- FALSE");
+      }
       messageClose(LOG_EVENTS);
-  }
-  if (DEBUG_STREAM(LOG_EVENTS))
+    }
     messageClose(LOG_EVENTS);
+  }
 
-  if(listLen(eventList) > 0)
+  for(i=0; i<nChanged; i++)
   {
-    TRACE_POP
-    return 1;
+    listPushFront(eventList, &(data->simulationInfo->zeroCrossingIndex[changed[i]]));
   }
 
   TRACE_POP
-  return 0;
+  return nChanged > 0;
 }
 
 /*! \fn checkEvents
@@ -283,6 +325,38 @@ void handleEvents(DATA* data, threadData_t *threadData, LIST* eventLst, double *
   TRACE_POP
 }
 
+/*! \fn hermiteStates
+ *
+ *  \param [in]  [nStates]
+ *  \param [in]  [work] states and derivatives at both ends of the step
+ *  \param [in]  [t0] start of the step
+ *  \param [in]  [h] step size
+ *  \param [in]  [t] time to interpolate the states at
+ *  \param [out] [states]
+ *
+ *  Dense output of the last step: cubic Hermite interpolation of the states
+ *  from the states and derivatives at both ends of the step, which the
+ *  solver loop has evaluated already.
+ */
+static void hermiteStates(long nStates, const double *work, double t0, double h, double t, double *states)
+{
+  const double *x0 = work;
+  const double *x1 = work + nStates;
+  const double *dx0 = work + 2*nStates;
+  const double *dx1 = work + 3*nStates;
+  const double s = h > 0.0 ? (t - t0)/h : 1.0;
+  const double h00 = (1.0 + 2.0*s)*(1.0 - s)*(1.0 - s);
+  const double h10 = s*(1.0 - s)*(1.0 - s)*h;
+  const double h01 = s*s*(3.0 - 2.0*s);
+  const double h11 = s*s*(s - 1.0)*h;
+  long i;
+
+  for(i=0; i<nStates; i++)
+  {
+    states[i] = h00*x0[i] + h10*dx0[i] + h01*x1[i] + h11*dx1[i];
+  }
+}
+
 /*! \fn findRoot
  *
  *  \param [ref] [data]
@@ -299,31 +373,31 @@ double findRoot(DATA* data, threadData_t *threadData, LIST *eventList)
   double eventTime;
   long event_id;
   LIST_NODE* it;
-  fortran_integer i=0;
-  static LIST *tmpEventList = NULL;
-
-  double *states_right = (double*) malloc(data->modelData->nStates * sizeof(double));
-  double *states_left = (double*) malloc(data->modelData->nStates * sizeof(double));
+  const long nStates = data->modelData->nStates;
+  const long evaluations = data->simulationInfo->callStatistics.eventLocationEvaluations;
+  LIST *tmpEventList = data->simulationInfo->eventLocationList;
+  double *work = data->simulationInfo->eventLocationWork;
 
   double time_left = data->simulationInfo->timeValueOld;
   double time_right = data->localData[0]->timeValue;
+  const double t0 = time_left;
+  const double h = time_right - time_left;
 
-  tmpEventList = allocList(sizeof(long));
-
-  assert(states_right);
-  assert(states_left);
+  listClear(tmpEventList);
 
   for(it=listFirstNode(eventList); it; it=listNextNode(it))
   {
     infoStreamPrint(LOG_ZEROCROSSINGS, 0, "search for current event. Events in list: %ld", *((long*)listNodeData(it)));
   }
 
-  /* write states to work arrays */
-  memcpy(states_left,  data->simulationInfo->realVarsOld, data->modelData->nStates * sizeof(double));
-  memcpy(states_right, data->localData[0]->realVars    , data->modelData->nStates * sizeof(double));
+  /* write states and derivatives at both ends of the step to the work array */
+  memcpy(work,             data->simulationInfo->realVarsOld,         nStates * sizeof(double));
+  memcpy(work + nStates,   data->localData[0]->realVars,              nStates * sizeof(double));
+  memcpy(work + 2*nStates, data->simulationInfo->realVarsOld + nStates, nStates * sizeof(double));
+  memcpy(work + 3*nStates, data->localData[0]->realVars + nStates,    nStates * sizeof(double));
 
   /* Search for event time and event_id with bisection method */
-  eventTime = bisection(data, threadData, &time_left, &time_right, states_left, states_right, tmpEventList, eventList);
+  eventTime = bisection(data, threadData, &time_left, &time_right, work, tmpEventList, eventList);
 
   if(listLen(tmpEventList) == 0)
   {
@@ -372,11 +446,11 @@ double findRoot(DATA* data, threadData_t *threadData, LIST *eventList)
 
   eventTime = time_right;
   debugStreamPrint(LOG_EVENTS, 0, "time: %.10e", eventTime);
+  infoStreamPrint(LOG_EVENTS_V, 0, "state event located in [%.15g, %.15g] after %ld zero-crossing evaluations", time_left, time_right,
+                  data->simulationInfo->callStatistics.eventLocationEvaluations - evaluations);
 
   data->localData[0]->timeValue = time_left;
-  for(i=0; i < data->modelData->nStates; i++) {
-    data->localData[0]->realVars[i] = states_left[i];
-  }
+  hermiteStates(nStates, work, t0, h, time_left, data->localData[0]->realVars);
 
   /* determined continuous system */
   data->callback->updateContinuousSystem(data, threadData);
@@ -384,13 +458,7 @@ double findRoot(DATA* data, threadData_t *threadData, LIST *eventList)
   /*sim_result_emit(data);*/
 
   data->localData[0]->timeValue = eventTime;
-  for(i=0; i < data->modelData->nStates; i++)
-  {
-    data->localData[0]->realVars[i] = states_right[i];
-  }
-
-  free(states_left);
-  free(states_right);
+  hermiteStates(nStates, work, t0, h, eventTime, data->localData[0]->realVars);
 
   TRACE_POP
   return eventTime;
@@ -401,21 +469,23 @@ double findRoot(DATA* data, threadData_t *threadData, LIST *eventList)
  *  \param [ref] [data]
  *  \param [ref] [a]
  *  \param [ref] [b]
- *  \param [ref] [states_a]
- *  \param [ref] [states_b]
+ *  \param [in]  [work] states and derivatives at a and b, see hermiteStates
  *  \param [ref] [eventListTmp]
  *  \param [in]  [eventList]
  *  \return Founded event time
  *
- *  Method to find root in interval [oldTime, timeValue]
+ *  Method to find root in interval [oldTime, timeValue]. The zero-crossing
+ *  functions only deliver signs, so the interval is bisected; the states
+ *  inside the interval are taken from the dense output of the step.
  */
-double bisection(DATA* data, threadData_t *threadData, double* a, double* b, double* states_a, double* states_b, LIST *tmpEventList, LIST *eventList)
+double bisection(DATA* data, threadData_t *threadData, double* a, double* b, const double* work, LIST *tmpEventList, LIST *eventList)
 {
   TRACE_PUSH
 
   double TTOL = MINIMAL_STEP_SIZE + MINIMAL_STEP_SIZE*fabs(*b-*a); /* absTol + relTol*abs(b-a) */
   double c;
-  long i=0;
+  const double t0 = *a;
+  const double h = *b - *a;
   /* n >= log(2)/log(2) + log(|b-a|/TOL)/log(2)*/
   unsigned int n = maxBisectionIterations > 0 ? maxBisectionIterations : 1 + ceil(log(fabs(*b - *a)/TTOL)/log(2));
 
@@ -430,10 +500,7 @@ double bisection(DATA* data, threadData_t *threadData, double* a, double* b, dou
     data->localData[0]->timeValue = c;
 
     /*calculates states at time c */
-    for(i=0; i < data->modelData->nStates; i++)
-    {
-      data->localData[0]->realVars[i] = 0.5*(states_a[i] + states_b[i]);
-    }
+    hermiteStates(data->modelData->nStates, work, t0, h, c, data->localData[0]->realVars);
 
     /*calculates Values dependents on new states*/
     /* read input vars */
@@ -443,16 +510,15 @@ double bisection(DATA* data, threadData_t *threadData, double* a, double* b, dou
     data->callback->function_ZeroCrossingsEquations(data, threadData);
 
     data->callback->function_ZeroCrossings(data, threadData, data->simulationInfo->zeroCrossings);
+    data->simulationInfo->callStatistics.eventLocationEvaluations++;
 
     if(checkZeroCrossings(data, tmpEventList, eventList))  /* If Zerocrossing in left Section */
     {
-      memcpy(states_b, data->localData[0]->realVars, data->modelData->nStates * sizeof(modelica_real));
       *b = c;
       memcpy(data->simulationInfo->zeroCrossingsBackup, data->simulationInfo->zeroCrossings, data->modelData->nZeroCrossings * sizeof(modelica_real));
     }
     else  /*else Zerocrossing in right Section */
     {
-      memcpy(states_a, data->localData[0]->realVars, data->modelData->nStates * sizeof(modelica_real));
       *a = c;
       memcpy(data->simulationInfo->zeroCrossingsPre, data->simulationInfo->zeroCrossings, data->modelData->nZeroCrossings * sizeof(modelica_real));
       memcpy(data->simulationInfo->zeroCrossings, data->simulationInfo->zeroCrossingsBackup, data->modelData->nZeroCrossings * sizeof(modelica_real));
@@ -516,13 +582,11 @@ int checkZeroCrossings(DATA *data, LIST *tmpEventList, LIST *eventList)
 void saveZeroCrossingsAfterEvent(DATA *data, threadData_t *threadData)
 {
   TRACE_PUSH
-  long i=0;
 
   infoStreamPrint(LOG_ZEROCROSSINGS, 0, "save all zerocrossings after an event at time=%g", data->localData[0]->timeValue); /* ??? */
 
   data->callback->function_ZeroCrossings(data, threadData, data->simulationInfo->zeroCrossings);
-  for(i=0; i<data->modelData->nZeroCrossings; i++)
-    data->simulationInfo->zeroCrossingsPre[i] = data->simulationInfo->zeroCrossings[i];
+  memcpy(data->simulationInfo->zeroCrossingsPre, data->simulationInfo->zeroCrossings, data->modelData->nZeroCrossings * sizeof(modelica_real));
 
   TRACE_POP
 }
@@ -98,6 +98,30 @@ static int idaScaleVector(N_Vector vec, double* factors, unsigned int size);
 static int idaReScaleVector(N_Vector vec, double* factors, unsigned int size);
 
 static IDA_SOLVER *idaDataGlobal;
+
+/* solver data of a worker of the parallel colored Jacobian */
+typedef struct IDA_JACOBIAN_WORKER
+{
+  IDA_SOLVER idaData;           /* copy of the solver data pointing to the private user data */
+  IDA_USERDATA simData;
+  N_Vector yy;                  /* private copy of the states */
+  N_Vector newdelta;            /* private residual */
+} IDA_JACOBIAN_WORKER;
+
+static IDA_JACOBIAN_WORKER* allocIdaJacobianWorker(long int N)
+{
+  IDA_JACOBIAN_WORKER *idaWorker = (IDA_JACOBIAN_WORKER*) calloc(1, sizeof(IDA_JACOBIAN_WORKER));
+  idaWorker->yy = N_VNew_Serial(N);
+  idaWorker->newdelta = N_VNew_Serial(N);
+  return idaWorker;
+}
+
+static void freeIdaJacobianWorker(IDA_JACOBIAN_WORKER *idaWorker)
+{
+  N_VDestroy_Serial(idaWorker->yy);
+  N_VDestroy_Serial(idaWorker->newdelta);
+  free(idaWorker);
+}
 static int initializedSolver = 0;
 int ida_event_update(DATA* data, threadData_t *threadData);
 
@@ -653,6 +677,22 @@ ida_solver_initial(DATA* data, threadData_t *threadData, SOLVER_INFO* solverInfo
       N_VSetArrayPointer_Serial((data->simulationInfo->sensitivityMatrix + i*idaData->N), idaData->ySResult[i]);
     }
   }
+  /* evaluate the color groups in parallel if -jacobianThreads is set */
+  idaData->parallelJacobian = NULL;
+  if (!idaData->daeMode && !idaData->idaSmode && !omc_flag[FLAG_IDA_SCALING] &&
+      (idaData->jacobianMethod == COLOREDNUMJAC || idaData->jacobianMethod == COLOREDSYMJAC ||
+       idaData->jacobianMethod == NUMJAC || idaData->jacobianMethod == SYMJAC))
+  {
+    idaData->parallelJacobian = allocParallelJacobian(data, threadData, data->callback->INDEX_JAC_A, idaData->N);
+    if (idaData->parallelJacobian)
+    {
+      for(i = 0; i < idaData->parallelJacobian->nThreads; ++i)
+      {
+        idaData->parallelJacobian->workers[i].solverData = allocIdaJacobianWorker(idaData->N);
+      }
+    }
+  }
+
   if (compiledInDAEMode){
     idaDataGlobal = idaData;
     initializedSolver = 1;
@@ -695,6 +735,17 @@ ida_solver_deinitial(IDA_SOLVER *idaData){
   N_VDestroy_Serial(idaData->errwgt);
   N_VDestroy_Serial(idaData->newdelta);
 
+  if (idaData->parallelJacobian)
+  {
+    int i;
+    printParallelJacobianStatistics(idaData->parallelJacobian);
+    for(i = 0; i < idaData->parallelJacobian->nThreads; ++i)
+    {
+      freeIdaJacobianWorker((IDA_JACOBIAN_WORKER*) idaData->parallelJacobian->workers[i].solverData);
+    }
+    freeParallelJacobian(idaData->parallelJacobian);
+  }
+
   IDAFree(&idaData->ida_mem);
 
   TRACE_POP
@@ -1314,6 +1365,138 @@ int rootsFunctionIDA(double time, N_Vector yy, N_Vector yp, double *gout, void*
 }
 
 
+static void setJacElementKluSparse(int row, int col, double value, int nth, SlsMat spJac);
+
+/* arguments of a Jacobian evaluation shared by the workers of the
+ * parallel colored Jacobian; either denseJac or sparseJac is set */
+typedef struct IDA_JACOBIAN_JOB
+{
+  double tt;
+  N_Vector yy;
+  N_Vector yp;
+  N_Vector rr;
+  double currentStep;
+  double *errwgt;
+  IDA_SOLVER *idaData;
+  DlsMat denseJac;
+  SlsMat sparseJac;
+} IDA_JACOBIAN_JOB;
+
+/* evaluates one color group of the numerical Jacobian on the private data of a worker */
+static
+int jacColoredNumericalGroup(JACOBIAN_WORKER *worker, unsigned int color, void *userData)
+{
+  IDA_JACOBIAN_JOB *job = (IDA_JACOBIAN_JOB*) userData;
+  IDA_JACOBIAN_WORKER *idaWorker = (IDA_JACOBIAN_WORKER*) worker->solverData;
+  IDA_SOLVER *idaData = &(idaWorker->idaData);
+  DATA* data = &(worker->data);
+  SPARSE_PATTERN* sparsePattern = &(data->simulationInfo->analyticJacobians[data->callback->INDEX_JAC_A].sparsePattern);
+
+  double *states = N_VGetArrayPointer(idaWorker->yy);
+  double *yprime = N_VGetArrayPointer(job->yp);
+  double *delta  = N_VGetArrayPointer(job->rr);
+  double *newdelta = N_VGetArrayPointer(idaWorker->newdelta);
+  double *errwgt = job->errwgt;
+  /* the color groups are disjoint, so the workers share delta_hh */
+  double *delta_hh = job->idaData->delta_hh;
+
+  double delta_h = numericalDifferentiationDeltaXsolver;
+  double delta_hhh;
+  long int j,l,ii;
+
+  /* the residual function takes its data from the user data */
+  *idaData = *job->idaData;
+  idaData->simData = &(idaWorker->simData);
+  idaData->newdelta = idaWorker->newdelta;
+  idaWorker->simData.data = data;
+  idaWorker->simData.threadData = &(worker->threadData);
+
+  memcpy(states, N_VGetArrayPointer(job->yy), idaData->N*sizeof(double));
+
+  for(ii=0; ii < idaData->N; ii++)
+  {
+    if(sparsePattern->colorCols[ii]-1 == color)
+    {
+      delta_hhh = job->currentStep * yprime[ii];
+      delta_hh[ii] = delta_h * fmax(fmax(fabs(states[ii]),fabs(delta_hhh)),fabs(1./errwgt[ii]));
+      delta_hh[ii] = (delta_hhh >= 0 ? delta_hh[ii] : -delta_hh[ii]);
+      delta_hh[ii] = (states[ii] + delta_hh[ii]) - states[ii];
+      states[ii] += delta_hh[ii];
+
+      delta_hh[ii] = 1. / delta_hh[ii];
+    }
+  }
+
+  (*idaData->residualFunction)(job->tt, idaWorker->yy, job->yp, idaWorker->newdelta, idaData);
+
+  increaseJacContext(data);
+
+  for(ii = 0; ii < idaData->N; ii++)
+  {
+    if(sparsePattern->colorCols[ii]-1 == color)
+    {
+      for(j = sparsePattern->leadindex[ii]; j < sparsePattern->leadindex[ii+1]; j++)
+      {
+        l = sparsePattern->index[j];
+        if (job->denseJac)
+        {
+          DENSE_ELEM(job->denseJac, l, ii) = (newdelta[l] - delta[l]) * delta_hh[ii];
+        }
+        else
+        {
+          setJacElementKluSparse(l, ii, (newdelta[l] - delta[l]) * delta_hh[ii], j, job->sparseJac);
+        }
+      }
+    }
+  }
+
+  return 0;
+}
+
+/* evaluates one color group of the symbolical Jacobian on the private data of a worker */
+static
+int jacColoredSymbolicalGroup(JACOBIAN_WORKER *worker, unsigned int color, void *userData)
+{
+  IDA_JACOBIAN_JOB *job = (IDA_JACOBIAN_JOB*) userData;
+  DATA* data = &(worker->data);
+  ANALYTIC_JACOBIAN* jacData = &(data->simulationInfo->analyticJacobians[data->callback->INDEX_JAC_A]);
+  SPARSE_PATTERN* sparsePattern = &(jacData->sparsePattern);
+  long int j,nth,ii;
+
+  for(ii=0; ii < job->idaData->N; ii++)
+  {
+    if(sparsePattern->colorCols[ii]-1 == color)
+    {
+      jacData->seedVars[ii] = 1;
+    }
+  }
+
+  data->callback->functionJacA_column(data, &(worker->threadData), jacData, NULL);
+  increaseJacContext(data);
+
+  for(ii = 0; ii < job->idaData->N; ii++)
+  {
+    if(sparsePattern->colorCols[ii]-1 == color)
+    {
+      for(nth = sparsePattern->leadindex[ii]; nth < sparsePattern->leadindex[ii+1]; nth++)
+      {
+        j = sparsePattern->index[nth];
+        if (job->denseJac)
+        {
+          DENSE_ELEM(job->denseJac, j, ii) = jacData->resultVars[j];
+        }
+        else
+        {
+          setJacElementKluSparse(j, ii, jacData->resultVars[j], nth, job->sparseJac);
+        }
+      }
+      jacData->seedVars[ii] = 0;
+    }
+  }
+
+  return 0;
+}
+
 /*
  *  function calculates a jacobian matrix by
  *  numerical method finite differences with coloring
@@ -1365,6 +1548,16 @@ int jacColoredNumericalDense(double tt, N_Vector yy, N_Vector yp, N_Vector rr, D
 
   setContext(data, &tt, CONTEXT_JACOBIAN);
 
+  if (idaData->parallelJacobian)
+  {
+    threadData_t* threadData = (threadData_t*)(((IDA_USERDATA*)idaData->simData)->threadData);
+    IDA_JACOBIAN_JOB job = {tt, yy, yp, rr, currentStep, errwgt, idaData, Jac, NULL};
+    int retVal = evalParallelJacobian(idaData->parallelJacobian, data, threadData, sparsePattern->maxColors, jacColoredNumericalGroup, &job);
+    unsetContext(data);
+    TRACE_POP
+    return retVal;
+  }
+
   for(i = 0; i < sparsePattern->maxColors; i++)
   {
     for(ii=0; ii < idaData->N; ii++)
@@ -1440,6 +1633,15 @@ int jacColoredSymbolicalDense(double tt, N_Vector yy, N_Vector yp, N_Vector rr,
 
   setContext(data, &tt, CONTEXT_SYM_JACOBIAN);
 
+  if (idaData->parallelJacobian)
+  {
+    IDA_JACOBIAN_JOB job = {tt, yy, yp, NULL, 0, NULL, idaData, Jac, NULL};
+    int retVal = evalParallelJacobian(idaData->parallelJacobian, data, threadData, sparsePattern->maxColors, jacColoredSymbolicalGroup, &job);
+    unsetContext(data);
+    TRACE_POP
+    return retVal;
+  }
+
   for(i = 0; i < sparsePattern->maxColors; i++)
   {
     for(ii=0; ii < idaData->N; ii++)
@@ -1614,6 +1816,19 @@ int jacoColoredNumericalSparse(double tt, N_Vector yy, N_Vector yp, N_Vector rr,
 
   setContext(data, &tt, CONTEXT_JACOBIAN);
 
+  /* the parallel Jacobian is only set up without scaling */
+  if (idaData->parallelJacobian)
+  {
+    threadData_t* threadData = (threadData_t*)(((IDA_USERDATA*)idaData->simData)->threadData);
+    IDA_JACOBIAN_JOB job = {tt, yy, yp, rr, currentStep, errwgt, idaData, NULL, Jac};
+    int retVal = evalParallelJacobian(idaData->parallelJacobian, data, threadData, sparsePattern->maxColors, jacColoredNumericalGroup, &job);
+    finishSparseColPtr(Jac, sparsePattern->numberOfNoneZeros);
+    unsetContext(data);
+    messageClose(LOG_SOLVER_V);
+    TRACE_POP
+    return retVal;
+  }
+
   /* rescale idaData->y and idaData->yp
    * the evaluation of the  residual function
    * needs to be performed on unscaled values
@@ -1720,6 +1935,16 @@ jacColoredSymbolicalSparse(double tt, N_Vector yy, N_Vector yp, N_Vector rr, Sls
 
   setContext(data, &tt, CONTEXT_SYM_JACOBIAN);
 
+  if (idaData->parallelJacobian)
+  {
+    IDA_JACOBIAN_JOB job = {tt, yy, yp, NULL, 0, NULL, idaData, NULL, Jac};
+    int retVal = evalParallelJacobian(idaData->parallelJacobian, data, threadData, sparsePattern->maxColors, jacColoredSymbolicalGroup, &job);
+    finishSparseColPtr(Jac, sparsePattern->numberOfNoneZeros);
+    unsetContext(data);
+    TRACE_POP
+    return retVal;
+  }
+
   for(i = 0; i < sparsePattern->maxColors; i++)
   {
     for(ii=0; ii < idaData->N; ii++)
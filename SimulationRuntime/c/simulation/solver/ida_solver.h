@@ -38,6 +38,7 @@
 #include "simulation_data.h"
 #include "util/simulation_options.h"
 #include "simulation/solver/solver_main.h"
+#include "simulation/solver/parallelJacobian.h"
 
 #ifdef WITH_SUNDIALS
 
@@ -85,6 +86,7 @@ typedef struct IDA_SOLVER
   double *delta_hh;
   N_Vector errwgt;
   N_Vector newdelta;
+  PARALLEL_JACOBIAN *parallelJacobian;  /* thread pool for the colored Jacobian, NULL if evaluated sequentially */
 
   /* ### ida internal data */
   void* ida_mem;
@@ -168,6 +168,19 @@ static int residual_wrapper(double* x, double* f, void** data, int sysNumber)
   return 0;
 }
 
+/*! \fn solve with the current factorization in place
+ *
+ */
+static int solveOldFactorizationKlu(void *voiddata, int method, double *rhs)
+{
+  DATA_KLU* solverData = (DATA_KLU*) voiddata;
+
+  if (1 == method)
+    return klu_solve(solverData->symbolic, solverData->numeric, solverData->n_col, 1, rhs, &solverData->common);
+  else
+    return klu_tsolve(solverData->symbolic, solverData->numeric, solverData->n_col, 1, rhs, &solverData->common);
+}
+
 /*! \fn solve linear system with Klu method
  *
  *  \param  [in]  [data]
@@ -186,6 +199,9 @@ solveKlu(DATA *data, threadData_t *threadData, int sysNumber, double* aux_x)
   int i, j, status = 0, success = 0, n = systemData->size, eqSystemNumber = systemData->equationIndex, indexes[2] = {1,eqSystemNumber};
   double tmpJacEvalTime;
   int reuseMatrixJac = (data->simulationInfo->currentContext == CONTEXT_SYM_JACOBIAN && data->simulationInfo->currentJacobianEval > 0);
+  /* try the last factorization first (-lssReuse), but not at events or during initialization */
+  int reuseFactorization = (systemData->reuseWork && solverData->numeric && !reuseMatrixJac &&
+                            !data->simulationInfo->initial && !data->simulationInfo->discreteCall);
 
   infoStreamPrintWithEquationIndexes(LOG_LS, 0, indexes, "Start solving Linear System %d (size %d) at time %g with Klu Solver",
    eqSystemNumber, (int) systemData->size,
@@ -203,8 +219,20 @@ solveKlu(DATA *data, threadData_t *threadData, int sysNumber, double* aux_x)
 
     /* set b vector */
     systemData->setb(data, threadData, systemData);
+
+    if (reuseFactorization && solveWithOldFactorization(data, threadData, sysNumber, aux_x, solverData->Ap, solverData->Ai, solverData->Ax, solveOldFactorizationKlu, solverData)){
+      infoStreamPrint(LOG_LS_V, 0, "Solved linear system %d with the old factorization.", eqSystemNumber);
+      solverData->numberSolving += 1;
+      return 1;
+    }
   } else {
 
+    if (reuseFactorization && solveWithOldFactorization(data, threadData, sysNumber, aux_x, NULL, NULL, NULL, solveOldFactorizationKlu, solverData)){
+      infoStreamPrint(LOG_LS_V, 0, "Solved linear system %d with the old factorization.", eqSystemNumber);
+      solverData->numberSolving += 1;
+      return 1;
+    }
+
     if (!reuseMatrixJac){
       solverData->Ap[0] = 0;
       /* calculate jacobian -> matrix A*/
@@ -251,6 +279,7 @@ solveKlu(DATA *data, threadData_t *threadData, int sysNumber, double* aux_x)
   {
     infoStreamPrint(LOG_LS_V, 0, "Perform analyze settings:\n - ordering used: %d\n - current status: %d", solverData->common.ordering, solverData->common.status);
     solverData->symbolic = klu_analyze(solverData->n_col, solverData->Ap, solverData->Ai, &solverData->common);
+    data->simulationInfo->callStatistics.linearSymbolicAnalyses++;
   }
 
   /* if reuseMatrixJac use also previous factorization */
@@ -272,10 +301,12 @@ solveKlu(DATA *data, threadData_t *threadData, int sysNumber, double* aux_x)
       } else {
         solverData->numeric = klu_factor(solverData->Ap, solverData->Ai, solverData->Ax, solverData->symbolic, &solverData->common);
       }
+      data->simulationInfo->callStatistics.linearFactorizations++;
     }
   }
 
   if (0 == solverData->common.status){
+    data->simulationInfo->callStatistics.linearSolves++;
     if (1 == systemData->method){
       if (klu_solve(solverData->symbolic, solverData->numeric, solverData->n_col, 1, systemData->b, &solverData->common)){
         success = 1;
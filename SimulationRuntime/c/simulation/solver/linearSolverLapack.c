@@ -230,9 +230,11 @@ int solveLapack(DATA *data, threadData_t *threadData, int sysNumber, double* aux
   rt_ext_tp_tick(&(solverData->timeClock));
 
   /* if reuseMatrixJac use also previous factorization */
+  data->simulationInfo->callStatistics.linearSolves++;
   if (!reuseMatrixJac)
   {
     /* Solve system */
+    data->simulationInfo->callStatistics.linearFactorizations++;
     dgesv_((int*) &systemData->size,
            (int*) &solverData->nrhs,
            solverData->A->data,
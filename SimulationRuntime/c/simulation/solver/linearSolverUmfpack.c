@@ -182,6 +182,22 @@ static int wrapper_fvec_umfpack(double* x, double* f, void** data, int sysNumber
   return 0;
 }
 
+/*! \fn solve with the current factorization in place
+ *
+ */
+static int solveOldFactorizationUmfPack(void *voiddata, int method, double *rhs)
+{
+  DATA_UMFPACK* solverData = (DATA_UMFPACK*) voiddata;
+  int status;
+
+  status = umfpack_di_wsolve(1 == method ? UMFPACK_A : UMFPACK_Aat, solverData->Ap, solverData->Ai, solverData->Ax, solverData->work, rhs, solverData->numeric, solverData->control, solverData->info, solverData->Wi, solverData->W);
+  if (UMFPACK_OK != status)
+    return 0;
+
+  memcpy(rhs, solverData->work, sizeof(double)*solverData->n_row);
+  return 1;
+}
+
 /*! \fn solve linear system with UmfPack method
  *
  *  \param  [in]  [data]
@@ -201,6 +217,9 @@ solveUmfPack(DATA *data, threadData_t *threadData, int sysNumber, double* aux_x)
   int casualTearingSet = systemData->strictTearingFunctionCall != NULL;
   double tmpJacEvalTime;
   int reuseMatrixJac = (data->simulationInfo->currentContext == CONTEXT_SYM_JACOBIAN && data->simulationInfo->currentJacobianEval > 0);
+  /* try the last factorization first (-lssReuse), but not at events or during initialization */
+  int reuseFactorization = (systemData->reuseWork && solverData->numeric && !reuseMatrixJac &&
+                            !data->simulationInfo->initial && !data->simulationInfo->discreteCall);
 
   infoStreamPrintWithEquationIndexes(LOG_LS, 0, indexes, "Start solving Linear System %d (size %d) at time %g with UMFPACK Solver",
    eqSystemNumber, (int) systemData->size,
@@ -218,8 +237,20 @@ solveUmfPack(DATA *data, threadData_t *threadData, int sysNumber, double* aux_x)
 
     /* set b vector */
     systemData->setb(data, threadData, systemData);
+
+    if (reuseFactorization && solveWithOldFactorization(data, threadData, sysNumber, aux_x, solverData->Ap, solverData->Ai, solverData->Ax, solveOldFactorizationUmfPack, solverData)){
+      infoStreamPrint(LOG_LS_V, 0, "Solved linear system %d with the old factorization.", eqSystemNumber);
+      solverData->numberSolving += 1;
+      return 1;
+    }
   } else {
 
+    if (reuseFactorization && solveWithOldFactorization(data, threadData, sysNumber, aux_x, NULL, NULL, NULL, solveOldFactorizationUmfPack, solverData)){
+      infoStreamPrint(LOG_LS_V, 0, "Solved linear system %d with the old factorization.", eqSystemNumber);
+      solverData->numberSolving += 1;
+      return 1;
+    }
+
     if (!reuseMatrixJac){
       solverData->Ap[0] = 0;
       /* calculate jacobian -> matrix A*/
@@ -264,6 +295,7 @@ solveUmfPack(DATA *data, threadData_t *threadData, int sysNumber, double* aux_x)
   if (0 == solverData->numberSolving)
   {
     status = umfpack_di_symbolic(solverData->n_col, solverData->n_row, solverData->Ap, solverData->Ai, solverData->Ax, &(solverData->symbolic), solverData->control, solverData->info);
+    data->simulationInfo->callStatistics.linearSymbolicAnalyses++;
   }
 
   /* compute the LU factorization of A */
@@ -273,10 +305,12 @@ solveUmfPack(DATA *data, threadData_t *threadData, int sysNumber, double* aux_x)
     if (0 == status){
       umfpack_di_free_numeric(&(solverData->numeric));
       status = umfpack_di_numeric(solverData->Ap, solverData->Ai, solverData->Ax, solverData->symbolic, &(solverData->numeric), solverData->control, solverData->info);
+      data->simulationInfo->callStatistics.linearFactorizations++;
     }
   }
 
   if (0 == status){
+    data->simulationInfo->callStatistics.linearSolves++;
     if (1 == systemData->method){
       status = umfpack_di_wsolve(UMFPACK_A, solverData->Ap, solverData->Ai, solverData->Ax, aux_x, systemData->b, solverData->numeric, solverData->control, solverData->info, solverData->Wi, solverData->W);
     } else {
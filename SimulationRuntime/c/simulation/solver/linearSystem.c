@@ -47,6 +47,7 @@
 #endif
 #include "linearSolverTotalPivot.h"
 #include "simulation/simulation_info_json.h"
+#include "simulation/options.h"
 
 static void setAElement(int row, int col, double value, int nth, void *data, threadData_t *);
 static void setAElementLis(int row, int col, double value, int nth, void *data, threadData_t *);
@@ -224,6 +225,18 @@ int initializeLinearSystems(DATA *data, threadData_t *threadData)
         throwStreamPrint(threadData, "unrecognized dense linear solver (%d)", data->simulationInfo->lsMethod);
       }
     }
+
+    /* work array for the simplified iteration with an old factorization (klu and umfpack only) */
+    linsys[i].reuseWork = NULL;
+#ifdef WITH_UMFPACK
+    if (omc_flag[FLAG_LSS_REUSE] &&
+        (linsys[i].useSparseSolver ? (LSS_KLU == data->simulationInfo->lssMethod || LSS_UMFPACK == data->simulationInfo->lssMethod)
+                                   : (LS_KLU == data->simulationInfo->lsMethod || LS_UMFPACK == data->simulationInfo->lsMethod)))
+    {
+      linsys[i].reuseWork = (double*) malloc(2*size*sizeof(double));
+      infoStreamPrint(LOG_LS, 0, "linear system %d reuses its factorization while the simplified iteration converges", i);
+    }
+#endif
   }
 
   messageClose(LOG_LS);
@@ -298,6 +311,7 @@ int freeLinearSystems(DATA *data, threadData_t *threadData)
     free(linsys[i].nominal);
     free(linsys[i].min);
     free(linsys[i].max);
+    free(linsys[i].reuseWork);
 
     if(linsys[i].useSparseSolver == 1)
     {
@@ -523,6 +537,77 @@ int solve_linear_system(DATA *data, threadData_t *threadData, int sysNumber, dou
   return retVal;
 }
 
+/*! \fn solveWithOldFactorization
+ *
+ *  Simplified iteration x := x + LU^-1 * r(x) that uses the factorization of
+ *  the previous call instead of a new one. The residual is b - A*x for
+ *  method 0 (A stored row-wise in Ap, Ai, Ax) and the torn residual for
+ *  method 1. The iteration is stopped as soon as it does not contract fast
+ *  enough, in which case x is left unchanged and the caller has to
+ *  factorize the current matrix.
+ *
+ *  \param [ref] [data]
+ *  \param [in]  [sysNumber] index of corresponding linear system
+ *  \param [ref] [x] start value and on success the solution
+ *  \param [in]  [solveOld] solves LU*y = rhs in place with the old factorization
+ *  \return 1 if converged, 0 otherwise
+ */
+int solveWithOldFactorization(DATA *data, threadData_t *threadData, int sysNumber, double *x,
+                              const int *Ap, const int *Ai, const double *Ax,
+                              int (*solveOld)(void *solverData, int method, double *rhs), void *solverData)
+{
+  static const int maxIterations = 5;
+  static const double maxContraction = 0.1;
+  void *dataAndThreadData[2] = {data, threadData};
+  LINEAR_SYSTEM_DATA* systemData = &(data->simulationInfo->linearSystemData[sysNumber]);
+  const int n = systemData->size;
+  const double tol = 1e-4 * data->simulationInfo->tolerance;
+  double *r = systemData->reuseWork;
+  double *xOld = systemData->reuseWork + n;
+  double norm, normOld = 0.0, scale;
+  int i, j, k, iflag = 0;
+
+  memcpy(xOld, x, n*sizeof(double));
+  for (k=0; k<maxIterations; ++k)
+  {
+    if (0 == systemData->method) {
+      for (i=0; i<n; ++i) {
+        r[i] = systemData->b[i];
+        for (j=Ap[i]; j<Ap[i+1]; ++j)
+          r[i] -= Ax[j]*x[Ai[j]];
+      }
+    } else {
+      systemData->residualFunc(dataAndThreadData, x, r, &iflag);
+    }
+
+    if (!solveOld(solverData, systemData->method, r))
+      break;
+    data->simulationInfo->callStatistics.linearSolves++;
+
+    norm = 0.0;
+    for (i=0; i<n; ++i) {
+      x[i] += r[i];
+      scale = fmax(fabs(x[i]), fabs(systemData->nominal[i]));
+      norm = fmax(norm, fabs(r[i]) / (scale > 0.0 ? scale : 1.0));
+    }
+    infoStreamPrint(LOG_LS_V, 0, "simplified iteration %d with old factorization: scaled correction %g", k+1, norm);
+
+    if (norm <= tol) {
+      /* update inner equations */
+      if (1 == systemData->method)
+        systemData->residualFunc(dataAndThreadData, x, r, &iflag);
+      data->simulationInfo->callStatistics.linearFactorizationReuses++;
+      return 1;
+    }
+    if (k > 0 && norm > maxContraction*normOld)
+      break;
+    normOld = norm;
+  }
+
+  memcpy(x, xOld, n*sizeof(double));
+  return 0;
+}
+
 /*! \fn check_linear_solutions
  *
  *   This function check whether some of linear systems
@@ -54,6 +54,9 @@ int freeLinearSystems(DATA *data, threadData_t *threadData);
 int solve_linear_system(DATA *data, threadData_t *threadData, int sysNumber, double* aux_x);
 int check_linear_solutions(DATA *data, int printFailingSystems);
 void printLinearSystemSolvingStatistics(DATA *data, int sysNumber, int logLevel);
+int solveWithOldFactorization(DATA *data, threadData_t *threadData, int sysNumber, double *x,
+                              const int *Ap, const int *Ai, const double *Ax,
+                              int (*solveOld)(void *solverData, int method, double *rhs), void *solverData);
 
 #ifdef __cplusplus
 }
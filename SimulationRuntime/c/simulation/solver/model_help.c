@@ -56,6 +56,7 @@ double linearSparseSolverMaxDensity = 0.2;
 int linearSparseSolverMinSize = 201;
 double nonlinearSparseSolverMaxDensity = 0.2;
 int nonlinearSparseSolverMinSize = 10001;
+int nonlinearExtrapolationOrder = 1;
 double maxStepFactor = 1e12;
 double newtonXTol = 1e-12;
 double newtonFTol = 1e-12;
@@ -79,7 +80,6 @@ double homTauMin = 1e-4;
 double homTauStart = 0.2;
 int homBacktraceStrategy = 1;
 
-static double tolZC;
 
 /*! \fn updateDiscreteSystem
  *
@@ -149,12 +149,10 @@ void updateDiscreteSystem(DATA *data, threadData_t *threadData)
 void saveZeroCrossings(DATA* data, threadData_t *threadData)
 {
   TRACE_PUSH
-  long i = 0;
 
   debugStreamPrint(LOG_ZEROCROSSINGS, 0, "save all zero-crossings");
 
-  for(i=0;i<data->modelData->nZeroCrossings;i++)
-    data->simulationInfo->zeroCrossingsPre[i] = data->simulationInfo->zeroCrossings[i];
+  memcpy(data->simulationInfo->zeroCrossingsPre, data->simulationInfo->zeroCrossings, data->modelData->nZeroCrossings * sizeof(modelica_real));
 
   data->callback->function_ZeroCrossings(data, threadData, data->simulationInfo->zeroCrossings);
 
@@ -953,6 +951,9 @@ void initializeDataStruc(DATA *data, threadData_t *threadData)
   data->simulationInfo->zeroCrossings = (modelica_real*) calloc(data->modelData->nZeroCrossings, sizeof(modelica_real));
   data->simulationInfo->zeroCrossingsPre = (modelica_real*) calloc(data->modelData->nZeroCrossings, sizeof(modelica_real));
   data->simulationInfo->zeroCrossingsBackup = (modelica_real*) calloc(data->modelData->nZeroCrossings, sizeof(modelica_real));
+  data->simulationInfo->eventLocationWork = (modelica_real*) calloc(4*data->modelData->nStates, sizeof(modelica_real));
+  data->simulationInfo->eventLocationList = allocList(sizeof(long));
+  data->simulationInfo->zeroCrossingsChanged = (long*) malloc(data->modelData->nZeroCrossings*sizeof(long));
   data->simulationInfo->relations = (modelica_boolean*) calloc(data->modelData->nRelations, sizeof(modelica_boolean));
   data->simulationInfo->relationsPre = (modelica_boolean*) calloc(data->modelData->nRelations, sizeof(modelica_boolean));
   data->simulationInfo->storedRelations = (modelica_boolean*) calloc(data->modelData->nRelations, sizeof(modelica_boolean));
@@ -1053,6 +1054,49 @@ void initializeDataStruc(DATA *data, threadData_t *threadData)
   data->simulationInfo->chatteringInfo.numEventLimit = 100;
   data->simulationInfo->chatteringInfo.lastSteps = (int*) calloc(data->simulationInfo->chatteringInfo.numEventLimit, sizeof(int));
   data->simulationInfo->chatteringInfo.lastTimes = (modelica_real*) calloc(data->simulationInfo->chatteringInfo.numEventLimit, sizeof(double));
+#endif
+
+  /* initial delay */
+#if !defined(OMC_NDELAY_EXPRESSIONS) || OMC_NDELAY_EXPRESSIONS>0
+  allocDelayArena(&data->simulationInfo->delayArena, data->modelData->nDelayExpressions);
+#endif
+
+  resetDataStruc(data);
+
+#if !defined(OMC_NO_STATESELECTION)
+  /* allocate memory for state selection */
+  initializeStateSetJacobians(data, threadData);
+#endif
+
+  /* allocate memory for sensitivity analysis */
+  if (omc_flag[FLAG_IDAS])
+  {
+    data->simulationInfo->sensitivityParList = (int*) calloc(data->modelData->nSensitivityParamVars, sizeof(int));
+    data->simulationInfo->sensitivityMatrix = (modelica_real*) calloc(data->modelData->nSensitivityVars-data->modelData->nSensitivityParamVars, sizeof(modelica_real));
+    data->modelData->realSensitivityData = (STATIC_REAL_DATA*) omc_alloc_interface.malloc_uncollectable(data->modelData->nSensitivityVars * sizeof(STATIC_REAL_DATA));
+  }
+
+
+  TRACE_POP
+}
+
+/*! \fn resetDataStruc
+ *
+ *  Resets the run-time state of the DATA structure (call statistics, event
+ *  switches, chattering info, delay lines) so that an already initialized model can be
+ *  simulated once more, e.g. for the next run of -batch.
+ *
+ *  \param [ref] [data]
+ *
+ */
+void resetDataStruc(DATA *data)
+{
+  TRACE_PUSH
+
+#if !defined(OMC_MINIMAL_LOGGING)
+  /* initial chattering info */
+  memset(data->simulationInfo->chatteringInfo.lastSteps, 0, data->simulationInfo->chatteringInfo.numEventLimit*sizeof(int));
+  memset(data->simulationInfo->chatteringInfo.lastTimes, 0, data->simulationInfo->chatteringInfo.numEventLimit*sizeof(double));
   data->simulationInfo->chatteringInfo.currentIndex = 0;
   data->simulationInfo->chatteringInfo.lastStepsNumStateEvents = 0;
   data->simulationInfo->chatteringInfo.messageEmitted = 0;
@@ -1065,8 +1109,19 @@ void initializeDataStruc(DATA *data, threadData_t *threadData)
   data->simulationInfo->callStatistics.functionZeroCrossingsEquations = 0;
   data->simulationInfo->callStatistics.functionZeroCrossings = 0;
   data->simulationInfo->callStatistics.functionAlgebraics = 0;
+  data->simulationInfo->callStatistics.linearSymbolicAnalyses = 0;
+  data->simulationInfo->callStatistics.linearFactorizations = 0;
+  data->simulationInfo->callStatistics.linearSolves = 0;
+  data->simulationInfo->callStatistics.linearFactorizationReuses = 0;
+  data->simulationInfo->callStatistics.eventLocationEvaluations = 0;
+
+#if !defined(OMC_NDELAY_EXPRESSIONS) || OMC_NDELAY_EXPRESSIONS>0
+  /* forget the samples of the previous run */
+  resetDelayArena(&data->simulationInfo->delayArena);
+#endif
 
   data->simulationInfo->lambda = 1.0;
+  data->simulationInfo->tolZC = 0;
 
   /* initial build calls terminal, initial */
   data->simulationInfo->terminal = 0;
@@ -1081,29 +1136,6 @@ void initializeDataStruc(DATA *data, threadData_t *threadData)
   /* initialize model error code */
   data->simulationInfo->simulationSuccess = 0;
 
-  /* initial delay */
-#if !defined(OMC_NDELAY_EXPRESSIONS) || OMC_NDELAY_EXPRESSIONS>0
-  data->simulationInfo->delayStructure = (RINGBUFFER**)malloc(data->modelData->nDelayExpressions * sizeof(RINGBUFFER*));
-  assertStreamPrint(threadData, 0 == data->modelData->nDelayExpressions || 0 != data->simulationInfo->delayStructure, "out of memory");
-
-  for(i=0; i<data->modelData->nDelayExpressions; i++)
-    data->simulationInfo->delayStructure[i] = allocRingBuffer(1024, sizeof(TIME_AND_VALUE));
-#endif
-
-#if !defined(OMC_NO_STATESELECTION)
-  /* allocate memory for state selection */
-  initializeStateSetJacobians(data, threadData);
-#endif
-
-  /* allocate memory for sensitivity analysis */
-  if (omc_flag[FLAG_IDAS])
-  {
-    data->simulationInfo->sensitivityParList = (int*) calloc(data->modelData->nSensitivityParamVars, sizeof(int));
-    data->simulationInfo->sensitivityMatrix = (modelica_real*) calloc(data->modelData->nSensitivityVars-data->modelData->nSensitivityParamVars, sizeof(modelica_real));
-    data->modelData->realSensitivityData = (STATIC_REAL_DATA*) omc_alloc_interface.malloc_uncollectable(data->modelData->nSensitivityVars * sizeof(STATIC_REAL_DATA));
-  }
-
-
   TRACE_POP
 }
 
@@ -1167,6 +1199,9 @@ void deInitializeDataStruc(DATA *data)
   free(data->simulationInfo->zeroCrossings);
   free(data->simulationInfo->zeroCrossingsPre);
   free(data->simulationInfo->zeroCrossingsBackup);
+  free(data->simulationInfo->eventLocationWork);
+  freeList(data->simulationInfo->eventLocationList);
+  free(data->simulationInfo->zeroCrossingsChanged);
   free(data->simulationInfo->relations);
   free(data->simulationInfo->relationsPre);
   free(data->simulationInfo->storedRelations);
@@ -1225,10 +1260,9 @@ void deInitializeDataStruc(DATA *data)
   free(data->simulationInfo->chatteringInfo.lastTimes);
 
   /* free delay structure */
-  for(i=0; i<data->modelData->nDelayExpressions; i++)
-    freeRingBuffer(data->simulationInfo->delayStructure[i]);
-
-  free(data->simulationInfo->delayStructure);
+#if !defined(OMC_NDELAY_EXPRESSIONS) || OMC_NDELAY_EXPRESSIONS>0
+  freeDelayArena(&data->simulationInfo->delayArena);
+#endif
 
 #if !defined(OMC_NO_STATESELECTION)
   /* free stateset data */
@@ -1255,39 +1289,39 @@ void deInitializeDataStruc(DATA *data)
  * Greater is for case LESSEQ and GREATER
  */
 
-void setZCtol(double relativeTol)
+void setZCtol(DATA *data, double relativeTol)
 {
   TRACE_PUSH
 
   /* lochel: force tolZC > 0 */
-  tolZC = TOL_HYSTERESIS_ZEROCROSSINGS * fmax(relativeTol, MINIMAL_STEP_SIZE);
-  infoStreamPrint(LOG_EVENTS_V, 0, "Set tolerance for zero-crossing hysteresis to: %e", tolZC);
+  data->simulationInfo->tolZC = TOL_HYSTERESIS_ZEROCROSSINGS * fmax(relativeTol, MINIMAL_STEP_SIZE);
+  infoStreamPrint(LOG_EVENTS_V, 0, "Set tolerance for zero-crossing hysteresis to: %e", data->simulationInfo->tolZC);
 
   TRACE_POP
 }
 
 /* TODO: fix this */
-modelica_boolean LessZC(double a, double b, modelica_boolean direction)
+modelica_boolean LessZC(double a, double b, double tolZC, modelica_boolean direction)
 {
   double eps = tolZC * fmax(fabs(a), fabs(b)) + tolZC;
   return direction ? (a - b <= eps) : (a - b <= -eps);
 }
 
-modelica_boolean LessEqZC(double a, double b, modelica_boolean direction)
+modelica_boolean LessEqZC(double a, double b, double tolZC, modelica_boolean direction)
 {
-  return !GreaterZC(a, b, !direction);
+  return !GreaterZC(a, b, tolZC, !direction);
 }
 
 /* TODO: fix this */
-modelica_boolean GreaterZC(double a, double b, modelica_boolean direction)
+modelica_boolean GreaterZC(double a, double b, double tolZC, modelica_boolean direction)
 {
   double eps = tolZC * fmax(fabs(a), fabs(b)) + tolZC;
   return direction ? (a - b >= -eps ) : (a - b >= eps);
 }
 
-modelica_boolean GreaterEqZC(double a, double b, modelica_boolean direction)
+modelica_boolean GreaterEqZC(double a, double b, double tolZC, modelica_boolean direction)
 {
-  return !LessZC(a, b, !direction);
+  return !LessZC(a, b, tolZC, !direction);
 }
 
 modelica_boolean Less(double a, double b)
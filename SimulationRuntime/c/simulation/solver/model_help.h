@@ -69,7 +69,7 @@ extern "C" {
   } \
   else \
   { \
-    res = ((op_w##ZC)((exp1),(exp2),data->simulationInfo->storedRelations[index])); \
+    res = ((op_w##ZC)((exp1),(exp2),data->simulationInfo->tolZC,data->simulationInfo->storedRelations[index])); \
     data->simulationInfo->relations[index] = res; \
   } \
 }
@@ -79,6 +79,7 @@ extern double linearSparseSolverMaxDensity;
 extern int linearSparseSolverMinSize;
 extern double nonlinearSparseSolverMaxDensity;
 extern int nonlinearSparseSolverMinSize;
+extern int nonlinearExtrapolationOrder;
 extern double newtonXTol;
 extern double newtonFTol;
 extern double maxStepFactor;
@@ -104,6 +105,8 @@ extern int homBacktraceStrategy;
 
 void initializeDataStruc(DATA *data, threadData_t *threadData);
 
+void resetDataStruc(DATA *data);
+
 void deInitializeDataStruc(DATA *data);
 
 void updateDiscreteSystem(DATA *data, threadData_t *threadData);
@@ -147,7 +150,7 @@ modelica_boolean checkRelations(DATA *data);
 void printHysteresisRelations(DATA *data);
 void activateHysteresis(DATA* data);
 void storeRelations(DATA* data);
-void setZCtol(double relativeTol);
+void setZCtol(DATA *data, double relativeTol);
 
 double getNextSampleTimeFMU(DATA *data);
 
@@ -172,10 +175,10 @@ modelica_boolean GreaterEq(double a, double b);
 /* functions used to evaluate relation in
  * zero-crossing with hysteresis effect
  */
-modelica_boolean LessZC(double a, double b, modelica_boolean);
-modelica_boolean LessEqZC(double a, double b, modelica_boolean);
-modelica_boolean GreaterZC(double a, double b, modelica_boolean);
-modelica_boolean GreaterEqZC(double a, double b, modelica_boolean);
+modelica_boolean LessZC(double a, double b, double tolZC, modelica_boolean);
+modelica_boolean LessEqZC(double a, double b, double tolZC, modelica_boolean);
+modelica_boolean GreaterZC(double a, double b, double tolZC, modelica_boolean);
+modelica_boolean GreaterEqZC(double a, double b, double tolZC, modelica_boolean);
 
 extern int measure_time_flag;
 
@@ -408,7 +408,9 @@ int initializeNonlinearSystems(DATA *data, threadData_t *threadData)
     nonlinsys[i].resValues = (double*) malloc(size*sizeof(double));
 
     /* allocate value list*/
-    nonlinsys[i].oldValueList = (void*) allocValueList(1);
+    nonlinsys[i].oldValueList = (void*) allocValueList(size, nonlinearExtrapolationOrder+1);
+    nonlinsys[i].numberOfExtrapolations = 0;
+    nonlinsys[i].numberOfExtrapolationHits = 0;
 
     nonlinsys[i].lastTimeSolved = 0.0;
 
@@ -550,7 +552,7 @@ int freeNonlinearSystems(DATA *data, threadData_t *threadData)
     free(nonlinsys[i].nominal);
     free(nonlinsys[i].min);
     free(nonlinsys[i].max);
-    freeValueList(nonlinsys[i].oldValueList, 1);
+    freeValueList(nonlinsys[i].oldValueList);
 
 #if !defined(OMC_MINIMAL_RUNTIME)
     if (data->simulationInfo->nlsCsvInfomation)
@@ -625,6 +627,7 @@ void printNonLinearSystemSolvingStatistics(DATA *data, int sysNumber, int logLev
   infoStreamPrint(logLevel, 0, " number of function evaluations : %ld", nonlinsys[sysNumber].numberOfFEval);
   infoStreamPrint(logLevel, 0, " number of jacobian evaluations : %ld", nonlinsys[sysNumber].numberOfJEval);
   infoStreamPrint(logLevel, 0, " time of jacobian evaluations   : %f", nonlinsys[sysNumber].jacobianTime);
+  infoStreamPrint(logLevel, 0, " number of extrapolated guesses : %ld (%ld closer to the solution than the last solution)", nonlinsys[sysNumber].numberOfExtrapolations, nonlinsys[sysNumber].numberOfExtrapolationHits);
   infoStreamPrint(logLevel, 0, " average time per call          : %f", nonlinsys[sysNumber].totalTime/nonlinsys[sysNumber].numberOfCall);
   infoStreamPrint(logLevel, 0, " total time                     : %f", nonlinsys[sysNumber].totalTime);
   messageClose(logLevel);
@@ -692,7 +695,7 @@ int getInitialGuess(NONLINEAR_SYSTEM_DATA *nonlinsys, double time)
   /* value extrapolation */
   printValuesListTimes((VALUES_LIST*)nonlinsys->oldValueList);
   /* if list is empty use current start values */
-  if (listLen(((VALUES_LIST*)nonlinsys->oldValueList)->valueList)==0)
+  if (((VALUES_LIST*)nonlinsys->oldValueList)->length==0)
   {
     /* use old value if no values are stored in the list */
     memcpy(nonlinsys->nlsx, nonlinsys->nlsxOld, nonlinsys->size*(sizeof(double)));
@@ -718,27 +721,30 @@ int getInitialGuess(NONLINEAR_SYSTEM_DATA *nonlinsys, double time)
  */
 int updateInitialGuessDB(NONLINEAR_SYSTEM_DATA *nonlinsys, double time, int context)
 {
+  VALUES_LIST *valueList = (VALUES_LIST*)nonlinsys->oldValueList;
+  int hit = 0;
+
   /* write solution to oldValue list for extrapolation */
   if (nonlinsys->solved == 1)
   {
+    if (checkExtrapolation(valueList, nonlinsys->nlsx, &hit))
+    {
+      nonlinsys->numberOfExtrapolations++;
+      nonlinsys->numberOfExtrapolationHits += hit;
+    }
     /* do not use solution of jacobian for next extrapolation */
     if (context < 4)
     {
-      addListElement((VALUES_LIST*)nonlinsys->oldValueList,
-              createValueElement(nonlinsys->size, time, nonlinsys->nlsx));
+      addListElement(valueList, time, nonlinsys->nlsx);
     }
   }
   else if (nonlinsys->solved == 2)
   {
-    if (listLen(((VALUES_LIST*)nonlinsys->oldValueList)->valueList)>0)
-    {
-      cleanValueList((VALUES_LIST*)nonlinsys->oldValueList, NULL);
-    }
+    cleanValueList(valueList);
     /* do not use solution of jacobian for next extrapolation */
     if (context < 4)
     {
-      addListElement((VALUES_LIST*)nonlinsys->oldValueList,
-              createValueElement(nonlinsys->size, time, nonlinsys->nlsx));
+      addListElement(valueList, time, nonlinsys->nlsx);
     }
   }
   messageClose(LOG_NLS_EXTRAPOLATE);
@@ -29,9 +29,9 @@
 *
 */
 
-/*! \file nonlinearValuesList.h
+/*! \file nonlinearValuesList.c
  * Description: This is a C implementation of a value database
- *              based on a list. It's purpose is to be used by a
+ *              based on a ring buffer. It's purpose is to be used by a
  *              a non-linear solver in OpenModelica in order to
  *              guess next value by extrapolation or interpolation.
  *              Assuming time passes forward.
@@ -41,305 +41,220 @@
 #include "epsilon.h"
 #include "nonlinearValuesList.h"
 
-#include "util/list.h"
 #include "util/omc_error.h"
 
+#include <math.h>
 #include <stdlib.h>
 #include <string.h>
 
-/* Forward extrapolate function definition */
-double extrapolateValues(const double, const double, const double, const double, const double);
+/* slot of the solution at position pos (0 = latest) */
+static inline unsigned int slot(const VALUES_LIST* valueList, unsigned int pos)
+{
+  return (valueList->first + pos) % valueList->capacity;
+}
 
-VALUES_LIST* allocValueList(unsigned int numberOfList)
+static inline double* valuesAt(const VALUES_LIST* valueList, unsigned int pos)
 {
-  unsigned int i = 0;
-  VALUES_LIST* valueList = (VALUES_LIST*) malloc(numberOfList*sizeof(VALUES_LIST));
+  return valueList->values + slot(valueList, pos)*valueList->size;
+}
 
-  for(i=0; i<numberOfList; ++i){
-    (valueList+i)->valueList = allocList(sizeof(VALUE));
-  }
+static inline double timeAt(const VALUES_LIST* valueList, unsigned int pos)
+{
+  return valueList->times[slot(valueList, pos)];
+}
+
+/*! \fn allocValueList
+ *
+ *  \param [in]  [size] size of the non-linear system
+ *  \param [in]  [capacity] number of solutions to keep; polynomial degree+1 of the extrapolation
+ */
+VALUES_LIST* allocValueList(unsigned int size, unsigned int capacity)
+{
+  VALUES_LIST* valueList = (VALUES_LIST*) malloc(sizeof(VALUES_LIST));
+  assertStreamPrint(NULL, 0 != valueList, "out of memory");
+
+  valueList->size = size;
+  valueList->capacity = capacity < 1 ? 1 : capacity;
+  valueList->first = 0;
+  valueList->length = 0;
+  valueList->times = (double*) malloc(valueList->capacity*sizeof(double));
+  valueList->values = (double*) malloc(valueList->capacity*size*sizeof(double));
+  valueList->guess = (double*) malloc(size*sizeof(double));
+  valueList->guessPoints = 0;
+  valueList->guessBase = 0;
+  assertStreamPrint(NULL, 0 != valueList->times && 0 != valueList->values && 0 != valueList->guess, "out of memory");
 
   return valueList;
 }
 
-void freeValueList(VALUES_LIST *valueList, unsigned int numberOfList)
+void freeValueList(VALUES_LIST *valueList)
 {
-  VALUE* elem;
-  VALUES_LIST *tmpList;
-
-  int i,j;
-  for(j = 0; j < numberOfList; ++j)
-  {
-    tmpList = valueList+j;
-    for(i = 0; i < listLen(tmpList->valueList); ++i)
-    {
-      elem = (VALUE*) listFirstData(tmpList->valueList);
-      listPopFront(tmpList->valueList);
-    }
-    freeList(tmpList->valueList);
-  }
+  free(valueList->times);
+  free(valueList->values);
+  free(valueList->guess);
   free(valueList);
 }
 
-void cleanValueList(VALUES_LIST *valueList, LIST_NODE *startNode)
+void cleanValueList(VALUES_LIST *valueList)
 {
-  LIST_NODE *next, *node;
-  VALUE* elem;
-
-  int i, j;
-  if (startNode == NULL)
-  {
-    listClear(valueList->valueList);
-  }
-  else
-  {
-    next = listNextNode(startNode);
-    /* clean list from next node */
-    infoStreamPrint(LOG_NLS_EXTRAPOLATE, 0, "cleanValueList length: %d", listLen(valueList->valueList));
-    updateNodeNext(valueList->valueList, startNode, NULL);
-    removeNodes(valueList->valueList, next);
-  }
+  valueList->length = 0;
+  valueList->guessPoints = 0;
 }
 
+/*! \fn cleanValueListbyTime
+ *
+ *  Removes all solutions later than time and keeps only the latest one
+ *  before it (the solutions before an event are not used to extrapolate
+ *  after it).
+ */
 void cleanValueListbyTime(VALUES_LIST *valueList, double time)
 {
-  LIST_NODE *next, *node;
-  VALUE* elem;
-
   /*  if it's empty anyway */
-  if (listLen(valueList->valueList) == 0)
+  if (valueList->length == 0)
   {
     return;
   }
   printValuesListTimes(valueList);
-  node = listFirstNode(valueList->valueList);
-  do
+  while (valueList->length > 1 && timeAt(valueList, 0) > time)
   {
-    elem = ((VALUE*)listNodeData(node));
-    next = listNextNode(node);
-    /*  if next node is empty */
-    if (!next)
-    {
-      return;
-    }
-    if (elem->time <= time)
-    {
-      break;
-    }
-    /* debug output */
-    infoStreamPrint(LOG_NLS_EXTRAPOLATE, 0, "cleanValueListbyTime %g check element: ", time);
-    printValueElement(elem);
-
-    freeNode(node);
-    updatelistFirst(valueList->valueList, next);
-    updatelistLength(valueList->valueList, listLen(valueList->valueList)-1);
-    node = next;
-  }while(1);
-  cleanValueList(valueList, node);
-  infoStreamPrint(LOG_NLS_EXTRAPOLATE, 0, "New list length %d: ", listLen(valueList->valueList));
-  printValuesListTimes(valueList);
-  infoStreamPrint(LOG_NLS_EXTRAPOLATE, 0, "Done!");
-}
-
-VALUE* createValueElement(unsigned int size, double time, double* values)
-{
-  VALUE* elem = (VALUE*) malloc(sizeof(VALUE));
-  elem->values = (double*) malloc(size*sizeof(double));
-  elem->time = time;
-  elem->size = size;
-
-  memcpy(elem->values, values, size*sizeof(double));
-
-  /* debug output */
-  infoStreamPrint(LOG_NLS_EXTRAPOLATE, 1, "Create Element");
-  messageClose(LOG_NLS_EXTRAPOLATE);
-
-  return elem;
-}
-
-void freeValue(VALUE* elem)
-{
-  free(elem->values);
-  free(elem);
+    valueList->first = slot(valueList, 1);
+    valueList->length--;
+  }
+  valueList->length = 1;
+  valueList->guessPoints = 0;
+  infoStreamPrint(LOG_NLS_EXTRAPOLATE, 0, "cleanValueListbyTime %g: kept element at time %g", time, timeAt(valueList, 0));
 }
 
-void addListElement(VALUES_LIST* valuesList, VALUE* newElem)
+/*! \fn addListElement
+ *
+ *  Stores a solution. A solution at (about) the same time as the latest
+ *  one replaces it; solutions later than the new one (e.g. of a rejected
+ *  step) are dropped. If the ring is full, the oldest solution is
+ *  overwritten.
+ */
+void addListElement(VALUES_LIST* valueList, double time, const double* values)
 {
-  LIST_NODE *node, *next;
-  VALUE* elem;
-  int replace = 0, i = 0;
+  infoStreamPrint(LOG_NLS_EXTRAPOLATE, 0, "Adding element at time %g in a list of size %d", time, (int)valueList->length);
 
-  /* debug output */
-  infoStreamPrint(LOG_NLS_EXTRAPOLATE, 1, "Adding element in a list of size %d", listLen(valuesList->valueList));
-  printValueElement(newElem);
-
-  /*  if it's empty, just push in  */
-  if (listLen(valuesList->valueList) == 0)
-  {
-    infoStreamPrint(LOG_NLS_EXTRAPOLATE, 0, "List is empty add just.");
-    listPushFront(valuesList->valueList, (void*) newElem);
-
-    messageClose(LOG_NLS_EXTRAPOLATE);
-    return;
-  }
-
-  /*  if the element at begin is earlier than current
-   *  push the element just in front and if the end element
-   *  is later than current push it just back.*/
-  node = listFirstNode(valuesList->valueList);
-  if ( fabs( ((VALUE*)listNodeData(node))->time - newElem->time ) > MINIMAL_STEP_SIZE )
+  while (valueList->length > 0 && timeAt(valueList, 0) > time + MINIMAL_STEP_SIZE)
   {
-    infoStreamPrint(LOG_NLS_EXTRAPOLATE, 0, "First Value list element is:");
-    printValueElement(((VALUE*)listNodeData(node)));
-    infoStreamPrint(LOG_NLS_EXTRAPOLATE, 0, "so new element is added before.");
-    listPushFront(valuesList->valueList, (void*) newElem);
-
-    messageClose(LOG_NLS_EXTRAPOLATE);
-    return;
+    valueList->first = slot(valueList, 1);
+    valueList->length--;
   }
 
-  infoStreamPrint(LOG_NLS_EXTRAPOLATE, 0, "Search position of new element");
-  /* search correct position */
-  next = node;
-  do
+  if (valueList->length == 0 || fabs(timeAt(valueList, 0) - time) > MINIMAL_STEP_SIZE)
   {
-    /*  if next node is empty */
-    if (!next)
+    valueList->first = slot(valueList, valueList->capacity - 1);
+    if (valueList->length < valueList->capacity)
     {
-      infoStreamPrint(LOG_NLS_EXTRAPOLATE, 0, "Search finished last element reached");
-      break;
+      valueList->length++;
     }
+  }
+  valueList->times[valueList->first] = time;
+  memcpy(valuesAt(valueList, 0), values, valueList->size*sizeof(double));
+  /* the ring changed; guessBase is no longer valid */
+  valueList->guessPoints = 0;
+}
 
-    elem = ((VALUE*)listNodeData(next));
-
-    /* debug output */
-    infoStreamPrint(LOG_NLS_EXTRAPOLATE, 0, "Next node of list is element:");
-    printValueElement(elem);
+/*! \fn getValues
+ *
+ *  Writes the polynomial extrapolation through the latest solutions not later
+ *  than time (up to capacity of them) to extrapolatedValues and the latest of
+ *  these solutions to oldOutput.
+ *
+ *  Conditions: the list is not empty
+ */
+void getValues(VALUES_LIST* valueList, double time, double* extrapolatedValues, double* oldOutput)
+{
+  unsigned int base, nPoints, i, k, l;
+  double weights[16];
 
+  assertStreamPrint(NULL, valueList->length > 0, "getValues failed, no elements");
+  infoStreamPrint(LOG_NLS_EXTRAPOLATE, 1, "Get values for time %g in a list of size %d", time, (int)valueList->length);
 
-    if (fabs(elem->time - newElem->time)<=MINIMAL_STEP_SIZE)
-    {
-      replace = 1;
-      break;
-    }
-    else if (elem->time < newElem->time)
-    {
-      break;
-    }
-    node = next;
-    next = listNextNode(node);
-    i++; /* count insert or replace place */
-  }while(1);
+  /* find the latest solution not later than time */
+  for (base = 0; base < valueList->length - 1 && timeAt(valueList, base) > time + MINIMAL_STEP_SIZE; base++);
 
-  /* add element before currect node */
-  if (!replace){
-    infoStreamPrint(LOG_NLS_EXTRAPOLATE, 0, "Insert element before last output element.");
-    listInsert(valuesList->valueList, node, (void*) newElem);
+  if (timeAt(valueList, base) > time - MINIMAL_STEP_SIZE)
+  {
+    /* same time, or there is no earlier solution */
+    nPoints = 1;
   }
   else
   {
-    infoStreamPrint(LOG_NLS_EXTRAPOLATE, 0, "replace element.");
-    updateNodeData(valuesList->valueList, next, (void*) newElem);
+    nPoints = valueList->length - base;
+    if (nPoints > valueList->capacity) nPoints = valueList->capacity;
+    if (nPoints > sizeof(weights)/sizeof(double)) nPoints = sizeof(weights)/sizeof(double);
   }
-  /*  clean list if too full */
-  if (i < 3 && listLen(valuesList->valueList)>10)
+
+  memcpy(oldOutput, valuesAt(valueList, base), valueList->size*sizeof(double));
+  if (nPoints == 1)
   {
-    while(i < 4)
-    {
-      next = listNextNode(next);
-      i++;
-    }
-    cleanValueList(valuesList, next);
+    infoStreamPrint(LOG_NLS_EXTRAPOLATE, 0, "take just old values.");
+    memcpy(extrapolatedValues, oldOutput, valueList->size*sizeof(double));
   }
-
-  messageClose(LOG_NLS_EXTRAPOLATE);
-  return;
-}
-
-void getValues(VALUES_LIST* valuesList, double time, double* extrapolatedValues, double* oldOutput)
-{
-  LIST_NODE *begin, *next, *old, *old2;
-  VALUE *oldValues, *old2Values, *elem;
-
-  infoStreamPrint(LOG_NLS_EXTRAPOLATE, 1, "Get values for time %g in a list of size %d", time, listLen(valuesList->valueList));
-  begin = listFirstNode(valuesList->valueList);
-
-  assertStreamPrint(NULL, NULL != begin, "getValues failed, no elements");
-
-  /* find corresponding values */
-  do{
-    elem = (VALUE*)listNodeData(begin);
-    infoStreamPrint(LOG_NLS_EXTRAPOLATE, 0, "Searching current element:");
-    printValueElement(elem);
-
-    if (fabs(elem->time - time)<=MINIMAL_STEP_SIZE)
+  else
+  {
+    /* Lagrange weights of the solutions at time */
+    for (k = 0; k < nPoints; k++)
     {
-      old = begin;
-      old2 = NULL;
-      infoStreamPrint(LOG_NLS_EXTRAPOLATE, 0, "take element with the same time.");
-      break;
+      double tk = timeAt(valueList, base+k);
+      weights[k] = 1.0;
+      for (l = 0; l < nPoints; l++)
+      {
+        if (l != k)
+        {
+          double tl = timeAt(valueList, base+l);
+          weights[k] *= (time - tl) / (tk - tl);
+        }
+      }
     }
-    else if (elem->time < time)
+    infoStreamPrint(LOG_NLS_EXTRAPOLATE, 0, "extrapolate through %d elements from time %g", (int)nPoints, timeAt(valueList, base));
+    for (i = 0; i < valueList->size; i++)
     {
-      old = begin;
-      old2 = listNextNode(old);
-      infoStreamPrint(LOG_NLS_EXTRAPOLATE, 0, "found element to use for extrapolation.");
-      break;
+      extrapolatedValues[i] = 0.0;
     }
-   else
+    for (k = 0; k < nPoints; k++)
     {
-      next = listNextNode(begin);
-      if (!next){
-        old = begin;
-        old2 = next;
-        infoStreamPrint(LOG_NLS_EXTRAPOLATE, 0, "reached end of list.");
-        break;
-      }
-      else
+      const double *v = valuesAt(valueList, base+k);
+      for (i = 0; i < valueList->size; i++)
       {
-        begin = next;
+        extrapolatedValues[i] += weights[k] * v[i];
       }
     }
-  }while(1);
-
-  /*  get next values */
-  if (old2 == NULL)
-  {
-    oldValues = (VALUE*) listNodeData(old);
-    memcpy(extrapolatedValues, oldValues->values, oldValues->size*sizeof(double));
-    memcpy(oldOutput, oldValues->values, oldValues->size*sizeof(double));
-    infoStreamPrint(LOG_NLS_EXTRAPOLATE, 0, "take just old values.");
-  }
-  else
-  {
-    int i;
-    oldValues = (VALUE*) listNodeData(old);
-    old2Values = (VALUE*) listNodeData(old2);
-    infoStreamPrint(LOG_NLS_EXTRAPOLATE, 0, "Use following elements for calculation:");
-    printValueElement(oldValues);
-    printValueElement(old2Values);
-    for(i = 0; i < oldValues->size; ++i)
-    {
-      extrapolatedValues[i] = extrapolateValues(time, oldValues->values[i], oldValues->time, old2Values->values[i], old2Values->time);
-    }
-    memcpy(oldOutput, oldValues->values, oldValues->size*sizeof(double));
   }
+
+  memcpy(valueList->guess, extrapolatedValues, valueList->size*sizeof(double));
+  valueList->guessPoints = nPoints;
+  valueList->guessBase = base;
   messageClose(LOG_NLS_EXTRAPOLATE);
-  return;
 }
 
-void printValueElement(VALUE* elem)
+/*! \fn checkExtrapolation
+ *
+ *  Returns 1 if the last initial guess was extrapolated; hit is then set if
+ *  it was closer to solution (max norm) than the solution it started from.
+ */
+int checkExtrapolation(VALUES_LIST* valueList, const double* solution, int *hit)
 {
-  /* debug output */
-  if(ACTIVE_STREAM(LOG_NLS_EXTRAPOLATE))
+  const double *old;
+  double errGuess = 0.0, errOld = 0.0;
+  unsigned int i;
+
+  if (valueList->guessPoints < 2)
   {
-    int i;
-    infoStreamPrint(LOG_NLS_EXTRAPOLATE, 1, "Element(size %d) at time %g ", elem->size, elem->time);
-    for(i = 0; i < elem->size; i++) {
-      infoStreamPrint(LOG_NLS_EXTRAPOLATE, 0, " oldValues[%d] = %g",i, elem->values[i]);
-    }
-    messageClose(LOG_NLS_EXTRAPOLATE);
+    valueList->guessPoints = 0;
+    return 0;
+  }
+  old = valuesAt(valueList, valueList->guessBase);
+  for (i = 0; i < valueList->size; i++)
+  {
+    errGuess = fmax(errGuess, fabs(solution[i] - valueList->guess[i]));
+    errOld = fmax(errOld, fabs(solution[i] - old[i]));
   }
+  *hit = errGuess < errOld;
+  valueList->guessPoints = 0;
+  return 1;
 }
 
 void printValuesListTimes(VALUES_LIST* list)
@@ -347,52 +262,19 @@ void printValuesListTimes(VALUES_LIST* list)
   /* debug output */
   if(ACTIVE_STREAM(LOG_NLS_EXTRAPOLATE))
   {
-    int i;
-    LIST_NODE *next;
-    VALUE *elem;
+    unsigned int i;
 
     infoStreamPrint(LOG_NLS_EXTRAPOLATE, 1, "Print all elements");
-    if (listLen(list->valueList) == 0){
+    if (list->length == 0){
       infoStreamPrint(LOG_NLS_EXTRAPOLATE, 0, "List is empty!");
       messageClose(LOG_NLS_EXTRAPOLATE);
       return;
     }
-    next = listFirstNode(list->valueList);
-
-    assertStreamPrint(NULL, NULL != next, "printValuesListTimes failed, no elements");
 
     /* go though the list */
-    for(i = 0; i < listLen(list->valueList); i++) {
-      elem = (VALUE*)listNodeData(next);
-      infoStreamPrint(LOG_NLS_EXTRAPOLATE, 0, "Element %d at time %g", i, elem->time);
-      next = listNextNode(next);
+    for(i = 0; i < list->length; i++) {
+      infoStreamPrint(LOG_NLS_EXTRAPOLATE, 0, "Element %d at time %g", (int)i, timeAt(list, i));
     }
     messageClose(LOG_NLS_EXTRAPOLATE);
   }
 }
-
-/*! \fn extraPolateValues
- *   This function extrapolates linear values based on old values.
- *
- *  \param [in]  [time] desired time for extrapolation
- *  \param [in]  [old1] old value at time1
- *  \param [in]  [time1] time for the first value
- *  \param [in]  [old2] old value at time2
- *  \param [in]  [time2] time for the second value
- */
-
-double extrapolateValues(const double time, const double old1, const double time1, const double old2, const double time2)
-{
-  double retValue;
-
-  if (time1 == time2 || old1 == old2)
-  {
-    retValue = old1;
-  }
-  else
-  {
-    retValue = old2 + ((time - time2)/(time1 - time2)) * (old1-old2);
-  }
-
-  return retValue;
-}
@@ -37,38 +37,36 @@
 #ifndef _OMC_VALUE_LIST_H
 #define _OMC_VALUE_LIST_H
 
-#include "util/list.h"
-
+/* The last solutions of a non-linear system, kept in a preallocated ring
+ * sorted by time; position 0 is the latest solution. */
 typedef struct VALUES_LIST
 {
-  LIST* valueList;
-} VALUES_LIST;
+  unsigned int size;          /* length of one solution vector */
+  unsigned int capacity;      /* number of solutions kept */
+  unsigned int first;         /* ring index of the latest solution */
+  unsigned int length;        /* number of stored solutions */
+  double *times;              /* [capacity] */
+  double *values;             /* [capacity*size] */
 
-typedef struct VALUE
-{
-  double time;
-  unsigned int size;
-  double *values;
-} VALUE;
+  /* the last initial guess, to tell if extrapolating paid off */
+  double *guess;              /* [size] */
+  unsigned int guessPoints;   /* number of solutions used for the guess; 0 = no guess */
+  unsigned int guessBase;     /* position of the latest solution used */
+} VALUES_LIST;
 
 
-VALUES_LIST *allocValueList(const unsigned int numberOfLists);
-void freeValueList(VALUES_LIST *valueList, unsigned int numberOfLists);
+VALUES_LIST *allocValueList(unsigned int size, unsigned int capacity);
+void freeValueList(VALUES_LIST *valueList);
 
-VALUE* createValueElement(unsigned int size, double time, double* values);
-void freeValue(VALUE* elem);
-void cleanValueList(VALUES_LIST *valueListm, LIST_NODE* next);
+void cleanValueList(VALUES_LIST *valueList);
 void cleanValueListbyTime(VALUES_LIST *valueList, double time);
-void removeNodes(LIST* list, LIST_NODE *node);
 
-void addListElement(VALUES_LIST* valueList, VALUE* elem);
+void addListElement(VALUES_LIST* valueList, double time, const double* values);
 void getValues(VALUES_LIST* valueList, double time, double* values, double* oldOutput);
+int checkExtrapolation(VALUES_LIST* valueList, const double* solution, int *hit);
 
-void printValueElement(VALUE* elem);
 void printValuesListTimes(VALUES_LIST* list);
 
 
 
 #endif
-
-
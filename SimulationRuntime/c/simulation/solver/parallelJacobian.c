@@ -0,0 +1,382 @@
+/*
+ * This file is part of OpenModelica.
+ *
+ * Copyright (c) 1998-CurrentYear, Linköping University,
+ * Department of Computer and Information Science,
+ * SE-58183 Linköping, Sweden.
+ *
+ * All rights reserved.
+ *
+ * THIS PROGRAM IS PROVIDED UNDER THE TERMS OF THIS OSMC PUBLIC
+ * LICENSE (OSMC-PL). ANY USE, REPRODUCTION OR DISTRIBUTION OF
+ * THIS PROGRAM CONSTITUTES RECIPIENT'S ACCEPTANCE OF THE OSMC
+ * PUBLIC LICENSE.
+ *
+ * The OpenModelica software and the Open Source Modelica
+ * Consortium (OSMC) Public License (OSMC-PL) are obtained
+ * from Linköping University, either from the above address,
+ * from the URL: http://www.ida.liu.se/projects/OpenModelica
+ * and in the OpenModelica distribution.
+ *
+ * This program is distributed  WITHOUT ANY WARRANTY; without
+ * even the implied warranty of  MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE, EXCEPT AS EXPRESSLY SET FORTH
+ * IN THE BY RECIPIENT SELECTED SUBSIDIARY LICENSE CONDITIONS
+ * OF OSMC-PL.
+ *
+ * See the full OSMC Public License conditions for more details.
+ *
+ */
+
+/*! \file parallelJacobian.c
+ * Description: Evaluation of the color groups of a colored Jacobian on
+ *              a pool of threads. The calling thread works as worker 0,
+ *              the others wait for the next Jacobian in the pool.
+ *              Each worker owns a copy of localData[0], the simulation
+ *              info and the analytic Jacobians, so the color groups can
+ *              perturb the states and run the model independently. The
+ *              color groups are disjoint sets of columns, so the workers
+ *              never write the same Jacobian element.
+ */
+
+#include "parallelJacobian.h"
+#include "model_help.h"
+#include "meta/meta_modelica.h"
+#include "util/omc_error.h"
+#include "util/omc_init.h"
+#include "simulation/options.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#if !defined(OMC_NO_THREADS)
+
+static void allocWorker(JACOBIAN_WORKER *worker, DATA *data, int index, long nResiduals)
+{
+  MODEL_DATA *mData = data->modelData;
+  ANALYTIC_JACOBIAN *jac = &(data->simulationInfo->analyticJacobians[index]);
+  ANALYTIC_JACOBIAN *privJac;
+
+  worker->sData.realVars = (modelica_real*) calloc(mData->nVariablesReal, sizeof(modelica_real));
+  worker->sData.integerVars = (modelica_integer*) calloc(mData->nVariablesInteger, sizeof(modelica_integer));
+  worker->sData.booleanVars = (modelica_boolean*) calloc(mData->nVariablesBoolean, sizeof(modelica_boolean));
+  worker->sData.stringVars = (modelica_string*) calloc(mData->nVariablesString, sizeof(modelica_string));
+  worker->localData = (SIMULATION_DATA**) calloc(SIZERINGBUFFER, sizeof(SIMULATION_DATA*));
+  worker->newdelta = (double*) calloc(nResiduals, sizeof(double));
+  worker->delayLines = (DELAY_LINE*) calloc(data->simulationInfo->delayArena.nLines, sizeof(DELAY_LINE));
+
+  /* only the Jacobian evaluated in parallel gets private work arrays */
+  worker->analyticJacobians = (ANALYTIC_JACOBIAN*) malloc(mData->nJacobians*sizeof(ANALYTIC_JACOBIAN));
+  memcpy(worker->analyticJacobians, data->simulationInfo->analyticJacobians, mData->nJacobians*sizeof(ANALYTIC_JACOBIAN));
+  privJac = &(worker->analyticJacobians[index]);
+  privJac->seedVars = (modelica_real*) calloc(jac->sizeCols, sizeof(modelica_real));
+  privJac->tmpVars = (modelica_real*) calloc(jac->sizeTmpVars, sizeof(modelica_real));
+  privJac->resultVars = (modelica_real*) calloc(jac->sizeRows, sizeof(modelica_real));
+}
+
+static void freeWorker(JACOBIAN_WORKER *worker, int index)
+{
+  free(worker->sData.realVars);
+  free(worker->sData.integerVars);
+  free(worker->sData.booleanVars);
+  free(worker->sData.stringVars);
+  free(worker->localData);
+  free(worker->newdelta);
+  free(worker->delayLines);
+  free(worker->analyticJacobians[index].seedVars);
+  free(worker->analyticJacobians[index].tmpVars);
+  free(worker->analyticJacobians[index].resultVars);
+  free(worker->analyticJacobians);
+}
+
+/* copies the current state of the solver into the private data of a worker */
+static void refreshWorker(JACOBIAN_WORKER *worker, DATA *data, int index)
+{
+  MODEL_DATA *mData = data->modelData;
+  SIMULATION_DATA *sData = data->localData[0];
+  size_t i;
+
+  worker->sData.timeValue = sData->timeValue;
+  memcpy(worker->sData.realVars, sData->realVars, mData->nVariablesReal*sizeof(modelica_real));
+  memcpy(worker->sData.integerVars, sData->integerVars, mData->nVariablesInteger*sizeof(modelica_integer));
+  memcpy(worker->sData.booleanVars, sData->booleanVars, mData->nVariablesBoolean*sizeof(modelica_boolean));
+  memcpy(worker->sData.stringVars, sData->stringVars, mData->nVariablesString*sizeof(modelica_string));
+  worker->sData.inlineVars = NULL;
+
+  worker->localData[0] = &(worker->sData);
+  for(i=1; i<SIZERINGBUFFER; i++) {
+    worker->localData[i] = data->localData[i];
+  }
+
+  worker->simulationInfo = *data->simulationInfo;
+  worker->simulationInfo.analyticJacobians = worker->analyticJacobians;
+  /* delayImpl moves the cursor of the line it reads */
+  memcpy(worker->delayLines, data->simulationInfo->delayArena.lines, data->simulationInfo->delayArena.nLines*sizeof(DELAY_LINE));
+  worker->simulationInfo.delayArena.lines = worker->delayLines;
+
+  worker->data = *data;
+  worker->data.localData = worker->localData;
+  worker->data.simulationInfo = &(worker->simulationInfo);
+}
+
+/* evaluates color groups until all of them are taken */
+static void runJob(PARALLEL_JACOBIAN *parJac, JACOBIAN_WORKER *worker)
+{
+  threadData_t *threadData = &(worker->threadData);
+  rtclock_t clock;
+  omc_pool_mark_t mark;
+  unsigned int color;
+  int success;
+
+  rt_ext_tp_tick(&clock);
+  for(;;)
+  {
+    pthread_mutex_lock(&parJac->mutex);
+    color = parJac->nextColor++;
+    pthread_mutex_unlock(&parJac->mutex);
+    if(color >= parJac->nColors) {
+      break;
+    }
+
+    /* the temporaries of the residual evaluations die with the color group */
+    mark = omc_pool_mark();
+    success = 0;
+    threadData->currentErrorStage = ERROR_INTEGRATOR;
+    /* try */
+#if !defined(OMC_EMCC)
+    MMC_TRY_INTERNAL(simulationJumpBuffer)
+#endif
+    threadData->globalJumpBuffer = threadData->simulationJumpBuffer;
+    threadData->mmc_jumper = threadData->simulationJumpBuffer;
+    success = (0 == parJac->func(worker, color, parJac->userData));
+#if !defined(OMC_EMCC)
+    MMC_CATCH_INTERNAL(simulationJumpBuffer)
+#endif
+    omc_pool_release(mark);
+
+    if(!success) {
+      pthread_mutex_lock(&parJac->mutex);
+      parJac->failed = 1;
+      pthread_mutex_unlock(&parJac->mutex);
+    }
+    worker->numberOfColors++;
+  }
+  worker->evalTime += rt_ext_tp_tock(&clock);
+}
+
+static void* workerThread(void *arg)
+{
+  JACOBIAN_WORKER *worker = (JACOBIAN_WORKER*) arg;
+  PARALLEL_JACOBIAN *parJac = worker->parJac;
+  unsigned long generation = 0;
+
+  pthread_mutex_init(&worker->threadData.parentMutex, NULL);
+  mmc_init_stackoverflow(&worker->threadData);
+  pthread_setspecific(mmc_thread_data_key, &worker->threadData);
+
+  pthread_mutex_lock(&parJac->mutex);
+  for(;;)
+  {
+    while(!parJac->shutdown && parJac->generation == generation) {
+      pthread_cond_wait(&parJac->start, &parJac->mutex);
+    }
+    if(parJac->shutdown) {
+      break;
+    }
+    generation = parJac->generation;
+    pthread_mutex_unlock(&parJac->mutex);
+
+    runJob(parJac, worker);
+
+    pthread_mutex_lock(&parJac->mutex);
+    if(0 == --parJac->running) {
+      pthread_cond_signal(&parJac->done);
+    }
+  }
+  pthread_mutex_unlock(&parJac->mutex);
+  pthread_mutex_destroy(&worker->threadData.parentMutex);
+
+  return NULL;
+}
+
+#endif /* !OMC_NO_THREADS */
+
+/*! \fn allocParallelJacobian
+ *
+ *  Starts the thread pool for the colored Jacobian with the given index
+ *  if -jacobianThreads asks for more than one thread. Returns NULL if the
+ *  Jacobian should be evaluated sequentially.
+ *
+ *  \param [in]  [data]
+ *  \param [in]  [threadData]
+ *  \param [in]  [index]       index of the analytic Jacobian
+ *  \param [in]  [nResiduals]  length of the private residual vectors
+ */
+PARALLEL_JACOBIAN* allocParallelJacobian(DATA *data, threadData_t *threadData, int index, long nResiduals)
+{
+  int nThreads = omc_flag[FLAG_JACOBIAN_THREADS] ? atoi(omc_flagValue[FLAG_JACOBIAN_THREADS]) : 1;
+#if !defined(OMC_NO_THREADS)
+  MODEL_DATA *mData = data->modelData;
+  PARALLEL_JACOBIAN *parJac;
+  int i;
+#endif
+
+  if(nThreads <= 1) {
+    return NULL;
+  }
+
+#if defined(OMC_NO_THREADS)
+  warningStreamPrint(LOG_STDOUT, 0, "The runtime is compiled without thread support; the Jacobian is evaluated sequentially.");
+  return NULL;
+#else
+  /* the solvers of algebraic loops keep their work arrays in the
+   * system data and are not reentrant */
+  if(mData->nLinearSystems > 0 || mData->nNonLinearSystems > 0 || mData->nMixedSystems > 0) {
+    infoStreamPrint(LOG_STDOUT, 0, "The model contains algebraic loops; the Jacobian is evaluated sequentially.");
+    return NULL;
+  }
+  /* external functions may keep state (e.g. lookup caches of tables) in
+   * the external objects, which can not be copied */
+  if(mData->nExtObjs > 0) {
+    infoStreamPrint(LOG_STDOUT, 0, "The model contains external objects; the Jacobian is evaluated sequentially.");
+    return NULL;
+  }
+  /* the logs of the residual evaluations would interleave */
+  if(ACTIVE_STREAM(LOG_DASSL_STATES) || ACTIVE_STREAM(LOG_SOLVER_V) || ACTIVE_STREAM(LOG_SOLVER_CONTEXT) || ACTIVE_STREAM(LOG_JAC)) {
+    infoStreamPrint(LOG_STDOUT, 0, "Detailed solver logging is active; the Jacobian is evaluated sequentially.");
+    return NULL;
+  }
+
+  parJac = (PARALLEL_JACOBIAN*) calloc(1, sizeof(PARALLEL_JACOBIAN));
+  assertStreamPrint(threadData, 0 != parJac, "out of memory");
+  parJac->nThreads = nThreads;
+  parJac->index = index;
+  parJac->workers = (JACOBIAN_WORKER*) calloc(nThreads, sizeof(JACOBIAN_WORKER));
+  parJac->threads = (pthread_t*) calloc(nThreads, sizeof(pthread_t));
+  assertStreamPrint(threadData, 0 != parJac->workers && 0 != parJac->threads, "out of memory");
+
+  pthread_mutex_init(&parJac->mutex, NULL);
+  pthread_cond_init(&parJac->start, NULL);
+  pthread_cond_init(&parJac->done, NULL);
+
+  for(i=0; i<nThreads; i++) {
+    parJac->workers[i].parJac = parJac;
+    allocWorker(&parJac->workers[i], data, index, nResiduals);
+  }
+  for(i=1; i<nThreads; i++) {
+    if(pthread_create(&parJac->threads[i], NULL, workerThread, &parJac->workers[i])) {
+      warningStreamPrint(LOG_STDOUT, 0, "Could not start thread %d of the parallel Jacobian; using %d threads.", i, i);
+      for(; nThreads > i; nThreads--) {
+        freeWorker(&parJac->workers[nThreads-1], index);
+      }
+      parJac->nThreads = i;
+      break;
+    }
+  }
+
+  infoStreamPrint(LOG_SOLVER, 0, "color groups of the Jacobian are evaluated by %d threads", parJac->nThreads);
+  return parJac;
+#endif
+}
+
+void freeParallelJacobian(PARALLEL_JACOBIAN *parJac)
+{
+#if !defined(OMC_NO_THREADS)
+  int i;
+
+  if(!parJac) {
+    return;
+  }
+
+  pthread_mutex_lock(&parJac->mutex);
+  parJac->shutdown = 1;
+  pthread_cond_broadcast(&parJac->start);
+  pthread_mutex_unlock(&parJac->mutex);
+  for(i=1; i<parJac->nThreads; i++) {
+    pthread_join(parJac->threads[i], NULL);
+  }
+
+  pthread_mutex_destroy(&parJac->mutex);
+  pthread_cond_destroy(&parJac->start);
+  pthread_cond_destroy(&parJac->done);
+
+  for(i=0; i<parJac->nThreads; i++) {
+    freeWorker(&parJac->workers[i], parJac->index);
+  }
+  free(parJac->workers);
+  free(parJac->threads);
+  free(parJac);
+#endif
+}
+
+/*! \fn evalParallelJacobian
+ *
+ *  Evaluates the color groups 0..nColors-1 with func on all threads of
+ *  the pool and returns after the last one is done. func receives the
+ *  worker with the private copy of the current solver state and must
+ *  only write the Jacobian columns of its color group.
+ *
+ *  \return 0 on success, 1 if an evaluation failed or threw
+ */
+int evalParallelJacobian(PARALLEL_JACOBIAN *parJac, DATA *data, threadData_t *threadData, unsigned int nColors, jacobianColorFunc func, void *userData)
+{
+#if !defined(OMC_NO_THREADS)
+  threadData_t *workerThreadData = &(parJac->workers[0].threadData);
+  threadData_t *oldThreadData;
+  int i;
+
+  for(i=0; i<parJac->nThreads; i++) {
+    refreshWorker(&parJac->workers[i], data, parJac->index);
+  }
+  /* the calling thread evaluates as worker 0; like MMC_TRY_TOP_SET, it
+   * works on a copy of its thread data with an own mutex, and throws that
+   * look the thread data up through the key have to land in runJob and
+   * not in the jump buffers of the solver while the pool is running */
+  oldThreadData = (threadData_t*) pthread_getspecific(mmc_thread_data_key);
+  *workerThreadData = *threadData;
+  pthread_mutex_init(&workerThreadData->parentMutex, NULL);
+  pthread_setspecific(mmc_thread_data_key, workerThreadData);
+
+  pthread_mutex_lock(&parJac->mutex);
+  parJac->func = func;
+  parJac->userData = userData;
+  parJac->nColors = nColors;
+  parJac->nextColor = 0;
+  parJac->failed = 0;
+  parJac->running = parJac->nThreads - 1;
+  parJac->generation++;
+  pthread_cond_broadcast(&parJac->start);
+  pthread_mutex_unlock(&parJac->mutex);
+
+  runJob(parJac, &parJac->workers[0]);
+
+  pthread_mutex_lock(&parJac->mutex);
+  while(parJac->running > 0) {
+    pthread_cond_wait(&parJac->done, &parJac->mutex);
+  }
+  pthread_mutex_unlock(&parJac->mutex);
+
+  pthread_setspecific(mmc_thread_data_key, oldThreadData);
+  pthread_mutex_destroy(&workerThreadData->parentMutex);
+
+  parJac->numberOfEvaluations++;
+  return parJac->failed;
+#else
+  return 1;
+#endif
+}
+
+void printParallelJacobianStatistics(PARALLEL_JACOBIAN *parJac)
+{
+  int i;
+
+  if(!parJac || !ACTIVE_STREAM(LOG_STATS)) {
+    return;
+  }
+
+  infoStreamPrint(LOG_STATS, 1, "parallel Jacobian (%d threads, %lu evaluations)", parJac->nThreads, parJac->numberOfEvaluations);
+  for(i=0; i<parJac->nThreads; i++) {
+    infoStreamPrint(LOG_STATS, 0, "thread %d: %lu color groups in %gs", i, parJac->workers[i].numberOfColors, parJac->workers[i].evalTime);
+  }
+  messageClose(LOG_STATS);
+}
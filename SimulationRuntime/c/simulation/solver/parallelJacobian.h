@@ -0,0 +1,111 @@
+/*
+ * This file is part of OpenModelica.
+ *
+ * Copyright (c) 1998-CurrentYear, Linköping University,
+ * Department of Computer and Information Science,
+ * SE-58183 Linköping, Sweden.
+ *
+ * All rights reserved.
+ *
+ * THIS PROGRAM IS PROVIDED UNDER THE TERMS OF THIS OSMC PUBLIC
+ * LICENSE (OSMC-PL). ANY USE, REPRODUCTION OR DISTRIBUTION OF
+ * THIS PROGRAM CONSTITUTES RECIPIENT'S ACCEPTANCE OF THE OSMC
+ * PUBLIC LICENSE.
+ *
+ * The OpenModelica software and the Open Source Modelica
+ * Consortium (OSMC) Public License (OSMC-PL) are obtained
+ * from Linköping University, either from the above address,
+ * from the URL: http://www.ida.liu.se/projects/OpenModelica
+ * and in the OpenModelica distribution.
+ *
+ * This program is distributed  WITHOUT ANY WARRANTY; without
+ * even the implied warranty of  MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE, EXCEPT AS EXPRESSLY SET FORTH
+ * IN THE BY RECIPIENT SELECTED SUBSIDIARY LICENSE CONDITIONS
+ * OF OSMC-PL.
+ *
+ * See the full OSMC Public License conditions for more details.
+ *
+ */
+
+/*! \file parallelJacobian.h
+ * Description: Evaluation of the color groups of a colored Jacobian on
+ *              several threads. Every worker evaluates the model on a
+ *              private copy of the simulation data written by a
+ *              continuous-time evaluation. The rest (inputs, parameters,
+ *              delay samples, previous steps) is shared and only read.
+ */
+
+#ifndef _OMC_PARALLEL_JACOBIAN_H
+#define _OMC_PARALLEL_JACOBIAN_H
+
+#include "simulation_data.h"
+#include "util/rtclock.h"
+
+#if !defined(OMC_NO_THREADS)
+#include <pthread.h>
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct PARALLEL_JACOBIAN;
+
+/* private copy of everything a residual or column evaluation writes */
+typedef struct JACOBIAN_WORKER
+{
+  struct PARALLEL_JACOBIAN *parJac;
+  DATA data;                           /* shallow copy pointing to the private parts below */
+  SIMULATION_INFO simulationInfo;
+  SIMULATION_DATA sData;               /* private localData[0] */
+  SIMULATION_DATA **localData;
+  ANALYTIC_JACOBIAN *analyticJacobians;
+  DELAY_LINE *delayLines;              /* private lookup cursors; the samples are only read */
+  threadData_t threadData;
+  double *newdelta;                    /* private residual vector */
+  void *solverData;                    /* solver specific per-worker data, owned by the solver */
+
+  /* statistics */
+  unsigned long numberOfColors;        /* number of evaluated color groups */
+  double evalTime;                     /* time spent evaluating color groups */
+} JACOBIAN_WORKER;
+
+/* evaluates color group 'color' on the private data of 'worker' */
+typedef int (*jacobianColorFunc)(JACOBIAN_WORKER *worker, unsigned int color, void *userData);
+
+typedef struct PARALLEL_JACOBIAN
+{
+  int nThreads;                        /* worker 0 is the calling thread */
+  int index;                           /* index of the analytic Jacobian */
+  JACOBIAN_WORKER *workers;
+  unsigned long numberOfEvaluations;
+
+  /* current job */
+  jacobianColorFunc func;
+  void *userData;
+  unsigned int nColors;
+  unsigned int nextColor;
+  int failed;
+
+#if !defined(OMC_NO_THREADS)
+  pthread_t *threads;
+  pthread_mutex_t mutex;
+  pthread_cond_t start;
+  pthread_cond_t done;
+  unsigned long generation;            /* counts the jobs handed to the pool */
+  int running;                         /* number of pool threads working on the job */
+  int shutdown;
+#endif
+} PARALLEL_JACOBIAN;
+
+PARALLEL_JACOBIAN* allocParallelJacobian(DATA *data, threadData_t *threadData, int index, long nResiduals);
+void freeParallelJacobian(PARALLEL_JACOBIAN *parJac);
+int evalParallelJacobian(PARALLEL_JACOBIAN *parJac, DATA *data, threadData_t *threadData, unsigned int nColors, jacobianColorFunc func, void *userData);
+void printParallelJacobianStatistics(PARALLEL_JACOBIAN *parJac);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -226,7 +226,7 @@ int initializeSolverData(DATA* data, threadData_t *threadData, SOLVER_INFO* solv
 
   /* set tolerance for ZeroCrossings */
   /*  TODO: Check this! */
-  /*  setZCtol(fmin(simInfo->stepSize, simInfo->tolerance)); */
+  /*  setZCtol(data, fmin(simInfo->stepSize, simInfo->tolerance)); */
 
   switch (solverInfo->solverMethod)
   {
@@ -566,6 +566,7 @@ int finishSimulation(DATA* data, threadData_t *threadData, SOLVER_INFO* solverIn
     infoStreamPrint(LOG_STATS, 1, "events");
     infoStreamPrint(LOG_STATS, 0, "%5ld state events", solverInfo->stateEvents);
     infoStreamPrint(LOG_STATS, 0, "%5ld time events", solverInfo->sampleEvents);
+    infoStreamPrint(LOG_STATS, 0, "%5ld zero-crossing evaluations to locate state events", data->simulationInfo->callStatistics.eventLocationEvaluations);
     messageClose(LOG_STATS);
 
     if(S_OPTIMIZATION == solverInfo->solverMethod || /* skip solver statistics for optimization */
@@ -604,6 +605,10 @@ int finishSimulation(DATA* data, threadData_t *threadData, SOLVER_INFO* solverIn
     messageClose(LOG_STATS_V);
 
     infoStreamPrint(LOG_STATS_V, 1, "linear systems");
+    infoStreamPrint(LOG_STATS_V, 0, "%5ld symbolic analyses", data->simulationInfo->callStatistics.linearSymbolicAnalyses);
+    infoStreamPrint(LOG_STATS_V, 0, "%5ld numeric factorizations", data->simulationInfo->callStatistics.linearFactorizations);
+    infoStreamPrint(LOG_STATS_V, 0, "%5ld solves", data->simulationInfo->callStatistics.linearSolves);
+    infoStreamPrint(LOG_STATS_V, 0, "%5ld solves with a reused factorization", data->simulationInfo->callStatistics.linearFactorizationReuses);
     for(ui=0; ui<data->modelData->nLinearSystems; ui++)
       printLinearSystemSolvingStatistics(data, ui, LOG_STATS_V);
     messageClose(LOG_STATS_V);
@@ -613,6 +618,18 @@ int finishSimulation(DATA* data, threadData_t *threadData, SOLVER_INFO* solverIn
       printNonLinearSystemSolvingStatistics(data, ui, LOG_STATS_V);
     messageClose(LOG_STATS_V);
 
+    if(omc_alloc_interface.malloc == omc_alloc_interface_pooled.malloc)
+    {
+      size_t inUse, highWater, reserved;
+      unsigned long chunkAllocations;
+      omc_pool_statistics(&inUse, &highWater, &reserved, &chunkAllocations);
+      infoStreamPrint(LOG_STATS_V, 1, "memory pool (main thread)");
+      infoStreamPrint(LOG_STATS_V, 0, "%12lu bytes high-water mark", (unsigned long) highWater);
+      infoStreamPrint(LOG_STATS_V, 0, "%12lu bytes reserved", (unsigned long) reserved);
+      infoStreamPrint(LOG_STATS_V, 0, "%12lu chunk allocations", chunkAllocations);
+      messageClose(LOG_STATS_V);
+    }
+
     messageClose(LOG_STATS);
     rt_tick(SIM_TIMER_TOTAL);
   }
@@ -685,7 +702,7 @@ int solver_main(DATA* data, threadData_t *threadData, const char* init_initMetho
   /*  initialize external input structure */
   externalInputallocate(data);
   /* set tolerance for ZeroCrossings */
-  setZCtol(fmin(data->simulationInfo->stepSize, data->simulationInfo->tolerance));
+  setZCtol(data, fmin(data->simulationInfo->stepSize, data->simulationInfo->tolerance));
   omc_alloc_interface.collect_a_little();
 
   /* initialize solver data */
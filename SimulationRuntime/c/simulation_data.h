@@ -108,6 +108,11 @@ typedef struct CALL_STATISTICS
   long functionZeroCrossings;
   long functionEvalDAE;
   long functionAlgebraics;
+  long linearSymbolicAnalyses;         /* sparse pattern analyses of linear systems */
+  long linearFactorizations;           /* numeric factorizations of linear systems */
+  long linearSolves;                   /* forward/backward substitutions of linear systems */
+  long linearFactorizationReuses;      /* linear solves done with an earlier factorization */
+  long eventLocationEvaluations;       /* zero-crossing evaluations while locating state events */
 } CALL_STATISTICS;
 
 typedef enum {ERROR_AT_TIME,NO_PROGRESS_START_POINT,NO_PROGRESS_FACTOR,IMPROPER_INPUT} equationSystemError;
@@ -287,7 +292,7 @@ typedef struct NONLINEAR_SYSTEM_DATA
   modelica_real *nlsxOld;              /* previous x */
   modelica_real *nlsxExtrapolation;    /* extrapolated values for x from old and old2 - used as initial guess */
 
-  void *oldValueList;                  /* old values organized in a sorted list for extrapolation and interpolate, respectively */
+  void *oldValueList;                  /* old values organized in a sorted ring for extrapolation and interpolate, respectively */
   modelica_real *resValues;            /* memory space for evaluated residual values */
 
   modelica_real residualError;         /* not used */
@@ -299,6 +304,8 @@ typedef struct NONLINEAR_SYSTEM_DATA
   unsigned long numberOfFEval;         /* number of function evaluations of this system */
   unsigned long numberOfJEval;         /* number of jacobian evaluations of this system */
   unsigned long numberOfIterations;    /* number of iteration of non-linear solvers of this system */
+  unsigned long numberOfExtrapolations;    /* number of solved calls started from an extrapolated guess */
+  unsigned long numberOfExtrapolationHits; /* ... where the guess was closer to the solution than the last solution */
   double totalTime;                    /* save the totalTime */
   rtclock_t totalTimeClock;            /* time clock for the totalTime  */
   double jacobianTime;                 /* save the time to calculate jacobians */
@@ -349,6 +356,7 @@ typedef struct LINEAR_SYSTEM_DATA
   modelica_boolean failed;              /* 1: failed while last try with lapack - else not */
   modelica_boolean useSparseSolver;     /* 1: use sparse solver, - else any solver */
   ANALYTIC_JACOBIAN* parentJacobian; 	/* if != NULL then it's the parent jacobian matrix */
+  modelica_real *reuseWork;             /* [2*size] work array to reuse a factorization (-lssReuse), else NULL */
 
   /* statistics */
   unsigned long numberOfCall;           /* number of solving calls of this system */
@@ -557,6 +565,31 @@ typedef struct CLOCK_DATA {
   long cnt;
 } CLOCK_DATA;
 
+typedef struct TIME_AND_VALUE
+{
+  double t; /* time; not named that due to macros */
+  double value;
+} TIME_AND_VALUE;
+
+/* The stored samples of one delay expression: the first nSamples of the
+ * line's slots [offset, offset+capacity) in the DELAY_ARENA */
+typedef struct DELAY_LINE
+{
+  long offset;
+  long capacity;
+  long nSamples;
+  long cursor;        /* sample found by the last lookup; delayed time is almost monotone */
+} DELAY_LINE;
+
+/* All delay lines share one contiguous array of samples */
+typedef struct DELAY_ARENA
+{
+  long nLines;
+  long size;          /* number of slots */
+  DELAY_LINE *lines;
+  TIME_AND_VALUE *samples;
+} DELAY_ARENA;
+
 enum EVAL_CONTEXT
 {
   CONTEXT_UNKNOWN = 0,
@@ -578,6 +611,7 @@ typedef struct SIMULATION_INFO
   modelica_integer numSteps;
   modelica_real stepSize;
   modelica_real tolerance;
+  modelica_real tolZC;                 /* tolerance of the zero-crossing hysteresis, see setZCtol */
   const char *solverMethod;
   const char *outputFormat;
   const char *variableFilter;
@@ -624,6 +658,9 @@ typedef struct SIMULATION_INFO
   modelica_real* zeroCrossings;
   modelica_real* zeroCrossingsPre;
   modelica_real* zeroCrossingsBackup;  /* used by bisection in event.c */
+  modelica_real* eventLocationWork;    /* states and derivatives at both ends of a step, used by findRoot in event.c */
+  LIST* eventLocationList;             /* events found by bisection in event.c */
+  long* zeroCrossingsChanged;          /* indexes of the zero-crossings that changed sign, used by checkForStateEvent in event.c */
   modelica_boolean* relations;
   modelica_boolean* relationsPre;
   modelica_boolean* storedRelations;   /* this array contains a copy of relations each time the event iteration starts */
@@ -674,7 +711,7 @@ typedef struct SIMULATION_INFO
 
   /* delay vars */
   double tStart;
-  RINGBUFFER **delayStructure;
+  DELAY_ARENA delayArena;
   const char *OPENMODELICAHOME;
 
   CHATTERING_INFO chatteringInfo;
@@ -0,0 +1,361 @@
+/*
+ * This file is part of OpenModelica.
+ *
+ * Copyright (c) 1998-CurrentYear, Open Source Modelica Consortium (OSMC),
+ * c/o Linköpings universitet, Department of Computer and Information Science,
+ * SE-58183 Linköping, Sweden.
+ *
+ * All rights reserved.
+ *
+ * THIS PROGRAM IS PROVIDED UNDER THE TERMS OF THE BSD NEW LICENSE OR THE
+ * GPL VERSION 3 LICENSE OR THE OSMC PUBLIC LICENSE (OSMC-PL) VERSION 1.2.
+ * ANY USE, REPRODUCTION OR DISTRIBUTION OF THIS PROGRAM CONSTITUTES
+ * RECIPIENT'S ACCEPTANCE OF THE OSMC PUBLIC LICENSE OR THE GPL VERSION 3,
+ * ACCORDING TO RECIPIENTS CHOICE.
+ *
+ * The OpenModelica software and the OSMC (Open Source Modelica Consortium)
+ * Public License (OSMC-PL) are obtained from OSMC, either from the above
+ * address, from the URLs: http://www.openmodelica.org or
+ * http://www.ida.liu.se/projects/OpenModelica, and in the OpenModelica
+ * distribution. GNU version 3 is obtained from:
+ * http://www.gnu.org/copyleft/gpl.html. The New BSD License is obtained from:
+ * http://www.opensource.org/licenses/BSD-3-Clause.
+ *
+ * This program is distributed WITHOUT ANY WARRANTY; without even the implied
+ * warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, EXCEPT AS
+ * EXPRESSLY SET FORTH IN THE BY RECIPIENT SELECTED SUBSIDIARY LICENSE
+ * CONDITIONS OF OSMC-PL.
+ *
+ */
+
+/*! \file omc_dtoa.c
+ * Shortest round-trip formatting of doubles with the Grisu2 algorithm of
+ * F. Loitsch, "Printing Floating-Point Numbers Quickly and Accurately with
+ * Integers", PLDI 2010. Grisu2 always produces a string that reads back to
+ * the same double and is the shortest such string for almost all inputs.
+ */
+
+#include <string.h>
+#include <stdint.h>
+
+#include "omc_dtoa.h"
+
+#define DP_SIGNIFICAND_SIZE 52
+#define DP_EXPONENT_BIAS (0x3FF + DP_SIGNIFICAND_SIZE)
+#define DP_MIN_EXPONENT (-DP_EXPONENT_BIAS)
+#define DP_EXPONENT_MASK 0x7FF0000000000000ULL
+#define DP_SIGNIFICAND_MASK 0x000FFFFFFFFFFFFFULL
+#define DP_HIDDEN_BIT 0x0010000000000000ULL
+
+typedef struct {
+  uint64_t f;
+  int e;
+} diy_fp;
+
+/* normalized 64 bit approximations of 10^k for k = -348, -340, ..., 340 */
+static const uint64_t cachedPowersF[] = {
+  0xfa8fd5a0081c0288ULL, 0xbaaee17fa23ebf76ULL, 0x8b16fb203055ac76ULL, 0xcf42894a5dce35eaULL,
+  0x9a6bb0aa55653b2dULL, 0xe61acf033d1a45dfULL, 0xab70fe17c79ac6caULL, 0xff77b1fcbebcdc4fULL,
+  0xbe5691ef416bd60cULL, 0x8dd01fad907ffc3cULL, 0xd3515c2831559a83ULL, 0x9d71ac8fada6c9b5ULL,
+  0xea9c227723ee8bcbULL, 0xaecc49914078536dULL, 0x823c12795db6ce57ULL, 0xc21094364dfb5637ULL,
+  0x9096ea6f3848984fULL, 0xd77485cb25823ac7ULL, 0xa086cfcd97bf97f4ULL, 0xef340a98172aace5ULL,
+  0xb23867fb2a35b28eULL, 0x84c8d4dfd2c63f3bULL, 0xc5dd44271ad3cdbaULL, 0x936b9fcebb25c996ULL,
+  0xdbac6c247d62a584ULL, 0xa3ab66580d5fdaf6ULL, 0xf3e2f893dec3f126ULL, 0xb5b5ada8aaff80b8ULL,
+  0x87625f056c7c4a8bULL, 0xc9bcff6034c13053ULL, 0x964e858c91ba2655ULL, 0xdff9772470297ebdULL,
+  0xa6dfbd9fb8e5b88fULL, 0xf8a95fcf88747d94ULL, 0xb94470938fa89bcfULL, 0x8a08f0f8bf0f156bULL,
+  0xcdb02555653131b6ULL, 0x993fe2c6d07b7facULL, 0xe45c10c42a2b3b06ULL, 0xaa242499697392d3ULL,
+  0xfd87b5f28300ca0eULL, 0xbce5086492111aebULL, 0x8cbccc096f5088ccULL, 0xd1b71758e219652cULL,
+  0x9c40000000000000ULL, 0xe8d4a51000000000ULL, 0xad78ebc5ac620000ULL, 0x813f3978f8940984ULL,
+  0xc097ce7bc90715b3ULL, 0x8f7e32ce7bea5c70ULL, 0xd5d238a4abe98068ULL, 0x9f4f2726179a2245ULL,
+  0xed63a231d4c4fb27ULL, 0xb0de65388cc8ada8ULL, 0x83c7088e1aab65dbULL, 0xc45d1df942711d9aULL,
+  0x924d692ca61be758ULL, 0xda01ee641a708deaULL, 0xa26da3999aef774aULL, 0xf209787bb47d6b85ULL,
+  0xb454e4a179dd1877ULL, 0x865b86925b9bc5c2ULL, 0xc83553c5c8965d3dULL, 0x952ab45cfa97a0b3ULL,
+  0xde469fbd99a05fe3ULL, 0xa59bc234db398c25ULL, 0xf6c69a72a3989f5cULL, 0xb7dcbf5354e9beceULL,
+  0x88fcf317f22241e2ULL, 0xcc20ce9bd35c78a5ULL, 0x98165af37b2153dfULL, 0xe2a0b5dc971f303aULL,
+  0xa8d9d1535ce3b396ULL, 0xfb9b7cd9a4a7443cULL, 0xbb764c4ca7a44410ULL, 0x8bab8eefb6409c1aULL,
+  0xd01fef10a657842cULL, 0x9b10a4e5e9913129ULL, 0xe7109bfba19c0c9dULL, 0xac2820d9623bf429ULL,
+  0x80444b5e7aa7cf85ULL, 0xbf21e44003acdd2dULL, 0x8e679c2f5e44ff8fULL, 0xd433179d9c8cb841ULL,
+  0x9e19db92b4e31ba9ULL, 0xeb96bf6ebadf77d9ULL, 0xaf87023b9bf0ee6bULL
+};
+static const int16_t cachedPowersE[] = {
+  -1220, -1193, -1166, -1140, -1113, -1087, -1060, -1034, -1007, -980, -954, -927,
+  -901, -874, -847, -821, -794, -768, -741, -715, -688, -661, -635, -608,
+  -582, -555, -529, -502, -475, -449, -422, -396, -369, -343, -316, -289,
+  -263, -236, -210, -183, -157, -130, -103, -77, -50, -24, 3, 30,
+  56, 83, 109, 136, 162, 189, 216, 242, 269, 295, 322, 348,
+  375, 402, 428, 455, 481, 508, 534, 561, 588, 614, 641, 667,
+  694, 720, 747, 774, 800, 827, 853, 880, 907, 933, 960, 986,
+  1013, 1039, 1066
+};
+
+static const uint32_t powersOf10[] = {1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000};
+
+static diy_fp diy_fp_from_double(double d)
+{
+  diy_fp res;
+  uint64_t bits;
+  int biased_e;
+  memcpy(&bits, &d, sizeof(double));
+  biased_e = (int)((bits & DP_EXPONENT_MASK) >> DP_SIGNIFICAND_SIZE);
+  res.f = bits & DP_SIGNIFICAND_MASK;
+  if (biased_e != 0) {
+    res.f += DP_HIDDEN_BIT;
+    res.e = biased_e - DP_EXPONENT_BIAS;
+  } else {
+    res.e = DP_MIN_EXPONENT + 1;
+  }
+  return res;
+}
+
+static diy_fp diy_fp_multiply(diy_fp x, diy_fp y)
+{
+  const uint64_t M32 = 0xFFFFFFFFULL;
+  const uint64_t a = x.f >> 32, b = x.f & M32, c = y.f >> 32, d = y.f & M32;
+  const uint64_t ac = a*c, bc = b*c, ad = a*d, bd = b*d;
+  uint64_t tmp = (bd >> 32) + (ad & M32) + (bc & M32);
+  diy_fp res;
+  tmp += 1U << 31; /* round */
+  res.f = ac + (ad >> 32) + (bc >> 32) + (tmp >> 32);
+  res.e = x.e + y.e + 64;
+  return res;
+}
+
+static diy_fp diy_fp_normalize(diy_fp x)
+{
+  while (!(x.f & 0x8000000000000000ULL)) {
+    x.f <<= 1;
+    x.e--;
+  }
+  return x;
+}
+
+/* boundaries m- and m+ of the rounding interval of v, with the exponent of m+ */
+static void normalized_boundaries(diy_fp v, diy_fp *minus, diy_fp *plus)
+{
+  diy_fp pl, mi;
+  pl.f = (v.f << 1) + 1;
+  pl.e = v.e - 1;
+  while (!(pl.f & (DP_HIDDEN_BIT << 1))) {
+    pl.f <<= 1;
+    pl.e--;
+  }
+  pl.f <<= 64 - DP_SIGNIFICAND_SIZE - 2;
+  pl.e -= 64 - DP_SIGNIFICAND_SIZE - 2;
+  if (v.f == DP_HIDDEN_BIT) {
+    mi.f = (v.f << 2) - 1;
+    mi.e = v.e - 2;
+  } else {
+    mi.f = (v.f << 1) - 1;
+    mi.e = v.e - 1;
+  }
+  mi.f <<= mi.e - pl.e;
+  mi.e = pl.e;
+  *plus = pl;
+  *minus = mi;
+}
+
+/* cached power c with -60 <= e(w*c) <= -32, returns the decimal exponent of 1/c in K */
+static diy_fp get_cached_power(int e, int *K)
+{
+  diy_fp res;
+  double dk = (-61 - e) * 0.30102999566398114 + 347; /* dk must be positive, so can do ceiling in positive */
+  int k = (int) dk;
+  unsigned index;
+  if (dk - k > 0.0) {
+    k++;
+  }
+  index = (unsigned)((k >> 3) + 1);
+  *K = -(-348 + (int)(index << 3));
+  res.f = cachedPowersF[index];
+  res.e = cachedPowersE[index];
+  return res;
+}
+
+static void grisu_round(char *buffer, int len, uint64_t delta, uint64_t rest, uint64_t ten_kappa, uint64_t wp_w)
+{
+  while (rest < wp_w && delta - rest >= ten_kappa &&
+         (rest + ten_kappa < wp_w || wp_w - rest > rest + ten_kappa - wp_w)) {
+    buffer[len-1]--;
+    rest += ten_kappa;
+  }
+}
+
+static int count_decimal_digits(uint32_t n)
+{
+  int i;
+  for (i=1; i<10; i++) {
+    if (n < powersOf10[i]) {
+      return i;
+    }
+  }
+  return 10;
+}
+
+static void digit_gen(diy_fp W, diy_fp Mp, uint64_t delta, char *buffer, int *len, int *K)
+{
+  diy_fp one, wp_w;
+  uint32_t p1, d;
+  uint64_t p2, tmp;
+  int kappa;
+
+  one.f = ((uint64_t)1) << -Mp.e;
+  one.e = Mp.e;
+  wp_w.f = Mp.f - W.f;
+  wp_w.e = Mp.e;
+  p1 = (uint32_t)(Mp.f >> -one.e);
+  p2 = Mp.f & (one.f - 1);
+  kappa = count_decimal_digits(p1);
+  *len = 0;
+
+  while (kappa > 0) {
+    d = p1 / powersOf10[kappa-1];
+    p1 %= powersOf10[kappa-1];
+    if (d || *len) {
+      buffer[(*len)++] = (char)('0' + d);
+    }
+    kappa--;
+    tmp = (((uint64_t)p1) << -one.e) + p2;
+    if (tmp <= delta) {
+      *K += kappa;
+      grisu_round(buffer, *len, delta, tmp, ((uint64_t)powersOf10[kappa]) << -one.e, wp_w.f);
+      return;
+    }
+  }
+
+  for (;;) {
+    p2 *= 10;
+    delta *= 10;
+    d = (uint32_t)(p2 >> -one.e);
+    if (d || *len) {
+      buffer[(*len)++] = (char)('0' + d);
+    }
+    p2 &= one.f - 1;
+    kappa--;
+    if (p2 < delta) {
+      *K += kappa;
+      grisu_round(buffer, *len, delta, p2, one.f, -kappa < 10 ? wp_w.f * powersOf10[-kappa] : 0);
+      return;
+    }
+  }
+}
+
+/* digits of a positive, finite value: value = buffer * 10^K */
+static void grisu2(double value, char *buffer, int *len, int *K)
+{
+  const diy_fp v = diy_fp_from_double(value);
+  diy_fp w_m, w_p, c_mk, W, Wp, Wm;
+  normalized_boundaries(v, &w_m, &w_p);
+
+  c_mk = get_cached_power(w_p.e, K);
+  W = diy_fp_multiply(diy_fp_normalize(v), c_mk);
+  Wp = diy_fp_multiply(w_p, c_mk);
+  Wm = diy_fp_multiply(w_m, c_mk);
+  Wm.f++;
+  Wp.f--;
+  digit_gen(W, Wp, Wp.f - Wm.f, buffer, len, K);
+}
+
+static int write_exponent(int K, char *buffer)
+{
+  char *p = buffer;
+  *p++ = 'e';
+  if (K < 0) {
+    *p++ = '-';
+    K = -K;
+  } else {
+    *p++ = '+';
+  }
+  if (K >= 100) {
+    *p++ = (char)('0' + K / 100);
+    K %= 100;
+  }
+  *p++ = (char)('0' + K / 10);
+  *p++ = (char)('0' + K % 10);
+  return (int)(p - buffer);
+}
+
+/* places the decimal point like printf %g with enough precision for all digits */
+static int prettify(char *buffer, int length, int k)
+{
+  const int exp10 = length + k - 1; /* 10^exp10 <= v < 10^(exp10+1) */
+  int i;
+
+  if (exp10 >= -4 && exp10 < 17) {
+    if (k >= 0) {
+      /* 1234e2 -> 123400 */
+      for (i=length; i<length+k; i++) {
+        buffer[i] = '0';
+      }
+      return length + k;
+    } else if (exp10 >= 0) {
+      /* 1234e-2 -> 12.34 */
+      memmove(&buffer[exp10+2], &buffer[exp10+1], (size_t)(length - exp10 - 1));
+      buffer[exp10+1] = '.';
+      return length + 1;
+    } else {
+      /* 1234e-6 -> 0.001234 */
+      const int offset = 1 - exp10;
+      memmove(&buffer[offset], &buffer[0], (size_t)length);
+      buffer[0] = '0';
+      buffer[1] = '.';
+      for (i=2; i<offset; i++) {
+        buffer[i] = '0';
+      }
+      return length + offset;
+    }
+  } else if (length == 1) {
+    /* 1e30 */
+    return 1 + write_exponent(exp10, &buffer[1]);
+  } else {
+    /* 1234e30 -> 1.234e+33 */
+    memmove(&buffer[2], &buffer[1], (size_t)(length - 1));
+    buffer[1] = '.';
+    return length + 1 + write_exponent(exp10, &buffer[length+1]);
+  }
+}
+
+int omc_dtoa_shortest(double value, char *buffer)
+{
+  char *p = buffer;
+  int length, K;
+
+  if (value != value) {
+    memcpy(buffer, "nan", 3);
+    return 3;
+  }
+  if (value < 0 || (value == 0 && 1/value < 0)) {
+    *p++ = '-';
+    value = -value;
+  }
+  if (value == 0) {
+    *p = '0';
+    return (int)(p - buffer) + 1;
+  }
+  if (value > 1.7976931348623157e308) {
+    memcpy(p, "inf", 3);
+    return (int)(p - buffer) + 3;
+  }
+  grisu2(value, p, &length, &K);
+  return (int)(p - buffer) + prettify(p, length, K);
+}
+
+int omc_itoa(int value, char *buffer)
+{
+  char tmp[OMC_ITOA_MAX_LENGTH];
+  char *p = buffer;
+  unsigned int u = (unsigned int) value;
+  int n = 0;
+
+  if (value < 0) {
+    *p++ = '-';
+    u = 0U - u;
+  }
+  do {
+    tmp[n++] = (char)('0' + u % 10);
+    u /= 10;
+  } while (u);
+  while (n) {
+    *p++ = tmp[--n];
+  }
+  return (int)(p - buffer);
+}
@@ -0,0 +1,60 @@
+/*
+ * This file is part of OpenModelica.
+ *
+ * Copyright (c) 1998-CurrentYear, Open Source Modelica Consortium (OSMC),
+ * c/o Linköpings universitet, Department of Computer and Information Science,
+ * SE-58183 Linköping, Sweden.
+ *
+ * All rights reserved.
+ *
+ * THIS PROGRAM IS PROVIDED UNDER THE TERMS OF THE BSD NEW LICENSE OR THE
+ * GPL VERSION 3 LICENSE OR THE OSMC PUBLIC LICENSE (OSMC-PL) VERSION 1.2.
+ * ANY USE, REPRODUCTION OR DISTRIBUTION OF THIS PROGRAM CONSTITUTES
+ * RECIPIENT'S ACCEPTANCE OF THE OSMC PUBLIC LICENSE OR THE GPL VERSION 3,
+ * ACCORDING TO RECIPIENTS CHOICE.
+ *
+ * The OpenModelica software and the OSMC (Open Source Modelica Consortium)
+ * Public License (OSMC-PL) are obtained from OSMC, either from the above
+ * address, from the URLs: http://www.openmodelica.org or
+ * http://www.ida.liu.se/projects/OpenModelica, and in the OpenModelica
+ * distribution. GNU version 3 is obtained from:
+ * http://www.gnu.org/copyleft/gpl.html. The New BSD License is obtained from:
+ * http://www.opensource.org/licenses/BSD-3-Clause.
+ *
+ * This program is distributed WITHOUT ANY WARRANTY; without even the implied
+ * warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, EXCEPT AS
+ * EXPRESSLY SET FORTH IN THE BY RECIPIENT SELECTED SUBSIDIARY LICENSE
+ * CONDITIONS OF OSMC-PL.
+ *
+ */
+
+/*! \file omc_dtoa.h
+ * Fast conversion of numbers to text for the result writers.
+ */
+
+#ifndef OMC_DTOA_H_
+#define OMC_DTOA_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* A double needs at most 24 characters ("-2.2250738585072014e-308"),
+ * an int at most 11. Neither function writes a terminating 0.
+ */
+#define OMC_DTOA_MAX_LENGTH 25
+#define OMC_ITOA_MAX_LENGTH 12
+
+/* Writes the shortest decimal string that reads back to exactly value
+ * (Grisu2) in printf %g style, e.g. 0.1, 1e-05, 1.2345678901234567e+20,
+ * and returns its length.
+ */
+int omc_dtoa_shortest(double value, char *buffer);
+/* Writes value in decimal and returns the length. */
+int omc_itoa(int value, char *buffer);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
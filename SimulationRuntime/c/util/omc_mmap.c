@@ -88,6 +88,33 @@ omc_mmap_write_unix omc_mmap_open_write_unix(const char *fileName, size_t size)
   return res;
 }
 
+const char* omc_mmap_try_open_read_unix(const char *fileName, omc_mmap_read_unix *map)
+{
+  struct stat s;
+  int fd = open(fileName, O_RDONLY);
+  map->size = 0;
+  map->data = NULL;
+  if (fd < 0) {
+    return strerror(errno);
+  }
+  if (fstat(fd, &s) < 0) {
+    close(fd);
+    return strerror(errno);
+  }
+  if (s.st_size == 0) {
+    close(fd);
+    return "empty file";
+  }
+  map->data = (const char*) mmap(0, s.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (map->data == MAP_FAILED) {
+    map->data = NULL;
+    return strerror(errno);
+  }
+  map->size = s.st_size;
+  return NULL;
+}
+
 void omc_mmap_close_read_unix(omc_mmap_read_unix map)
 {
   munmap((void*)map.data, map.size);
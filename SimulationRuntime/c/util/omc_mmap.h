@@ -88,6 +88,8 @@ omc_mmap_read_unix omc_mmap_open_read_unix(const char *filename);
 omc_mmap_write_unix omc_mmap_open_write_unix(const char *filename, size_t size);
 void omc_mmap_close_read_unix(omc_mmap_read_unix map);
 void omc_mmap_close_write_unix(omc_mmap_write_unix map);
+/* Like omc_mmap_open_read_unix, but returns the error message (NULL on success) instead of throwing */
+const char* omc_mmap_try_open_read_unix(const char *filename, omc_mmap_read_unix *map);
 
 typedef omc_mmap_read_unix omc_mmap_read;
 typedef omc_mmap_write_unix omc_mmap_write;
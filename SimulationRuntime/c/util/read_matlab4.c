@@ -35,6 +35,16 @@
 #include <assert.h>
 #include <ctype.h>
 #include "read_matlab4.h"
+#include "write_matlab4.h"
+#if !defined(OMC_NO_FILESYSTEM)
+#include "omc_mmap.h"
+#endif
+
+#if defined(HAVE_MMAP) && HAVE_MMAP
+#define OMC_MAT_LAZY_MMAP 1
+#else
+#define OMC_MAT_LAZY_MMAP 0
+#endif
 
 extern const char *omc_mat_Aclass;
 
@@ -53,6 +63,7 @@ typedef struct {
 
 static const char *binTrans_char = "binTrans";
 static const char *binNormal_char = "binNormal";
+static const char *binChunk_char = "binChunk";
 
 /* strcmp ignore whitespace */
 static OMC_INLINE int strcmp_iws(const char *a, const char *b)
@@ -122,7 +133,7 @@ void omc_free_matlab4_reader(ModelicaMatReader *reader)
     free(reader->allInfo[i].descr);
   }
   reader->nall = 0;
-  if (reader->file) {
+  if (reader->allInfo) {
     free(reader->allInfo);
     reader->allInfo=NULL;
   }
@@ -138,6 +149,29 @@ void omc_free_matlab4_reader(ModelicaMatReader *reader)
     free(reader->vars);
     reader->vars=NULL;
   }
+  if (reader->chunks) {
+    free(reader->chunks);
+    reader->chunks=NULL;
+  }
+  reader->nchunks = 0;
+  if (reader->cacheVals) {
+    free(reader->cacheVals);
+    reader->cacheVals=NULL;
+  }
+#if OMC_MAT_LAZY_MMAP
+  if (reader->map) {
+    omc_mmap_read_unix map;
+    map.data = reader->map;
+    map.size = reader->mapSize;
+    omc_mmap_close_read_unix(map);
+    reader->map=NULL;
+  }
+#endif
+  if (reader->lastUse) {
+    free(reader->lastUse);
+    reader->lastUse=NULL;
+  }
+  reader->nCachedVars = 0;
 }
 
 void remSpaces(char *ch){
@@ -215,6 +249,167 @@ static int read_double(int type, size_t n, FILE *file, double *val)
 }
 
 
+static OMC_INLINE double bits_double(uint64_t u)
+{
+  double d;
+  memcpy(&d, &u, sizeof(double));
+  return d;
+}
+
+static OMC_INLINE uint64_t double_bits(double d)
+{
+  uint64_t u;
+  memcpy(&u, &d, sizeof(double));
+  return u;
+}
+
+/* Decodes a column of a chunked file; see omc_matc_encode_column. Returns 0 on success */
+static int decode_chunk_column(const uint8_t *in, size_t len, double *out, size_t n)
+{
+  const uint8_t *end = in + len;
+  size_t i;
+  int mode;
+  if (n == 0) {
+    return 0;
+  }
+  if (len < 1) {
+    return 1;
+  }
+  mode = *in++;
+  if (mode == OMC_MATC_COLUMN_RAW) {
+    if (end - in != n*sizeof(double)) {
+      return 1;
+    }
+    memcpy(out, in, n*sizeof(double));
+    return 0;
+  }
+  if ((mode != OMC_MATC_COLUMN_XOR && mode != OMC_MATC_COLUMN_LINEAR) || end - in < sizeof(double)) {
+    return 1;
+  }
+  memcpy(out, in, sizeof(double));
+  in += sizeof(double);
+  for (i=1; i<n; i++) {
+    unsigned int lead, nbytes, k;
+    uint64_t x = 0;
+    double prediction;
+    if (in >= end) {
+      return 1;
+    }
+    lead = *in >> 4;
+    nbytes = *in & 0xf;
+    in++;
+    /* the writer stores an unchanged value as 8 leading zero bytes; any
+     * other control byte needs 1 <= lead+nbytes <= 8, or the shift below
+     * is undefined */
+    if ((nbytes == 0 ? lead != 8 : lead + nbytes > 8) || end - in < nbytes) {
+      return 1;
+    }
+    for (k=0; k<nbytes; k++) {
+      x |= ((uint64_t) in[k]) << (8*k);
+    }
+    in += nbytes;
+    x <<= 8*(8 - lead - nbytes);
+    if (mode == OMC_MATC_COLUMN_LINEAR && i > 1) {
+      prediction = 2.0*out[i-1];
+      prediction = prediction - out[i-2];
+    } else {
+      prediction = out[i-1];
+    }
+    out[i] = bits_double(double_bits(prediction) ^ x);
+  }
+  return in != end;
+}
+
+/* Reads the chunk headers of a chunked file; the column data is only read on demand */
+static const char* read_chunk_directory(ModelicaMatReader *reader)
+{
+  uint32_t i, firstRow = 0, allocated = 0;
+  /* The number of variables is not stored in a data_2 header */
+  reader->nvar = 0;
+  for (i=0; i<reader->nall; i++) {
+    if (!reader->allInfo[i].isParam && abs(reader->allInfo[i].index) > reader->nvar) {
+      reader->nvar = abs(reader->allInfo[i].index);
+    }
+  }
+  reader->vars = (double**) calloc(reader->nvar*2,sizeof(double*));
+  reader->doublePrecision = 1;
+  reader->cacheChunk = -1;
+  while (1) {
+    MHeader_t hdr;
+    char name[6];
+    uint32_t info[2];
+    double times[2];
+    size_t offset;
+    if (1 != fread(&hdr,sizeof(MHeader_t),1,reader->file)) {
+      break; /* end of file */
+    }
+    if (hdr.namelen != sizeof(name) || 1 != fread(name,sizeof(name),1,reader->file) || 0 != strcmp(name,"chunk")) {
+      return "Corrupt header: chunk matrix";
+    }
+    if (hdr.mrows == 0) {
+      break; /* the simulation stopped while this chunk was written */
+    }
+    offset = ftell(reader->file);
+    if (1 != fread(info,sizeof(info),1,reader->file) || 1 != fread(times,sizeof(times),1,reader->file)) {
+      break;
+    }
+    if (info[1] != reader->nvar) {
+      return "Corrupt header: chunk matrix does not match dataInfo";
+    }
+    if (reader->nchunks == allocated) {
+      allocated = allocated ? 2*allocated : 64;
+      reader->chunks = (ModelicaMatChunk_t*) realloc(reader->chunks, allocated*sizeof(ModelicaMatChunk_t));
+    }
+    reader->chunks[reader->nchunks].offset = offset;
+    reader->chunks[reader->nchunks].nrows = info[0];
+    reader->chunks[reader->nchunks].firstRow = firstRow;
+    reader->chunks[reader->nchunks].startTime = times[0];
+    reader->chunks[reader->nchunks].stopTime = times[1];
+    reader->nchunks++;
+    firstRow += info[0];
+    if (-1 == fseek(reader->file, offset + hdr.mrows*hdr.ncols, SEEK_SET)) {
+      return "Corrupt header: chunk matrix";
+    }
+  }
+  reader->nrows = firstRow;
+  return 0;
+}
+
+/* Decodes column absVarIndex (1-based) of the given chunk into out. Returns 0 on success */
+static int read_chunk_column(ModelicaMatReader *reader, uint32_t chunk, size_t absVarIndex, double *out)
+{
+  const ModelicaMatChunk_t *c = reader->chunks + chunk;
+  size_t columnData = c->offset + OMC_MATC_CHUNK_HEADER_SIZE + (reader->nvar+1)*sizeof(uint32_t);
+  uint32_t range[2];
+  uint8_t *buf;
+  int res;
+  if (-1 == fseek(reader->file, c->offset + OMC_MATC_CHUNK_HEADER_SIZE + (absVarIndex-1)*sizeof(uint32_t), SEEK_SET) ||
+      1 != fread(range, sizeof(range), 1, reader->file) || range[1] < range[0]) {
+    return 1;
+  }
+  buf = (uint8_t*) malloc(range[1]-range[0]+1);
+  res = -1 == fseek(reader->file, columnData + range[0], SEEK_SET) ||
+        (range[1] > range[0] && 1 != fread(buf, range[1]-range[0], 1, reader->file)) ||
+        decode_chunk_column(buf, range[1]-range[0], out, c->nrows);
+  free(buf);
+  return res;
+}
+
+/* Returns the index of the chunk containing the given row */
+static uint32_t find_chunk(ModelicaMatReader *reader, uint32_t row)
+{
+  uint32_t min = 0, max = reader->nchunks-1;
+  while (min < max) {
+    uint32_t mid = min + (max-min+1)/2;
+    if (reader->chunks[mid].firstRow > row) {
+      max = mid-1;
+    } else {
+      min = mid;
+    }
+  }
+  return min;
+}
+
 /* Returns 0 on success; the error message on error */
 const char* omc_new_matlab4_reader(const char *filename, ModelicaMatReader *reader)
 {
@@ -225,6 +420,7 @@ const char* omc_new_matlab4_reader(const char *filename, ModelicaMatReader *read
   const int matrixTypes[6]={51,51,51,20,0,0};
   int i;
   char binTrans = 1;
+  char chunked = 0;
   memset(reader, 0, sizeof(ModelicaMatReader));
   reader->file = fopen(filename, "rb");
   if(!reader->file) return strerror(errno);
@@ -233,7 +429,12 @@ const char* omc_new_matlab4_reader(const char *filename, ModelicaMatReader *read
   reader->stopTime = NAN;
   for(i=0; i<nMatrix;i++) {
     MHeader_t hdr;
-    int nr = fread(&hdr,sizeof(MHeader_t),1,reader->file);
+    int nr;
+    if(i==5 && chunked) {
+      /* chunked files have "chunk" matrices instead of data_2 */
+      return read_chunk_directory(reader);
+    }
+    nr = fread(&hdr,sizeof(MHeader_t),1,reader->file);
     size_t matrix_length,element_length;
     char *name;
     if(nr != 1) return "Corrupt header (1)";
@@ -285,6 +486,10 @@ const char* omc_new_matlab4_reader(const char *filename, ModelicaMatReader *read
             /* binNormal */
             /* fprintf(stderr, "use binNormal format\n"); */
             binTrans = 0;
+          } else if(0 == strncmp(row,binChunk_char,8))  {
+            /* binChunk: the metadata is stored like binTrans */
+            binTrans = 1;
+            chunked = 1;
           } else {
             /* fprintf(stderr, "row 3: %s\n", row); */
             return "Aclass matrix does not match binTrans or binNormal format";
@@ -482,6 +687,64 @@ const char* omc_new_matlab4_reader(const char *filename, ModelicaMatReader *read
   return 0;
 }
 
+const char* omc_new_matlab4_reader_lazy(const char *filename, ModelicaMatReader *reader, size_t cacheSize)
+{
+  const char *msg = omc_new_matlab4_reader(filename, reader);
+  if (msg) {
+    return msg;
+  }
+  if (reader->nvar == 0) {
+    return 0;
+  }
+  reader->lastUse = (uint64_t*) calloc(2*reader->nvar, sizeof(uint64_t));
+  if (cacheSize && reader->nrows) {
+    size_t n = cacheSize / (reader->nrows*sizeof(double));
+    reader->maxCachedVars = n < 1 ? 1 : n > 2*reader->nvar ? 2*reader->nvar : n;
+  }
+#if OMC_MAT_LAZY_MMAP
+  /* binNormal files are decoded while opening and chunked files are
+   * compressed; only the data_2 matrix of binTrans files is read in place */
+  if (!reader->chunks && !reader->vars[0]) {
+    size_t elementSize = reader->doublePrecision==1 ? sizeof(double) : sizeof(float);
+    omc_mmap_read_unix map;
+    if (0 == omc_mmap_try_open_read_unix(filename, &map)) {
+      if (map.size >= reader->var_offset + elementSize*reader->nvar*reader->nrows) {
+        reader->map = map.data;
+        reader->mapSize = map.size;
+      } else {
+        omc_mmap_close_read_unix(map); /* truncated file; let stdio report the error */
+      }
+    }
+  }
+#endif
+  return 0;
+}
+
+/* Stores a decoded column. For lazy readers the least recently used column is
+ * free'd first if the cache is full; the time column is kept and not counted */
+static double* cache_column(ModelicaMatReader *reader, size_t ix, double *vals)
+{
+  if (reader->lastUse && ix) {
+    if (reader->maxCachedVars && reader->nCachedVars >= reader->maxCachedVars) {
+      size_t i, lru = 0;
+      for (i=1; i<2*reader->nvar; i++) {
+        if (reader->vars[i] && (!lru || reader->lastUse[i] < reader->lastUse[lru])) {
+          lru = i;
+        }
+      }
+      if (lru) {
+        free(reader->vars[lru]);
+        reader->vars[lru] = NULL;
+        reader->nCachedVars--;
+      }
+    }
+    reader->nCachedVars++;
+    reader->lastUse[ix] = ++reader->useCount;
+  }
+  reader->vars[ix] = vals;
+  return vals;
+}
+
 static char* dymolaStyleVariableName(const char *varName)
 {
   int len,is_der=0==strncmp("der(", varName, 4);
@@ -566,57 +829,94 @@ double* omc_matlab4_read_vals(ModelicaMatReader *reader, int varIndex)
 {
   size_t absVarIndex = abs(varIndex);
   size_t ix = (varIndex < 0 ? absVarIndex + reader->nvar : absVarIndex) -1;
+  unsigned int i;
+  double *tmp;
   assert(absVarIndex > 0 && absVarIndex <= reader->nvar);
   if (0 == reader->nrows) {
     return NULL;
-  } else if(!reader->vars[ix]) {
-    unsigned int i;
-    double *tmp = (double*) malloc(reader->nrows*sizeof(double));
-    if(reader->doublePrecision==1)
-    {
+  } else if(reader->vars[ix]) {
+    if(reader->lastUse) {
+      reader->lastUse[ix] = ++reader->useCount;
+    }
+    return reader->vars[ix];
+  }
+  tmp = (double*) malloc(reader->nrows*sizeof(double));
+  if(reader->chunks) {
+    /* only the given column of every chunk is read */
+    for(i=0; i<reader->nchunks; i++) {
+      if(read_chunk_column(reader, i, absVarIndex, tmp + reader->chunks[i].firstRow)) {
+        free(tmp);
+        return NULL;
+      }
+    }
+    if(varIndex < 0) {
       for(i=0; i<reader->nrows; i++) {
-        fseek(reader->file,reader->var_offset + sizeof(double)*(i*reader->nvar + absVarIndex-1), SEEK_SET);
-        if(1 != fread(&tmp[i], sizeof(double), 1, reader->file)) {
-          /* fprintf(stderr, "Corrupt file at %d of %d? nvar %d\n", i, reader->nrows, reader->nvar); */
-          free(tmp);
-          tmp=NULL;
-          return NULL;
-        }
-        if(varIndex < 0) tmp[i] = -tmp[i];
-        /* fprintf(stderr, "tmp[%d]=%g\n", i, tmp[i]); */
+        tmp[i] = -tmp[i];
       }
     }
-    else
-    {
-      float *buffer = (float*) malloc(reader->nrows*sizeof(float));
+  } else if(reader->map) {
+    /* gather the strided column straight out of the mapping */
+    const char *data = reader->map + reader->var_offset;
+    if(reader->doublePrecision==1) {
+      const size_t stride = reader->nvar*sizeof(double);
+      data += (absVarIndex-1)*sizeof(double);
       for(i=0; i<reader->nrows; i++) {
-        fseek(reader->file,reader->var_offset + sizeof(float)*(i*reader->nvar + absVarIndex-1), SEEK_SET);
-        if(1 != fread(&buffer[i], sizeof(float), 1, reader->file)) {
-          /* fprintf(stderr, "Corrupt file at %d of %d? nvar %d\n", i, reader->nrows, reader->nvar); */
-          free(buffer);
-          free(tmp);
-          tmp=NULL;
-          return NULL;
-        }
+        memcpy(&tmp[i], data + i*stride, sizeof(double));
       }
-      if(varIndex < 0)
-      {
-        for(i=0; i<reader->nrows; i++) {
-          tmp[i] = -buffer[i];
-        }
+    } else {
+      const size_t stride = reader->nvar*sizeof(float);
+      data += (absVarIndex-1)*sizeof(float);
+      for(i=0; i<reader->nrows; i++) {
+        float f;
+        memcpy(&f, data + i*stride, sizeof(float));
+        tmp[i] = f;
       }
-      else
-      {
-          for(i=0; i<reader->nrows; i++) {
-            tmp[i] = buffer[i];
-          }
+    }
+    if(varIndex < 0) {
+      for(i=0; i<reader->nrows; i++) {
+        tmp[i] = -tmp[i];
+      }
+    }
+  } else if(reader->doublePrecision==1) {
+    for(i=0; i<reader->nrows; i++) {
+      fseek(reader->file,reader->var_offset + sizeof(double)*(i*reader->nvar + absVarIndex-1), SEEK_SET);
+      if(1 != fread(&tmp[i], sizeof(double), 1, reader->file)) {
+        /* fprintf(stderr, "Corrupt file at %d of %d? nvar %d\n", i, reader->nrows, reader->nvar); */
+        free(tmp);
+        tmp=NULL;
+        return NULL;
       }
-      free(buffer);
+      if(varIndex < 0) tmp[i] = -tmp[i];
       /* fprintf(stderr, "tmp[%d]=%g\n", i, tmp[i]); */
     }
-    reader->vars[ix] = tmp;
+  } else {
+    float *buffer = (float*) malloc(reader->nrows*sizeof(float));
+    for(i=0; i<reader->nrows; i++) {
+      fseek(reader->file,reader->var_offset + sizeof(float)*(i*reader->nvar + absVarIndex-1), SEEK_SET);
+      if(1 != fread(&buffer[i], sizeof(float), 1, reader->file)) {
+        /* fprintf(stderr, "Corrupt file at %d of %d? nvar %d\n", i, reader->nrows, reader->nvar); */
+        free(buffer);
+        free(tmp);
+        tmp=NULL;
+        return NULL;
+      }
+    }
+    if(varIndex < 0)
+    {
+      for(i=0; i<reader->nrows; i++) {
+        tmp[i] = -buffer[i];
+      }
+    }
+    else
+    {
+        for(i=0; i<reader->nrows; i++) {
+          tmp[i] = buffer[i];
+        }
+    }
+    free(buffer);
+    /* fprintf(stderr, "tmp[%d]=%g\n", i, tmp[i]); */
   }
-  return reader->vars[ix];
+  return cache_column(reader, ix, tmp);
 }
 
 void matrix_transpose(double *m, int w, int h)
@@ -672,6 +972,10 @@ int omc_matlab4_read_all_vals(ModelicaMatReader *reader)
   if (nvar == 0 || nrows == 0) {
     return 1;
   }
+  if (reader->lastUse) {
+    /* lazy reader: columns are read on demand */
+    return 0;
+  }
   for (i=0; i<2*nvar; i++) {
     if (reader->vars[i] == 0) done = 0;
   }
@@ -679,6 +983,16 @@ int omc_matlab4_read_all_vals(ModelicaMatReader *reader)
     reader->readAll = 1;
     return 0;
   }
+  if (reader->chunks) {
+    /* there is no data_2 matrix to transpose; decode the columns instead */
+    for (i=1; i<=nvar; i++) {
+      if (!omc_matlab4_read_vals(reader, i) || !omc_matlab4_read_vals(reader, -i)) {
+        return 1;
+      }
+    }
+    reader->readAll = 1;
+    return 0;
+  }
   tmp = (double*) malloc(2*nvar*nrows*sizeof(double));
   if (!tmp) {
     return 1;
@@ -719,7 +1033,37 @@ double omc_matlab4_read_single_val(double *res, ModelicaMatReader *reader, int v
     *res = reader->vars[ix][timeIndex];
     return 0;
   }
-  if(reader->doublePrecision==1) {
+  if(reader->chunks && reader->lastUse) {
+    /* lazy reader: decode (and cache) the whole column instead of thrashing the single-chunk cache */
+    double *vals = omc_matlab4_read_vals(reader, varIndex);
+    if(!vals) {
+      *res = 0;
+      return 1;
+    }
+    *res = vals[timeIndex];
+    return 0;
+  } else if(reader->chunks) {
+    uint32_t chunk = find_chunk(reader, timeIndex);
+    if(reader->cacheChunk != (int) chunk || reader->cacheVar != (int) absVarIndex) {
+      reader->cacheVals = (double*) realloc(reader->cacheVals, reader->chunks[chunk].nrows*sizeof(double));
+      if(read_chunk_column(reader, chunk, absVarIndex, reader->cacheVals)) {
+        reader->cacheChunk = -1;
+        *res = 0;
+        return 1;
+      }
+      reader->cacheChunk = chunk;
+      reader->cacheVar = absVarIndex;
+    }
+    *res = reader->cacheVals[timeIndex - reader->chunks[chunk].firstRow];
+  } else if(reader->map) {
+    if(reader->doublePrecision==1) {
+      memcpy(res, reader->map + reader->var_offset + sizeof(double)*(timeIndex*reader->nvar + absVarIndex-1), sizeof(double));
+    } else {
+      float tmpres;
+      memcpy(&tmpres, reader->map + reader->var_offset + sizeof(float)*(timeIndex*reader->nvar + absVarIndex-1), sizeof(float));
+      *res = tmpres;
+    }
+  } else if(reader->doublePrecision==1) {
     fseek(reader->file,reader->var_offset + sizeof(double)*(timeIndex*reader->nvar + absVarIndex-1), SEEK_SET);
     if(1 != fread(res, sizeof(double), 1, reader->file)) {
       *res = 0;
@@ -872,6 +1216,86 @@ int omc_matlab4_read_vars_val(double *res, ModelicaMatReader *reader, ModelicaMa
     return 0;
 }
 
+double* omc_matlab4_read_vals_interval(ModelicaMatReader *reader, int varIndex, double startTime, double stopTime, uint32_t *nvals)
+{
+  size_t absVarIndex = abs(varIndex);
+  size_t ix = (varIndex < 0 ? absVarIndex + reader->nvar : absVarIndex) -1;
+  double *res = NULL;
+  uint32_t i, j, n = 0;
+  assert(absVarIndex > 0 && absVarIndex <= reader->nvar);
+  *nvals = 0;
+  if (0 == reader->nrows || startTime > stopTime) {
+    return NULL;
+  }
+  if (!reader->chunks || (reader->vars[0] && reader->vars[ix])) {
+    double *time = omc_matlab4_read_vals(reader, 1);
+    double *vals = omc_matlab4_read_vals(reader, varIndex);
+    uint32_t min = 0, max = reader->nrows;
+    if (!time || !vals) {
+      return NULL;
+    }
+    /* first time >= startTime */
+    while (min < max) {
+      uint32_t mid = min + (max-min)/2;
+      if (time[mid] < startTime) {
+        min = mid+1;
+      } else {
+        max = mid;
+      }
+    }
+    for (j=min; j<reader->nrows && time[j] <= stopTime; j++) {
+      n++;
+    }
+    if (n == 0) {
+      return NULL;
+    }
+    res = (double*) malloc(n*sizeof(double));
+    memcpy(res, vals+min, n*sizeof(double));
+  } else {
+    /* only read the chunks overlapping the interval */
+    double *time = NULL, *vals = NULL;
+    uint32_t maxRows = 0, nAlloc = 0;
+    for (i=0; i<reader->nchunks; i++) {
+      if (reader->chunks[i].stopTime >= startTime && reader->chunks[i].startTime <= stopTime) {
+        nAlloc += reader->chunks[i].nrows;
+        if (reader->chunks[i].nrows > maxRows) {
+          maxRows = reader->chunks[i].nrows;
+        }
+      }
+    }
+    if (nAlloc == 0) {
+      return NULL;
+    }
+    res = (double*) malloc(nAlloc*sizeof(double));
+    time = (double*) malloc(maxRows*sizeof(double));
+    vals = (double*) malloc(maxRows*sizeof(double));
+    for (i=0; i<reader->nchunks; i++) {
+      if (reader->chunks[i].stopTime < startTime || reader->chunks[i].startTime > stopTime) {
+        continue;
+      }
+      if (read_chunk_column(reader, i, 1, time) || read_chunk_column(reader, i, absVarIndex, vals)) {
+        free(res);
+        res = NULL;
+        n = 0;
+        break;
+      }
+      for (j=0; j<reader->chunks[i].nrows; j++) {
+        if (time[j] >= startTime && time[j] <= stopTime) {
+          res[n++] = varIndex < 0 ? -vals[j] : vals[j];
+        }
+      }
+    }
+    free(time);
+    free(vals);
+    if (res && n == 0) {
+      free(res);
+      res = NULL;
+    }
+  }
+  *nvals = n;
+  return res;
+}
+
 void omc_matlab4_print_all_vars(FILE *stream, ModelicaMatReader *reader)
 {
   unsigned int i;
@@ -42,6 +42,35 @@ typedef struct {
   int index;
 } ModelicaMatVariable_t;
 
+/* Chunked result files (outputFormat "matc") use the same Aclass, name,
+ * description, dataInfo and data_1 matrices as the mat format (with row 4 of
+ * Aclass set to "binChunk"), but instead of a single data_2 matrix they
+ * contain a sequence of uint8 matrices named "chunk". Each chunk stores up to
+ * a fixed number of output points, column by column:
+ *
+ *   uint32 nrows, uint32 nvar, double startTime, double stopTime,
+ *   uint32 offsets[nvar+1]  (byte offset of each column relative to the column data)
+ *   column data
+ *
+ * Every column starts with one of the OMC_MATC_COLUMN_* modes. The packed
+ * modes store the first value raw and every further value as the XOR of its
+ * bit pattern and a prediction (the previous value, or the linear
+ * extrapolation of the two previous values), with the zero bytes at both ends
+ * stripped: one control byte (leading zero bytes << 4 | significant bytes)
+ * followed by the significant bytes, least significant first.
+ */
+#define OMC_MATC_CHUNK_HEADER_SIZE (2*sizeof(uint32_t)+2*sizeof(double))
+#define OMC_MATC_COLUMN_RAW    0
+#define OMC_MATC_COLUMN_XOR    1 /* prediction: previous value */
+#define OMC_MATC_COLUMN_LINEAR 2 /* prediction: 2*previous - second previous; exact for equidistant time */
+
+typedef struct {
+  size_t offset; /* file offset of the chunk header */
+  uint32_t nrows;
+  uint32_t firstRow;
+  double startTime, stopTime;
+} ModelicaMatChunk_t;
+
 typedef struct {
   FILE *file;
   char *fileName;
@@ -55,6 +84,16 @@ typedef struct {
   int readAll; /* Read all variables already */
   double **vars;
   char doublePrecision; /* data_1 and data_2 in double ore single precision */
+  /* chunked files only */
+  uint32_t nchunks;
+  ModelicaMatChunk_t *chunks;
+  int cacheChunk, cacheVar; /* the last decoded column of a chunk */
+  double *cacheVals;
+  /* lazy readers only (omc_new_matlab4_reader_lazy) */
+  const char *map; /* the whole file, if it could be mapped */
+  size_t mapSize;
+  uint32_t maxCachedVars, nCachedVars; /* bound on the number of decoded columns in vars; 0 = no bound */
+  uint64_t useCount, *lastUse; /* for evicting the least recently used column */
 } ModelicaMatReader;
 
 /* Returns 0 on success; the error message on error.
@@ -66,6 +105,16 @@ extern "C" {
 #endif
 const char* omc_new_matlab4_reader(const char *filename, ModelicaMatReader *reader);
 
+/* Like omc_new_matlab4_reader, but memory-maps the file (where mmap is
+ * available) and reads values straight out of the mapping instead of using
+ * stdio. At most cacheSize bytes of decoded columns (0 = no bound) are kept;
+ * when the bound is reached the least recently used column is free'd, so a
+ * pointer returned by omc_matlab4_read_vals is only valid until reader->maxCachedVars
+ * other columns have been read. The time column is always kept.
+ * omc_matlab4_read_all_vals does not load anything for such a reader.
+ */
+const char* omc_new_matlab4_reader_lazy(const char *filename, ModelicaMatReader *reader, size_t cacheSize);
+
 void omc_free_matlab4_reader(ModelicaMatReader *reader);
 
 /* Returns a variable or NULL */
@@ -78,6 +127,16 @@ ModelicaMatVariable_t *omc_matlab4_find_var(ModelicaMatReader *reader, const cha
  */
 double* omc_matlab4_read_vals(ModelicaMatReader *reader, int varIndex);
 
+/* Returns the values of a variable at all output points with startTime <= time <= stopTime
+ * and writes their number to nvals. For chunked files only the chunks overlapping the
+ * interval are read. The returned array is malloc'ed and owned by the caller.
+ * Returns NULL on failure or if there are no output points in the interval.
+ */
+double* omc_matlab4_read_vals_interval(ModelicaMatReader *reader, int varIndex, double startTime, double stopTime, uint32_t *nvals);
+
+/* Writes the value of the variable at output point timeIndex to res. Returns 0 on success */
+double omc_matlab4_read_single_val(double *res, ModelicaMatReader *reader, int varIndex, int timeIndex);
+
 /* Returns 0 on success */
 int omc_matlab4_val(double *res, ModelicaMatReader *reader, ModelicaMatVariable_t *var, double time);
 
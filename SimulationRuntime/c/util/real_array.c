@@ -41,6 +41,7 @@
 #include <stdarg.h>
 #include <math.h>
 #include <float.h>
+#include <string.h>
 
 static inline modelica_real *real_ptrget(const real_array_t *a, size_t i)
 {
@@ -882,6 +883,55 @@ modelica_real mul_real_scalar_product(const real_array_t a, const real_array_t b
     return res;
 }
 
+/* Matrix kernels working on the row-major data of the arrays. The loops are
+ * blocked so that the rows of b used by one block stay in cache, and the
+ * innermost loops run with unit stride so that the compiler can vectorise
+ * them. Every element is still summed in the order of the plain triple loop,
+ * so the results do not change.
+ */
+#define REAL_MATRIX_BLOCK 64
+#define REAL_MATRIX_SMALL 8
+
+static void real_matrix_product_kernel(const modelica_real *a, const modelica_real *b, modelica_real *c,
+                                       size_t i_size, size_t k_size, size_t j_size)
+{
+    size_t i, j, k, kk, jj, k_end, j_end;
+
+    if(j_size < REAL_MATRIX_SMALL) {
+        /* short rows: the blocked loops do not pay off */
+        for(i = 0; i < i_size; ++i) {
+            for(j = 0; j < j_size; ++j) {
+                modelica_real tmp = 0;
+                for(k = 0; k < k_size; ++k) {
+                    tmp += a[i * k_size + k] * b[k * j_size + j];
+                }
+                c[i * j_size + j] = tmp;
+            }
+        }
+        return;
+    }
+
+    for(i = 0; i < i_size * j_size; ++i) {
+        c[i] = 0;
+    }
+    for(kk = 0; kk < k_size; kk += REAL_MATRIX_BLOCK) {
+        k_end = kk + REAL_MATRIX_BLOCK < k_size ? kk + REAL_MATRIX_BLOCK : k_size;
+        for(jj = 0; jj < j_size; jj += REAL_MATRIX_BLOCK) {
+            j_end = jj + REAL_MATRIX_BLOCK < j_size ? jj + REAL_MATRIX_BLOCK : j_size;
+            for(i = 0; i < i_size; ++i) {
+                modelica_real *c_row = c + i * j_size;
+                for(k = kk; k < k_end; ++k) {
+                    const modelica_real a_ik = a[i * k_size + k];
+                    const modelica_real *b_row = b + k * j_size;
+                    for(j = jj; j < j_end; ++j) {
+                        c_row[j] += a_ik * b_row[j];
+                    }
+                }
+            }
+        }
+    }
+}
+
 void mul_real_matrix_product(const real_array_t * a,const real_array_t * b,real_array_t* dest)
 {
     modelica_real tmp;
@@ -897,6 +947,12 @@ void mul_real_matrix_product(const real_array_t * a,const real_array_t * b,real_
     j_size = dest->dim_size[1];
     k_size = a->dim_size[1];
 
+    if(dest->data != a->data && dest->data != b->data) {
+        real_matrix_product_kernel((const modelica_real *) a->data, (const modelica_real *) b->data,
+                                   (modelica_real *) dest->data, i_size, k_size, j_size);
+        return;
+    }
+
     for(i = 0; i < i_size; ++i) {
         for(j = 0; j < j_size; ++j) {
             tmp = 0;
@@ -914,7 +970,9 @@ void mul_real_matrix_vector(const real_array_t * a, const real_array_t * b,real_
     size_t j;
     size_t i_size;
     size_t j_size;
-    modelica_real tmp;
+    const modelica_real *A = (const modelica_real *) a->data;
+    const modelica_real *x = (const modelica_real *) b->data;
+    modelica_real *y = (modelica_real *) dest->data;
 
     /* Assert a matrix */
     /* Assert b vector */
@@ -923,12 +981,30 @@ void mul_real_matrix_vector(const real_array_t * a, const real_array_t * b,real_
     i_size = a->dim_size[0];
     j_size = a->dim_size[1];
 
-    for(i = 0; i < i_size; ++i) {
-        tmp = 0;
+    /* four rows at a time share the loads of b */
+    for(i = 0; i + 4 <= i_size; i += 4) {
+        const modelica_real *a0 = A + i * j_size;
+        const modelica_real *a1 = a0 + j_size;
+        const modelica_real *a2 = a1 + j_size;
+        const modelica_real *a3 = a2 + j_size;
+        modelica_real t0 = 0, t1 = 0, t2 = 0, t3 = 0;
         for(j = 0; j < j_size; ++j) {
-            tmp += real_get(*a, (i * j_size) + j) * real_get(*b, j);
+            t0 += a0[j] * x[j];
+            t1 += a1[j] * x[j];
+            t2 += a2[j] * x[j];
+            t3 += a3[j] * x[j];
         }
-        real_set(dest, i, tmp);
+        y[i] = t0;
+        y[i+1] = t1;
+        y[i+2] = t2;
+        y[i+3] = t3;
+    }
+    for(; i < i_size; ++i) {
+        modelica_real tmp = 0;
+        for(j = 0; j < j_size; ++j) {
+            tmp += A[i * j_size + j] * x[j];
+        }
+        y[i] = tmp;
     }
 }
 
@@ -939,21 +1015,27 @@ void mul_real_vector_matrix(const real_array_t * a, const real_array_t * b,real_
     size_t j;
     size_t i_size;
     size_t j_size;
-    modelica_real tmp;
+    const modelica_real *x = (const modelica_real *) a->data;
+    const modelica_real *B = (const modelica_real *) b->data;
+    modelica_real *y = (modelica_real *) dest->data;
 
     /* Assert a vector */
     /* Assert b matrix */
     /* Assert dest vector of correct size */
 
-    i_size = a->dim_size[0];
-    j_size = b->dim_size[1];
+    i_size = b->dim_size[1];
+    j_size = a->dim_size[0];
 
+    /* y = sum_j a[j]*b[j,:], row by row of b */
     for(i = 0; i < i_size; ++i) {
-        tmp = 0;
-        for(j = 0; j < j_size; ++j) {
-            tmp += real_get(*a, j) * real_get(*b, (j * j_size) + i);
+        y[i] = 0;
+    }
+    for(j = 0; j < j_size; ++j) {
+        const modelica_real x_j = x[j];
+        const modelica_real *b_row = B + j * i_size;
+        for(i = 0; i < i_size; ++i) {
+            y[i] += x_j * b_row[i];
         }
-        real_set(dest, i, tmp);
     }
 }
 
@@ -1098,35 +1180,36 @@ void exp_real_array(const real_array_t * a, modelica_integer n, real_array_t* de
             clone_real_array_spec(a,dest);
             mul_real_matrix_product(a,a,dest);
         } else {
-            modelica_integer i;
+            /* exponentiation by squaring, O(log n) matrix products */
+            const size_t dim = a->dim_size[0];
+            modelica_real *base = real_alloc(dim * dim);
+            modelica_real *tmp = real_alloc(dim * dim);
+            modelica_real *res = (modelica_real *) dest->data;
+            modelica_real *x;
+            int first = 1;
 
-            real_array_t tmp;
-            real_array_t * b;
-            real_array_t * c;
-
-            /* prepare temporary array */
-            clone_real_array_spec(a,&tmp);
             clone_real_array_spec(a,dest);
-
-            if ((n&1) != 0) {
-              b = &tmp;
-              c = dest;
-            } else {
-              b = dest;
-              c = &tmp;
+            memcpy(base, a->data, dim * dim * sizeof(modelica_real));
+            for(;;) {
+                if((n&1) != 0) {
+                    if(first) {
+                        memcpy(res, base, dim * dim * sizeof(modelica_real));
+                        first = 0;
+                    } else {
+                        real_matrix_product_kernel(res, base, tmp, dim, dim, dim);
+                        x = res; res = tmp; tmp = x;
+                    }
+                }
+                n >>= 1;
+                if(n == 0) {
+                    break;
+                }
+                real_matrix_product_kernel(base, base, tmp, dim, dim, dim);
+                x = base; base = tmp; tmp = x;
             }
-            mul_real_matrix_product(a,a,b);
-            for( i = 2; i < n; ++i) {
-                real_array_t * x;
-
-                mul_real_matrix_product(a,b,c);
-
-                /* exchange b and c */
-                x = b;
-                b = c;
-                c = x;
+            if(res != (modelica_real *) dest->data) {
+                memcpy(dest->data, res, dim * dim * sizeof(modelica_real));
             }
-            /* result is already in dest */
         }
     }
 }
@@ -1289,11 +1372,14 @@ void transpose_alloc_real_array(const real_array_t * a, real_array_t* dest)
  *
  * Implementation of transpose(A) for matrix A.
  */
+#define REAL_TRANSPOSE_BLOCK 32
+
 void transpose_real_array(const real_array_t * a, real_array_t* dest)
 {
     size_t i;
     size_t j;
-    /*  size_t k;*/
+    size_t ii;
+    size_t jj;
     size_t n,m;
 
     if(a->ndims == 1) {
@@ -1308,9 +1394,16 @@ void transpose_real_array(const real_array_t * a, real_array_t* dest)
 
     omc_assert_macro(dest->dim_size[0] == m && dest->dim_size[1] == n);
 
-    for(i = 0; i < n; ++i) {
-        for(j = 0; j < m; ++j) {
-            real_set(dest, (j * n) + i, real_get(*a, (i * m) + j));
+    /* tile-wise, so that neither the rows of a nor of dest leave the cache */
+    for(ii = 0; ii < n; ii += REAL_TRANSPOSE_BLOCK) {
+        const size_t i_end = ii + REAL_TRANSPOSE_BLOCK < n ? ii + REAL_TRANSPOSE_BLOCK : n;
+        for(jj = 0; jj < m; jj += REAL_TRANSPOSE_BLOCK) {
+            const size_t j_end = jj + REAL_TRANSPOSE_BLOCK < m ? jj + REAL_TRANSPOSE_BLOCK : m;
+            for(i = ii; i < i_end; ++i) {
+                for(j = jj; j < j_end; ++j) {
+                    real_set(dest, (j * n) + i, real_get(*a, (i * m) + j));
+                }
+            }
         }
     }
 }
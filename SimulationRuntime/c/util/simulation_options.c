@@ -35,6 +35,8 @@ const char *FLAG_NAME[FLAG_MAX+1] = {
 
   /* FLAG_ABORT_SLOW */                   "abortSlowSimulation",
   /* FLAG_ALARM */                        "alarm",
+  /* FLAG_BATCH */                        "batch",
+  /* FLAG_BATCH_WORKERS */                "batchWorkers",
   /* FLAG_CLOCK */                        "clock",
   /* FLAG_CPU */                          "cpu",
   /* FLAG_CSV_OSTEP */                    "csvOstep",
@@ -44,6 +46,7 @@ const char *FLAG_NAME[FLAG_MAX+1] = {
   /* FLAG_EMBEDDED_SERVER */              "embeddedServer",
   /* FLAG_EMBEDDED_SERVER_PORT */         "embeddedServerPort",
   /* FLAG_MAT_SYNC */                     "mat_sync",
+  /* FLAG_MAT_ASYNC */                    "mat_async",
   /* FLAG_EMIT_PROTECTED */               "emit_protected",
   /* FLAG_DATA_RECONCILE_Eps */           "eps",
   /* FLAG_F */                            "f",
@@ -88,6 +91,7 @@ const char *FLAG_NAME[FLAG_MAX+1] = {
   /* FLAG_IPOPT_MAX_ITER */               "ipopt_max_iter",
   /* FLAG_IPOPT_WARM_START */             "ipopt_warm_start",
   /* FLAG_JACOBIAN */                     "jacobian",
+  /* FLAG_JACOBIAN_THREADS */             "jacobianThreads",
   /* FLAG_L */                            "l",
   /* FLAG_L_DATA_RECOVERY */              "l_datarec",
   /* FLAG_LOG_FORMAT */                   "logFormat",
@@ -96,6 +100,7 @@ const char *FLAG_NAME[FLAG_MAX+1] = {
   /* FLAG_LSS */                          "lss",
   /* FLAG_LSS_MAX_DENSITY */              "lssMaxDensity",
   /* FLAG_LSS_MIN_SIZE */                 "lssMinSize",
+  /* FLAG_LSS_REUSE */                    "lssReuse",
   /* FLAG_LV */                           "lv",
   /* FLAG_MAX_BISECTION_ITERATIONS */     "mbi",
   /* FLAG_MAX_EVENT_ITERATIONS */         "mei",
@@ -107,6 +112,7 @@ const char *FLAG_NAME[FLAG_MAX+1] = {
   /* FLAG_NEWTON_XTOL */                  "newtonXTol",
   /* FLAG_NEWTON_STRATEGY */              "newton",
   /* FLAG_NLS */                          "nls",
+  /* FLAG_NLS_EXTRAPOLATION_ORDER */      "nlsExtrapolationOrder",
   /* FLAG_NLS_INFO */                     "nlsInfo",
   /* FLAG_NLS_LS */                       "nlsLS",
   /* FLAG_NLS_MAX_DENSITY */              "nlssMaxDensity",
@@ -127,6 +133,7 @@ const char *FLAG_NAME[FLAG_MAX+1] = {
   /* FLAG_OUTPUT_PATH */                  "outputPath",
   /* FLAG_OVERRIDE */                     "override",
   /* FLAG_OVERRIDE_FILE */                "overrideFile",
+  /* FLAG_PARMODAUTO_SCHEDULER */         "parmodautoScheduler",
   /* FLAG_PORT */                         "port",
   /* FLAG_R */                            "r",
   /* FLAG_DATA_RECONCILE  */              "reconcile",
@@ -148,6 +155,8 @@ const char *FLAG_DESC[FLAG_MAX+1] = {
 
   /* FLAG_ABORT_SLOW */                   "aborts if the simulation chatters",
   /* FLAG_ALARM */                        "aborts after the given number of seconds (0 disables)",
+  /* FLAG_BATCH */                        "value specifies a CSV file with one simulation run per row",
+  /* FLAG_BATCH_WORKERS */                "value specifies the number of worker processes for -batch",
   /* FLAG_CLOCK */                        "selects the type of clock to use -clock=RT, -clock=CYC or -clock=CPU",
   /* FLAG_CPU */                          "dumps the cpu-time into the result file",
   /* FLAG_CSV_OSTEP */                    "value specifies csv-files for debug values for optimizer step",
@@ -157,6 +166,7 @@ const char *FLAG_DESC[FLAG_MAX+1] = {
   /* FLAG_EMBEDDED_SERVER */              "enables an embedded server. Valid values: none, opc-da [broken], opc-ua [experimental], or the path to a shared object.",
   /* FLAG_EMBEDDED_SERVER_PORT */         "[int (default 4841)] value specifies the port number used by the embedded server",
   /* FLAG_MAT_SYNC */                     "[int (default 0)] syncs the mat file header after emitting every N time-points (default disabled)",
+  /* FLAG_MAT_ASYNC */                    "[int (default 0)] writes the mat file from a background thread using a ring of N row blocks (default disabled)",
   /* FLAG_EMIT_PROTECTED */               "emits protected variables to the result-file",
   /* FLAG_DATA_RECONCILE_Eps */           "value specifies the number of convergence iteration to be performed for DataReconciliation",
   /* FLAG_F */                            "value specifies a new setup XML file to the generated simulation code",
@@ -201,6 +211,7 @@ const char *FLAG_DESC[FLAG_MAX+1] = {
   /* FLAG_IPOPT_MAX_ITER */               "value specifies the max number of iteration for ipopt",
   /* FLAG_IPOPT_WARM_START */             "value specifies lvl for a warm start in ipopt: 1,2,3,...",
   /* FLAG_JACOBIAN */                     "select the calculation method of the Jacobian used only by ida and dassl solver.",
+  /* FLAG_JACOBIAN_THREADS */             "[int (default 1)] value specifies the number of threads evaluating the colored Jacobian of dassl and ida",
   /* FLAG_L */                            "value specifies a time where the linearization of the model should be performed",
   /* FLAG_L_DATA_RECOVERY */              "emit data recovery matrices with model linearization",
   /* FLAG_LOG_FORMAT */                   "value specifies the log format of the executable. -logFormat=text (default), -logFormat=xml or -logFormat=xmltcp",
@@ -209,6 +220,7 @@ const char *FLAG_DESC[FLAG_MAX+1] = {
   /* FLAG_LSS */                          "value specifies the linear sparse solver method (default: umfpack)",
   /* FLAG_LSS_MAX_DENSITY */              "[double (default 0.2)] value specifies the maximum density for using a linear sparse solver",
   /* FLAG_LSS_MIN_SIZE */                 "[int (default 4001)] value specifies the minimum system size for using a linear sparse solver",
+  /* FLAG_LSS_REUSE */                    "reuse the factorization of sparse linear systems while a simplified iteration converges",
   /* FLAG_LV */                           "[string list] value specifies the logging level",
   /* FLAG_MAX_BISECTION_ITERATIONS */     "[int (default 0)] value specifies the maximum number of bisection iterations for state event detection or zero for default behavior",
   /* FLAG_MAX_EVENT_ITERATIONS */         "[int (default 20)] value specifies the maximum number of event iterations",
@@ -220,6 +232,7 @@ const char *FLAG_DESC[FLAG_MAX+1] = {
   /* FLAG_NEWTON_XTOL */                  "[double (default 1e-12)] tolerance respecting newton correction (delta_x) for updating solution vector in Newton solver",
   /* FLAG_NEWTON_STRATEGY */              "value specifies the damping strategy for the newton solver",
   /* FLAG_NLS */                          "value specifies the nonlinear solver",
+  /* FLAG_NLS_EXTRAPOLATION_ORDER */      "[int (default 1)] value specifies the degree of the polynomial extrapolating the initial guess of non-linear systems",
   /* FLAG_NLS_INFO */                     "outputs detailed information about solving process of non-linear systems into csv files.",
   /* FLAG_NLS_LS */                       "value specifies the linear solver used by the non-linear solver",
   /* FLAG_NLS_MAX_DENSITY */              "[double (default 0.2)] value specifies the maximum density for using a non-linear sparse solver",
@@ -240,6 +253,7 @@ const char *FLAG_DESC[FLAG_MAX+1] = {
   /* FLAG_OUTPUT_PATH */                  "value specifies a path for writing the output files i.e., model_res.mat, model_prof.intdata, model_prof.realdata etc.",
   /* FLAG_OVERRIDE */                     "override the variables or the simulation settings in the XML setup file",
   /* FLAG_OVERRIDE_FILE */                "will override the variables or the simulation settings in the XML setup file with the values from the file",
+  /* FLAG_PARMODAUTO_SCHEDULER */         "value specifies the scheduler of the automatically parallelized ODE system: levels (default) or worksteal",
   /* FLAG_PORT */                         "value specifies the port for simulation status (default disabled)",
   /* FLAG_R */                            "value specifies a new result file than the default Model_res.mat",
   /* FLAG_DATA_RECONCILE */               "Run the DataReconciliation algorithm for constrained equation",
@@ -262,6 +276,16 @@ const char *FLAG_DETAILED_DESC[FLAG_MAX+1] = {
   "  Aborts if the simulation chatters.",
   /* FLAG_ALARM */
   "  Aborts after the given number of seconds (default=0 disables the alarm).",
+  /* FLAG_BATCH */
+  "  Value specifies a CSV file with one simulation run per row. The first row\n"
+  "  names the columns: model variables or parameters (their start values are\n"
+  "  overridden) or one of startTime, stopTime, stepSize and tolerance.\n"
+  "  The model is loaded once and every row is simulated in turn; run k writes\n"
+  "  its results to <model>_res_k.<format>.",
+  /* FLAG_BATCH_WORKERS */
+  "  Value specifies the number of worker processes used to simulate the runs of\n"
+  "  -batch (default 1). Each worker is forked after the model is loaded and\n"
+  "  simulates every N-th run. Ignored on systems without fork().",
   /* FLAG_CLOCK */
   "  Selects the type of clock to use. Valid options include:\n\n"
   "  * RT (monotonic real-time clock)\n"
@@ -287,6 +311,11 @@ const char *FLAG_DETAILED_DESC[FLAG_MAX+1] = {
   "  Value specifies the port number used by the embedded server. The default value is 4841.",
   /* FLAG_MAT_SYNC */
   "  Syncs the mat file header after emitting every N time-points.",
+  /* FLAG_MAT_ASYNC */
+  "  Writes the mat result file from a background thread. The solver thread only copies each\n"
+  "  output row into a ring of N preallocated row blocks; full blocks are written in large chunks\n"
+  "  by the writer thread, which also keeps the data_2 header in sync (see -mat_sync).\n"
+  "  The default value 0 disables the background writer.",
   /* FLAG_EMIT_PROTECTED */
   "  Emits protected variables to the result-file.",
   /* FLAG_DATA_RECONCILE_Eps */
@@ -385,6 +414,11 @@ const char *FLAG_DETAILED_DESC[FLAG_MAX+1] = {
   "  Value specifies lvl for a warm start in ipopt: 1,2,3,...",
   /* FLAG_JACOBIAN */
   "  Select the calculation method for Jacobian used by the integration method:\n",
+  /* FLAG_JACOBIAN_THREADS */
+  "  Value specifies the number of threads which evaluate the color groups of the\n"
+  "  colored Jacobian of dassl and ida in parallel. Every thread works on a private\n"
+  "  copy of the variables. Models with algebraic loops are always evaluated\n"
+  "  sequentially. The value is an Integer with default value 1.",
   /* FLAG_L */
   "  Value specifies a time where the linearization of the model should be performed.",
   /* FLAG_L_DATA_RECOVERY */
@@ -407,6 +441,11 @@ const char *FLAG_DETAILED_DESC[FLAG_MAX+1] = {
   /* FLAG_LSS_MIN_SIZE */
   "  Value specifies the minimum system size for using a linear sparse solver.\n"
   "  The value is an Integer with default value 4001.",
+  /* FLAG_LSS_REUSE */
+  "  Solves sparse linear systems with the LU factorization of an earlier solve as\n"
+  "  long as a simplified iteration with it converges fast enough. A new Jacobian\n"
+  "  and factorization are computed when the iteration is too slow, during\n"
+  "  initialization and at events. Only for the klu and umfpack solvers.",
   /* FLAG_LV */
   "  Value (a comma-separated String list) specifies which logging levels to\n"
   "  enable. Multiple options can be enabled at the same time.",
@@ -442,6 +481,11 @@ const char *FLAG_DETAILED_DESC[FLAG_MAX+1] = {
   "  Value specifies the damping strategy for the newton solver.",
   /* FLAG_NLS */
   "  Value specifies the nonlinear solver:",
+  /* FLAG_NLS_EXTRAPOLATION_ORDER */
+  "  Value specifies the degree of the polynomial through the last solutions of a\n"
+  "  non-linear system that extrapolates the initial guess of the next solve.\n"
+  "  0 starts from the last solution, 1 extrapolates linearly and 2 quadratically.\n"
+  "  The value is an Integer with default value 1.",
   /* FLAG_NLS_INFO */
   "  Outputs detailed information about solving process of non-linear systems into csv files.",
   /* FLAG_NLS_LS */
@@ -497,6 +541,13 @@ const char *FLAG_DETAILED_DESC[FLAG_MAX+1] = {
   "  Note that: -overrideFile CANNOT be used with -override.\n"
   "  Use when variables for -override are too many.\n"
   "  overrideFileName contains lines of the form: var1=start1",
+  /* FLAG_PARMODAUTO_SCHEDULER */
+  "  Value specifies the scheduler used for the ODE system of models compiled with\n"
+  "  -d=parmodauto:\n"
+  "  * levels (default): the clusters of each level are run in parallel with a\n"
+  "    barrier between the levels.\n"
+  "  * worksteal: the clusters are run as soon as their parents finished, idle\n"
+  "    threads steal ready clusters from the others.",
   /* FLAG_PORT */
   "  Value specifies the port for simulation status (default disabled).",
   /* FLAG_R */
@@ -533,6 +584,8 @@ const int FLAG_TYPE[FLAG_MAX] = {
 
   /* FLAG_ABORT_SLOW */                   FLAG_TYPE_FLAG,
   /* FLAG_ALARM */                        FLAG_TYPE_OPTION,
+  /* FLAG_BATCH */                        FLAG_TYPE_OPTION,
+  /* FLAG_BATCH_WORKERS */                FLAG_TYPE_OPTION,
   /* FLAG_CLOCK */                        FLAG_TYPE_OPTION,
   /* FLAG_CPU */                          FLAG_TYPE_FLAG,
   /* FLAG_CSV_OSTEP */                    FLAG_TYPE_OPTION,
@@ -542,6 +595,7 @@ const int FLAG_TYPE[FLAG_MAX] = {
   /* FLAG_EMBEDDED_SERVER */              FLAG_TYPE_OPTION,
   /* FLAG_EMBEDDED_SERVER_PORT */         FLAG_TYPE_OPTION,
   /* FLAG_MAT_SYNC */                     FLAG_TYPE_OPTION,
+  /* FLAG_MAT_ASYNC */                    FLAG_TYPE_OPTION,
   /* FLAG_EMIT_PROTECTED */               FLAG_TYPE_FLAG,
   /* FLAG_DATA_RECONCILE_Eps */           FLAG_TYPE_OPTION,
   /* FLAG_F */                            FLAG_TYPE_OPTION,
@@ -586,6 +640,7 @@ const int FLAG_TYPE[FLAG_MAX] = {
   /* FLAG_IPOPT_MAX_ITER */               FLAG_TYPE_OPTION,
   /* FLAG_IPOPT_WARM_START */             FLAG_TYPE_OPTION,
   /* FLAG_JACOBIAN */                     FLAG_TYPE_OPTION,
+  /* FLAG_JACOBIAN_THREADS */             FLAG_TYPE_OPTION,
   /* FLAG_L */                            FLAG_TYPE_OPTION,
   /* FLAG_L_DATA_RECOVERY */              FLAG_TYPE_FLAG,
   /* FLAG_LOG_FORMAT */                   FLAG_TYPE_OPTION,
@@ -594,6 +649,7 @@ const int FLAG_TYPE[FLAG_MAX] = {
   /* FLAG_LSS */                          FLAG_TYPE_OPTION,
   /* FLAG_LSS_MAX_DENSITY */              FLAG_TYPE_OPTION,
   /* FLAG_LSS_MIN_SIZE */                 FLAG_TYPE_OPTION,
+  /* FLAG_LSS_REUSE */                    FLAG_TYPE_FLAG,
   /* FLAG_LV */                           FLAG_TYPE_OPTION,
   /* FLAG_MAX_BISECTION_ITERATIONS */     FLAG_TYPE_OPTION,
   /* FLAG_MAX_EVENT_ITERATIONS */         FLAG_TYPE_OPTION,
@@ -605,6 +661,7 @@ const int FLAG_TYPE[FLAG_MAX] = {
   /* FLAG_NEWTON_XTOL */                  FLAG_TYPE_OPTION,
   /* FLAG_NEWTON_STRATEGY */              FLAG_TYPE_OPTION,
   /* FLAG_NLS */                          FLAG_TYPE_OPTION,
+  /* FLAG_NLS_EXTRAPOLATION_ORDER */      FLAG_TYPE_OPTION,
   /* FLAG_NLS_INFO */                     FLAG_TYPE_FLAG,
   /* FLAG_NLS_LS */                       FLAG_TYPE_OPTION,
   /* FLAG_NLS_MAX_DENSITY */              FLAG_TYPE_OPTION,
@@ -625,6 +682,7 @@ const int FLAG_TYPE[FLAG_MAX] = {
   /* FLAG_OUTPUT_PATH */                  FLAG_TYPE_OPTION,
   /* FLAG_OVERRIDE */                     FLAG_TYPE_OPTION,
   /* FLAG_OVERRIDE_FILE */                FLAG_TYPE_OPTION,
+  /* FLAG_PARMODAUTO_SCHEDULER */         FLAG_TYPE_OPTION,
   /* FLAG_PORT */                         FLAG_TYPE_OPTION,
   /* FLAG_R */                            FLAG_TYPE_OPTION,
   /* FLAG_DATA_RECONCILE */               FLAG_TYPE_FLAG,
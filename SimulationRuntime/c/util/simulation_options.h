@@ -43,6 +43,8 @@ enum _FLAG
 
   FLAG_ABORT_SLOW,
   FLAG_ALARM,
+  FLAG_BATCH,
+  FLAG_BATCH_WORKERS,
   FLAG_CLOCK,
   FLAG_CPU,
   FLAG_CSV_OSTEP,
@@ -52,6 +54,7 @@ enum _FLAG
   FLAG_EMBEDDED_SERVER,
   FLAG_EMBEDDED_SERVER_PORT,
   FLAG_MAT_SYNC,
+  FLAG_MAT_ASYNC,
   FLAG_EMIT_PROTECTED,
   FLAG_DATA_RECONCILE_Eps,
   FLAG_F,
@@ -96,6 +99,7 @@ enum _FLAG
   FLAG_IPOPT_MAX_ITER,
   FLAG_IPOPT_WARM_START,
   FLAG_JACOBIAN,
+  FLAG_JACOBIAN_THREADS,
   FLAG_L,
   FLAG_L_DATA_RECOVERY,
   FLAG_LOG_FORMAT,
@@ -104,6 +108,7 @@ enum _FLAG
   FLAG_LSS,
   FLAG_LSS_MAX_DENSITY,
   FLAG_LSS_MIN_SIZE,
+  FLAG_LSS_REUSE,
   FLAG_LV,
   FLAG_MAX_BISECTION_ITERATIONS,
   FLAG_MAX_EVENT_ITERATIONS,
@@ -115,6 +120,7 @@ enum _FLAG
   FLAG_NEWTON_XTOL,
   FLAG_NEWTON_STRATEGY,
   FLAG_NLS,
+  FLAG_NLS_EXTRAPOLATION_ORDER,
   FLAG_NLS_INFO,
   FLAG_NLS_LS,
   FLAG_NLS_MAX_DENSITY,
@@ -135,6 +141,7 @@ enum _FLAG
   FLAG_OUTPUT_PATH,
   FLAG_OVERRIDE,
   FLAG_OVERRIDE_FILE,
+  FLAG_PARMODAUTO_SCHEDULER,
   FLAG_PORT,
   FLAG_R,
   FLAG_DATA_RECONCILE,
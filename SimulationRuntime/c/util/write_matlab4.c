@@ -90,3 +90,85 @@ int writeMatVer4Matrix(FILE *fout, const char *name, int rows, int cols, const v
   /* write data */
   return !(0==writeMatVer4MatrixHeader(fout, name, rows, cols, size) && 1 == fwrite(matrixData, (size)*rows*cols, 1, fout));
 }
+
+static OMC_INLINE uint64_t double_bits(double d)
+{
+  uint64_t u;
+  memcpy(&u, &d, sizeof(double));
+  return u;
+}
+
+static OMC_INLINE double linear_prediction(double prev, double prev2)
+{
+  double d = 2.0*prev;
+  return d - prev2;
+}
+
+/* number of significant bytes of x; lead receives the number of leading zero bytes */
+static OMC_INLINE unsigned int significant_bytes(uint64_t x, unsigned int *lead)
+{
+  unsigned int l = 0, t = 0;
+  if (!x) {
+    *lead = 8;
+    return 0;
+  }
+  while (!((x >> (8*(7-l))) & 0xff)) l++;
+  while (!((x >> (8*t)) & 0xff)) t++;
+  *lead = l;
+  return 8 - l - t;
+}
+
+static OMC_INLINE size_t packed_size(uint64_t x)
+{
+  unsigned int lead;
+  return 1 + significant_bytes(x, &lead);
+}
+
+static OMC_INLINE uint8_t* write_packed(uint64_t x, uint8_t *out)
+{
+  unsigned int lead, len = significant_bytes(x, &lead);
+  *out++ = (uint8_t) (lead << 4 | len);
+  x >>= 8*(8 - lead - len);
+  while (len--) {
+    *out++ = (uint8_t) (x & 0xff);
+    x >>= 8;
+  }
+  return out;
+}
+
+size_t omc_matc_encode_column(const double *vals, size_t n, uint8_t *out)
+{
+  uint8_t *cur = out;
+  size_t i, sizeXor = 1 + 8, sizeLinear = 1 + 8;
+
+  if (n < 2) {
+    *cur++ = OMC_MATC_COLUMN_RAW;
+    memcpy(cur, vals, n*sizeof(double));
+    return 1 + n*sizeof(double);
+  }
+
+  /* pick the cheapest mode */
+  sizeLinear += packed_size(double_bits(vals[1]) ^ double_bits(vals[0]));
+  for (i=1; i<n; i++) {
+    sizeXor += packed_size(double_bits(vals[i]) ^ double_bits(vals[i-1]));
+  }
+  for (i=2; i<n; i++) {
+    sizeLinear += packed_size(double_bits(vals[i]) ^ double_bits(linear_prediction(vals[i-1], vals[i-2])));
+  }
+
+  if (sizeXor >= 1 + n*sizeof(double) && sizeLinear >= 1 + n*sizeof(double)) {
+    *cur++ = OMC_MATC_COLUMN_RAW;
+    memcpy(cur, vals, n*sizeof(double));
+    return 1 + n*sizeof(double);
+  }
+
+  *cur++ = sizeLinear < sizeXor ? OMC_MATC_COLUMN_LINEAR : OMC_MATC_COLUMN_XOR;
+  memcpy(cur, vals, sizeof(double));
+  cur += sizeof(double);
+  cur = write_packed(double_bits(vals[1]) ^ double_bits(vals[0]), cur);
+  for (i=2; i<n; i++) {
+    double prediction = sizeLinear < sizeXor ? linear_prediction(vals[i-1], vals[i-2]) : vals[i-1];
+    cur = write_packed(double_bits(vals[i]) ^ double_bits(prediction), cur);
+  }
+  return cur - out;
+}
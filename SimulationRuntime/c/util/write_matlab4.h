@@ -31,6 +31,9 @@
 #ifndef OMC_WRITE_MATLAB4_H
 #define OMC_WRITE_MATLAB4_H
 
+#include <stddef.h>
+#include <stdint.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -40,6 +43,13 @@ int writeMatVer4AclassNormal(FILE *fout);
 int writeMatVer4MatrixHeader(FILE *fout,const char *name, int rows, int cols, unsigned int size);
 int writeMatVer4Matrix(FILE *fout, const char *name, int rows, int cols, const void *matrixData, unsigned int size);
 
+/* Upper bound of the encoded size of a column with n values */
+#define OMC_MATC_MAX_COLUMN_SIZE(n) (1 + 9*(n))
+/* Encodes a column of a chunked result file (see read_matlab4.h) into out,
+ * which needs room for OMC_MATC_MAX_COLUMN_SIZE(n) bytes.
+ * Returns the number of bytes used. */
+size_t omc_matc_encode_column(const double *vals, size_t n, uint8_t *out);
+
 #ifdef __cplusplus
 } /* extern "C" */
 #endif
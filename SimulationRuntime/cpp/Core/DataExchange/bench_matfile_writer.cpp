@@ -0,0 +1,272 @@
+/** @addtogroup dataexchange
+ *
+ *  @{
+ */
+/*=={info}======================================================================================*/
+/*!
+ * \title      bench_matfile_writer
+ *
+ * \content    Timing of MatFileWriter for models with 10k and 100k output variables. Every
+ *             output step is also written the way the writer did it before the gather plans:
+ *             one std::transform over the pointer lists, a header update and a row write per
+ *             step. The data_2 matrices of both files have to be byte-identical.
+ *
+ *             usage: bench_matfile_writer [rows for 10k outputs] [directory]
+ */
+/*========================================================================================{end}==*/
+// no boost_chrono library to link
+#define BOOST_CHRONO_HEADER_ONLY
+#include <Core/ModelicaDefine.h>
+#include <Core/Modelica.h>
+
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <boost/chrono.hpp>
+
+#include <Core/DataExchange/Writer.h>
+#include <Core/DataExchange/Policies/MatfileWriter.h>
+
+/**
+ * Output variables laid out like in a generated model: mostly runs of consecutive simvars with
+ * parameters in between, a few scattered variables and negated alias variables.
+ */
+struct OutputSet
+{
+    vector<double> realSimVars;
+    vector<int> intSimVars;
+    boost::container::vector<bool> boolSimVars;
+    all_vars_time_t vars;
+    neg_all_vars_t neg;
+
+    OutputSet(size_t nReal)
+    {
+        size_t nInt = nReal / 20, nBool = nReal / 20;
+        realSimVars.resize(2 * nReal);
+        intSimVars.resize(2 * nInt);
+        boolSimVars.resize(2 * nBool);
+        reset();
+
+        addOutputs(realSimVars, nReal, get<0>(vars), get<0>(neg));
+        addOutputs(intSimVars, nInt, get<1>(vars), get<1>(neg));
+        addOutputs(boolSimVars, nBool, get<2>(vars), get<2>(neg));
+    }
+
+    template<typename T, typename Container>
+    static void addOutputs(const Container& simVars, size_t n, boost::container::vector<const T*>& outputs, negate_values_t& negate)
+    {
+        size_t index = 0;
+        while (outputs.size() < n)
+        {
+            int kind = std::rand() % 20;
+            if (kind == 0 && !outputs.empty())
+            {
+                // negated alias of an earlier output
+                outputs.push_back(outputs[std::rand() % outputs.size()]);
+                negate.push_back(true);
+            }
+            else if (kind == 1)
+            {
+                outputs.push_back(&simVars[std::rand() % simVars.size()]);
+                negate.push_back(false);
+            }
+            else
+            {
+                // a run of consecutive variables, then skip a few parameters
+                size_t run = 1 + std::rand() % 64;
+                for (size_t i = 0; i < run && outputs.size() < n && index < simVars.size(); ++i, ++index)
+                {
+                    outputs.push_back(&simVars[index]);
+                    negate.push_back(false);
+                }
+                index += std::rand() % 4;
+                if (index >= simVars.size())
+                    index = 0;
+            }
+        }
+    }
+
+    /// start values, the same for every writer
+    void reset()
+    {
+        for (size_t i = 0; i < realSimVars.size(); ++i)
+            realSimVars[i] = 0.5 * i;
+        for (size_t i = 0; i < intSimVars.size(); ++i)
+            intSimVars[i] = i;
+        for (size_t i = 0; i < boolSimVars.size(); ++i)
+            boolSimVars[i] = i % 3 == 0;
+    }
+
+    /// changes a few values per step, so that the rows differ
+    void step(size_t row)
+    {
+        get<3>(vars) = 1e-3 * row;
+        realSimVars[row % realSimVars.size()] += 1.0;
+        if (!intSimVars.empty())
+            intSimVars[row % intSimVars.size()] += 1;
+        if (!boolSimVars.empty())
+            boolSimVars[row % boolSimVars.size()] = !boolSimVars[row % boolSimVars.size()];
+    }
+};
+
+/**
+ * The data_2 matrix written row by row as MatFileWriter did before the gather plans
+ */
+class PerStepWriter
+{
+    std::ofstream _output_stream;
+    std::streampos _dataHdrPos;
+    vector<double> _row;
+    unsigned int _uiValueCount;
+
+    void writeHeader(unsigned int rows, unsigned int cols)
+    {
+        const int endian_test = 1;
+        unsigned int hdr[5];
+        hdr[0] = 1000 * ((*(char*) &endian_test) == 0);
+        hdr[1] = rows;
+        hdr[2] = cols;
+        hdr[3] = 0;
+        hdr[4] = 7;
+        _output_stream.write((char*) hdr, sizeof(hdr));
+        _output_stream.write("data_2", 7);
+    }
+
+ public:
+    PerStepWriter(const string& file_name)
+            : _output_stream(file_name.c_str(), ios::binary | ios::trunc),
+              _dataHdrPos(_output_stream.tellp()),
+              _uiValueCount(0)
+    {
+    }
+
+    void write(const all_vars_time_t& v_list, const neg_all_vars_t& neg_v_list)
+    {
+        size_t nReal = get<0>(v_list).size(), nInt = get<1>(v_list).size();
+        _row.resize(nReal + nInt + get<2>(v_list).size() + 1);
+        _row[0] = get<3>(v_list);
+        std::transform(get<0>(v_list).begin(), get<0>(v_list).end(), get<0>(neg_v_list).begin(),
+            _row.begin() + 1, WriteOutputVar<double>());
+        std::transform(get<1>(v_list).begin(), get<1>(v_list).end(), get<1>(neg_v_list).begin(),
+            _row.begin() + 1 + nReal, WriteOutputVar<int>());
+        std::transform(get<2>(v_list).begin(), get<2>(v_list).end(), get<2>(neg_v_list).begin(),
+            _row.begin() + 1 + nReal + nInt, WriteOutputVar<bool>());
+
+        _uiValueCount++;
+        if (_uiValueCount > 1)
+        {
+            std::streampos eof = _output_stream.tellp();
+            _output_stream.seekp(_dataHdrPos);
+            writeHeader(_row.size(), _uiValueCount);
+            _output_stream.seekp(eof);
+        }
+        else
+            writeHeader(_row.size(), _uiValueCount);
+        _output_stream.write((const char*) &_row[0], sizeof(double) * _row.size());
+    }
+};
+
+static double elapsed(boost::chrono::steady_clock::time_point start)
+{
+    return boost::chrono::duration<double>(boost::chrono::steady_clock::now() - start).count();
+}
+
+/// true if file b ends with the content of file a
+static bool sameTail(const string& a, const string& b)
+{
+    std::ifstream fa(a.c_str(), ios::binary | ios::ate), fb(b.c_str(), ios::binary | ios::ate);
+    std::streamoff sizeA = fa.tellg(), sizeB = fb.tellg();
+    if (sizeA <= 0 || sizeB < sizeA)
+        return false;
+    fa.seekg(0);
+    fb.seekg(sizeB - sizeA);
+
+    vector<char> bufA(1 << 20), bufB(1 << 20);
+    for (std::streamoff left = sizeA; left > 0; )
+    {
+        std::streamsize chunk = std::min<std::streamoff>(left, bufA.size());
+        fa.read(&bufA[0], chunk);
+        fb.read(&bufB[0], chunk);
+        if (memcmp(&bufA[0], &bufB[0], chunk) != 0)
+            return false;
+        left -= chunk;
+    }
+    return true;
+}
+
+template<typename WriterT>
+static void writeRows(WriterT& writer, OutputSet& outputs, size_t rows)
+{
+    for (size_t r = 0; r < rows; ++r)
+    {
+        outputs.step(r);
+        writer.write(outputs.vars, outputs.neg);
+    }
+}
+
+/// best of three runs of each writer, the writers are destroyed inside the timed scope
+static void timeWriters(OutputSet& outputs, size_t rows, const string& stepFile, const string& planFile,
+                        double& tStep, double& tPlan)
+{
+    tStep = tPlan = 1e300;
+    for (int run = 0; run < 3; ++run)
+    {
+        outputs.reset();
+        boost::chrono::steady_clock::time_point start = boost::chrono::steady_clock::now();
+        {
+            PerStepWriter writer(stepFile);
+            writeRows(writer, outputs, rows);
+        }
+        tStep = std::min(tStep, elapsed(start));
+
+        outputs.reset();
+        start = boost::chrono::steady_clock::now();
+        {
+            MatFileWriter writer(0, planFile);
+            writer.init(planFile, 0);
+            writer.write(all_vars_t(), 0.0, 1.0);
+            writeRows(writer, outputs, rows);
+        }
+        tPlan = std::min(tPlan, elapsed(start));
+    }
+}
+
+static int bench(size_t nOutputs, size_t rows, const string& dir)
+{
+    OutputSet outputs(nOutputs);
+    string planFile = dir + "/bench_matfile_plan.mat", stepFile = dir + "/bench_matfile_step.mat";
+    double tStep, tPlan;
+
+#if !defined(_WIN32)
+    // without the file system, only the row assembly and the stream calls are left
+    timeWriters(outputs, rows, "/dev/null", "/dev/null", tStep, tPlan);
+    std::cout << nOutputs << " outputs, " << rows << " rows to /dev/null: per step " << tStep
+              << " s, gather plan " << tPlan << " s, speedup " << tStep / tPlan << std::endl;
+#endif
+
+    timeWriters(outputs, rows, stepFile, planFile, tStep, tPlan);
+    std::cout << nOutputs << " outputs, " << rows << " rows to " << dir << ": per step " << tStep
+              << " s, gather plan " << tPlan << " s, speedup " << tStep / tPlan << std::endl;
+
+    bool ok = sameTail(stepFile, planFile);
+    std::remove(stepFile.c_str());
+    std::remove(planFile.c_str());
+    if (!ok)
+        std::cout << "data_2 differs" << std::endl;
+    return ok ? 0 : 1;
+}
+
+int main(int argc, char** argv)
+{
+    size_t rows = argc > 1 ? std::atoi(argv[1]) : 1000;
+    string dir = argc > 2 ? argv[2] : ".";
+
+    std::srand(42);
+    // same amount of data for both sizes
+    if (bench(10000, rows, dir) != 0)
+        return 1;
+    if (bench(100000, rows / 10 > 0 ? rows / 10 : 1, dir) != 0)
+        return 2;
+    return 0;
+}
+/** @} */ // end of dataexchange
@@ -1,57 +1,166 @@
 #include <Core/ModelicaDefine.h>
  #include <Core/Modelica.h>
-#include <Core/Math/matrix_t.h>
+#include <Core/Math/SparseMatrix.h>
+#include <algorithm>
 #ifdef USE_UMFPACK
 #include "umfpack.h"
 #endif
 
-#ifdef USE_UMFPACK
+sparse_matrix::sparse_matrix(int n)
+  : n(n)
+  , _symbolic(NULL)
+  , _numeric(NULL)
+  , _valuesChanged(true)
+{
+}
+
+sparse_matrix::sparse_matrix(const sparse_matrix& other)
+  : Ap(other.Ap)
+  , Ai(other.Ai)
+  , Ax(other.Ax)
+  , n(other.n)
+  , _symbolic(NULL)
+  , _numeric(NULL)
+  , _valuesChanged(true)
+{
+}
+
+sparse_matrix& sparse_matrix::operator=(const sparse_matrix& other)
+{
+    if(this != &other) {
+        freeFactorization(true);
+        Ap = other.Ap;
+        Ai = other.Ai;
+        Ax = other.Ax;
+        n = other.n;
+        _valuesChanged = true;
+    }
+    return *this;
+}
+
+sparse_matrix::~sparse_matrix()
+{
+    freeFactorization(true);
+}
+
 void sparse_matrix::build(sparse_inserter& ins) {
-        if(n==-1) {
-            n=ins.content.rbegin()->first.first+1;
-        } else {
-            if(n-1!=ins.content.rbegin()->first.first) {
-                throw ModelicaSimulationError(MATH_FUNCTION,"size doesn't match");
-            }
+    if(ins.content.empty()) {
+        throw ModelicaSimulationError(MATH_FUNCTION,"empty sparse matrix");
+    }
+    int size = n;
+    if(size==-1) {
+        size=ins.content.rbegin()->first.first+1;
+    } else {
+        if(size-1!=ins.content.rbegin()->first.first) {
+            throw ModelicaSimulationError(MATH_FUNCTION,"size doesn't match");
         }
-        size_t n=ins.content.size();
-        Ap.assign(this->n+1,0);
-        Ai.resize(n);
-        Ax.resize(n);
-        unsigned int j=0;
-        int rowold=1;
-        for(map< pair<int,int>, double>::iterator it=ins.content.begin(); it!=ins.content.end(); it++) {
-            if(it->first.first+1==rowold) {
-                ++Ap[rowold];
-            } else {
-                Ap[it->first.first+1]=Ap[rowold]+1;
-                rowold=it->first.first+1;
-            }
-            Ai[j]=it->first.second;
-            Ax[j]=it->second;
-            ++j;
+    }
+    // the inserter is ordered by column, then row
+    std::vector<int> colPtr(size+1,0);
+    std::vector<int> rowIdx;
+    std::vector<double> values;
+    rowIdx.reserve(ins.content.size());
+    values.reserve(ins.content.size());
+    for(map< pair<int,int>, double>::iterator it=ins.content.begin(); it!=ins.content.end(); it++) {
+        ++colPtr[it->first.first+1];
+        rowIdx.push_back(it->first.second);
+        values.push_back(it->second);
+    }
+    for(int j=0; j<size; ++j) {
+        colPtr[j+1]+=colPtr[j];
+    }
+    assign(size, &colPtr[0], &rowIdx[0], &values[0]);
+}
+
+void sparse_matrix::assign(int size, const int* colPtr, const int* rowIdx, const double* values) {
+    const int nnz = colPtr[size];
+    if(size!=n || (int)Ap.size()!=size+1 || (int)Ai.size()!=nnz
+       || !std::equal(colPtr, colPtr+size+1, Ap.begin())
+       || !std::equal(rowIdx, rowIdx+nnz, Ai.begin())) {
+        // new pattern, the symbolic analysis is no longer valid
+        freeFactorization(true);
+        n=size;
+        Ap.assign(colPtr, colPtr+size+1);
+        Ai.assign(rowIdx, rowIdx+nnz);
+    }
+    Ax.assign(values, values+nnz);
+    _valuesChanged=true;
+}
+
+int sparse_matrix::index(int i, int j) const {
+    if(j<0 || j>=n) {
+        return -1;
+    }
+    std::vector<int>::const_iterator first=Ai.begin()+Ap[j];
+    std::vector<int>::const_iterator last=Ai.begin()+Ap[j+1];
+    std::vector<int>::const_iterator it=std::lower_bound(first, last, i);
+    return (it!=last && *it==i) ? (int)(it-Ai.begin()) : -1;
+}
+
+void sparse_matrix::setValue(int i, int j, double value) {
+    int k=index(i,j);
+    if(k<0) {
+        throw ModelicaSimulationError(MATH_FUNCTION,"element is not part of the sparsity pattern");
+    }
+    Ax[k]=value;
+    _valuesChanged=true;
+}
+
+#ifdef USE_UMFPACK
+void sparse_matrix::freeFactorization(bool symbolic) {
+    if(_numeric) {
+        umfpack_di_free_numeric(&_numeric);
+        _numeric=NULL;
+    }
+    if(symbolic && _symbolic) {
+        umfpack_di_free_symbolic(&_symbolic);
+        _symbolic=NULL;
+    }
+    _valuesChanged=true;
+}
+
+int sparse_matrix::factorize() {
+    int status=UMFPACK_OK;
+    if(!_valuesChanged && _numeric) {
+        return status;
+    }
+    if(!_symbolic) {
+        status = umfpack_di_symbolic(n, n, &Ap[0], &Ai[0], &Ax[0], &_symbolic, NULL, NULL);
+        if(status<0) {
+            _symbolic=NULL;
+            return status;
         }
     }
+    freeFactorization(false);
+    status = umfpack_di_numeric(&Ap[0], &Ai[0], &Ax[0], _symbolic, &_numeric, NULL, NULL);
+    if(status<0) {
+        _numeric=NULL;
+        return status;
+    }
+    _valuesChanged=false;
+    return status;
+}
 
-int sparse_matrix::solve(const double* b, double * x) {
-    int status, sys=0;
-    double Control [UMFPACK_CONTROL], Info [UMFPACK_INFO] ;
-    void *Symbolic, *Numeric ;
-    umfpack_di_defaults (Control) ;
-    status = umfpack_di_symbolic (sparse_matrix::n, sparse_matrix::n, &sparse_matrix::Ap[0], &sparse_matrix::Ai[0], &sparse_matrix::Ax[0], &Symbolic, Control, Info) ;
-    status = umfpack_di_numeric (&sparse_matrix::Ap[0], &sparse_matrix::Ai[0], &sparse_matrix::Ax[0], Symbolic, &Numeric, Control, Info);
-    status = umfpack_di_solve (sys, &sparse_matrix::Ap[0], &sparse_matrix::Ai[0], &sparse_matrix::Ax[0], x, b, Numeric, Control, Info);
-    umfpack_di_free_symbolic (&Symbolic);
-    umfpack_di_free_numeric (&Numeric);
+int sparse_matrix::solve(const double* b, double * x, int nrhs) {
+    int status=factorize();
+    if(status<0) {
+        return status;
+    }
+    for(int k=0; k<nrhs && status>=0; ++k) {
+        status = umfpack_di_solve(UMFPACK_A, &Ap[0], &Ai[0], &Ax[0], x+k*n, b+k*n, _numeric, NULL, NULL);
+    }
     return status;
 }
 #else
-void sparse_matrix::build(sparse_inserter& ins) {
-        throw ModelicaSimulationError(MATH_FUNCTION,"no umfpack");
-    }
+void sparse_matrix::freeFactorization(bool symbolic) {
+    _valuesChanged=true;
+}
 
-int sparse_matrix::solve(const double* b, double * x) {
-        throw ModelicaSimulationError(MATH_FUNCTION,"no umfpack");
+int sparse_matrix::factorize() {
+    throw ModelicaSimulationError(MATH_FUNCTION,"no umfpack");
 }
 
+int sparse_matrix::solve(const double* b, double * x, int nrhs) {
+    throw ModelicaSimulationError(MATH_FUNCTION,"no umfpack");
+}
 #endif
@@ -33,6 +33,8 @@ SolverDefaultImplementation::SolverDefaultImplementation(IMixedSystem* system, I
     , _rejStps              (0)
     , _zeroStps             (0)
     , _zeros                (0)
+    , _jacEvals             (0)
+    , _factorizations       (0)
     , _dimSys               (0)
     , _zeroStatus           (ISolver::UNCHANGED_SIGN)
     , _zeroValInit          (NULL)
@@ -158,6 +160,8 @@ void SolverDefaultImplementation::initialize()
   _rejStps = 0;
   _zeroStps = 0;
   _zeros = 0;
+  _jacEvals = 0;
+  _factorizations = 0;
 
   // Set initial step size
   //_h = _settings->_globalSettings->_hOutput;
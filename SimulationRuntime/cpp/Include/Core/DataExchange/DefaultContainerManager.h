@@ -35,6 +35,18 @@ class DefaultContainerManager : public Writer
     virtual ~DefaultContainerManager()
     {
     }
+    /**
+     * The container is written directly, nothing to wait for.
+     */
+    void flushContainers()
+    {
+    }
+    /**
+     * There is no writer thread to stop.
+     */
+    void stopWriterThread()
+    {
+    }
     /**
      * Get the internal container. It is always the same.
      * @return A reference to the internal container that can be filled with values.
@@ -6,96 +6,245 @@
  */
 #include <Core/Modelica.h>
 #include <Core/ModelicaDefine.h>
+#include <Core/Utils/extension/logger.hpp>
+#include <boost/lexical_cast.hpp>
+#if !defined(USE_CHRONO)
+  #include <boost/date_time/posix_time/posix_time_types.hpp>
+#endif
 
-#define CONTAINER_COUNT 3
+/** default number of result slots between the simulation and the writer thread (-DPARALLEL_OUTPUT_QUEUE_DEPTH=n) */
+#ifndef PARALLEL_OUTPUT_QUEUE_DEPTH
+  #define PARALLEL_OUTPUT_QUEUE_DEPTH 16
+#endif
 
 /**
- * This container manager is designed to write simulation results in parallel. It has multiple data containers that
- * can be filled with values. The write routine works asynchronously with the help of a consumer-producer-queue.
+ * This container manager is designed to write simulation results in parallel. The values of one output step are
+ * copied into a preallocated slot of a bounded single-producer/single-consumer ring, so the simulation thread can
+ * continue while a writer thread passes the slots to the write routine of the results policy. Producer and consumer
+ * only fall back to a mutex/condition variable handoff if the ring is full or empty.
  */
 class ParallelContainerManager : public Writer
 {
   private:
-    deque<write_data_t > _writeContainers;
-    deque<write_data_t > _freeContainers;
-    semaphore _freeContainerMutex;
-    semaphore _writeContainerMutex;
-    semaphore _nempty;
-    thread _writerThread;
-    bool _threadWorkDone;
+    /**
+     * One entry of the ring. The pointer lists in data point into the value buffers of the slot, so the write
+     * routines of the policies can be used unchanged.
+     */
+    struct ResultSlot
+    {
+      boost::container::vector<double> realValues;
+      boost::container::vector<int> intValues;
+      boost::container::vector<bool> boolValues;
+      boost::container::vector<double> derValues;
+      boost::container::vector<double> resValues;
+      write_data_t data;
+    };
+
+    vector<ResultSlot> _slots;
+    size_t _depth;
+    atomic<size_t> _head;            ///< number of slots written by the writer thread
+    atomic<size_t> _tail;            ///< number of slots filled by the simulation thread
+    atomic<bool> _producerWaiting;
+    atomic<bool> _consumerWaiting;
+    atomic<bool> _threadWorkDone;
+    mutex _handoffMutex;
+    condition_variable _notFull;
+    condition_variable _notEmpty;
+    write_data_t _container;
+    thread* _writerThread;
+
+    //statistics, only touched by the simulation thread
+    unsigned long _enqueued;
+    unsigned long _stalls;
+    double _stallTime;               ///< time in seconds the simulation waited for a free slot
+    unsigned long _occupancySum;
+    size_t _maxOccupancy;
 
   protected:
     void writeThread()
     {
-      std::cerr << "Parallel writer thread used" << std::endl;
-      while(!_threadWorkDone)
-        writeContainer();
-
-      while(!_writeContainers.empty())
-        writeContainer();
+      for (;;)
+      {
+        size_t head = _head.load();
+        if (head == _tail.load())
+        {
+          unique_lock<mutex> lock(_handoffMutex);
+          _consumerWaiting.store(true);
+          while (head == _tail.load() && !_threadWorkDone.load())
+            _notEmpty.wait(lock);
+          _consumerWaiting.store(false);
+          if (head == _tail.load())
+            return;
+        }
+
+        const write_data_t& container = _slots[head % _depth].data;
+        write(get<0>(container), get<1>(container));
+        _head.store(head + 1);
+
+        if (_producerWaiting.load())
+        {
+          unique_lock<mutex> lock(_handoffMutex);
+          _notFull.notify_one();
+        }
+      }
     }
 
-    void writeContainer()
+    /**
+     * Copy the values the pointers of src refer to into the slot buffer and let dst point to them.
+     */
+    template<typename T>
+    static void copyValues(const typename SimulationOutput<T>::values_t& src, boost::container::vector<T>& values,
+                           typename SimulationOutput<T>::values_t& dst)
     {
-      const write_data_t* container;
-
-      _writeContainerMutex.wait();
-      if (!_writeContainers.empty())
-        container = &_writeContainers.front();
-
-      _writeContainerMutex.post();
-
-      if (!container)
+      size_t n = src.size();
+      if (values.size() != n)
       {
-        usleep(5);
-        return;
+        values.resize(n);
+        dst.resize(n);
+        for (size_t i = 0; i < n; ++i)
+          dst[i] = &values[i];
       }
+      for (size_t i = 0; i < n; ++i)
+        values[i] = *src[i];
+    }
 
-      write(get<0>(*container),get<1>(*container));
-
-      _writeContainerMutex.wait();
-      _writeContainers.pop_front();
-      _writeContainerMutex.post();
+    /**
+     * Block until the writer thread has written at least head slots.
+     */
+    void waitForHead(size_t head)
+    {
+      unique_lock<mutex> lock(_handoffMutex);
+      _producerWaiting.store(true);
+      while (_head.load() < head)
+        _notFull.wait(lock);
+      _producerWaiting.store(false);
+    }
 
-      _freeContainerMutex.wait();
-      _freeContainers.push_back(*container);
-      _freeContainerMutex.post();
-      _nempty.post();
+    void waitForFreeSlot(size_t tail)
+    {
+#if defined(USE_CHRONO)
+      high_resolution_clock::time_point start = high_resolution_clock::now();
+      waitForHead(tail - _depth + 1);
+      _stallTime += duration_cast<duration<double> >(high_resolution_clock::now() - start).count();
+#else
+      boost::posix_time::ptime start = boost::posix_time::microsec_clock::universal_time();
+      waitForHead(tail - _depth + 1);
+      _stallTime += (boost::posix_time::microsec_clock::universal_time() - start).total_microseconds() * 1e-6;
+#endif
+      _stalls++;
     }
 
   public:
-    ParallelContainerManager() : Writer()
-      , _writeContainers()
-      ,_freeContainers()
-      ,_freeContainerMutex(1)
-      ,_writeContainerMutex(1)
-      ,_nempty(CONTAINER_COUNT)
-      ,_writerThread(&ParallelContainerManager::writeThread, this)
+    ParallelContainerManager(size_t depth = PARALLEL_OUTPUT_QUEUE_DEPTH) : Writer()
+      ,_slots(depth > 0 ? depth : 1)
+      ,_depth(depth > 0 ? depth : 1)
+      ,_head(0)
+      ,_tail(0)
+      ,_producerWaiting(false)
+      ,_consumerWaiting(false)
       ,_threadWorkDone(false)
+      ,_handoffMutex()
+      ,_notFull()
+      ,_notEmpty()
+      ,_container()
+      ,_writerThread(NULL)
+      ,_enqueued(0)
+      ,_stalls(0)
+      ,_stallTime(0.0)
+      ,_occupancySum(0)
+      ,_maxOccupancy(0)
     {
+      _writerThread = new thread(&ParallelContainerManager::writeThread, this);
     }
 
     virtual ~ParallelContainerManager()
     {
-      _threadWorkDone = true;
-      _writerThread.join();
+      stopWriterThread();
     }
 
-    virtual write_data_t& getFreeContainer()
+    /**
+     * Wait until the writer thread has passed all queued slots to the results policy.
+     */
+    void flushContainers()
     {
-      _nempty.wait();
-      _freeContainerMutex.wait();
+      waitForHead(_tail.load());
+    }
 
-       write_data_t& container = _freeContainers.front();
-      _freeContainers.pop_front();
-      _freeContainerMutex.post();
+    /**
+     * Write all queued slots and stop the writer thread. Has to be called while the results policy is still alive.
+     */
+    void stopWriterThread()
+    {
+      if (!_writerThread)
+        return;
+      {
+        unique_lock<mutex> lock(_handoffMutex);
+        _threadWorkDone.store(true);
+        _notEmpty.notify_one();
+      }
+      _writerThread->join();
+      delete _writerThread;
+      _writerThread = NULL;
+
+      if (_enqueued > 0)
+      {
+        LOGGER_WRITE("ParallelContainerManager: " + boost::lexical_cast<string>(_enqueued) + " output steps, queue depth "
+                     + boost::lexical_cast<string>(_depth) + ", average occupancy " + boost::lexical_cast<string>(getAverageQueueOccupancy())
+                     + ", max occupancy " + boost::lexical_cast<string>(_maxOccupancy) + ", " + boost::lexical_cast<string>(_stalls)
+                     + " stalls (" + boost::lexical_cast<string>(_stallTime) + " s)", LC_OUTPUT, LL_INFO);
+      }
+    }
 
-      return container;
-  };
+    size_t getQueueDepth() const { return _depth; }
+    unsigned long getProducerStalls() const { return _stalls; }
+    double getProducerStallTime() const { return _stallTime; }
+    size_t getMaxQueueOccupancy() const { return _maxOccupancy; }
+    double getAverageQueueOccupancy() const { return _enqueued > 0 ? double(_occupancySum) / _enqueued : 0.0; }
+
+    /**
+     * Get a scratch container. The values are copied into the ring by addContainerToWriteQueue.
+     */
+    virtual write_data_t& getFreeContainer()
+    {
+      return _container;
+    }
 
-  virtual void addContainerToWriteQueue(const write_data_t& container)
-  {
-    _writeContainers.push_back(container);
-  };
+    /**
+     * Copy the values of the given container into the next free slot and hand it to the writer thread.
+     * Blocks only if all slots are still waiting to be written.
+     */
+    virtual void addContainerToWriteQueue(const write_data_t& container)
+    {
+      size_t tail = _tail.load();
+      size_t occupancy = tail - _head.load();
+      if (occupancy >= _depth)
+      {
+        waitForFreeSlot(tail);
+        occupancy = tail - _head.load();
+      }
+      _occupancySum += occupancy;
+      if (occupancy + 1 > _maxOccupancy)
+        _maxOccupancy = occupancy + 1;
+      _enqueued++;
+
+      ResultSlot& slot = _slots[tail % _depth];
+      const all_vars_time_t& v_list = get<0>(container);
+      all_vars_time_t& values = get<0>(slot.data);
+      copyValues<double>(get<0>(v_list), slot.realValues, get<0>(values));
+      copyValues<int>(get<1>(v_list), slot.intValues, get<1>(values));
+      copyValues<bool>(get<2>(v_list), slot.boolValues, get<2>(values));
+      get<3>(values) = get<3>(v_list);
+      copyValues<double>(get<4>(v_list), slot.derValues, get<4>(values));
+      copyValues<double>(get<5>(v_list), slot.resValues, get<5>(values));
+      get<1>(slot.data) = get<1>(container);
+
+      _tail.store(tail + 1);
+
+      if (_consumerWaiting.load())
+      {
+        unique_lock<mutex> lock(_handoffMutex);
+        _notEmpty.notify_one();
+      }
+    }
 };
 /** @} */ // end of dataexchange
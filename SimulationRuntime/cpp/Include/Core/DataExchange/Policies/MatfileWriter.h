@@ -26,6 +26,109 @@ using std::ios;
 
 class MatFileWriter : public ContainerManager
 {
+ protected:
+    /// size in bytes of the row buffer, rows are written to the file in batches of this size
+    static const size_t MAT_WRITE_BUFFER_SIZE = 1 << 20;
+    /// minimum number of rows per batch, so wide rows still share one header update
+    static const unsigned int MIN_BUFFERED_ROWS = 16;
+    /// number of gather plans kept for alternating pointer sets
+    static const size_t MAX_GATHER_PLANS = 64;
+
+    /**
+     * A run of consecutive variables in memory that is copied to consecutive columns of an output row
+     */
+    template<typename T>
+    struct GatherSpan
+    {
+        const T* src;
+        unsigned int column;
+        unsigned int count;
+    };
+
+    /**
+     * Copy instructions for one output row, compiled from the pointer lists of the output variables
+     */
+    struct GatherPlan
+    {
+        vector<GatherSpan<double> > realSpans;
+        vector<GatherSpan<int> > intSpans;
+        vector<GatherSpan<bool> > boolSpans;
+        vector<unsigned int> negated;       ///< columns of negated real and int alias variables
+        vector<unsigned int> negatedBool;   ///< columns of negated boolean alias variables
+        unsigned int columns;
+        negate_values_t negReal;
+        negate_values_t negInt;
+        negate_values_t negBool;
+        real_vars_t realVars;               ///< pointer lists the plan was compiled from
+        int_vars_t intVars;
+        bool_vars_t boolVars;
+
+        GatherPlan() : columns(0) {}
+
+        /// one memcmp per list, a check against the spans mispredicts on every span boundary
+        template<typename T>
+        static bool samePointers(const boost::container::vector<const T*>& a, const boost::container::vector<const T*>& b)
+        {
+            return a.size() == b.size() && (a.empty() || memcmp(&a[0], &b[0], a.size() * sizeof(const T*)) == 0);
+        }
+
+        /// boost::container::vector<bool> stores plain bools, so the flags compare as one block
+        static bool sameFlags(const negate_values_t& a, const negate_values_t& b)
+        {
+            return a.size() == b.size() && (a.empty() || memcmp(&a[0], &b[0], a.size() * sizeof(bool)) == 0);
+        }
+
+        bool matches(const all_vars_time_t& v_list, const neg_all_vars_t& neg_v_list) const
+        {
+            return columns > 0
+                && samePointers(get<0>(v_list), realVars)
+                && samePointers(get<1>(v_list), intVars)
+                && samePointers(get<2>(v_list), boolVars)
+                && sameFlags(negReal, get<0>(neg_v_list)) && sameFlags(negInt, get<1>(neg_v_list))
+                && sameFlags(negBool, get<2>(neg_v_list));
+        }
+
+        template<typename T>
+        static void compileSpans(const boost::container::vector<const T*>& vars, const negate_values_t& neg, unsigned int column,
+                                 vector<GatherSpan<T> >& spans, vector<unsigned int>& negated)
+        {
+            spans.clear();
+            for (size_t i = 0; i < vars.size(); ++i, ++column)
+            {
+                if (!spans.empty() && spans.back().src + spans.back().count == vars[i])
+                    spans.back().count++;
+                else
+                {
+                    GatherSpan<T> span = {vars[i], column, 1};
+                    spans.push_back(span);
+                }
+                if (neg[i])
+                    negated.push_back(column);
+            }
+        }
+
+        void compile(const all_vars_time_t& v_list, const neg_all_vars_t& neg_v_list)
+        {
+            realVars = get<0>(v_list);
+            intVars = get<1>(v_list);
+            boolVars = get<2>(v_list);
+            negReal = get<0>(neg_v_list);
+            negInt = get<1>(neg_v_list);
+            negBool = get<2>(neg_v_list);
+            negated.clear();
+            negatedBool.clear();
+
+            // column 0 is the time
+            unsigned int column = 1;
+            compileSpans(realVars, negReal, column, realSpans, negated);
+            column += realVars.size();
+            compileSpans(intVars, negInt, column, intSpans, negated);
+            column += intVars.size();
+            compileSpans(boolVars, negBool, column, boolSpans, negatedBool);
+            columns = column + boolVars.size();
+        }
+    };
+
  public:
     MatFileWriter(unsigned long size, string file_name)
             : ContainerManager(),
@@ -33,6 +136,10 @@ class MatFileWriter : public ContainerManager
               _dataEofPos(),
               _curser_position(0),
               _uiValueCount(0),
+              _uiColumns(0),
+              _uiBufferedRows(0),
+              _uiBufferCapacity(0),
+              _uiLastPlan(0),
               _file_name(file_name),
               _doubleMatrixData1(NULL),
               _doubleMatrixData2(NULL),
@@ -44,6 +151,9 @@ class MatFileWriter : public ContainerManager
     }
     ~MatFileWriter()
     {
+        // write the buffered rows
+        flushRows();
+
         // free memory and initialize pointer
         delete[] _doubleMatrixData1;
         delete[] _doubleMatrixData2;
@@ -218,6 +328,93 @@ class MatFileWriter : public ContainerManager
         }
     }
 
+    /*=={function}===================================================================================*/
+    /*!
+     *  void flushRows()
+     *
+     *  brief:
+     *  ------
+     *  function updates the header of the "data_2" matrix and writes all buffered rows with one write
+     *
+     * \return
+     */
+    /*========================================================================================{end}==*/
+    void flushRows()
+    {
+        if (_uiBufferedRows == 0 || !_output_stream.is_open())
+            return;
+
+        _uiValueCount += _uiBufferedRows;
+        writeMatVer4MatrixHeader("data_2", _uiColumns, _uiValueCount, sizeof(double));
+        _output_stream.write((const char*) _doubleMatrixData2, sizeof(double) * _uiColumns * _uiBufferedRows);
+        _uiBufferedRows = 0;
+    }
+
+    /*=={function}===================================================================================*/
+    /*!
+     *  const GatherPlan& getGatherPlan(const all_vars_time_t& v_list,const neg_all_vars_t& neg_v_list)
+     *
+     *  brief:
+     *  ------
+     *  function returns the gather plan for the given output pointers. The plan is compiled once and
+     *  reused as long as the pointers and the negate flags do not change.
+     *
+     * \return
+     */
+    /*========================================================================================{end}==*/
+    const GatherPlan& getGatherPlan(const all_vars_time_t& v_list,const neg_all_vars_t& neg_v_list)
+    {
+        for (size_t i = 0; i < _gatherPlans.size(); ++i)
+        {
+            size_t index = (_uiLastPlan + i) % _gatherPlans.size();
+            if (_gatherPlans[index].matches(v_list, neg_v_list))
+            {
+                _uiLastPlan = index;
+                return _gatherPlans[index];
+            }
+        }
+
+        // the parallel container manager hands over one pointer set per ring slot, keep a plan for each of them
+        if (_gatherPlans.size() < MAX_GATHER_PLANS)
+        {
+            _gatherPlans.push_back(GatherPlan());
+            _uiLastPlan = _gatherPlans.size() - 1;
+        }
+        else
+            _uiLastPlan = (_uiLastPlan + 1) % MAX_GATHER_PLANS;
+
+        GatherPlan& plan = _gatherPlans[_uiLastPlan];
+        plan.compile(v_list, neg_v_list);
+
+        if (plan.columns != _uiColumns)
+        {
+            flushRows();
+            delete[] _doubleMatrixData2;
+            _uiColumns = plan.columns;
+            _uiBufferCapacity = max(MIN_BUFFERED_ROWS, (unsigned int)(MAT_WRITE_BUFFER_SIZE / (sizeof(double) * _uiColumns)));
+            _doubleMatrixData2 = new double[_uiBufferCapacity * _uiColumns];
+        }
+        return plan;
+    }
+
+    static inline void gatherSpans(const vector<GatherSpan<double> >& spans, double* row)
+    {
+        for (vector<GatherSpan<double> >::const_iterator it = spans.begin(); it != spans.end(); ++it)
+            memcpy(row + it->column, it->src, sizeof(double) * it->count);
+    }
+
+    template<typename T>
+    static inline void gatherSpans(const vector<GatherSpan<T> >& spans, double* row)
+    {
+        for (typename vector<GatherSpan<T> >::const_iterator it = spans.begin(); it != spans.end(); ++it)
+        {
+            const T* src = it->src;
+            double* dst = row + it->column;
+            for (unsigned int i = 0; i < it->count; ++i)
+                dst[i] = src[i];
+        }
+    }
+
     /*=={function}===================================================================================*/
     /*!
      *  void  init(std::string file_name)
@@ -240,7 +437,10 @@ class MatFileWriter : public ContainerManager
         _file_name = file_name;
 
         if (_output_stream.is_open())
+        {
+            flushRows();
             _output_stream.close();
+        }
 
         // open new file
         _output_stream.open(file_name.c_str(), ios::binary | ios::trunc);
@@ -256,14 +456,18 @@ class MatFileWriter : public ContainerManager
         _dataEofPos = 0;
 
         _doubleMatrixData1 = NULL;
-        _doubleMatrixData2 = NULL;
         _stringMatrix = NULL;
         _pacString = NULL;
         _intMatrix = NULL;
 
-        // allocate temp buffer for simulation data:
-        // dim_1 (number of variables) + dim_2 (number of der. variables) + 1 (time)
-        _doubleMatrixData2 = new double[dim + 1];
+        // the row buffer for simulation data is allocated with the first gather plan
+        delete[] _doubleMatrixData2;
+        _doubleMatrixData2 = NULL;
+        _uiColumns = 0;
+        _uiBufferedRows = 0;
+        _uiBufferCapacity = 0;
+        _gatherPlans.clear();
+        _uiLastPlan = 0;
     }
 
     /*=={function}===================================================================================*/
@@ -703,55 +907,25 @@ class MatFileWriter : public ContainerManager
     /*========================================================================================{end}==*/
     virtual void write(const all_vars_time_t& v_list,const neg_all_vars_t& neg_v_list)
     {
-        unsigned int uiVarCount = get<0>(v_list).size() + get<1>(v_list).size() + get<2>(v_list).size() + 1;  // alle Variablen, alle abgeleiteten Variablen und die Zeit
-        double *doubleHelpMatrix = NULL;
+        const GatherPlan& plan = getGatherPlan(v_list, neg_v_list);
 
-        _uiValueCount++;
+        if (_uiBufferedRows == _uiBufferCapacity)
+            flushRows();
 
-        // reset tempbuffer to zero
-        memset(_doubleMatrixData2, 0, sizeof(double) * uiVarCount);
-        doubleHelpMatrix = _doubleMatrixData2;
+        // time, followed by real, int and bool variable values
+        double *row = _doubleMatrixData2 + _uiBufferedRows * plan.columns;
+        *row = get<3>(v_list);
+        gatherSpans(plan.realSpans, row);
+        gatherSpans(plan.intSpans, row);
+        gatherSpans(plan.boolSpans, row);
 
-        // first time ist written to "data_2" matrix...
-        *doubleHelpMatrix = get<3>(v_list);
-        doubleHelpMatrix++;
-
-        // ...followed by real variable values...
-        /*for (real_vars_t::const_iterator it = get<0>(v_list).begin(); it != get<0>(v_list).end(); ++it)
-        {
-            *doubleHelpMatrix = *(*it);
-            doubleHelpMatrix++;
-        }*/
+        // negated alias variables
+        for (vector<unsigned int>::const_iterator it = plan.negated.begin(); it != plan.negated.end(); ++it)
+            row[*it] = -row[*it];
+        for (vector<unsigned int>::const_iterator it = plan.negatedBool.begin(); it != plan.negatedBool.end(); ++it)
+            row[*it] = 1.0 - row[*it];
 
-        std::transform(get<0>(v_list).begin(), get<0>(v_list).end(), get<0>(neg_v_list).begin(),
-            doubleHelpMatrix, WriteOutputVar<double>());
-
-
-        // ...followed by int variable values.
-        /*for (int_vars_t::const_iterator it = get<1>(v_list).begin(); it != get<1>(v_list).end(); ++it)
-        {
-            *doubleHelpMatrix = *(*it);
-            doubleHelpMatrix++;
-        }*/
-            size_t nReal = get<0>(v_list).size();
-        std::transform(get<1>(v_list).begin(), get<1>(v_list).end(), get<1>(neg_v_list).begin(),
-            doubleHelpMatrix + nReal, WriteOutputVar<int>());
-        // ...followed by bool variable values.
-        /*for (bool_vars_t::const_iterator it = get<2>(v_list).begin(); it != get<2>(v_list).end(); ++it)
-        {
-            *doubleHelpMatrix = *(*it);
-            doubleHelpMatrix++;
-        }
-        */
-             size_t nInt = get<1>(v_list).size();
-        std::transform(get<2>(v_list).begin(), get<2>(v_list).end(), get<2>(neg_v_list).begin(),
-            doubleHelpMatrix+nReal+nInt, WriteOutputVar<bool>());
-
-        // write matrix to file
-        writeMatVer4Matrix("data_2", uiVarCount, _uiValueCount, _doubleMatrixData2, sizeof(double));
-
-        // initialize pointer
-        doubleHelpMatrix = NULL;
+        _uiBufferedRows++;
     }
 
     /*=================================================================================*/
@@ -807,6 +981,11 @@ class MatFileWriter : public ContainerManager
     std::ofstream::pos_type _dataEofPos;
     unsigned int _curser_position;
     unsigned int _uiValueCount;
+    unsigned int _uiColumns;              ///< number of columns of an output row (time and all variables)
+    unsigned int _uiBufferedRows;         ///< number of rows in _doubleMatrixData2 not yet written to file
+    unsigned int _uiBufferCapacity;       ///< number of rows that fit into _doubleMatrixData2
+    size_t _uiLastPlan;
+    vector<GatherPlan> _gatherPlans;
     std::string _file_name;
     double *_doubleMatrixData1;
     double *_doubleMatrixData2;
@@ -38,14 +38,39 @@ struct BOOST_EXTENSION_EXPORT_DECL sparse_inserter  {
 
 };
 
+/**
+ * Square sparse matrix in compressed sparse column format (0-based) that keeps
+ * its UMFPACK factorization between solves. The symbolic analysis is reused as
+ * long as the sparsity pattern does not change; new values only cause a
+ * numeric refactorization at the next solve.
+ */
 struct BOOST_EXTENSION_EXPORT_DECL sparse_matrix {
     std::vector<int> Ap;
     std::vector<int> Ai;
     std::vector<double> Ax;
     int n;
-    sparse_matrix(int n=-1): n(n) {}
+    sparse_matrix(int n=-1);
+    sparse_matrix(const sparse_matrix& other);
+    sparse_matrix& operator=(const sparse_matrix& other);
+    ~sparse_matrix();
 
+    /// Takes pattern and values from the inserter
     void build(sparse_inserter& ins);
-    int solve(const double* b,double* x);
-};
+    /// Takes pattern and values from compressed column arrays, the symbolic analysis is kept if the pattern is unchanged
+    void assign(int n, const int* Ap, const int* Ai, const double* Ax);
+    /// Position of element (i,j) in Ax, -1 if it is not part of the pattern
+    int index(int i, int j) const;
+    /// Overwrites element (i,j), which has to be part of the pattern
+    void setValue(int i, int j, double value);
+    /// Factorizes the matrix if its values changed since the last factorization
+    int factorize();
+    /// Solves A*x=b for nrhs right hand sides stored one after the other
+    int solve(const double* b, double* x, int nrhs=1);
+
+private:
+    void freeFactorization(bool symbolic);
 
+    void* _symbolic;
+    void* _numeric;
+    bool _valuesChanged;
+};
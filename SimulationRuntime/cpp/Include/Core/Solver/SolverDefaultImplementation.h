@@ -87,7 +87,9 @@ protected:
     _accStps,                 ///< Number of accepted time integration steps
     _rejStps,                 ///< Number of rejected time integration steps
     _zeroStps,                ///< Number of zero search steps during whole time integration interval
-    _zeros;                   ///< Number of zeros in whole time integration interval
+    _zeros,                   ///< Number of zeros in whole time integration interval
+    _jacEvals,                ///< Number of Jacobian evaluations of implicit methods
+    _factorizations;          ///< Number of (re-)factorizations of the iteration matrix of implicit methods
 
   int
     _dimSys,                  ///< Number of equations (=dimension of the system)
@@ -5,6 +5,9 @@
  */
 #include "FactoryExport.h"
 #include <Core/Solver/SolverDefaultImplementation.h>
+#if defined(klu)
+  #include <klu.h>
+#endif
 
 class IEulerSettings;
 
@@ -140,6 +143,18 @@ private:
     /// Berechnung der Jacobimatrix
     void calcJac(double* yHelp, double* _fHelp, const double* _f, double* jac, const bool& flag);
 
+    /// Evaluates the Jacobian at (_tCurrent,_z), f has to be the right hand side at this point
+    void updateJacobian(double* yHelp, double* fHelp, const double* f);
+
+    /// Builds the iteration matrix T = E - hCoef*J and factorizes it (dgetrf or KLU)
+    void factorizeIterationMatrix(const double& hCoef);
+
+    /// Solves T*x = rhs with the stored factors, rhs is overwritten by x
+    void solveIterationMatrix(double* rhs);
+
+    /// Simplified Newton iteration for Z = hCoef*f(tNew,_z+Z) + rhsConst, reuses the factors of the iteration matrix; f0 = f(_tCurrent,_z)
+    bool solveStage(const double& tNew, const double& hCoef, const double* rhsConst, const double& tol, double& nu_old, double* Z, const double* f0, double* fHelp);
+
 
     // Member variables
     //---------------------------------------------------------------
@@ -186,6 +201,42 @@ private:
     int
         *_zeroSignIter;                                ///< Temp            - Temporary zeroSign Vector
 
+    // Simplified Newton iteration of the implicit methods
+    double
+        *_jac,                                      ///< Temp            - Jacobian (column major)
+        *_iterMat,                                  ///< Temp            - LU factors of the iteration matrix E - hCoef*J
+        *_deltaZ,                                   ///< Temp            - Newton correction
+        *_yHelp,
+        _iterMatHCoef;                              ///< Temp            - hCoef of the factorized iteration matrix
+
+    long int
+        *_pivot;                                    ///< Temp            - Pivots of the LU factorization
+
+    bool
+        _jacValid,                                  ///< Temp            - Jacobian may be reused
+        _jacCurrent,                                ///< Temp            - Jacobian was evaluated in the current step
+        _iterMatValid,                              ///< Temp            - Factors of the iteration matrix may be reused
+        _sparseJac;                                 ///< Temp            - Jacobian is provided by the system as sparse matrix
+
+#if defined(klu)
+    std::vector<int>
+        _sparseAp,                                  ///< Temp            - Column pointers of the sparse iteration matrix (pattern of J and the diagonal)
+        _sparseAi,                                  ///< Temp            - Row indices of the sparse iteration matrix
+        _sparseDiag;                                ///< Temp            - Position of the diagonal elements in _sparseAi
+    std::vector<double>
+        _sparseJacValues,                           ///< Temp            - Values of the Jacobian in the pattern of the iteration matrix
+        _sparseIterMat;                             ///< Temp            - Values of the iteration matrix
+    klu_common
+        _kluCommon;
+    klu_symbolic
+        *_kluSymbolic;                              ///< Temp            - Symbolic analysis, kept as long as the pattern does not change
+    klu_numeric
+        *_kluNumeric;                               ///< Temp            - LU factors of the sparse iteration matrix
+
+    /// Frees the KLU factors and the symbolic analysis
+    void freeSparseFactors();
+#endif
+
     ISystemProperties* _properties;
     IContinuous* _continuous_system;
     IEvent* _event_system;
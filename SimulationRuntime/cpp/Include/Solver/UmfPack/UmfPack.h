@@ -6,6 +6,7 @@
 #include <Core/Solver/ILinearAlgLoopSolver.h>        // Export function from dll
 #include <Core/Solver/ILinSolverSettings.h>
 #include <Solver/UmfPack/UmfPackSettings.h>
+#include <Core/Math/SparseMatrix.h>
 
 
 class UmfPack : public ILinearAlgLoopSolver,  public AlgLoopSolverDefaultImplementation
@@ -43,4 +44,5 @@ private:
            *_x_old,
            *_x_new;
     bool _firstuse;
+    sparse_matrix _sparseA;   ///< keeps the symbolic analysis and factorization of the sparse system matrix
 };
@@ -9,6 +9,12 @@
 #include <Solver/Euler/Euler.h>
 #include <Solver/Euler/EulerSettings.h>
 #include <Core/Math/ILapack.h>
+#include <Core/Utils/extension/logger.hpp>
+
+/// Contraction rate above which the Jacobian is re-evaluated for the next step
+static const double THETA_JAC = 0.5;
+/// Contraction rate above which the simplified Newton iteration is considered divergent
+static const double THETA_MAX = 0.99;
 
 
 
@@ -38,7 +44,24 @@ Euler::Euler(IMixedSystem* system, ISolverSettings* settings)
     ,_zeroTol            (1e-8)
     ,_outputStp(1)
     ,_tZero(-1)
+    ,_jac(NULL)
+    ,_iterMat(NULL)
+    ,_deltaZ(NULL)
+    ,_yHelp(NULL)
+    ,_iterMatHCoef(0.0)
+    ,_pivot(NULL)
+    ,_jacValid(false)
+    ,_jacCurrent(false)
+    ,_iterMatValid(false)
+    ,_sparseJac(false)
+#if defined(klu)
+    ,_kluSymbolic(NULL)
+    ,_kluNumeric(NULL)
+#endif
 {
+#if defined(klu)
+    klu_defaults(&_kluCommon);
+#endif
 }
 
 Euler::~Euler()
@@ -57,7 +80,30 @@ Euler::~Euler()
         delete [] _f0;
     if(_f1)
         delete [] _f1;
+    if(_jac)
+        delete [] _jac;
+    if(_iterMat)
+        delete [] _iterMat;
+    if(_deltaZ)
+        delete [] _deltaZ;
+    if(_yHelp)
+        delete [] _yHelp;
+    if(_pivot)
+        delete [] _pivot;
+#if defined(klu)
+    freeSparseFactors();
+#endif
+}
+
+#if defined(klu)
+void Euler::freeSparseFactors()
+{
+    if(_kluNumeric)
+        klu_free_numeric(&_kluNumeric, &_kluCommon);
+    if(_kluSymbolic)
+        klu_free_symbolic(&_kluSymbolic, &_kluCommon);
 }
+#endif
 
 bool Euler::stateSelection()
  {
@@ -116,6 +162,31 @@ void Euler::initialize()
         memset(_z0,0,sizeof(double));
         memset(_z1,0,sizeof(double));
 
+        // Iterationsmatrix und Faktorisierung für die impliziten Verfahren
+        if(_jac)       delete [] _jac;
+        if(_iterMat)   delete [] _iterMat;
+        if(_deltaZ)    delete [] _deltaZ;
+        if(_yHelp)     delete [] _yHelp;
+        if(_pivot)     delete [] _pivot;
+
+        _sparseJac = false;
+#if defined(klu)
+        freeSparseFactors();
+        _sparseAp.clear();
+        _sparseAi.clear();
+        _sparseJac = _mixed_system->isJacobianSparse() && _mixed_system->isAnalyticJacobianGenerated();
+#endif
+        bool denseIterMat = !_sparseJac && _eulerSettings->getEulerMethod() != IEulerSettings::EULERFORWARD;
+        _jac = denseIterMat ? new double[_dimSys*_dimSys] : NULL;
+        _iterMat = denseIterMat ? new double[_dimSys*_dimSys] : NULL;
+        _deltaZ = new double[_dimSys];
+        _yHelp = new double[_dimSys];
+        _pivot = new long int[_dimSys];
+        memset(_pivot,0,_dimSys*sizeof(long int));
+        _jacValid = false;
+        _jacCurrent = false;
+        _iterMatValid = false;
+
         // Counter initialisieren
         _outputStps    = 0;
 
@@ -330,29 +401,15 @@ void Euler::doEulerForward()
 
 void Euler::doEulerBackward()
 {
-    int         numberOfIterations = 0;
     double      tHelp;
-    double      nu,
-        theta;
     double        nu_old = 1e6;
-    long int    dimRHS = 1;                            // Dimension der rechten Seite zur Lösung LGS
 
     double
         *Z        = new double[_dimSys],                // Steigung (1. Stufe)
-        *deltaZ    = new double[_dimSys],                // Hilfsvariable
-        *LSErhs    = new double[_dimSys],                // Hilfsvariale y-Wert
-        *T        = new double[_dimSys*_dimSys],            // Iterationsmatrix
-        *jac    = new double[_dimSys*_dimSys],        // Jacobimatrix
-        *yHelp    = new double[_dimSys],
         *fHelp  = new double[_dimSys];
 
-  long int *pHelp    = new long int[_dimSys];                // Hilfsvariale Pivotisierun
-    memset(pHelp,0,_dimSys*sizeof(long int));
-
     while(  _idid == 0 && _solverStatus != USER_STOP )
     {
-
-        nu = 1e12;
         // Letzten Schritt ggf. anpassen
         if((_tCurrent + _h) > _tEnd)
             _h = (_tEnd - _tCurrent);
@@ -360,97 +417,20 @@ void Euler::doEulerBackward()
         // neue Stelle
         tHelp = _tCurrent + _h;
 
-        // Startwerte setzten
-        memset(Z,0,_dimSys*sizeof(double));
-        for (int i=0;i<_dimSys;i++)
-            deltaZ[i] = 1e15;
-
-
         // alten Zustandsvektor zwischenspeichren
         //if (_eulerSettings-> getDenseOutput())
         memcpy(_z0,_z,(int)_dimSys*sizeof(double));
 
         calcFunction(_tCurrent,_z,_f0);
-        // Jacobimatrix aufstellen
-        if(numberOfIterations == 0)
-            calcJac(yHelp,fHelp,_f0,jac,false);
-        else
-        {
-            /*ToDo
-            if(_eulerSettings->iJacUpdate == 0 )
-            {*/
-            if(numberOfIterations == 1)
-                calcJac(yHelp,fHelp,_f0,jac,false);
-            /*Todo
-            }
-
-            else if(_accStps % _eulerSettings->iJacUpdate == 0)
-            calcJac(yHelp,fHelp,_f0,jac,false);
-            }
-            */
-        }
-        //Iterationsmatrix aufstellen
-        for(int j=0; j<_dimSys; ++j)
-        {
-            for(int i=0; i<_dimSys; ++i)
-            {
-                if (i==j)
-                    T[i+j*_dimSys] = 1-_h*jac[i+j*_dimSys];
-                else
-                    T[i+j*_dimSys] = -_h*jac[i+j*_dimSys];
-            }
-        }
-
-        // Iteration
-        numberOfIterations = 0;
-        while ( nu*euclidNorm(_dimSys,deltaZ) > _eulerSettings->getIterTol()*1e-3 && _idid == 0)
-        {
-
-            for (int i=0;i<_dimSys;i++)
-                yHelp[i] = _z[i] + Z[i];
-
-            calcFunction(tHelp, yHelp, fHelp);
-            // Rechte Seite des LGS (k_diff)
-            for(int i=0; i<_dimSys; ++i)
-                LSErhs[i] =-Z[i] + _h*fHelp[i];
-
-            // Löse das LGS (delta_Z wird in LSErhs geschrieben)
-             dgesv_(&_dimSys,&dimRHS,T,&_dimSys,pHelp,LSErhs,&_dimSys,&_idid);
-
-            // Konvergenzcheck
-            if (numberOfIterations > 0)
-            {
-                theta = euclidNorm(_dimSys,LSErhs)/euclidNorm(_dimSys,deltaZ);
-                nu = theta/(1-theta);
-            }
-            else
-            {
-                nu = max(nu_old,UROUND);
-            }
-
-            // Neue Iterierte
-            for(int i=0; i<_dimSys; ++i)
-            {
-                Z[i] +=  LSErhs[i];
-            }
-
-            memcpy(deltaZ,LSErhs,_dimSys*sizeof(double));
-
 
-            ++ numberOfIterations;
-
-
-            if (numberOfIterations > 100 )
-                _idid = -5000;
-        }
+        // Vereinfachte Newton-Iteration, Jacobi- und Iterationsmatrix werden über Schritte hinweg wiederverwendet
+        solveStage(tHelp,_h,NULL,_eulerSettings->getIterTol()*1e-3,nu_old,Z,_f0,fHelp);
 
         if (_idid < 0/*ToDo && _eulerSettings->bContinue*/)
         {
             _idid = 0;
         }
 
-        nu_old = nu;
-
 
         // Berechnung des neuen y
         for(int i = 0; i < _dimSys; ++i)
@@ -502,6 +482,8 @@ void Euler::doEulerBackward()
              _event_system->getZeroFunc(_zeroVal);
             _zeroStatus = ISolver::EQUAL_ZERO;
 
+            // das System kann sich durch das Event geändert haben
+            _jacValid = false;
         }
 
 
@@ -521,40 +503,21 @@ void Euler::doEulerBackward()
 
 
     delete [] Z;
-    delete [] deltaZ;
-    delete [] LSErhs;
-    delete [] pHelp;
-    delete [] T;
-    delete [] jac;
     delete [] fHelp;
-
-    delete [] yHelp;
 }
 
 void Euler::doMidpoint()
 {
-    int         numberOfIterations;
     double      tHelp,
-        nu,
-        theta,
         nu_old = 1e6,
         C = 1.5;
-    long int    dimRHS    = 1;                                // Dimension rechte Seite zur Lösung LGS
 
     double
-        *jac    = new double[_dimSys*_dimSys],        // Jacobimatrix
-        *T        = new double[_dimSys*_dimSys],            // Iterationsmatrix
-        *yHelp    = new double[_dimSys],                    // Hilfsvariable für y
         *Z        = new double[_dimSys],                    // Hilfsvariable für Stufe
-        *deltaZ    = new double[_dimSys],                    // Hilfsvariable für Stufe
         *f0        = new double[_dimSys],
-        *LSErhs    = new double[_dimSys],
+        *rhsConst  = new double[_dimSys],                   // konstanter Anteil der Stufengleichung
         *fHelp    = new double[_dimSys];                    // Hilfsvariable für rechte Seite
 
-    long int  *pHelp    = new long int[_dimSys];                // Hilfsvariale Pivotisierun
-    // Rechte Seite
-    double* k1 = new double[_dimSys];
-
     while( _idid == 0)
     {
         // Letzten Schritt ggf. anpassen
@@ -564,9 +527,6 @@ void Euler::doMidpoint()
         // neue Stelle
         tHelp = _tCurrent + _h;
 
-        // Counter initialisieren
-        numberOfIterations = 0;
-
 
         // alten Zustandsvektor für Dense-Output zwischenspeichern
         memcpy(_z0,_z,(int)_dimSys*sizeof(double));
@@ -576,77 +536,21 @@ void Euler::doMidpoint()
         // Newton-Iteration
         if(_eulerSettings->getUseNewtonIteration())
         {
-
-            nu = 1e12;
             // Initiale rechte Seite in k-Vektor schreiben
             calcFunction(_tCurrent,_z,f0);
 
-            // Startwerte
-            memset(Z,0,_dimSys*sizeof(double));
-            for (int i=0;i<_dimSys;i++)
-                deltaZ[i] = 1e15;
-
-            // Jacobimatrix
-            calcJac(yHelp,fHelp,f0,jac,true);
-            // T = (E-hAJ)
-            for(int j=0; j<_dimSys; ++j)
-                for(int i=0; i<_dimSys; ++i)
-                    if(i==j)
-                        T[i+j*_dimSys] = 1.0 - C/(C+1)*_h*jac[i+j*_dimSys];
-                    else
-                        T[i+j*_dimSys] = - C/(C+1)*_h*jac[i+j*_dimSys];
-
-
-            // Iteration
-            while ( nu*euclidNorm(_dimSys,deltaZ) > _eulerSettings->getIterTol() && _idid == 0)
-            {
-                for (int i=0;i<_dimSys;i++)
-                    yHelp[i] = _z[i] + Z[i];
-
-                calcFunction(tHelp, yHelp, fHelp);
-
-                // Rechte Seite des LGS (k_diff)
-                for(int i=0; i<_dimSys; ++i)
-                    LSErhs[i] =-Z[i] + C/(C+1)*_h*fHelp[i] + (1-C/(C+1))*_h*f0[i] ;
-
-                // Löse das LGS (delta_Z wird in LSErhs geschrieben)
-                dgesv_(&_dimSys,&dimRHS,T,&_dimSys,pHelp,LSErhs,&_dimSys,&_idid);
-
-                // Konvergenzcheck
-                if (numberOfIterations > 0)
-                {
-                    theta = euclidNorm(_dimSys,LSErhs)/euclidNorm(_dimSys,deltaZ);
-                    nu = theta/(1-theta);
-                }
-                else
-                {
-                    nu = std::max(nu_old,UROUND);
-                }
-
-                // Neue Iterierte
-                for(int i=0; i<_dimSys; ++i)
-                {
-                    Z[i] +=  LSErhs[i];
-                }
-
-                memcpy(deltaZ,LSErhs,_dimSys*sizeof(double));
-
-
-                ++ numberOfIterations;
-
-
-                if (numberOfIterations > 100 )
-                    _idid = -5000;
-            }
+            for(int i=0; i<_dimSys; ++i)
+                rhsConst[i] = (1-C/(C+1))*_h*f0[i];
 
-            nu_old = nu;
+            // Vereinfachte Newton-Iteration mit T = (E-hAJ), die Faktorisierung wird über Schritte hinweg wiederverwendet
+            solveStage(tHelp,C/(C+1)*_h,rhsConst,_eulerSettings->getIterTol(),nu_old,Z,f0,fHelp);
 
 
             // Berechnung des neuen y
             for (int i=0;i<_dimSys;i++)
-                yHelp[i] = _z[i] + Z[i];
+                _yHelp[i] = _z[i] + Z[i];
 
-            calcFunction(tHelp, yHelp, fHelp);
+            calcFunction(tHelp, _yHelp, fHelp);
 
             for(int i = 0; i < _dimSys; ++i)
             {
@@ -695,6 +599,8 @@ void Euler::doMidpoint()
             _mixed_system->handleSystemEvents(_events/*,boost::ref(update_event)*/);
              _event_system->getZeroFunc(_zeroVal);
 
+            // das System kann sich durch das Event geändert haben
+            _jacValid = false;
         }
 
 
@@ -708,15 +614,230 @@ void Euler::doMidpoint()
         _tCurrent += _h;
 
     }
-    delete    [] jac;
-    delete    [] T;
-    delete    [] yHelp;
     delete    [] Z;
-    delete    [] deltaZ;
     delete    [] fHelp;
     delete    [] f0;
-    delete    [] LSErhs;
-    delete    [] pHelp;
+    delete    [] rhsConst;
+}
+
+bool Euler::solveStage(const double& tNew, const double& hCoef, const double* rhsConst, const double& tol, double& nu_old, double* Z, const double* f0, double* fHelp)
+{
+    int     numberOfIterations = 0;
+    double  nu = 1e12,
+        theta = 0.0,
+        normDelta,
+        normDeltaOld = 0.0;
+
+    // Jacobimatrix nur neu aufstellen, wenn die alte nicht mehr konvergiert
+    _jacCurrent = false;
+    if(!_jacValid)
+        updateJacobian(_yHelp,fHelp,f0);
+
+    // Iterationsmatrix nur bei geänderter Schrittweite oder neuer Jacobimatrix faktorisieren
+    if(!_iterMatValid || hCoef != _iterMatHCoef)
+        factorizeIterationMatrix(hCoef);
+
+    memset(Z,0,_dimSys*sizeof(double));
+    while(_idid == 0)
+    {
+        for (int i=0;i<_dimSys;i++)
+            _yHelp[i] = _z[i] + Z[i];
+
+        calcFunction(tNew, _yHelp, fHelp);
+
+        // Rechte Seite des LGS (k_diff)
+        for(int i=0; i<_dimSys; ++i)
+            _deltaZ[i] = -Z[i] + hCoef*fHelp[i] + (rhsConst ? rhsConst[i] : 0.0);
+
+        // Löse das LGS mit den gespeicherten Faktoren (delta_Z wird in _deltaZ geschrieben)
+        solveIterationMatrix(_deltaZ);
+        normDelta = euclidNorm(_dimSys,_deltaZ);
+
+        // Konvergenzcheck
+        if (numberOfIterations > 0)
+        {
+            theta = normDelta/normDeltaOld;
+            if (theta >= THETA_MAX)
+            {
+                if (!_jacCurrent)
+                {
+                    // Divergenz mit alter Jacobimatrix: neu aufstellen und Iteration neu starten
+                    updateJacobian(_yHelp,fHelp,f0);
+                    factorizeIterationMatrix(hCoef);
+                    memset(Z,0,_dimSys*sizeof(double));
+                    numberOfIterations = 0;
+                    continue;
+                }
+                _idid = -5000;
+                break;
+            }
+            nu = theta/(1-theta);
+        }
+        else
+        {
+            nu = std::max(nu_old,UROUND);
+        }
+
+        // Neue Iterierte
+        for(int i=0; i<_dimSys; ++i)
+            Z[i] += _deltaZ[i];
+
+        normDeltaOld = normDelta;
+        ++ numberOfIterations;
+
+        if (nu*normDelta <= tol)
+            break;
+
+        if (numberOfIterations > 100 )
+            _idid = -5000;
+    }
+
+    nu_old = nu;
+
+    // langsame Konvergenz: neue Jacobimatrix im nächsten Schritt
+    if (_idid != 0 || theta > THETA_JAC)
+        _jacValid = false;
+
+    return _idid == 0;
+}
+
+void Euler::updateJacobian(double* yHelp, double* fHelp, const double* f)
+{
+#if defined(klu)
+    if(_sparseJac)
+    {
+        // der Systemzustand ist nach der Auswertung von f noch (_tCurrent,_z)
+        calcFunction(_tCurrent,_z,fHelp);
+        sparsematrix_t& A = _mixed_system->getSparseJacobian();
+        A.complete_index1_data();
+        const int* colPtr = &A.index1_data()[0];
+        const int* rowIdx = &A.index2_data()[0];
+        const double* values = &A.value_data()[0];
+
+        // Muster der Iterationsmatrix: Muster von J und die Diagonale
+        std::vector<int> Tp(_dimSys+1), Ti;
+        Ti.reserve(colPtr[_dimSys]+_dimSys);
+        _sparseJacValues.clear();
+        _sparseJacValues.reserve(colPtr[_dimSys]+_dimSys);
+        _sparseDiag.resize(_dimSys);
+        for(int j=0; j<_dimSys; ++j)
+        {
+            bool diag = false;
+            Tp[j] = Ti.size();
+            for(int k=colPtr[j]; k<colPtr[j+1]; ++k)
+            {
+                if(!diag && rowIdx[k] >= j)
+                {
+                    _sparseDiag[j] = Ti.size();
+                    diag = true;
+                    if(rowIdx[k] > j)
+                    {
+                        Ti.push_back(j);
+                        _sparseJacValues.push_back(0.0);
+                    }
+                }
+                Ti.push_back(rowIdx[k]);
+                _sparseJacValues.push_back(values[k]);
+            }
+            if(!diag)
+            {
+                _sparseDiag[j] = Ti.size();
+                Ti.push_back(j);
+                _sparseJacValues.push_back(0.0);
+            }
+        }
+        Tp[_dimSys] = Ti.size();
+
+        // die symbolische Analyse von KLU bleibt gültig, solange sich das Muster nicht ändert
+        if(Tp != _sparseAp || Ti != _sparseAi)
+        {
+            freeSparseFactors();
+            _sparseAp.swap(Tp);
+            _sparseAi.swap(Ti);
+            _sparseIterMat.resize(_sparseAi.size());
+        }
+    }
+    else
+#endif
+        calcJac(yHelp,fHelp,f,_jac,false);
+
+    ++_jacEvals;
+    _jacValid = true;
+    _jacCurrent = true;
+    _iterMatValid = false;
+}
+
+void Euler::factorizeIterationMatrix(const double& hCoef)
+{
+#if defined(klu)
+    if(_sparseJac)
+    {
+        for(size_t k=0; k<_sparseIterMat.size(); ++k)
+            _sparseIterMat[k] = -hCoef*_sparseJacValues[k];
+        for(int j=0; j<_dimSys; ++j)
+            _sparseIterMat[_sparseDiag[j]] += 1.0;
+
+        int* Ap = &_sparseAp[0];
+        int* Ai = &_sparseAi[0];
+        double* Ax = &_sparseIterMat[0];
+        if(!_kluSymbolic)
+            _kluSymbolic = klu_analyze(_dimSys, Ap, Ai, &_kluCommon);
+        if(!_kluSymbolic)
+        {
+            _idid = -5001;
+        }
+        else
+        {
+            // Pivotfolge der letzten Faktorisierung wiederverwenden, solange das Pivotwachstum klein bleibt
+            bool refactored = _kluNumeric
+                && klu_refactor(Ap, Ai, Ax, _kluSymbolic, _kluNumeric, &_kluCommon) == 1
+                && klu_rgrowth(Ap, Ai, Ax, _kluSymbolic, _kluNumeric, &_kluCommon) == 1
+                && _kluCommon.rgrowth >= 1e-3;
+            if(!refactored)
+            {
+                if(_kluNumeric)
+                    klu_free_numeric(&_kluNumeric, &_kluCommon);
+                _kluNumeric = klu_factor(Ap, Ai, Ax, _kluSymbolic, &_kluCommon);
+                if(!_kluNumeric)
+                    _idid = -5001;
+            }
+        }
+    }
+    else
+#endif
+    {
+        //Iterationsmatrix aufstellen
+        for(int j=0; j<_dimSys; ++j)
+        {
+            for(int i=0; i<_dimSys; ++i)
+            {
+                if (i==j)
+                    _iterMat[i+j*_dimSys] = 1-hCoef*_jac[i+j*_dimSys];
+                else
+                    _iterMat[i+j*_dimSys] = -hCoef*_jac[i+j*_dimSys];
+            }
+        }
+        dgetrf_(&_dimSys,&_dimSys,_iterMat,&_dimSys,_pivot,&_idid);
+    }
+
+    ++_factorizations;
+    _iterMatHCoef = hCoef;
+    _iterMatValid = (_idid == 0);
+}
+
+void Euler::solveIterationMatrix(double* rhs)
+{
+#if defined(klu)
+    if(_sparseJac)
+    {
+        if(klu_solve(_kluSymbolic, _kluNumeric, _dimSys, 1, rhs, &_kluCommon) != 1)
+            _idid = -5001;
+        return;
+    }
+#endif
+    char trans = 'N';
+    long int dimRHS = 1, info = 0;                      // Dimension der rechten Seite zur Lösung LGS
+    dgetrs_(&trans,&_dimSys,&dimRHS,_iterMat,&_dimSys,_pivot,rhs,&_dimSys,&info);
 }
 
 
@@ -1215,6 +1336,13 @@ void Euler::interp1(double time, double *value)
 
 void Euler::writeSimulationInfo()
 {
+    LOGGER_WRITE("Euler: number steps = " + to_string(_totStps), LC_SOLVER, LL_INFO);
+    if(_eulerSettings->getEulerMethod() != IEulerSettings::EULERFORWARD)
+    {
+        LOGGER_WRITE("Euler: Jacobian evaluations = " + to_string(_jacEvals), LC_SOLVER, LL_INFO);
+        LOGGER_WRITE("Euler: iteration matrix factorizations = " + to_string(_factorizations), LC_SOLVER, LL_INFO);
+    }
+
     //// Solver
     //outputStream
     //    << "Solver:                       Euler\n"
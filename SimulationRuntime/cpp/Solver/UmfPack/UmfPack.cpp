@@ -124,35 +124,20 @@ void UmfPack::solve()
 
 
          int status;
-        // get the default control parameters
-		umf::control_type<> Control;
-		// change the default print level
-		Control [UMFPACK_PRL] = 6;
 
 		 _algLoop->evaluate();
         _algLoop->getb(_rhs);
          long int dimSys = _algLoop->getDimReal();
-        const sparsematrix_t& A = _algLoop->getSparseAMatrix();
-
-        adaptor_t rhs_adaptor(dimSys,_rhs);
-		shared_vector_t b(dimSys,rhs_adaptor);
-
-        adaptor_t x_adaptor(dimSys,_x);
-		shared_vector_t x(dimSys,x_adaptor);
-
-
-        umf::symbolic_type<double> Symbolic;
-        umf::numeric_type<double> Numeric;
-		status = umf::symbolic(A, Symbolic);
-        if(status<0)
-			//umf::report_status (Control, status)
-			throw ModelicaSimulationError(ALGLOOP_SOLVER,"Error in umfpack symbolic function");
-		status = umf::numeric (A, Symbolic, Numeric);
-		if(status<0)
-			throw ModelicaSimulationError(ALGLOOP_SOLVER,"Error in umfpack numeric function");
-        status = umf::solve (A, x, b, Numeric);
+        sparsematrix_t& A = _algLoop->getSparseAMatrix();
+
+        // the symbolic analysis is only redone if the sparsity pattern changed
+        _sparseA.assign(dimSys,
+                        boost::numeric::bindings::begin_compressed_index_major(A),
+                        boost::numeric::bindings::begin_index_minor(A),
+                        boost::numeric::bindings::begin_value(A));
+        status = _sparseA.solve(_rhs, _x);
 		if(status<0)
-			throw ModelicaSimulationError(ALGLOOP_SOLVER,"Error in umfpack solve function");
+			throw ModelicaSimulationError(ALGLOOP_SOLVER,"Error in umfpack factorization or solve function");
         _algLoop->setReal(_x);
 
 
@@ -627,7 +627,7 @@ fmiStatus fmiInitialize(fmiComponent c, fmiBoolean toleranceControlled, fmiReal
       toleranceControlled, relativeTolerance);
 
   /* set zero-crossing tolerance */
-  setZCtol(relativeTolerance);
+  setZCtol(comp->fmuData, relativeTolerance);
 
   setStartValues(comp);
   copyStartValuestoInitValues(comp->fmuData);
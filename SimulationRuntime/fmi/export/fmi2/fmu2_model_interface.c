@@ -33,6 +33,7 @@
 #include "simulation/solver/model_help.h"
 #if !defined(OMC_NUM_NONLINEAR_SYSTEMS) || OMC_NUM_NONLINEAR_SYSTEMS>0
 #include "simulation/solver/nonlinearSystem.h"
+#include "simulation/solver/nonlinearValuesList.h"
 #endif
 #if !defined(OMC_NUM_LINEAR_SYSTEMS) || OMC_NUM_LINEAR_SYSTEMS>0
 #include "simulation/solver/linearSystem.h"
@@ -42,14 +43,24 @@
 #endif
 #include "simulation/solver/delay.h"
 #include "simulation/solver/fmi_events.h"
+#include "simulation/solver/synchronous.h"
 #include "simulation/simulation_info_json.h"
 #include "simulation/simulation_input_xml.h"
+
+#include <float.h>
+#include <math.h>
 /*
 DLLExport pthread_key_t fmu2_thread_data_key;
 */
 
 fmi2Boolean isCategoryLogged(ModelInstance *comp, int categoryIndex);
 
+#if defined(FMU2_TEST_HOOKS)
+/* set by test/test_fmu2_dostep_status.c: status that replaces the one of
+ * fmi2CompletedIntegratorStep inside fmi2DoStep, fmi2OK to use the real one */
+FMI2_Export fmi2Status fmu2InjectedStepStatus = fmi2OK;
+#endif
+
 static fmi2String logCategoriesNames[] = {"logEvents", "logSingularLinearSystems", "logNonlinearSystems", "logDynamicStateSelection",
     "logStatusWarning", "logStatusDiscard", "logStatusError", "logStatusFatal", "logStatusPending", "logAll", "logFmi2Call"};
 
@@ -188,20 +199,101 @@ static void omc_assert_fmi_warning(FILE_INFO info, const char *msg, ...)
 // ---------------------------------------------------------------------------
 // Private helpers functions
 // ---------------------------------------------------------------------------
+/* Puts back the thread data the calling thread had before the call, NULL if
+ * it had none. The key never keeps the thread data of an instance after a
+ * call, so no instance records another one (possibly freed later) as its
+ * parent. */
 static inline void resetThreadData(ModelInstance* comp)
 {
-  if (comp->threadDataParent) {
-    pthread_setspecific(mmc_thread_data_key, comp->threadDataParent);
-  }
+  pthread_setspecific(mmc_thread_data_key, comp->threadDataParent);
 }
 
+/* Always installed, since instances of the same FMU may be stepped on
+ * different threads. The thread data found in the key belongs to the
+ * calling thread (e.g. the OpenModelica host) unless this is a nested call
+ * of the same instance. */
 static inline void setThreadData(ModelInstance* comp)
 {
-  if (comp->threadDataParent) {
+  threadData_t *current = (threadData_t*) pthread_getspecific(mmc_thread_data_key);
+  if (current != comp->threadData) {
+    comp->threadDataParent = current;
     pthread_setspecific(mmc_thread_data_key, comp->threadData);
   }
 }
 
+static pthread_once_t fmu2_runtime_once = PTHREAD_ONCE_INIT;
+
+/* Setup of the runtime shared by all instances of the process. Done only once,
+ * since mmc_init_nogc creates a new thread data key that would hide the thread
+ * data of the instances running on other threads. */
+static void initRuntime(void)
+{
+  if (0 == pthread_getspecific(mmc_thread_data_key)) {
+    /* We can only disable GC if the parent is not OM */
+    omc_alloc_interface = omc_alloc_interface_pooled;
+  }
+  mmc_init_nogc();
+  omc_alloc_interface.init();
+  omc_assert = omc_assert_fmi;
+  omc_assert_warning = omc_assert_fmi_warning;
+}
+
+/* set in updatedBlocks by the first getter after a change of the model */
+#define FMU2_BLOCK_READ 4
+
+/* number of blocks a getter read since the last change of the model left unevaluated */
+static unsigned long skippedBlocks(ModelInstance *comp)
+{
+  unsigned int skipped = FMU2_BLOCK_ALL & ~comp->updatedBlocks;
+  if (!(comp->updatedBlocks & FMU2_BLOCK_READ)) {
+    return 0;
+  }
+  return (skipped & FMU2_BLOCK_ODE ? 1 : 0) + (skipped & FMU2_BLOCK_ALG ? 1 : 0);
+}
+
+/*!
+ * Evaluates the blocks of the model equations needed by a getter that are not
+ * up to date since the last change of the model. The other blocks are left
+ * for later getters. In initialization mode the initialization is done.
+ */
+static void updateModel(ModelInstance *comp, unsigned int blocks)
+{
+  DATA *data = comp->fmuData;
+
+  if (comp->_need_update)
+  {
+    comp->savedBlockEvaluations += skippedBlocks(comp);
+    comp->updatedBlocks = FMU2_BLOCK_READ;
+    comp->_need_update = 0;
+    if (modelInitializationMode == comp->state)
+    {
+      data->callback->updateBoundParameters(data, comp->threadData);
+      data->callback->updateBoundVariableAttributes(data, comp->threadData);
+      initialization(data, comp->threadData, "fmi", "", 0.0);
+      comp->updatedBlocks |= FMU2_BLOCK_ALL;
+    }
+  }
+
+  if (blocks & FMU2_BLOCK_ALG) {
+    blocks |= FMU2_BLOCK_ODE;
+  }
+  blocks &= ~comp->updatedBlocks;
+
+  if (blocks & FMU2_BLOCK_ODE)
+  {
+    data->callback->functionODE(data, comp->threadData);
+    overwriteOldSimulationData(data);
+  }
+  if (blocks & FMU2_BLOCK_ALG)
+  {
+    data->callback->functionAlgebraics(data, comp->threadData);
+    data->callback->output_function(data, comp->threadData);
+    data->callback->function_storeDelayed(data, comp->threadData);
+    storePreValues(data);
+  }
+  comp->updatedBlocks |= blocks;
+}
+
 fmi2Status fmi2EventUpdate(fmi2Component c, fmi2EventInfo* eventInfo)
 {
   int i, done=0;
@@ -362,12 +454,7 @@ fmi2Component fmi2Instantiate(fmi2String instanceName, fmi2Type fmuType, fmi2Str
   * The problem is that we might overwrite the main simulation's copy of the interface...
   */
   threadData_t *threadDataParent = (threadData_t*) pthread_getspecific(mmc_thread_data_key);
-  if (0==threadDataParent) {
-    /* We can only disable GC if the parent is not OM */
-    omc_alloc_interface = omc_alloc_interface_pooled;
-  }
-  mmc_init_nogc();
-  omc_alloc_interface.init();
+  pthread_once(&fmu2_runtime_once, initRuntime);
 
   // ignoring arguments: fmuResourceLocation, visible
   ModelInstance *comp;
@@ -430,9 +517,7 @@ fmi2Component fmi2Instantiate(fmi2String instanceName, fmi2Type fmuType, fmi2Str
     return NULL;
   }
 
-  pthread_setspecific(mmc_thread_data_key, comp->threadData);
-  omc_assert = omc_assert_fmi;
-  omc_assert_warning = omc_assert_fmi_warning;
+  setThreadData(comp);
 
   strcpy((char*)comp->instanceName, (const char*)instanceName);
   comp->type = fmuType;
@@ -487,13 +572,33 @@ fmi2Component fmi2Instantiate(fmi2String instanceName, fmi2Type fmuType, fmi2Str
   /* allocate memory for Jacobian */
   comp->_has_jacobian = 0;
   comp->fmiDerJac = NULL;
+  comp->jacWork = NULL;
   if (comp->fmuData->callback->initialPartialFMIDER != NULL){
+    comp->fmiDerJac = (ANALYTIC_JACOBIAN*)functions->allocateMemory(1, sizeof(ANALYTIC_JACOBIAN));
     if (! comp->fmuData->callback->initialPartialFMIDER(comp->fmuData, comp->threadData, comp->fmiDerJac)) {
       comp->_has_jacobian = 1;
+      comp->jacWork = (int*)functions->allocateMemory(comp->fmiDerJac->sizeCols + comp->fmiDerJac->sizeRows + comp->fmiDerJac->sparsePattern.maxColors + 1, sizeof(int));
     }
   }
 
   comp->_need_update = 1;
+  comp->updatedBlocks = 0;
+  comp->savedBlockEvaluations = 0;
+  comp->stateBuffer = NULL;
+  comp->stateBufferSize = 0;
+
+  /* work arrays of the co-simulation integrator, see fmi2DoStep */
+  comp->csSolver = OMC_FMI_CS_SOLVER;
+  comp->csStepSize = 0;
+  comp->csWork = NULL;
+  if (fmuType == fmi2CoSimulation && (comp->fmuData->modelData->nStates > 0 || comp->fmuData->modelData->nZeroCrossings > 0)) {
+    comp->csWork = (fmi2Real*)functions->allocateMemory(10*comp->fmuData->modelData->nStates + 3*comp->fmuData->modelData->nZeroCrossings, sizeof(fmi2Real));
+    if (!comp->csWork) {
+      functions->logger(functions->componentEnvironment, instanceName, fmi2Error, "error", "fmi2Instantiate: Out of memory.");
+      fmi2FreeInstance(comp);
+      return NULL;
+    }
+  }
 
   FILTERED_LOG(comp, fmi2OK, LOG_FMI2_CALL, "fmi2Instantiate: GUID=%s", fmuGUID)
   resetThreadData(comp);
@@ -512,6 +617,7 @@ void fmi2FreeInstance(fmi2Component c)
 
   FILTERED_LOG(comp, fmi2OK, LOG_FMI2_CALL, "fmi2FreeInstance")
 
+  setThreadData(comp);
   /* call external objects destructors */
   comp->fmuData->callback->callExternalObjectDestructors(comp->fmuData, comp->threadData);
 #if !defined(OMC_NUM_NONLINEAR_SYSTEMS) || OMC_NUM_NONLINEAR_SYSTEMS>0
@@ -530,12 +636,25 @@ void fmi2FreeInstance(fmi2Component c)
   deInitializeDataStruc(comp->fmuData);
 
   comp->functions->freeMemory(comp->fmuData->modelData->resourcesDir);
+  if (comp->stateBuffer) comp->functions->freeMemory(comp->stateBuffer);
+  if (comp->csWork) comp->functions->freeMemory(comp->csWork);
+  if (comp->_has_jacobian) {
+    free(comp->fmiDerJac->seedVars);
+    free(comp->fmiDerJac->resultVars);
+    free(comp->fmiDerJac->tmpVars);
+    free(comp->fmiDerJac->sparsePattern.leadindex);
+    free(comp->fmiDerJac->sparsePattern.index);
+    free(comp->fmiDerJac->sparsePattern.colorCols);
+  }
+  if (comp->fmiDerJac) comp->functions->freeMemory(comp->fmiDerJac);
+  if (comp->jacWork) comp->functions->freeMemory(comp->jacWork);
 
   /* free simuation data */
   comp->functions->freeMemory(comp->fmuData->modelData);
   comp->functions->freeMemory(comp->fmuData->simulationInfo);
 
-  /* free fmuData */
+  /* free fmuData, do not leave the freed thread data installed */
+  pthread_setspecific(mmc_thread_data_key, comp->threadDataParent);
   comp->functions->freeMemory(comp->threadData);
   comp->functions->freeMemory(comp->fmuData);
   /* free instanceName & GUID */
@@ -560,6 +679,7 @@ fmi2Status fmi2SetupExperiment(fmi2Component c, fmi2Boolean toleranceDefined, fm
   comp->startTime = startTime;
   comp->stopTimeDefined = stopTimeDefined;
   comp->stopTime = stopTime;
+  comp->csStepSize = 0;
   return fmi2OK;
 }
 
@@ -571,7 +691,7 @@ fmi2Status fmi2EnterInitializationMode(fmi2Component c)
     return fmi2Error;
   FILTERED_LOG(comp, fmi2OK, LOG_FMI2_CALL, "fmi2EnterInitializationMode...")
 
-  setZCtol(comp->tolerance); /* set zero-crossing tolerance */
+  setZCtol(comp->fmuData, comp->tolerance); /* set zero-crossing tolerance */
   setStartValues(comp);
   copyStartValuestoInitValues(comp->fmuData);
   comp->state = modelInitializationMode;
@@ -670,6 +790,8 @@ fmi2Status fmi2Terminate(fmi2Component c)
   if (invalidState(comp, "fmi2Terminate", modelEventMode|modelContinuousTimeMode, ~0))
     return fmi2Error;
   FILTERED_LOG(comp, fmi2OK, LOG_FMI2_CALL, "fmi2Terminate")
+  FILTERED_LOG(comp, fmi2OK, LOG_ALL, "fmi2Terminate: lazy evaluation of the getters saved %lu evaluations of model equation blocks",
+               comp->savedBlockEvaluations + skippedBlocks(comp))
 
   setThreadData(comp);
   comp->state = modelTerminated;
@@ -699,6 +821,7 @@ fmi2Status fmi2Reset(fmi2Component c)
   setAllVarsToStart(comp->fmuData);
   setAllParamsToStart(comp->fmuData);
 
+  comp->csStepSize = 0;
   comp->state = modelInstantiated;
   resetThreadData(comp);
   return fmi2OK;
@@ -707,6 +830,7 @@ fmi2Status fmi2Reset(fmi2Component c)
 fmi2Status fmi2GetReal(fmi2Component c, const fmi2ValueReference vr[], size_t nvr, fmi2Real value[])
 {
   int i;
+  unsigned int blocks = 0;
   ModelInstance *comp = (ModelInstance*)c;
 
   if (invalidState(comp, "fmi2GetReal", modelInitializationMode|modelEventMode|modelContinuousTimeMode|modelTerminated|modelError, ~0))
@@ -718,32 +842,19 @@ fmi2Status fmi2GetReal(fmi2Component c, const fmi2ValueReference vr[], size_t nv
 
   setThreadData(comp);
 #if NUMBER_OF_REALS > 0
-  if (comp->_need_update)
+  for (i = 0; i < nvr; i++)
   {
-    if (modelInitializationMode == comp->state)
-    {
-      comp->fmuData->callback->updateBoundParameters(comp->fmuData, comp->threadData);
-      comp->fmuData->callback->updateBoundVariableAttributes(comp->fmuData, comp->threadData);
-      initialization(comp->fmuData, comp->threadData, "fmi", "", 0.0);
-    }
-    else
-    {
-      comp->fmuData->callback->functionODE(comp->fmuData, comp->threadData);
-      overwriteOldSimulationData(comp->fmuData);
-      comp->fmuData->callback->functionAlgebraics(comp->fmuData, comp->threadData);
-      comp->fmuData->callback->output_function(comp->fmuData, comp->threadData);
-      comp->fmuData->callback->function_storeDelayed(comp->fmuData, comp->threadData);
-      storePreValues(comp->fmuData);
+    if (vrOutOfRange(comp, "fmi2GetReal", vr[i], NUMBER_OF_REALS)) {
+      resetThreadData(comp);
+      return fmi2Error;
     }
-    comp->_need_update = 0;
+    blocks |= getRealEvaluationBlocks(vr[i]); // to be implemented by the includer of this file
   }
+  updateModel(comp, blocks);
 
   resetThreadData(comp);
   for (i = 0; i < nvr; i++)
   {
-    if (vrOutOfRange(comp, "fmi2GetReal", vr[i], NUMBER_OF_REALS)) {
-      return fmi2Error;
-    }
     value[i] = getReal(comp, vr[i]); // to be implemented by the includer of this file
     FILTERED_LOG(comp, fmi2OK, LOG_FMI2_CALL, "fmi2GetReal: #r%u# = %.16g", vr[i], value[i])
   }
@@ -763,25 +874,7 @@ fmi2Status fmi2GetInteger(fmi2Component c, const fmi2ValueReference vr[], size_t
     return fmi2Error;
 
   setThreadData(comp);
-  if (comp->_need_update)
-  {
-    if (modelInitializationMode == comp->state)
-    {
-      comp->fmuData->callback->updateBoundParameters(comp->fmuData, comp->threadData);
-      comp->fmuData->callback->updateBoundVariableAttributes(comp->fmuData, comp->threadData);
-      initialization(comp->fmuData, comp->threadData, "fmi", "", 0.0);
-    }
-    else
-    {
-      comp->fmuData->callback->functionODE(comp->fmuData, comp->threadData);
-      overwriteOldSimulationData(comp->fmuData);
-      comp->fmuData->callback->functionAlgebraics(comp->fmuData, comp->threadData);
-      comp->fmuData->callback->output_function(comp->fmuData, comp->threadData);
-      comp->fmuData->callback->function_storeDelayed(comp->fmuData, comp->threadData);
-      storePreValues(comp->fmuData);
-    }
-    comp->_need_update = 0;
-  }
+  updateModel(comp, FMU2_BLOCK_ALL);
 
   resetThreadData(comp);
   for (i = 0; i < nvr; i++)
@@ -807,25 +900,7 @@ fmi2Status fmi2GetBoolean(fmi2Component c, const fmi2ValueReference vr[], size_t
     return fmi2Error;
 
   setThreadData(comp);
-  if (comp->_need_update)
-  {
-    if (modelInitializationMode == comp->state)
-    {
-      comp->fmuData->callback->updateBoundParameters(comp->fmuData, comp->threadData);
-      comp->fmuData->callback->updateBoundVariableAttributes(comp->fmuData, comp->threadData);
-      initialization(comp->fmuData, comp->threadData, "fmi", "", 0.0);
-    }
-    else
-    {
-      comp->fmuData->callback->functionODE(comp->fmuData, comp->threadData);
-      overwriteOldSimulationData(comp->fmuData);
-      comp->fmuData->callback->functionAlgebraics(comp->fmuData, comp->threadData);
-      comp->fmuData->callback->output_function(comp->fmuData, comp->threadData);
-      comp->fmuData->callback->function_storeDelayed(comp->fmuData, comp->threadData);
-      storePreValues(comp->fmuData);
-    }
-    comp->_need_update = 0;
-  }
+  updateModel(comp, FMU2_BLOCK_ALL);
 
   resetThreadData(comp);
   for (i = 0; i < nvr; i++)
@@ -851,25 +926,7 @@ fmi2Status fmi2GetString(fmi2Component c, const fmi2ValueReference vr[], size_t
     return fmi2Error;
 
   setThreadData(comp);
-  if (comp->_need_update)
-  {
-    if (modelInitializationMode == comp->state)
-    {
-      comp->fmuData->callback->updateBoundParameters(comp->fmuData, comp->threadData);
-      comp->fmuData->callback->updateBoundVariableAttributes(comp->fmuData, comp->threadData);
-      initialization(comp->fmuData, comp->threadData, "fmi", "", 0.0);
-    }
-    else
-    {
-      comp->fmuData->callback->functionODE(comp->fmuData, comp->threadData);
-      overwriteOldSimulationData(comp->fmuData);
-      comp->fmuData->callback->functionAlgebraics(comp->fmuData, comp->threadData);
-      comp->fmuData->callback->output_function(comp->fmuData, comp->threadData);
-      comp->fmuData->callback->function_storeDelayed(comp->fmuData, comp->threadData);
-      storePreValues(comp->fmuData);
-    }
-    comp->_need_update = 0;
-  }
+  updateModel(comp, FMU2_BLOCK_ALL);
   resetThreadData(comp);
 
   for (i=0; i<nvr; i++)
@@ -989,34 +1046,605 @@ fmi2Status fmi2SetString(fmi2Component c, const fmi2ValueReference vr[], size_t
   return fmi2OK;
 }
 
+/* Cursor over the payload of an FMU state. The same routine packs and
+ * unpacks the state, so both directions always agree on the layout. */
+typedef struct FMU2_STATE_STREAM {
+  char *buffer;       /* NULL: only count the bytes */
+  size_t pos;
+  size_t size;
+  int reading;
+  int validateOnly;   /* reading without touching the model data */
+  int failed;
+  long delaySize;     /* samples of the delay arena in the state, set while reading */
+} FMU2_STATE_STREAM;
+
+static void stateCopy(FMU2_STATE_STREAM *s, void *value, size_t n)
+{
+  if (n == 0 || s->failed) {
+    return;
+  }
+  if (s->reading) {
+    if (s->pos + n > s->size) {
+      s->failed = 1;
+      return;
+    }
+    if (!s->validateOnly) {
+      memcpy(value, s->buffer + s->pos, n);
+    }
+  } else if (s->buffer) {
+    memcpy(s->buffer + s->pos, value, n);
+  }
+  s->pos += n;
+}
+
+/* copy a size of the state; while reading it is always returned, also in validateOnly mode */
+static long stateCopyCount(FMU2_STATE_STREAM *s, long count)
+{
+  int validateOnly = s->validateOnly;
+  s->validateOnly = 0;
+  stateCopy(s, &count, sizeof(long));
+  s->validateOnly = validateOnly;
+  return count;
+}
+
+/* a size of the model structure; the state can only be restored in an instance with the same size */
+static void stateCheckCount(FMU2_STATE_STREAM *s, long count)
+{
+  if (stateCopyCount(s, count) != count) {
+    s->failed = 1;
+  }
+}
+
+static void stateCopyStrings(FMU2_STATE_STREAM *s, modelica_string *values, long n)
+{
+  long i;
+  size_t len;
+  /* length including the terminating zero, 0 for strings not set yet */
+  for (i = 0; i < n && !s->failed; i++) {
+    len = (s->reading || !values[i]) ? 0 : MMC_STRLEN(values[i]) + 1;
+    len = (size_t) stateCopyCount(s, (long) len);
+    if (s->failed) {
+      return;
+    }
+    if (s->reading) {
+      if (len > 0 && (s->pos + len > s->size || s->buffer[s->pos + len - 1] != '\0')) {
+        s->failed = 1;
+        return;
+      }
+      if (!s->validateOnly) {
+        values[i] = len > 0 ? mmc_mk_scon(s->buffer + s->pos) : NULL;
+      }
+      s->pos += len;
+    } else {
+      stateCopy(s, (void*) MMC_STRINGDATA(values[i]), len);
+    }
+  }
+}
+
+/* Packs or unpacks everything that evolves during a simulation: the
+ * SIMULATION_DATA ring, pre and old values, relations, zero-crossings,
+ * sample and clock timers, parameters, delay buffers and the solution
+ * history of the non-linear systems used for extrapolation. */
+static void copyFMUstate(ModelInstance *comp, FMU2_STATE_STREAM *s)
+{
+  DATA *data = comp->fmuData;
+  MODEL_DATA *mData = data->modelData;
+  SIMULATION_INFO *sInfo = data->simulationInfo;
+  DELAY_ARENA *arena = &sInfo->delayArena;
+  long i, n, nRing = ringBufferLength(data->simulationData);
+
+  /* instance */
+  stateCopy(s, &comp->state, sizeof(ModelState));
+  stateCopy(s, &comp->eventInfo, sizeof(fmi2EventInfo));
+  stateCopy(s, &comp->_need_update, sizeof(int));
+  stateCopy(s, &comp->updatedBlocks, sizeof(unsigned int));
+  stateCopy(s, &comp->toleranceDefined, sizeof(fmi2Boolean));
+  stateCopy(s, &comp->tolerance, sizeof(fmi2Real));
+  stateCopy(s, &comp->startTime, sizeof(fmi2Real));
+  stateCopy(s, &comp->stopTimeDefined, sizeof(fmi2Boolean));
+  stateCopy(s, &comp->stopTime, sizeof(fmi2Real));
+  stateCopy(s, &comp->csStepSize, sizeof(fmi2Real));
+
+  /* ring buffer */
+  stateCheckCount(s, nRing);
+  for (i = 0; i < nRing; i++) {
+    stateCopy(s, &data->localData[i]->timeValue, sizeof(modelica_real));
+    stateCopy(s, data->localData[i]->realVars, mData->nVariablesReal * sizeof(modelica_real));
+    stateCopy(s, data->localData[i]->integerVars, mData->nVariablesInteger * sizeof(modelica_integer));
+    stateCopy(s, data->localData[i]->booleanVars, mData->nVariablesBoolean * sizeof(modelica_boolean));
+  }
+
+  /* simulation info */
+  stateCopy(s, &sInfo->startTime, sizeof(modelica_real));
+  stateCopy(s, &sInfo->stopTime, sizeof(modelica_real));
+  stateCopy(s, &sInfo->useStopTime, sizeof(int));
+  stateCopy(s, &sInfo->tolerance, sizeof(modelica_real));
+  stateCopy(s, &sInfo->currentContext, sizeof(int));
+  stateCopy(s, &sInfo->currentContextOld, sizeof(int));
+  stateCopy(s, &sInfo->lambda, sizeof(double));
+  stateCopy(s, &sInfo->initial, sizeof(modelica_boolean));
+  stateCopy(s, &sInfo->terminal, sizeof(modelica_boolean));
+  stateCopy(s, &sInfo->discreteCall, sizeof(modelica_boolean));
+  stateCopy(s, &sInfo->needToIterate, sizeof(modelica_boolean));
+  stateCopy(s, &sInfo->simulationSuccess, sizeof(modelica_boolean));
+  stateCopy(s, &sInfo->sampleActivated, sizeof(modelica_boolean));
+  stateCopy(s, &sInfo->solveContinuous, sizeof(modelica_boolean));
+  stateCopy(s, &sInfo->solverSteps, sizeof(double));
+  stateCopy(s, &sInfo->nextSampleEvent, sizeof(double));
+  stateCopy(s, &sInfo->timeValueOld, sizeof(modelica_real));
+  stateCopy(s, &sInfo->tStart, sizeof(double));
+
+  /* samples and clocks */
+  stateCheckCount(s, mData->nSamples);
+  stateCopy(s, sInfo->nextSampleTimes, mData->nSamples * sizeof(double));
+  stateCopy(s, sInfo->samples, mData->nSamples * sizeof(modelica_boolean));
+  stateCheckCount(s, sInfo->clocksData ? mData->nClocks : 0);
+  if (sInfo->clocksData) {
+    stateCopy(s, sInfo->clocksData, mData->nClocks * sizeof(CLOCK_DATA));
+  }
+  n = stateCopyCount(s, sInfo->intvlTimers ? listLen(sInfo->intvlTimers) : 0);
+  if (s->reading) {
+    if (n > 0 && !sInfo->intvlTimers) {
+      s->failed = 1;
+    } else if (sInfo->intvlTimers && !s->validateOnly && !s->failed) {
+      listClear(sInfo->intvlTimers);
+    }
+    for (i = 0; i < n && !s->failed; i++) {
+      SYNC_TIMER timer;
+      int validateOnly = s->validateOnly;
+      s->validateOnly = 0;
+      stateCopy(s, &timer, sizeof(SYNC_TIMER));
+      s->validateOnly = validateOnly;
+      if (!validateOnly && !s->failed) {
+        listPushBack(sInfo->intvlTimers, &timer);
+      }
+    }
+  } else if (n > 0) {
+    LIST_NODE *node;
+    for (node = listFirstNode(sInfo->intvlTimers); node; node = listNextNode(node)) {
+      stateCopy(s, listNodeData(node), sizeof(SYNC_TIMER));
+    }
+  }
+
+  /* events */
+  stateCheckCount(s, mData->nZeroCrossings);
+  stateCopy(s, sInfo->zeroCrossings, mData->nZeroCrossings * sizeof(modelica_real));
+  stateCopy(s, sInfo->zeroCrossingsPre, mData->nZeroCrossings * sizeof(modelica_real));
+  stateCheckCount(s, mData->nRelations);
+  stateCopy(s, sInfo->relations, mData->nRelations * sizeof(modelica_boolean));
+  stateCopy(s, sInfo->relationsPre, mData->nRelations * sizeof(modelica_boolean));
+  stateCopy(s, sInfo->storedRelations, mData->nRelations * sizeof(modelica_boolean));
+  stateCheckCount(s, mData->nMathEvents);
+  stateCopy(s, sInfo->mathEventsValuePre, mData->nMathEvents * sizeof(modelica_real));
+
+  /* old and pre values */
+  stateCopy(s, sInfo->realVarsOld, mData->nVariablesReal * sizeof(modelica_real));
+  stateCopy(s, sInfo->integerVarsOld, mData->nVariablesInteger * sizeof(modelica_integer));
+  stateCopy(s, sInfo->booleanVarsOld, mData->nVariablesBoolean * sizeof(modelica_boolean));
+  stateCopy(s, sInfo->realVarsPre, mData->nVariablesReal * sizeof(modelica_real));
+  stateCopy(s, sInfo->integerVarsPre, mData->nVariablesInteger * sizeof(modelica_integer));
+  stateCopy(s, sInfo->booleanVarsPre, mData->nVariablesBoolean * sizeof(modelica_boolean));
+
+  /* parameters and inputs */
+  stateCheckCount(s, mData->nParametersReal);
+  stateCopy(s, sInfo->realParameter, mData->nParametersReal * sizeof(modelica_real));
+  stateCheckCount(s, mData->nParametersInteger);
+  stateCopy(s, sInfo->integerParameter, mData->nParametersInteger * sizeof(modelica_integer));
+  stateCheckCount(s, mData->nParametersBoolean);
+  stateCopy(s, sInfo->booleanParameter, mData->nParametersBoolean * sizeof(modelica_boolean));
+  stateCheckCount(s, mData->nInputVars);
+  stateCopy(s, sInfo->inputVars, mData->nInputVars * sizeof(modelica_real));
+  stateCheckCount(s, mData->nOutputVars);
+  stateCopy(s, sInfo->outputVars, mData->nOutputVars * sizeof(modelica_real));
+
+  /* delay buffers; the arena may have grown since the state was taken and
+   * is resized by restoreFMUstate before the state is applied */
+  stateCheckCount(s, arena->nLines);
+  n = stateCopyCount(s, arena->size);
+  s->delaySize = n;
+  if (s->reading && !s->validateOnly && n != arena->size) {
+    s->failed = 1;
+  }
+  stateCopy(s, arena->lines, arena->nLines * sizeof(DELAY_LINE));
+  stateCopy(s, arena->samples, n * sizeof(TIME_AND_VALUE));
+
+#if !defined(OMC_NUM_NONLINEAR_SYSTEMS) || OMC_NUM_NONLINEAR_SYSTEMS>0
+  /* non-linear systems and their extrapolation history */
+  stateCheckCount(s, mData->nNonLinearSystems);
+  for (i = 0; i < mData->nNonLinearSystems; i++) {
+    NONLINEAR_SYSTEM_DATA *nls = &sInfo->nonlinearSystemData[i];
+    VALUES_LIST *valueList = (VALUES_LIST*) nls->oldValueList;
+    stateCheckCount(s, nls->size);
+    stateCopy(s, nls->nlsx, nls->size * sizeof(modelica_real));
+    stateCopy(s, nls->nlsxOld, nls->size * sizeof(modelica_real));
+    stateCopy(s, nls->nlsxExtrapolation, nls->size * sizeof(modelica_real));
+    stateCopy(s, &nls->solved, sizeof(modelica_boolean));
+    stateCopy(s, &nls->lastTimeSolved, sizeof(modelica_real));
+    stateCheckCount(s, valueList->capacity);
+    stateCopy(s, &valueList->first, sizeof(unsigned int));
+    stateCopy(s, &valueList->length, sizeof(unsigned int));
+    stateCopy(s, valueList->times, valueList->capacity * sizeof(double));
+    stateCopy(s, valueList->values, valueList->capacity * valueList->size * sizeof(double));
+    if (s->reading && !s->validateOnly) {
+      valueList->guessPoints = 0;
+    }
+  }
+#endif
+
+#if !defined(OMC_NVAR_STRING) || OMC_NVAR_STRING>0
+  /* strings last, they are the only entries of variable length */
+  stateCheckCount(s, mData->nVariablesString);
+  for (i = 0; i < nRing; i++) {
+    stateCopyStrings(s, data->localData[i]->stringVars, mData->nVariablesString);
+  }
+  stateCopyStrings(s, sInfo->stringVarsOld, mData->nVariablesString);
+  stateCopyStrings(s, sInfo->stringVarsPre, mData->nVariablesString);
+  stateCheckCount(s, mData->nParametersString);
+  stateCopyStrings(s, sInfo->stringParameter, mData->nParametersString);
+#endif
+}
+
+static fmi2Boolean reserveStateBuffer(ModelInstance *comp, size_t size)
+{
+  if (comp->stateBufferSize < size) {
+    if (comp->stateBuffer) {
+      comp->functions->freeMemory(comp->stateBuffer);
+    }
+    comp->stateBuffer = (char*) comp->functions->allocateMemory(size, sizeof(char));
+    comp->stateBufferSize = comp->stateBuffer ? size : 0;
+  }
+  return comp->stateBuffer ? fmi2True : fmi2False;
+}
+
+/* Reuses *FMUstate if its payload is large enough, as the FMI standard allows. */
+static FMU2_STATE* allocFMUstate(ModelInstance *comp, fmi2FMUstate* FMUstate, size_t size)
+{
+  FMU2_STATE *state = (FMU2_STATE*) *FMUstate;
+  if (state && state->capacity < size) {
+    comp->functions->freeMemory(state);
+    state = NULL;
+  }
+  if (!state) {
+    state = (FMU2_STATE*) comp->functions->allocateMemory(1, sizeof(FMU2_STATE) + size);
+    if (!state) {
+      *FMUstate = NULL;
+      return NULL;
+    }
+    state->capacity = size;
+  }
+  state->magic = FMU2_STATE_MAGIC;
+  state->version = FMU2_STATE_VERSION;
+  strncpy(state->guid, MODEL_GUID, FMU2_STATE_GUID_LENGTH-1);
+  state->guid[FMU2_STATE_GUID_LENGTH-1] = '\0';
+  state->size = size;
+  state->fullSize = size;
+  state->deltaRuns = 0;
+  state->base = NULL;
+  *FMUstate = state;
+  return state;
+}
+
+static inline char* stateData(const FMU2_STATE *state)
+{
+  return (char*) (state + 1);
+}
+
+/* write the full state into dst */
+static void expandFMUstate(const FMU2_STATE *state, char *dst)
+{
+  const char *run = stateData(state);
+  size_t i, offset, length;
+
+  if (state->deltaRuns == 0) {
+    memcpy(dst, stateData(state), state->size);
+    return;
+  }
+  memcpy(dst, stateData(state->base), state->base->fullSize < state->fullSize ? state->base->fullSize : state->fullSize);
+  for (i = 0; i < state->deltaRuns; i++) {
+    memcpy(&offset, run, sizeof(size_t));
+    memcpy(&length, run + sizeof(size_t), sizeof(size_t));
+    memcpy(dst + offset, run + 2*sizeof(size_t), length);
+    run += 2*sizeof(size_t) + length;
+  }
+}
+
+static fmi2Boolean invalidFMUstate(ModelInstance *comp, const char *f, const FMU2_STATE *state)
+{
+  if (!state || state->magic != FMU2_STATE_MAGIC || state->version != FMU2_STATE_VERSION
+      || strncmp(state->guid, MODEL_GUID, FMU2_STATE_GUID_LENGTH-1) != 0) {
+    FILTERED_LOG(comp, fmi2Error, LOG_STATUSERROR, "%s: Invalid FMU state, it was not created by this FMU.", f)
+    return fmi2True;
+  }
+  return fmi2False;
+}
+
+/* restore the model from a full state; nothing is changed if it does not fit the instance */
+static fmi2Status restoreFMUstate(ModelInstance *comp, const char *f, char *buffer, size_t size)
+{
+  FMU2_STATE_STREAM stream = {buffer, 0, size, 1, 1, 0, 0};
+
+  DELAY_ARENA *arena = &comp->fmuData->simulationInfo->delayArena;
+  TIME_AND_VALUE *samples;
+
+  copyFMUstate(comp, &stream);
+  if (stream.failed || stream.pos != size) {
+    FILTERED_LOG(comp, fmi2Error, LOG_STATUSERROR, "%s: FMU state does not match this instance.", f)
+    return fmi2Error;
+  }
+  if (stream.delaySize != arena->size) {
+    samples = (TIME_AND_VALUE*) realloc(arena->samples, stream.delaySize * sizeof(TIME_AND_VALUE));
+    if (!samples && stream.delaySize > 0) {
+      FILTERED_LOG(comp, fmi2Error, LOG_STATUSERROR, "%s: Out of memory.", f)
+      return fmi2Error;
+    }
+    arena->samples = samples;
+    arena->size = stream.delaySize;
+  }
+  stream.pos = 0;
+  stream.validateOnly = 0;
+  copyFMUstate(comp, &stream);
+  return fmi2OK;
+}
+
+#define FMU_STATE_STATES (modelInstantiated|modelInitializationMode|modelEventMode|modelContinuousTimeMode|modelSlaveInitialized|modelTerminated|modelError)
+
 fmi2Status fmi2GetFMUstate(fmi2Component c, fmi2FMUstate* FMUstate)
 {
-  return unsupportedFunction(c, "fmi2GetFMUstate", modelInstantiated|modelInitializationMode|modelEventMode|modelContinuousTimeMode|modelTerminated|modelError);
+  ModelInstance *comp = (ModelInstance *)c;
+  FMU2_STATE_STREAM stream = {NULL, 0, 0, 0, 0, 0, 0};
+  FMU2_STATE *state;
+
+  if (invalidState(comp, "fmi2GetFMUstate", FMU_STATE_STATES, FMU_STATE_STATES))
+    return fmi2Error;
+  if (nullPointer(comp, "fmi2GetFMUstate", "FMUstate", FMUstate))
+    return fmi2Error;
+
+  copyFMUstate(comp, &stream);
+  state = allocFMUstate(comp, FMUstate, stream.pos);
+  if (!state) {
+    FILTERED_LOG(comp, fmi2Error, LOG_STATUSERROR, "fmi2GetFMUstate: Out of memory.")
+    return fmi2Error;
+  }
+  stream.buffer = stateData(state);
+  stream.pos = 0;
+  copyFMUstate(comp, &stream);
+
+  FILTERED_LOG(comp, fmi2OK, LOG_FMI2_CALL, "fmi2GetFMUstate: %lu bytes", (unsigned long) state->size)
+  return fmi2OK;
+}
+
+fmi2Status omc_fmi2GetFMUstateDelta(fmi2Component c, fmi2FMUstate base, fmi2FMUstate* FMUstate)
+{
+  ModelInstance *comp = (ModelInstance *)c;
+  FMU2_STATE_STREAM stream = {NULL, 0, 0, 0, 0, 0, 0};
+  FMU2_STATE *baseState = (FMU2_STATE*) base, *state;
+  const size_t chunk = 64, runHeader = 2*sizeof(size_t);
+  size_t fullSize, pos, end, runStart, deltaSize = 0, nRuns = 0;
+  char *full, *baseData, *run;
+  int pass;
+
+  if (invalidState(comp, "omc_fmi2GetFMUstateDelta", FMU_STATE_STATES, FMU_STATE_STATES))
+    return fmi2Error;
+  if (nullPointer(comp, "omc_fmi2GetFMUstateDelta", "FMUstate", FMUstate))
+    return fmi2Error;
+  if (invalidFMUstate(comp, "omc_fmi2GetFMUstateDelta", baseState))
+    return fmi2Error;
+  if (baseState->deltaRuns > 0 || *FMUstate == base) {
+    FILTERED_LOG(comp, fmi2Error, LOG_STATUSERROR, "omc_fmi2GetFMUstateDelta: The base has to be a different, full FMU state.")
+    return fmi2Error;
+  }
+
+  copyFMUstate(comp, &stream);
+  fullSize = stream.pos;
+  if (!reserveStateBuffer(comp, fullSize)) {
+    FILTERED_LOG(comp, fmi2Error, LOG_STATUSERROR, "omc_fmi2GetFMUstateDelta: Out of memory.")
+    return fmi2Error;
+  }
+  full = comp->stateBuffer;
+  stream.buffer = full;
+  stream.pos = 0;
+  copyFMUstate(comp, &stream);
+
+  /* first pass measures the runs of changed chunks, the second one stores them */
+  baseData = stateData(baseState);
+  state = NULL;
+  run = NULL;
+  for (pass = 0; pass < 2; pass++) {
+    for (pos = 0; pos < fullSize; pos = end) {
+      end = pos + chunk < fullSize ? pos + chunk : fullSize;
+      if (end <= baseState->size && memcmp(full + pos, baseData + pos, end - pos) == 0)
+        continue;
+      runStart = pos;
+      while (end < fullSize) {
+        size_t next = end + chunk < fullSize ? end + chunk : fullSize;
+        if (next <= baseState->size && memcmp(full + end, baseData + end, next - end) == 0)
+          break;
+        end = next;
+      }
+      if (pass == 0) {
+        deltaSize += runHeader + end - runStart;
+        nRuns++;
+      } else {
+        size_t length = end - runStart;
+        memcpy(run, &runStart, sizeof(size_t));
+        memcpy(run + sizeof(size_t), &length, sizeof(size_t));
+        memcpy(run + runHeader, full + runStart, length);
+        run += runHeader + length;
+      }
+    }
+    if (pass == 0) {
+      /* not worth it, store the full state */
+      if (nRuns == 0 || deltaSize >= fullSize) {
+        nRuns = 0;
+        deltaSize = fullSize;
+      }
+      state = allocFMUstate(comp, FMUstate, deltaSize);
+      if (!state) {
+        FILTERED_LOG(comp, fmi2Error, LOG_STATUSERROR, "omc_fmi2GetFMUstateDelta: Out of memory.")
+        return fmi2Error;
+      }
+      state->fullSize = fullSize;
+      if (nRuns == 0) {
+        memcpy(stateData(state), full, fullSize);
+        break;
+      }
+      state->deltaRuns = nRuns;
+      state->base = baseState;
+      run = stateData(state);
+    }
+  }
+
+  FILTERED_LOG(comp, fmi2OK, LOG_FMI2_CALL, "omc_fmi2GetFMUstateDelta: %lu of %lu bytes in %lu runs", (unsigned long) state->size, (unsigned long) fullSize, (unsigned long) state->deltaRuns)
+  return fmi2OK;
 }
 
 fmi2Status fmi2SetFMUstate(fmi2Component c, fmi2FMUstate FMUstate)
 {
-  return unsupportedFunction(c, "fmi2SetFMUstate", modelInstantiated|modelInitializationMode|modelEventMode|modelContinuousTimeMode|modelTerminated|modelError);
+  ModelInstance *comp = (ModelInstance *)c;
+  FMU2_STATE *state = (FMU2_STATE*) FMUstate;
+  char *buffer;
+
+  if (invalidState(comp, "fmi2SetFMUstate", FMU_STATE_STATES, FMU_STATE_STATES))
+    return fmi2Error;
+  if (invalidFMUstate(comp, "fmi2SetFMUstate", state))
+    return fmi2Error;
+
+  if (state->deltaRuns == 0) {
+    buffer = stateData(state);
+  } else {
+    if (!reserveStateBuffer(comp, state->fullSize)) {
+      FILTERED_LOG(comp, fmi2Error, LOG_STATUSERROR, "fmi2SetFMUstate: Out of memory.")
+      return fmi2Error;
+    }
+    buffer = comp->stateBuffer;
+    expandFMUstate(state, buffer);
+  }
+
+  FILTERED_LOG(comp, fmi2OK, LOG_FMI2_CALL, "fmi2SetFMUstate: %lu bytes", (unsigned long) state->fullSize)
+  return restoreFMUstate(comp, "fmi2SetFMUstate", buffer, state->fullSize);
 }
 
 fmi2Status fmi2FreeFMUstate(fmi2Component c, fmi2FMUstate* FMUstate)
 {
-  return unsupportedFunction(c, "fmi2FreeFMUstate", modelInstantiated|modelInitializationMode|modelEventMode|modelContinuousTimeMode|modelTerminated|modelError);
+  ModelInstance *comp = (ModelInstance *)c;
+  if (invalidState(comp, "fmi2FreeFMUstate", FMU_STATE_STATES, FMU_STATE_STATES))
+    return fmi2Error;
+  if (nullPointer(comp, "fmi2FreeFMUstate", "FMUstate", FMUstate))
+    return fmi2Error;
+
+  FILTERED_LOG(comp, fmi2OK, LOG_FMI2_CALL, "fmi2FreeFMUstate")
+  if (*FMUstate) {
+    comp->functions->freeMemory(*FMUstate);
+    *FMUstate = NULL;
+  }
+  return fmi2OK;
 }
 
 fmi2Status fmi2SerializedFMUstateSize(fmi2Component c, fmi2FMUstate FMUstate, size_t *size)
 {
-  return unsupportedFunction(c, "fmi2SerializedFMUstateSize", modelInstantiated|modelInitializationMode|modelEventMode|modelContinuousTimeMode|modelTerminated|modelError);
+  ModelInstance *comp = (ModelInstance *)c;
+  FMU2_STATE *state = (FMU2_STATE*) FMUstate;
+  if (invalidState(comp, "fmi2SerializedFMUstateSize", FMU_STATE_STATES, FMU_STATE_STATES))
+    return fmi2Error;
+  if (nullPointer(comp, "fmi2SerializedFMUstateSize", "size", size))
+    return fmi2Error;
+  if (invalidFMUstate(comp, "fmi2SerializedFMUstateSize", state))
+    return fmi2Error;
+
+  *size = sizeof(FMU2_STATE) + state->fullSize;
+  FILTERED_LOG(comp, fmi2OK, LOG_FMI2_CALL, "fmi2SerializedFMUstateSize: %lu bytes", (unsigned long) *size)
+  return fmi2OK;
 }
 
 fmi2Status fmi2SerializeFMUstate(fmi2Component c, fmi2FMUstate FMUstate, fmi2Byte serializedState[], size_t size)
 {
-  return unsupportedFunction(c, "fmi2SerializeFMUstate", modelInstantiated|modelInitializationMode|modelEventMode|modelContinuousTimeMode|modelTerminated|modelError);
+  ModelInstance *comp = (ModelInstance *)c;
+  FMU2_STATE *state = (FMU2_STATE*) FMUstate;
+  FMU2_STATE header;
+  if (invalidState(comp, "fmi2SerializeFMUstate", FMU_STATE_STATES, FMU_STATE_STATES))
+    return fmi2Error;
+  if (nullPointer(comp, "fmi2SerializeFMUstate", "serializedState", serializedState))
+    return fmi2Error;
+  if (invalidFMUstate(comp, "fmi2SerializeFMUstate", state))
+    return fmi2Error;
+  if (size < sizeof(FMU2_STATE) + state->fullSize) {
+    FILTERED_LOG(comp, fmi2Error, LOG_STATUSERROR, "fmi2SerializeFMUstate: Buffer of %lu bytes is too small.", (unsigned long) size)
+    return fmi2Error;
+  }
+
+  /* the serialized state is always a full state */
+  header = *state;
+  header.size = state->fullSize;
+  header.capacity = state->fullSize;
+  header.deltaRuns = 0;
+  header.base = NULL;
+  memcpy(serializedState, &header, sizeof(FMU2_STATE));
+  expandFMUstate(state, (char*) serializedState + sizeof(FMU2_STATE));
+
+  FILTERED_LOG(comp, fmi2OK, LOG_FMI2_CALL, "fmi2SerializeFMUstate")
+  return fmi2OK;
 }
 
 fmi2Status fmi2DeSerializeFMUstate(fmi2Component c, const fmi2Byte serializedState[], size_t size, fmi2FMUstate* FMUstate)
 {
-  return unsupportedFunction(c, "fmi2DeSerializeFMUstate", modelInstantiated|modelInitializationMode|modelEventMode|modelContinuousTimeMode|modelTerminated|modelError);
+  ModelInstance *comp = (ModelInstance *)c;
+  FMU2_STATE header;
+  FMU2_STATE *state;
+  if (invalidState(comp, "fmi2DeSerializeFMUstate", FMU_STATE_STATES, FMU_STATE_STATES))
+    return fmi2Error;
+  if (nullPointer(comp, "fmi2DeSerializeFMUstate", "serializedState", serializedState))
+    return fmi2Error;
+  if (nullPointer(comp, "fmi2DeSerializeFMUstate", "FMUstate", FMUstate))
+    return fmi2Error;
+  if (size < sizeof(FMU2_STATE)) {
+    FILTERED_LOG(comp, fmi2Error, LOG_STATUSERROR, "fmi2DeSerializeFMUstate: Invalid size %lu.", (unsigned long) size)
+    return fmi2Error;
+  }
+  memcpy(&header, serializedState, sizeof(FMU2_STATE));
+  if (invalidFMUstate(comp, "fmi2DeSerializeFMUstate", &header))
+    return fmi2Error;
+  if (header.deltaRuns != 0 || header.size != header.fullSize || size != sizeof(FMU2_STATE) + header.size) {
+    FILTERED_LOG(comp, fmi2Error, LOG_STATUSERROR, "fmi2DeSerializeFMUstate: Invalid size %lu.", (unsigned long) size)
+    return fmi2Error;
+  }
+
+  state = allocFMUstate(comp, FMUstate, header.size);
+  if (!state) {
+    FILTERED_LOG(comp, fmi2Error, LOG_STATUSERROR, "fmi2DeSerializeFMUstate: Out of memory.")
+    return fmi2Error;
+  }
+  memcpy(stateData(state), serializedState + sizeof(FMU2_STATE), header.size);
+
+  FILTERED_LOG(comp, fmi2OK, LOG_FMI2_CALL, "fmi2DeSerializeFMUstate: %lu bytes", (unsigned long) header.size)
+  return fmi2OK;
+}
+
+/* This code assumes that the FMU variables are always sorted, states first
+ * and then derivatives. This is true for the actual OMC FMUs. The value
+ * references of inputs and outputs are mapped with
+ * mapInputReference2InputNumber and mapOutputReference2OutputNumber. */
+
+/* index of a known in the seeds of FMIDER: states, then inputs */
+static int jacobianSeedIndex(ModelInstance *comp, fmi2ValueReference vr)
+{
+  MODEL_DATA* modelData = comp->fmuData->modelData;
+  int idx = vr;
+  if (idx >= modelData->nStates) {
+    idx = modelData->nStates + mapInputReference2InputNumber(vr);
+  }
+  return idx;
+}
+
+/* index of an unknown in the results of FMIDER: derivatives, then outputs */
+static int jacobianResultIndex(ModelInstance *comp, fmi2ValueReference vr)
+{
+  MODEL_DATA* modelData = comp->fmuData->modelData;
+  /* derivatives are behind the states */
+  int idx = vr - modelData->nStates;
+  if (idx >= modelData->nStates) {
+    idx = modelData->nStates + mapOutputReference2OutputNumber(vr);
+  }
+  return idx;
 }
 
 fmi2Status fmi2GetDirectionalDerivative(fmi2Component c,
@@ -1026,11 +1654,10 @@ fmi2Status fmi2GetDirectionalDerivative(fmi2Component c,
 {
   ModelInstance *comp = (ModelInstance *)c;
   DATA* fmudata = (DATA *) comp->fmuData;
-  SIMULATION_INFO* simInfo = (SIMULATION_INFO*) fmudata->simulationInfo;
   MODEL_DATA* modelData = (MODEL_DATA*) fmudata->modelData;
   threadData_t* td = comp->threadData;
 
-  int i,j;
+  int i, seeded = 0;
 
   int independent = modelData->nStates+modelData->nInputVars;
   int dependent = modelData->nStates+modelData->nOutputVars;
@@ -1041,52 +1668,208 @@ fmi2Status fmi2GetDirectionalDerivative(fmi2Component c,
   if (!comp->_has_jacobian)
     return unsupportedFunction(c, "fmi2GetDirectionalDerivative", modelInitializationMode|modelEventMode|modelContinuousTimeMode|modelTerminated|modelError);
   /***************************************/
-  /* This code assumes that the FMU variables are always sorted,
-     states first and then derivatives.
-     This is true for the actual OMC FMUs.
-     The input values references are mapped with mapInputReference2InputNumber
-     and mapOutputReference2OutputNumber functions
-  */
   /* clear out the seeds */
   for (i=0;i<independent; i++) {
     comp->fmiDerJac->seedVars[i]=0;
   }
   for (i=0;i<nKnown; i++) {
-    int idx = vKnown_ref[i];
-    /* if idx is > nStates it's an input so we need a mapping */
-    if (idx >= modelData->nStates){
-      idx = mapInputReference2InputNumber(vKnown_ref[i]);
-      idx = modelData->nStates + idx;
-    }
+    int idx = jacobianSeedIndex(comp, vKnown_ref[i]);
     if (vrOutOfRange(comp, "fmi2GetDirectionalDerivative input index", idx, independent))
       return fmi2Error;
     /* Put the supplied value in the seeds */
     comp->fmiDerJac->seedVars[idx]=dvKnown[i];
+    seeded = seeded || dvKnown[i] != 0;
   }
   /* Call the Jacobian evaluation function. This function evaluates the whole column of the Jacobian.
-   * More efficient code could only evaluate the equations needed for the
-   * known variables only */
-  setThreadData(comp);
-  fmudata->callback->functionJacFMIDER_column(fmudata, td, comp->fmiDerJac, NULL);
-  resetThreadData(comp);
+   * A zero seed has a zero derivative, no need to evaluate anything. */
+  if (seeded) {
+    setThreadData(comp);
+    fmudata->callback->functionJacFMIDER_column(fmudata, td, comp->fmiDerJac, NULL);
+    resetThreadData(comp);
+  }
 
   /* Write the results to dvUnknown array */
   for (i=0;i<nUnknown; i++) {
-    /* derivatives are behind the states */
-    int idx = vUnknown_ref[i] - modelData->nStates;
-    /* if idx is > nStates it's an output so we need a mapping */
-    if (idx >= modelData->nStates){
-      idx = mapOutputReference2OutputNumber(vUnknown_ref[i]);
-      idx = modelData->nStates + idx;
-    }
+    int idx = jacobianResultIndex(comp, vUnknown_ref[i]);
     if (vrOutOfRange(comp, "fmi2GetDirectionalDerivative output index", idx, dependent))
       return fmi2Error;
-    dvUnknown[i] = comp->fmiDerJac->resultVars[idx];
+    dvUnknown[i] = seeded ? comp->fmiDerJac->resultVars[idx] : 0;
   }
   /***************************************/
   return fmi2OK;
 }
 
+/* Mark the seeds and results asked for in jacWork and return the number of
+ * colors of the selected knowns. With duplicate references the first one
+ * is marked. */
+static int markJacobianPositions(ModelInstance *comp, const char *f,
+    const fmi2ValueReference vUnknown_ref[], size_t nUnknown,
+    const fmi2ValueReference vKnown_ref[], size_t nKnown)
+{
+  ANALYTIC_JACOBIAN *jac = comp->fmiDerJac;
+  int *seedPos = comp->jacWork, *resultPos = seedPos + jac->sizeCols, *colorUsed = resultPos + jac->sizeRows;
+  int i, idx, nColors = 0;
+
+  for (i = 0; i < jac->sizeCols; i++) seedPos[i] = -1;
+  for (i = 0; i < jac->sizeRows; i++) resultPos[i] = -1;
+  for (i = 0; i < jac->sparsePattern.maxColors; i++) colorUsed[i] = 0;
+
+  for (i = 0; i < nKnown; i++) {
+    idx = jacobianSeedIndex(comp, vKnown_ref[i]);
+    if (vrOutOfRange(comp, f, idx, jac->sizeCols))
+      return -1;
+    if (seedPos[idx] < 0) {
+      seedPos[idx] = i;
+      if (jac->sparsePattern.maxColors > 0 && !colorUsed[jac->sparsePattern.colorCols[idx]-1]) {
+        colorUsed[jac->sparsePattern.colorCols[idx]-1] = 1;
+        nColors++;
+      }
+    }
+  }
+  for (i = 0; i < nUnknown; i++) {
+    idx = jacobianResultIndex(comp, vUnknown_ref[i]);
+    if (vrOutOfRange(comp, f, idx, jac->sizeRows))
+      return -1;
+    if (resultPos[idx] < 0) {
+      resultPos[idx] = i;
+    }
+  }
+  return jac->sparsePattern.maxColors > 0 ? nColors : (int) nKnown;
+}
+
+fmi2Status omc_fmi2GetJacobian(fmi2Component c,
+    const fmi2ValueReference vUnknown_ref[], size_t nUnknown,
+    const fmi2ValueReference vKnown_ref[], size_t nKnown, fmi2Real jacobian[])
+{
+  ModelInstance *comp = (ModelInstance *)c;
+  DATA* fmudata = comp->fmuData;
+  ANALYTIC_JACOBIAN *jac = comp->fmiDerJac;
+  SPARSE_PATTERN *sp;
+  int *seedPos, *resultPos, *colorUsed;
+  unsigned int i, j, k, l, color, nColors;
+  int nEvaluated = 0;
+
+  if (invalidState(comp, "omc_fmi2GetJacobian", modelInstantiated|modelEventMode|modelContinuousTimeMode, ~0))
+    return fmi2Error;
+  if (!comp->_has_jacobian)
+    return unsupportedFunction(c, "omc_fmi2GetJacobian", modelInitializationMode|modelEventMode|modelContinuousTimeMode|modelTerminated|modelError);
+  if (nullPointer(comp, "omc_fmi2GetJacobian", "jacobian[]", jacobian))
+    return fmi2Error;
+
+  if (markJacobianPositions(comp, "omc_fmi2GetJacobian", vUnknown_ref, nUnknown, vKnown_ref, nKnown) < 0)
+    return fmi2Error;
+  sp = &jac->sparsePattern;
+  seedPos = comp->jacWork;
+  resultPos = seedPos + jac->sizeCols;
+  colorUsed = resultPos + jac->sizeRows;
+  memset(jacobian, 0, nUnknown * nKnown * sizeof(fmi2Real));
+  memset(jac->seedVars, 0, jac->sizeCols * sizeof(modelica_real));
+
+  setThreadData(comp);
+  /* without coloring every known is a color of its own */
+  nColors = sp->maxColors > 0 ? sp->maxColors : jac->sizeCols;
+  for (color = 0; color < nColors; color++) {
+    if (sp->maxColors > 0 ? !colorUsed[color] : seedPos[color] < 0)
+      continue;
+    for (j = 0; j < jac->sizeCols; j++) {
+      if (seedPos[j] >= 0 && (sp->maxColors > 0 ? sp->colorCols[j]-1 == color : j == color))
+        jac->seedVars[j] = 1;
+    }
+
+    fmudata->callback->functionJacFMIDER_column(fmudata, comp->threadData, jac, NULL);
+    nEvaluated++;
+
+    for (j = 0; j < jac->sizeCols; j++) {
+      if (jac->seedVars[j] == 0)
+        continue;
+      if (sp->maxColors > 0) {
+        for (k = sp->leadindex[j]; k < sp->leadindex[j+1]; k++) {
+          l = sp->index[k];
+          if (resultPos[l] >= 0)
+            jacobian[seedPos[j]*nUnknown + resultPos[l]] = jac->resultVars[l];
+        }
+      } else {
+        for (l = 0; l < jac->sizeRows; l++) {
+          if (resultPos[l] >= 0)
+            jacobian[seedPos[j]*nUnknown + resultPos[l]] = jac->resultVars[l];
+        }
+      }
+      jac->seedVars[j] = 0;
+    }
+  }
+  resetThreadData(comp);
+
+  /* duplicate references get the values of the first one */
+  for (i = 0; i < nKnown; i++) {
+    k = seedPos[jacobianSeedIndex(comp, vKnown_ref[i])];
+    if (k != i)
+      memcpy(jacobian + i*nUnknown, jacobian + k*nUnknown, nUnknown * sizeof(fmi2Real));
+  }
+  for (i = 0; i < nUnknown; i++) {
+    k = resultPos[jacobianResultIndex(comp, vUnknown_ref[i])];
+    if (k != i)
+      for (j = 0; j < nKnown; j++)
+        jacobian[j*nUnknown + i] = jacobian[j*nUnknown + k];
+  }
+
+  FILTERED_LOG(comp, fmi2OK, LOG_FMI2_CALL, "omc_fmi2GetJacobian: %u x %u in %d evaluations", (unsigned int) nUnknown, (unsigned int) nKnown, nEvaluated)
+  return fmi2OK;
+}
+
+fmi2Status omc_fmi2GetDirectionalDerivatives(fmi2Component c,
+    const fmi2ValueReference vUnknown_ref[], size_t nUnknown,
+    const fmi2ValueReference vKnown_ref[], size_t nKnown,
+    const fmi2Real dvKnown[], size_t nDirections, fmi2Real dvUnknown[])
+{
+  ModelInstance *comp = (ModelInstance *)c;
+  fmi2Real *jacobian;
+  fmi2Status status;
+  size_t d, i, j;
+  int nColors;
+
+  if (invalidState(comp, "omc_fmi2GetDirectionalDerivatives", modelInstantiated|modelEventMode|modelContinuousTimeMode, ~0))
+    return fmi2Error;
+  if (!comp->_has_jacobian)
+    return unsupportedFunction(c, "omc_fmi2GetDirectionalDerivatives", modelInitializationMode|modelEventMode|modelContinuousTimeMode|modelTerminated|modelError);
+
+  nColors = markJacobianPositions(comp, "omc_fmi2GetDirectionalDerivatives", vUnknown_ref, nUnknown, vKnown_ref, nKnown);
+  if (nColors < 0)
+    return fmi2Error;
+
+  /* few directions: one evaluation per direction */
+  if (nDirections <= nColors || nUnknown * nKnown == 0) {
+    for (d = 0; d < nDirections; d++) {
+      status = fmi2GetDirectionalDerivative(c, vUnknown_ref, nUnknown, vKnown_ref, nKnown, dvKnown + d*nKnown, dvUnknown + d*nUnknown);
+      if (status != fmi2OK)
+        return status;
+    }
+    return fmi2OK;
+  }
+
+  /* many directions: one evaluation per color, then multiply */
+  jacobian = (fmi2Real*)comp->functions->allocateMemory(nUnknown * nKnown, sizeof(fmi2Real));
+  if (!jacobian) {
+    FILTERED_LOG(comp, fmi2Error, LOG_STATUSERROR, "omc_fmi2GetDirectionalDerivatives: Out of memory.")
+    return fmi2Error;
+  }
+  status = omc_fmi2GetJacobian(c, vUnknown_ref, nUnknown, vKnown_ref, nKnown, jacobian);
+  if (status == fmi2OK) {
+    for (d = 0; d < nDirections; d++) {
+      fmi2Real *out = dvUnknown + d*nUnknown;
+      const fmi2Real *in = dvKnown + d*nKnown;
+      memset(out, 0, nUnknown * sizeof(fmi2Real));
+      for (j = 0; j < nKnown; j++) {
+        if (in[j] == 0)
+          continue;
+        for (i = 0; i < nUnknown; i++)
+          out[i] += jacobian[j*nUnknown + i] * in[j];
+      }
+    }
+  }
+  comp->functions->freeMemory(jacobian);
+  return status;
+}
+
 
 
 /***************************************************
@@ -1239,12 +2022,7 @@ fmi2Status fmi2GetDerivatives(fmi2Component c, fmi2Real derivatives[], size_t nx
   /* try */
   MMC_TRY_INTERNAL(simulationJumpBuffer)
 
-    if (comp->_need_update)
-    {
-      comp->fmuData->callback->functionODE(comp->fmuData, comp->threadData);
-      overwriteOldSimulationData(comp->fmuData);
-      comp->_need_update = 0;
-    }
+    updateModel(comp, FMU2_BLOCK_ODE);
 
 #if NUMBER_OF_STATES>0
     for (i = 0; i < nx; i++) {
@@ -1286,11 +2064,7 @@ fmi2Status fmi2GetEventIndicators(fmi2Component c, fmi2Real eventIndicators[], s
 
 #if NUMBER_OF_EVENT_INDICATORS>0
     /* eval needed equations*/
-    if (comp->_need_update)
-    {
-      comp->fmuData->callback->functionODE(comp->fmuData, comp->threadData);
-      comp->_need_update = 0;
-    }
+    updateModel(comp, FMU2_BLOCK_ODE);
     comp->fmuData->callback->function_ZeroCrossings(comp->fmuData, comp->threadData, comp->fmuData->simulationInfo->zeroCrossings);
     for (i = 0; i < nx; i++) {
       eventIndicators[i] = comp->fmuData->simulationInfo->zeroCrossings[i];
@@ -1361,20 +2135,228 @@ fmi2Status fmi2GetRealOutputDerivatives(fmi2Component c, const fmi2ValueReferenc
   return unsupportedFunction(c, "fmi2GetRealOutputDerivatives", ~0);
 }
 
+/* Dormand-Prince 5(4): nodes, coefficients of the stages 2..7 and the
+ * difference of the weights of the two solutions; the 7th stage is the
+ * derivative at the end of the step (FSAL) */
+static const fmi2Real dopriC[7] = {0.0, 1.0/5.0, 3.0/10.0, 4.0/5.0, 8.0/9.0, 1.0, 1.0};
+static const fmi2Real dopriA[6][6] = {
+  {1.0/5.0},
+  {3.0/40.0, 9.0/40.0},
+  {44.0/45.0, -56.0/15.0, 32.0/9.0},
+  {19372.0/6561.0, -25360.0/2187.0, 64448.0/6561.0, -212.0/729.0},
+  {9017.0/3168.0, -355.0/33.0, 46732.0/5247.0, 49.0/176.0, -5103.0/18656.0},
+  {35.0/384.0, 0.0, 500.0/1113.0, 125.0/192.0, -2187.0/6784.0, 11.0/84.0}
+};
+static const fmi2Real dopriE[7] = {71.0/57600.0, 0.0, -71.0/16695.0, 71.0/1920.0, -17253.0/339200.0, 22.0/525.0, -1.0/40.0};
+
+/* evaluate the derivatives dx for the states x at time t; the model is left at (t, x) */
+static inline void csEvalODE(ModelInstance *comp, fmi2Real t, const fmi2Real *x, fmi2Real *dx)
+{
+  DATA *data = comp->fmuData;
+  long n = data->modelData->nStates;
+  data->localData[0]->timeValue = t;
+  memcpy(data->localData[0]->realVars, x, n * sizeof(fmi2Real));
+  data->callback->functionODE(data, comp->threadData);
+  memcpy(dx, data->localData[0]->realVars + n, n * sizeof(fmi2Real));
+}
+
+/* cubic Hermite interpolation of the states in the step [t0, t0+h] */
+static void csInterpolate(long n, fmi2Real t0, fmi2Real h, const fmi2Real *y0, const fmi2Real *f0,
+                          const fmi2Real *y1, const fmi2Real *f1, fmi2Real t, fmi2Real *y)
+{
+  long i;
+  fmi2Real s = (t - t0) / h, s2 = s*s, s3 = s2*s;
+  fmi2Real h00 = 2*s3 - 3*s2 + 1, h10 = (s3 - 2*s2 + s)*h, h01 = 3*s2 - 2*s3, h11 = (s3 - s2)*h;
+  for (i = 0; i < n; i++) {
+    y[i] = h00*y0[i] + h10*f0[i] + h01*y1[i] + h11*f1[i];
+  }
+}
+
+static int csSignChange(long nz, const fmi2Real *z0, const fmi2Real *z1)
+{
+  long i;
+  for (i = 0; i < nz; i++) {
+    if (z0[i]*z1[i] < 0) {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+/* Locates the first zero-crossing of the event indicators zL at t0 and zR
+ * at t1 on the interpolant of the step. Secant steps towards the earliest
+ * crossing, with bisection if one side of the bracket gets stuck. Returns
+ * the time right after the crossing; the model and y are left there. */
+static fmi2Real csLocateEvent(ModelInstance *comp, fmi2Real t0, fmi2Real t1, const fmi2Real *y0, const fmi2Real *f0,
+                              const fmi2Real *y1, const fmi2Real *f1, fmi2Real *zL, fmi2Real *zR, fmi2Real *zM, fmi2Real *y, fmi2Real *f)
+{
+  long i, n = comp->fmuData->modelData->nStates, nz = comp->fmuData->modelData->nZeroCrossings;
+  fmi2Real tL = t0, tR = t1, tM, tSecant, *swap;
+  fmi2Real eps = 1e3 * DBL_EPSILON * fmax(1.0, fabs(t1));
+  int iter, side = 0, lastSide = 0;
+
+  for (iter = 0; iter < 100 && tR - tL > eps; iter++) {
+    tM = tR;
+    for (i = 0; i < nz; i++) {
+      if (zL[i]*zR[i] < 0) {
+        tSecant = tR - zR[i] * (tR - tL) / (zR[i] - zL[i]);
+        tM = fmin(tM, tSecant);
+      }
+    }
+    if ((side != 0 && side == lastSide) || tM <= tL || tM >= tR) {
+      tM = 0.5 * (tL + tR);
+    }
+    csInterpolate(n, t0, t1 - t0, y0, f0, y1, f1, tM, y);
+    csEvalODE(comp, tM, y, f);
+    comp->fmuData->callback->function_ZeroCrossings(comp->fmuData, comp->threadData, zM);
+
+    lastSide = side;
+    if (csSignChange(nz, zL, zM)) {
+      side = 1;
+      tR = tM;
+      swap = zR; zR = zM; zM = swap;
+    } else {
+      side = -1;
+      tL = tM;
+      swap = zL; zL = zM; zM = swap;
+    }
+  }
+
+  csInterpolate(n, t0, t1 - t0, y0, f0, y1, f1, tR, y);
+  csEvalODE(comp, tR, y, f);
+  return tR;
+}
+
+/* Integrates from the current time to tStop or up to the first event.
+ * Every accepted step is completed like fmi2CompletedIntegratorStep does,
+ * so delay buffers and pre values see all steps. */
+static fmi2Status csIntegrate(ModelInstance *comp, fmi2Real tStop, fmi2Boolean *event, fmi2Boolean *terminateSimulation)
+{
+  DATA *data = comp->fmuData;
+  threadData_t *threadData = comp->threadData;
+  long i, j, s, n = data->modelData->nStates, nz = data->modelData->nZeroCrossings;
+  fmi2Real *y0 = comp->csWork, *y1 = y0 + n, *y = y1 + n, *k = y + n, *z0 = k + 7*n, *z1 = z0 + nz, *zM = z1 + nz, *swap;
+  fmi2Real *f0 = k, *f1 = k + 6*n;
+  fmi2Real t, tNext, h, err, sc, fac, sum;
+  fmi2Real tol = comp->toleranceDefined ? comp->tolerance : FMU2_CS_DEFAULT_TOLERANCE;
+  fmi2Boolean clipped, failed = fmi2False, enterEventMode = fmi2False;
+  fmi2Status status = fmi2Error, stepStatus = fmi2OK;
+
+  *event = fmi2False;
+  *terminateSimulation = fmi2False;
+
+  setThreadData(comp);
+  /* try */
+  MMC_TRY_INTERNAL(simulationJumpBuffer)
+    t = data->localData[0]->timeValue;
+    memcpy(y0, data->localData[0]->realVars, n * sizeof(fmi2Real));
+    csEvalODE(comp, t, y0, f0);
+    if (nz > 0) {
+      data->callback->function_ZeroCrossings(data, threadData, z0);
+    }
+
+    while (t < tStop && !*event && !*terminateSimulation && !failed)
+    {
+      h = (comp->csSolver == FMU2_CS_DOPRI45 && comp->csStepSize > 0 && n > 0) ? comp->csStepSize : tStop - t;
+      clipped = (t + 1.01*h >= tStop);
+      if (clipped) {
+        h = tStop - t;
+      }
+      if (h < 1e3 * DBL_EPSILON * fmax(1.0, fabs(t))) {
+        FILTERED_LOG(comp, fmi2Error, LOG_STATUSERROR, "fmi2DoStep: Step size %g too small at time %.16g.", h, t)
+        failed = fmi2True;
+        break;
+      }
+
+      if (comp->csSolver == FMU2_CS_EULER || n == 0) {
+        for (i = 0; i < n; i++) {
+          y1[i] = y0[i] + h*f0[i];
+        }
+        csEvalODE(comp, t + h, y1, f1);
+      } else {
+        for (s = 1; s < 7; s++) {
+          fmi2Real *ys = (s == 6) ? y1 : y;
+          for (i = 0; i < n; i++) {
+            sum = 0;
+            for (j = 0; j < s; j++) {
+              sum += dopriA[s-1][j] * k[j*n + i];
+            }
+            ys[i] = y0[i] + h*sum;
+          }
+          csEvalODE(comp, t + dopriC[s]*h, ys, k + s*n);
+        }
+
+        err = 0;
+        for (i = 0; i < n; i++) {
+          sum = 0;
+          for (s = 0; s < 7; s++) {
+            sum += dopriE[s] * k[s*n + i];
+          }
+          sc = tol + tol*fmax(fabs(y0[i]), fabs(y1[i]));
+          err += (h*sum/sc) * (h*sum/sc);
+        }
+        err = sqrt(err / n);
+        fac = err > 0 ? fmin(5.0, fmax(0.2, 0.9*pow(err, -0.2))) : 5.0;
+
+        if (err > 1.0) {
+          comp->csStepSize = h*fac;
+          continue;
+        }
+        comp->csStepSize = clipped ? fmax(comp->csStepSize, h*fac) : h*fac;
+      }
+      tNext = clipped ? tStop : t + h;
+
+      /* state events in the step */
+      if (nz > 0) {
+        data->callback->function_ZeroCrossings(data, threadData, z1);
+        if (csSignChange(nz, z0, z1)) {
+          tNext = csLocateEvent(comp, t, t + h, y0, f0, y1, f1, z0, z1, zM, y, k + n);
+          FILTERED_LOG(comp, fmi2OK, LOG_EVENTS, "fmi2DoStep: state event at time %.16g", tNext)
+          memcpy(y1, y, n * sizeof(fmi2Real));
+          memcpy(f1, k + n, n * sizeof(fmi2Real));
+          *event = fmi2True;
+        }
+      }
+
+      stepStatus = fmi2CompletedIntegratorStep(comp, fmi2True, &enterEventMode, terminateSimulation);
+      setThreadData(comp); /* reset by the nested call */
+#if defined(FMU2_TEST_HOOKS)
+      if (fmu2InjectedStepStatus != fmi2OK) {
+        stepStatus = fmu2InjectedStepStatus;
+      }
+#endif
+      if (stepStatus != fmi2OK && stepStatus != fmi2Warning) {
+        failed = fmi2True;
+        break;
+      }
+      *event = *event || enterEventMode;
+
+      t = tNext;
+      swap = y0; y0 = y1; y1 = swap;
+      memcpy(f0, f1, n * sizeof(fmi2Real));
+      if (nz > 0 && !*event) {
+        data->callback->function_ZeroCrossings(data, threadData, z0);
+      }
+    }
+    data->localData[0]->timeValue = t;
+    status = !failed ? fmi2OK : (stepStatus == fmi2Fatal ? fmi2Fatal : fmi2Error);
+
+  /* catch */
+  MMC_CATCH_INTERNAL(simulationJumpBuffer)
+  resetThreadData(comp);
+
+  if (status != fmi2OK) {
+    FILTERED_LOG(comp, fmi2Error, LOG_FMI2_CALL, "fmi2DoStep: integration failed.")
+  }
+  return status;
+}
+
 fmi2Status fmi2DoStep(fmi2Component c, fmi2Real currentCommunicationPoint, fmi2Real communicationStepSize, fmi2Boolean noSetFMUStatePriorToCurrentPoint)
 {
   ModelInstance *comp = (ModelInstance *)c;
-  fmi2CallbackFunctions* functions = (fmi2CallbackFunctions*)comp->functions;
-  int i, zc_event = 0, time_event = 0;
+  fmi2Real tEnd = currentCommunicationPoint + communicationStepSize, tStop;
+  fmi2Boolean stateEvent = fmi2False, terminateSimulation = fmi2False;
   fmi2Status status = fmi2OK;
-  fmi2Real* states = (fmi2Real*)functions->allocateMemory(NUMBER_OF_STATES, sizeof(fmi2Real));
-  fmi2Real* states_der = (fmi2Real*)functions->allocateMemory(NUMBER_OF_STATES, sizeof(fmi2Real));
-  fmi2Real* event_indicators = (fmi2Real*)functions->allocateMemory(NUMBER_OF_EVENT_INDICATORS, sizeof(fmi2Real));
-  fmi2Real* event_indicators_prev = (fmi2Real*)functions->allocateMemory(NUMBER_OF_EVENT_INDICATORS, sizeof(fmi2Real));
-  fmi2Real t = comp->fmuData->localData[0]->timeValue;
-  fmi2Real tNext, tEnd;
-  fmi2Boolean enterEventMode = fmi2False, terminateSimulation = fmi2False;
-  fmi2Real tCommunication;
 
   fmi2EventInfo eventInfo;
   eventInfo.newDiscreteStatesNeeded           = fmi2False;
@@ -1384,120 +2366,41 @@ fmi2Status fmi2DoStep(fmi2Component c, fmi2Real currentCommunicationPoint, fmi2R
   eventInfo.nextEventTimeDefined              = fmi2False;
   eventInfo.nextEventTime                     = -0.0;
 
-  if (comp->stopTimeDefined)
+  if (comp->stopTimeDefined && tEnd > comp->stopTime)
     tEnd = comp->stopTime;
-  else
-    tEnd = currentCommunicationPoint + communicationStepSize;
-  tCommunication = currentCommunicationPoint;
 
+  /* inputs may have changed discretely */
   fmi2EnterEventMode(c);
   fmi2EventIteration(c, &eventInfo);
   fmi2EnterContinuousTimeMode(c);
 
   while (status == fmi2OK && comp->fmuData->localData[0]->timeValue < tEnd)
   {
-    while (tCommunication <= comp->fmuData->localData[0]->timeValue)
-    {
-      tCommunication += communicationStepSize;
-    }
-
-    /* fprintf(stderr, "DoStep %g -> %g State: %s\n", comp->fmuData->localData[0]->timeValue, tNext, stateToString(comp)); */
-
-    if (NUMBER_OF_STATES > 0)
-    {
-      status = fmi2GetDerivatives(c, states_der, NUMBER_OF_STATES);
-      if (status != fmi2OK) {status=fmi2Error; break;}
-
-
-      status = fmi2GetContinuousStates(c, states, NUMBER_OF_STATES);
-      if (status != fmi2OK) {status=fmi2Error; break;}
-    }
-
-    if (NUMBER_OF_EVENT_INDICATORS > 0)
-    {
-      status = fmi2GetEventIndicators(c, event_indicators_prev, NUMBER_OF_EVENT_INDICATORS);
-      if (status != fmi2OK) {status=fmi2Error; break;}
-    }
-
-    /* adjust tNext step to get tEnd exactly */
-    if (tCommunication > tEnd - communicationStepSize/1e16)
-      tNext = tEnd;
-    else
-      tNext = tCommunication;
+    tStop = tEnd;
+    if (eventInfo.nextEventTimeDefined && eventInfo.nextEventTime <= tStop)
+      tStop = eventInfo.nextEventTime;
 
-    /* adjust for time events */
-    if (eventInfo.nextEventTimeDefined && (eventInfo.nextEventTime <= tNext))
-    {
-      tNext = eventInfo.nextEventTime;
-      time_event = 1;
-    }
-
-    /* integrate */
-    for (i = 0; i < NUMBER_OF_STATES; i++)
-    {
-      states[i] = states[i] + (tNext - comp->fmuData->localData[0]->timeValue) * states_der[i];
-    }
-    fmi2SetTime(c, tNext);
-
-    /* set the continuous states */
-    if (NUMBER_OF_STATES > 0)
-    {
-      status = fmi2SetContinuousStates(c, states, NUMBER_OF_STATES);
-      if (status != fmi2OK) {status=fmi2Error; break;}
-    }
-
-    /* signal completed integrator step */
-    status = fmi2CompletedIntegratorStep(c, fmi2True, &enterEventMode, &terminateSimulation);
-    if (status != fmi2OK) {status=fmi2Error; break;}
+    /* fprintf(stderr, "DoStep %g -> %g State: %s\n", comp->fmuData->localData[0]->timeValue, tStop, stateToString(comp)); */
+    status = csIntegrate(comp, tStop, &stateEvent, &terminateSimulation);
+    /* a fatal status is passed on, everything else fails the step */
+    if (status != fmi2OK) {if (status != fmi2Fatal) status=fmi2Error; break;}
 
-    /* check for events */
-    if (NUMBER_OF_EVENT_INDICATORS > 0)
+    if (stateEvent || (eventInfo.nextEventTimeDefined && comp->fmuData->localData[0]->timeValue >= eventInfo.nextEventTime))
     {
-      status = fmi2GetEventIndicators(c, event_indicators, NUMBER_OF_EVENT_INDICATORS);
-      if (status != fmi2OK) {status=fmi2Error; break;}
-
-      for (i = 0; i < NUMBER_OF_EVENT_INDICATORS; i++)
-      {
-        if (event_indicators[i]*event_indicators_prev[i] < 0)
-        {
-          zc_event = 1;
-          break;
-        }
-      }
-    }
-
-    if (enterEventMode || zc_event || time_event)
-    {
-      /* fprintf(stderr, "enterEventMode = %d, zc_event = %d, time_event = %d\n", enterEventMode, zc_event, time_event); */
-
       fmi2EnterEventMode(c);
       fmi2EventIteration(c, &eventInfo);
-
-      if (eventInfo.valuesOfContinuousStatesChanged)
-      {
-        status = fmi2GetContinuousStates(c, states, NUMBER_OF_STATES);
-        if (status != fmi2OK) {status=fmi2Error; break;}
-      }
-
-      if (eventInfo.nominalsOfContinuousStatesChanged)
-      {
-        status = fmi2GetNominalsOfContinuousStates(c, states, NUMBER_OF_STATES);
-        if (status != fmi2OK) {status=fmi2Error; break;}
-      }
-
-      status = fmi2GetEventIndicators(c, event_indicators_prev, NUMBER_OF_EVENT_INDICATORS);
-      if (status != fmi2OK) {status=fmi2Error; break;}
-
       status = fmi2EnterContinuousTimeMode(c);
-      if (status != fmi2OK) {status=fmi2Error; break;}
+      if (status != fmi2OK) {if (status != fmi2Fatal) status=fmi2Error; break;}
     }
-  }
 
-  functions->freeMemory(states);
-  functions->freeMemory(states_der);
-  functions->freeMemory(event_indicators);
-  functions->freeMemory(event_indicators_prev);
+    if (terminateSimulation || eventInfo.terminateSimulation)
+    {
+      FILTERED_LOG(comp, fmi2OK, LOG_FMI2_CALL, "fmi2DoStep: terminate simulation at time %.16g", comp->fmuData->localData[0]->timeValue)
+      status = fmi2Discard;
+    }
+  }
 
+  comp->_need_update = 1;
   return status;
 }
 
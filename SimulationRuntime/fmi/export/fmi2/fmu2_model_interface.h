@@ -89,10 +89,76 @@ typedef struct {
   fmi2Real stopTime;
 
   int _need_update;
+  unsigned int updatedBlocks;          /* FMU2_BLOCK_* evaluated since the last change of the model */
+  unsigned long savedBlockEvaluations; /* blocks skipped by the lazy evaluation of the getters */
   int _has_jacobian;
   ANALYTIC_JACOBIAN* fmiDerJac;
+  int* jacWork;             /* positions of seeds, results and used colors for batched derivatives */
+
+  char* stateBuffer;        /* scratch for packing and expanding FMU states */
+  size_t stateBufferSize;
+
+  int csSolver;             /* integrator of fmi2DoStep */
+  fmi2Real csStepSize;      /* step size proposed by the last step */
+  fmi2Real* csWork;         /* work arrays of the integrator, allocated once */
 } ModelInstance;
 
+/* Blocks of the model equations the getters evaluate on demand. The generated
+ * getRealEvaluationBlocks returns the blocks needed to read a real variable. */
+#define FMU2_BLOCK_ODE 1  /* functionODE: derivatives and the variables they depend on */
+#define FMU2_BLOCK_ALG 2  /* functionAlgebraics and output_function, needs FMU2_BLOCK_ODE */
+#define FMU2_BLOCK_ALL (FMU2_BLOCK_ODE|FMU2_BLOCK_ALG)
+
+/* Integrators for co-simulation. The default can be changed by compiling the
+ * FMU with -DOMC_FMI_CS_SOLVER=... */
+#define FMU2_CS_EULER    0  /* one explicit Euler step per communication step */
+#define FMU2_CS_DOPRI45  1  /* Dormand-Prince 5(4) with step size control */
+
+#if !defined(OMC_FMI_CS_SOLVER)
+#define OMC_FMI_CS_SOLVER FMU2_CS_DOPRI45
+#endif
+
+#define FMU2_CS_DEFAULT_TOLERANCE 1e-6
+
+/* Snapshot of the FMU state as returned by fmi2GetFMUstate. The header is
+ * followed by size bytes of payload. The payload is either the full state
+ * or, if deltaRuns > 0, a list of runs {size_t offset; size_t length; bytes}
+ * that replace the bytes of the full state of base. A serialized state is
+ * the header followed by the full state. */
+#define FMU2_STATE_MAGIC        0x534d464fu /* "OFMS" */
+#define FMU2_STATE_VERSION      2
+#define FMU2_STATE_GUID_LENGTH  64
+
+typedef struct FMU2_STATE {
+  unsigned int magic;
+  unsigned int version;
+  char guid[FMU2_STATE_GUID_LENGTH];
+  size_t size;              /* bytes of payload */
+  size_t fullSize;          /* bytes of the full state */
+  size_t capacity;          /* bytes allocated for the payload */
+  size_t deltaRuns;
+  struct FMU2_STATE *base;  /* only used in memory */
+} FMU2_STATE;
+
+/* OpenModelica extension: get the FMU state as difference to the full state
+ * base, which has to be freed after all states depending on it */
+FMI2_Export fmi2Status omc_fmi2GetFMUstateDelta(fmi2Component c, fmi2FMUstate base, fmi2FMUstate* FMUstate);
+
+/* OpenModelica extension: the partial derivatives of the unknowns with respect
+ * to the knowns as dense nUnknown x nKnown matrix in column-major order. The
+ * knowns of one color of the sparsity pattern are seeded together, so there
+ * is one evaluation per color of the selected knowns. */
+FMI2_Export fmi2Status omc_fmi2GetJacobian(fmi2Component c,
+    const fmi2ValueReference vUnknown_ref[], size_t nUnknown,
+    const fmi2ValueReference vKnown_ref[], size_t nKnown, fmi2Real jacobian[]);
+
+/* OpenModelica extension: nDirections directional derivatives at once. Seeds
+ * and results of direction d start at dvKnown[d*nKnown] and dvUnknown[d*nUnknown]. */
+FMI2_Export fmi2Status omc_fmi2GetDirectionalDerivatives(fmi2Component c,
+    const fmi2ValueReference vUnknown_ref[], size_t nUnknown,
+    const fmi2ValueReference vKnown_ref[], size_t nKnown,
+    const fmi2Real dvKnown[], size_t nDirections, fmi2Real dvUnknown[]);
+
 /* reset alignment policy to the one set before reading this file */
 #if defined _MSC_VER || defined __GNUC__
 #pragma pack(pop)
@@ -0,0 +1,180 @@
+/*
+ * This file is part of OpenModelica.
+ *
+ * Copyright (c) 1998-CurrentYear, Open Source Modelica Consortium (OSMC),
+ * c/o Linköpings universitet, Department of Computer and Information Science,
+ * SE-58183 Linköping, Sweden.
+ *
+ * All rights reserved.
+ *
+ * THIS PROGRAM IS PROVIDED UNDER THE TERMS OF GPL VERSION 3 LICENSE OR
+ * THIS OSMC PUBLIC LICENSE (OSMC-PL) VERSION 1.2.
+ * ANY USE, REPRODUCTION OR DISTRIBUTION OF THIS PROGRAM CONSTITUTES RECIPIENT'S ACCEPTANCE
+ * OF THE OSMC PUBLIC LICENSE OR THE GPL VERSION 3, ACCORDING TO RECIPIENTS CHOICE.
+ *
+ * The OpenModelica software and the Open Source Modelica
+ * Consortium (OSMC) Public License (OSMC-PL) are obtained
+ * from OSMC, either from the above address,
+ * from the URLs: http://www.ida.liu.se/projects/OpenModelica or
+ * http://www.openmodelica.org, and in the OpenModelica distribution.
+ * GNU version 3 is obtained from: http://www.gnu.org/copyleft/gpl.html.
+ *
+ * This program is distributed WITHOUT ANY WARRANTY; without
+ * even the implied warranty of  MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE, EXCEPT AS EXPRESSLY SET FORTH
+ * IN THE BY RECIPIENT SELECTED SUBSIDIARY LICENSE CONDITIONS OF OSMC-PL.
+ *
+ * See the full OSMC Public License conditions for more details.
+ *
+ */
+
+
+/*! \file bench_fmu2_state.c
+ * Description: Latency of saving and restoring the state of an FMI 2.0 FMU.
+ *              Every round takes one co-simulation step and then times
+ *              fmi2GetFMUstate (reusing the state of the previous round),
+ *              fmi2SetFMUstate, fmi2SerializeFMUstate and
+ *              fmi2DeSerializeFMUstate. The state restored last is checked
+ *              against the values it was taken at.
+ *
+ *   cc -O2 -o bench_fmu2_state bench_fmu2_state.c -ldl
+ *   ./bench_fmu2_state <unzipped FMU> [rounds=10000] [stepSize=1e-3]
+ */
+
+#include <time.h>
+
+#include "fmu2_loader.h"
+
+static double now(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + 1e-9*ts.tv_nsec;
+}
+
+static int compareDoubles(const void *a, const void *b)
+{
+  double x = *(const double*) a, y = *(const double*) b;
+  return (x > y) - (x < y);
+}
+
+static void report(const char *name, double *samples, int n)
+{
+  double sum = 0;
+  int i;
+  for (i = 0; i < n; i++) {
+    sum += samples[i];
+  }
+  qsort(samples, n, sizeof(double), compareDoubles);
+  printf("%-24s mean %9.2f us   median %9.2f us   p99 %9.2f us\n", name,
+         1e6*sum/n, 1e6*samples[n/2], 1e6*samples[(int)(0.99*(n-1))]);
+}
+
+int main(int argc, char **argv)
+{
+  FMU2 fmu;
+  fmi2Component c;
+  fmi2FMUstate state = NULL, copy = NULL;
+  fmi2Byte *bytes = NULL;
+  size_t size = 0, capacity = 0, j;
+  int rounds = argc > 2 ? atoi(argv[2]) : 10000;
+  double stepSize = argc > 3 ? atof(argv[3]) : 1e-3;
+  double *tGet, *tSet, *tSerialize, *tDeSerialize, *saved, *restored, t0;
+  int i, rc = 0;
+
+  if (argc < 2) {
+    fprintf(stderr, "usage: %s <unzipped FMU> [rounds] [stepSize]\n", argv[0]);
+    return 2;
+  }
+  if (fmu2Load(&fmu, argv[1])) {
+    return 2;
+  }
+  if (!fmu.getFMUstate || !fmu.setFMUstate || !fmu.freeFMUstate || !fmu.serializedFMUstateSize ||
+      !fmu.serializeFMUstate || !fmu.deSerializeFMUstate) {
+    fprintf(stderr, "the FMU does not export the FMU state functions\n");
+    fmu2Unload(&fmu);
+    return 2;
+  }
+  c = fmu2Start(&fmu, "bench", (rounds + 1)*stepSize);
+  if (!c) {
+    fmu2Unload(&fmu);
+    return 2;
+  }
+
+  tGet = (double*) malloc(rounds*sizeof(double));
+  tSet = (double*) malloc(rounds*sizeof(double));
+  tSerialize = (double*) malloc(rounds*sizeof(double));
+  tDeSerialize = (double*) malloc(rounds*sizeof(double));
+  saved = (double*) malloc((fmu.nReals + 1)*sizeof(double));
+  restored = (double*) malloc((fmu.nReals + 1)*sizeof(double));
+
+  for (i = 0; i < rounds && !rc; i++) {
+    if (fmi2OK != fmu.doStep(c, i*stepSize, stepSize, fmi2True) ||
+        fmi2OK != fmu.getReal(c, fmu.realVRs, fmu.nReals, saved)) {
+      rc = 1;
+      break;
+    }
+
+    t0 = now();
+    rc |= fmi2OK != fmu.getFMUstate(c, &state);
+    tGet[i] = now() - t0;
+
+    rc |= fmi2OK != fmu.serializedFMUstateSize(c, state, &size);
+    if (size > capacity) {
+      capacity = size;
+      bytes = (fmi2Byte*) realloc(bytes, capacity);
+    }
+    t0 = now();
+    rc |= fmi2OK != fmu.serializeFMUstate(c, state, bytes, size);
+    tSerialize[i] = now() - t0;
+
+    if (copy) {
+      fmu.freeFMUstate(c, &copy);
+    }
+    t0 = now();
+    rc |= fmi2OK != fmu.deSerializeFMUstate(c, bytes, size, &copy);
+    tDeSerialize[i] = now() - t0;
+
+    /* move away from the saved point, then go back to it */
+    rc |= fmi2OK != fmu.doStep(c, (i+1)*stepSize, stepSize, fmi2True);
+    t0 = now();
+    rc |= fmi2OK != fmu.setFMUstate(c, (i % 2) ? copy : state);
+    tSet[i] = now() - t0;
+  }
+
+  if (!rc && fmi2OK == fmu.getReal(c, fmu.realVRs, fmu.nReals, restored)) {
+    for (j = 0; j < fmu.nReals; j++) {
+      if (saved[j] != restored[j]) {
+        fprintf(stderr, "value reference %u: restored %.17g instead of %.17g\n", fmu.realVRs[j], restored[j], saved[j]);
+        rc = 1;
+      }
+    }
+  } else {
+    fprintf(stderr, "an FMI call failed in round %d\n", i);
+    rc = 1;
+  }
+
+  if (!rc) {
+    printf("%d rounds, %lu bytes serialized state, %lu Real variables\n", rounds, (unsigned long) size, (unsigned long) fmu.nReals);
+    report("fmi2GetFMUstate", tGet, rounds);
+    report("fmi2SetFMUstate", tSet, rounds);
+    report("fmi2SerializeFMUstate", tSerialize, rounds);
+    report("fmi2DeSerializeFMUstate", tDeSerialize, rounds);
+  }
+
+  fmu.freeFMUstate(c, &state);
+  if (copy) {
+    fmu.freeFMUstate(c, &copy);
+  }
+  fmu.terminate(c);
+  fmu.freeInstance(c);
+  free(bytes);
+  free(tGet);
+  free(tSet);
+  free(tSerialize);
+  free(tDeSerialize);
+  free(saved);
+  free(restored);
+  fmu2Unload(&fmu);
+  return rc;
+}
@@ -0,0 +1,236 @@
+/*
+ * This file is part of OpenModelica.
+ *
+ * Copyright (c) 1998-CurrentYear, Open Source Modelica Consortium (OSMC),
+ * c/o Linköpings universitet, Department of Computer and Information Science,
+ * SE-58183 Linköping, Sweden.
+ *
+ * All rights reserved.
+ *
+ * THIS PROGRAM IS PROVIDED UNDER THE TERMS OF GPL VERSION 3 LICENSE OR
+ * THIS OSMC PUBLIC LICENSE (OSMC-PL) VERSION 1.2.
+ * ANY USE, REPRODUCTION OR DISTRIBUTION OF THIS PROGRAM CONSTITUTES RECIPIENT'S ACCEPTANCE
+ * OF THE OSMC PUBLIC LICENSE OR THE GPL VERSION 3, ACCORDING TO RECIPIENTS CHOICE.
+ *
+ * The OpenModelica software and the Open Source Modelica
+ * Consortium (OSMC) Public License (OSMC-PL) are obtained
+ * from OSMC, either from the above address,
+ * from the URLs: http://www.ida.liu.se/projects/OpenModelica or
+ * http://www.openmodelica.org, and in the OpenModelica distribution.
+ * GNU version 3 is obtained from: http://www.gnu.org/copyleft/gpl.html.
+ *
+ * This program is distributed WITHOUT ANY WARRANTY; without
+ * even the implied warranty of  MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE, EXCEPT AS EXPRESSLY SET FORTH
+ * IN THE BY RECIPIENT SELECTED SUBSIDIARY LICENSE CONDITIONS OF OSMC-PL.
+ *
+ * See the full OSMC Public License conditions for more details.
+ *
+ */
+
+
+/*! \file fmu2_loader.h
+ * Description: Minimal loader of an unzipped FMI 2.0 FMU for the test and
+ *              benchmark harnesses in this directory. Reads the GUID, the
+ *              model identifier and the value references of the Real
+ *              variables from modelDescription.xml and binds the functions
+ *              of binaries/<platform>/<modelIdentifier>.so.
+ */
+
+#ifndef FMU2_LOADER_H
+#define FMU2_LOADER_H
+
+#include <dlfcn.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../fmi2Functions.h"
+
+#if defined(__APPLE__)
+#define FMU2_PLATFORM "darwin64"
+#define FMU2_LIB_EXT ".dylib"
+#else
+#define FMU2_PLATFORM "linux64"
+#define FMU2_LIB_EXT ".so"
+#endif
+
+typedef struct {
+  void *handle;
+  char guid[128];
+  char modelIdentifier[256];
+  char resourceLocation[1024];
+  fmi2ValueReference *realVRs;
+  size_t nReals;
+
+  fmi2InstantiateTYPE *instantiate;
+  fmi2FreeInstanceTYPE *freeInstance;
+  fmi2SetupExperimentTYPE *setupExperiment;
+  fmi2EnterInitializationModeTYPE *enterInitializationMode;
+  fmi2ExitInitializationModeTYPE *exitInitializationMode;
+  fmi2TerminateTYPE *terminate;
+  fmi2GetRealTYPE *getReal;
+  fmi2DoStepTYPE *doStep;
+  fmi2GetFMUstateTYPE *getFMUstate;
+  fmi2SetFMUstateTYPE *setFMUstate;
+  fmi2FreeFMUstateTYPE *freeFMUstate;
+  fmi2SerializedFMUstateSizeTYPE *serializedFMUstateSize;
+  fmi2SerializeFMUstateTYPE *serializeFMUstate;
+  fmi2DeSerializeFMUstateTYPE *deSerializeFMUstate;
+} FMU2;
+
+static void fmu2Logger(fmi2ComponentEnvironment env, fmi2String instanceName, fmi2Status status, fmi2String category, fmi2String message, ...)
+{
+  va_list args;
+  if (status == fmi2OK) {
+    return;
+  }
+  va_start(args, message);
+  fprintf(stderr, "%s [%s]: ", instanceName, category);
+  vfprintf(stderr, message, args);
+  fprintf(stderr, "\n");
+  va_end(args);
+}
+
+static const fmi2CallbackFunctions fmu2Callbacks = {fmu2Logger, calloc, free, NULL, NULL};
+
+static char* fmu2ReadFile(const char *fileName)
+{
+  FILE *file = fopen(fileName, "rb");
+  char *buffer;
+  long size;
+  if (!file) {
+    return NULL;
+  }
+  fseek(file, 0, SEEK_END);
+  size = ftell(file);
+  fseek(file, 0, SEEK_SET);
+  buffer = (char*) malloc(size + 1);
+  if (buffer && fread(buffer, 1, size, file) != (size_t) size) {
+    free(buffer);
+    buffer = NULL;
+  }
+  if (buffer) {
+    buffer[size] = '\0';
+  }
+  fclose(file);
+  return buffer;
+}
+
+/* copies the value of attribute name of the element starting at element */
+static int fmu2Attribute(const char *element, const char *name, char *value, size_t len)
+{
+  char pattern[64];
+  const char *begin, *end, *close = strchr(element, '>');
+  snprintf(pattern, sizeof(pattern), " %s=\"", name);
+  begin = strstr(element, pattern);
+  if (!begin || (close && begin > close)) {
+    return 1;
+  }
+  begin += strlen(pattern);
+  end = strchr(begin, '"');
+  if (!end || (size_t)(end - begin) >= len) {
+    return 1;
+  }
+  memcpy(value, begin, end - begin);
+  value[end - begin] = '\0';
+  return 0;
+}
+
+#define FMU2_BIND(fmu, name, symbol) (*(void**)(&(fmu)->name) = dlsym((fmu)->handle, #symbol))
+
+/* loads the unzipped FMU in directory dir, returns 0 on success */
+static int fmu2Load(FMU2 *fmu, const char *dir)
+{
+  char fileName[1024], value[32];
+  char *xml, *var;
+  size_t capacity = 64;
+
+  memset(fmu, 0, sizeof(FMU2));
+  snprintf(fileName, sizeof(fileName), "%s/modelDescription.xml", dir);
+  xml = fmu2ReadFile(fileName);
+  if (!xml) {
+    fprintf(stderr, "could not read %s\n", fileName);
+    return 1;
+  }
+  if (fmu2Attribute(strstr(xml, "<fmiModelDescription"), "guid", fmu->guid, sizeof(fmu->guid)) ||
+      !strstr(xml, "<CoSimulation") ||
+      fmu2Attribute(strstr(xml, "<CoSimulation"), "modelIdentifier", fmu->modelIdentifier, sizeof(fmu->modelIdentifier))) {
+    fprintf(stderr, "%s does not describe a co-simulation FMU\n", fileName);
+    free(xml);
+    return 1;
+  }
+
+  fmu->realVRs = (fmi2ValueReference*) malloc(capacity*sizeof(fmi2ValueReference));
+  for (var = strstr(xml, "<ScalarVariable"); var; var = strstr(var + 1, "<ScalarVariable")) {
+    char *type = strchr(var, '>');
+    if (!type || fmu2Attribute(var, "valueReference", value, sizeof(value))) {
+      continue;
+    }
+    type += strspn(type + 1, " \t\r\n") + 1;
+    if (0 != strncmp(type, "<Real", 5)) {
+      continue;
+    }
+    if (fmu->nReals == capacity) {
+      capacity *= 2;
+      fmu->realVRs = (fmi2ValueReference*) realloc(fmu->realVRs, capacity*sizeof(fmi2ValueReference));
+    }
+    fmu->realVRs[fmu->nReals++] = (fmi2ValueReference) strtoul(value, NULL, 10);
+  }
+  free(xml);
+
+  snprintf(fmu->resourceLocation, sizeof(fmu->resourceLocation), "file://%s/resources", dir);
+  snprintf(fileName, sizeof(fileName), "%s/binaries/%s/%s%s", dir, FMU2_PLATFORM, fmu->modelIdentifier, FMU2_LIB_EXT);
+  fmu->handle = dlopen(fileName, RTLD_NOW|RTLD_LOCAL);
+  if (!fmu->handle) {
+    fprintf(stderr, "%s\n", dlerror());
+    return 1;
+  }
+  FMU2_BIND(fmu, instantiate, fmi2Instantiate);
+  FMU2_BIND(fmu, freeInstance, fmi2FreeInstance);
+  FMU2_BIND(fmu, setupExperiment, fmi2SetupExperiment);
+  FMU2_BIND(fmu, enterInitializationMode, fmi2EnterInitializationMode);
+  FMU2_BIND(fmu, exitInitializationMode, fmi2ExitInitializationMode);
+  FMU2_BIND(fmu, terminate, fmi2Terminate);
+  FMU2_BIND(fmu, getReal, fmi2GetReal);
+  FMU2_BIND(fmu, doStep, fmi2DoStep);
+  FMU2_BIND(fmu, getFMUstate, fmi2GetFMUstate);
+  FMU2_BIND(fmu, setFMUstate, fmi2SetFMUstate);
+  FMU2_BIND(fmu, freeFMUstate, fmi2FreeFMUstate);
+  FMU2_BIND(fmu, serializedFMUstateSize, fmi2SerializedFMUstateSize);
+  FMU2_BIND(fmu, serializeFMUstate, fmi2SerializeFMUstate);
+  FMU2_BIND(fmu, deSerializeFMUstate, fmi2DeSerializeFMUstate);
+  if (!fmu->instantiate || !fmu->freeInstance || !fmu->setupExperiment || !fmu->enterInitializationMode ||
+      !fmu->exitInitializationMode || !fmu->terminate || !fmu->getReal || !fmu->doStep) {
+    fprintf(stderr, "%s does not export the co-simulation interface\n", fileName);
+    return 1;
+  }
+  return 0;
+}
+
+static void fmu2Unload(FMU2 *fmu)
+{
+  free(fmu->realVRs);
+  if (fmu->handle) {
+    dlclose(fmu->handle);
+  }
+}
+
+/* instantiates and initializes a co-simulation instance at time 0 */
+static fmi2Component fmu2Start(FMU2 *fmu, const char *instanceName, double stopTime)
+{
+  fmi2Component c = fmu->instantiate(instanceName, fmi2CoSimulation, fmu->guid, fmu->resourceLocation, &fmu2Callbacks, fmi2False, fmi2False);
+  if (!c) {
+    return NULL;
+  }
+  if (fmi2OK != fmu->setupExperiment(c, fmi2False, 0.0, 0.0, fmi2True, stopTime) ||
+      fmi2OK != fmu->enterInitializationMode(c) ||
+      fmi2OK != fmu->exitInitializationMode(c)) {
+    fmu->freeInstance(c);
+    return NULL;
+  }
+  return c;
+}
+
+#endif
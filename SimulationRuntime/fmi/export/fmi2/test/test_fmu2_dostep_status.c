@@ -0,0 +1,111 @@
+/*
+ * This file is part of OpenModelica.
+ *
+ * Copyright (c) 1998-CurrentYear, Open Source Modelica Consortium (OSMC),
+ * c/o Linköpings universitet, Department of Computer and Information Science,
+ * SE-58183 Linköping, Sweden.
+ *
+ * All rights reserved.
+ *
+ * THIS PROGRAM IS PROVIDED UNDER THE TERMS OF GPL VERSION 3 LICENSE OR
+ * THIS OSMC PUBLIC LICENSE (OSMC-PL) VERSION 1.2.
+ * ANY USE, REPRODUCTION OR DISTRIBUTION OF THIS PROGRAM CONSTITUTES RECIPIENT'S ACCEPTANCE
+ * OF THE OSMC PUBLIC LICENSE OR THE GPL VERSION 3, ACCORDING TO RECIPIENTS CHOICE.
+ *
+ * The OpenModelica software and the Open Source Modelica
+ * Consortium (OSMC) Public License (OSMC-PL) are obtained
+ * from OSMC, either from the above address,
+ * from the URLs: http://www.ida.liu.se/projects/OpenModelica or
+ * http://www.openmodelica.org, and in the OpenModelica distribution.
+ * GNU version 3 is obtained from: http://www.gnu.org/copyleft/gpl.html.
+ *
+ * This program is distributed WITHOUT ANY WARRANTY; without
+ * even the implied warranty of  MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE, EXCEPT AS EXPRESSLY SET FORTH
+ * IN THE BY RECIPIENT SELECTED SUBSIDIARY LICENSE CONDITIONS OF OSMC-PL.
+ *
+ * See the full OSMC Public License conditions for more details.
+ *
+ */
+
+
+/*! \file test_fmu2_dostep_status.c
+ * Description: Checks the status fmi2DoStep returns when the integrator
+ *              step of the co-simulation fails. The FMU has to be compiled
+ *              with -DFMU2_TEST_HOOKS, which lets the test replace the
+ *              status of fmi2CompletedIntegratorStep inside fmi2DoStep.
+ *              A fatal status has to be passed on, discard and error fail
+ *              the step with fmi2Error and a warning does not stop it.
+ *
+ *   cc -O2 -o test_fmu2_dostep_status test_fmu2_dostep_status.c -ldl
+ *   ./test_fmu2_dostep_status <unzipped FMU> [stepSize=1e-3]
+ *
+ * Returns 0 if fmi2DoStep returns the expected status in all cases.
+ */
+
+#include "fmu2_loader.h"
+
+static const char* statusName(fmi2Status status)
+{
+  switch (status) {
+    case fmi2OK: return "fmi2OK";
+    case fmi2Warning: return "fmi2Warning";
+    case fmi2Discard: return "fmi2Discard";
+    case fmi2Error: return "fmi2Error";
+    case fmi2Fatal: return "fmi2Fatal";
+    case fmi2Pending: return "fmi2Pending";
+  }
+  return "unknown";
+}
+
+int main(int argc, char **argv)
+{
+  /* status of fmi2CompletedIntegratorStep and the one fmi2DoStep has to return */
+  static const fmi2Status cases[][2] = {
+    {fmi2Fatal, fmi2Fatal},
+    {fmi2Error, fmi2Error},
+    {fmi2Discard, fmi2Error},
+    {fmi2Warning, fmi2OK},
+    {fmi2OK, fmi2OK}
+  };
+  FMU2 fmu;
+  fmi2Status *injected;
+  fmi2Status status;
+  double stepSize = argc > 2 ? atof(argv[2]) : 1e-3;
+  int i, rc = 0;
+
+  if (argc < 2) {
+    fprintf(stderr, "usage: %s <unzipped FMU> [stepSize]\n", argv[0]);
+    return 2;
+  }
+  if (fmu2Load(&fmu, argv[1])) {
+    return 2;
+  }
+  injected = (fmi2Status*) dlsym(fmu.handle, "fmu2InjectedStepStatus");
+  if (!injected) {
+    fprintf(stderr, "the FMU was not compiled with -DFMU2_TEST_HOOKS\n");
+    fmu2Unload(&fmu);
+    return 2;
+  }
+
+  for (i = 0; i < (int)(sizeof(cases)/sizeof(cases[0])); i++) {
+    fmi2Component c = fmu2Start(&fmu, "dostep_status", 10*stepSize);
+    if (!c) {
+      fprintf(stderr, "could not instantiate the FMU\n");
+      rc = 2;
+      break;
+    }
+    *injected = cases[i][0];
+    status = fmu.doStep(c, 0.0, stepSize, fmi2True);
+    *injected = fmi2OK;
+    printf("fmi2CompletedIntegratorStep %s: fmi2DoStep returned %s, expected %s\n",
+           statusName(cases[i][0]), statusName(status), statusName(cases[i][1]));
+    if (status != cases[i][1]) {
+      rc = 1;
+    }
+    fmu.freeInstance(c);
+  }
+
+  fmu2Unload(&fmu);
+  return rc;
+}
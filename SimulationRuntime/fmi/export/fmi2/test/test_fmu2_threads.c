@@ -0,0 +1,174 @@
+/*
+ * This file is part of OpenModelica.
+ *
+ * Copyright (c) 1998-CurrentYear, Open Source Modelica Consortium (OSMC),
+ * c/o Linköpings universitet, Department of Computer and Information Science,
+ * SE-58183 Linköping, Sweden.
+ *
+ * All rights reserved.
+ *
+ * THIS PROGRAM IS PROVIDED UNDER THE TERMS OF GPL VERSION 3 LICENSE OR
+ * THIS OSMC PUBLIC LICENSE (OSMC-PL) VERSION 1.2.
+ * ANY USE, REPRODUCTION OR DISTRIBUTION OF THIS PROGRAM CONSTITUTES RECIPIENT'S ACCEPTANCE
+ * OF THE OSMC PUBLIC LICENSE OR THE GPL VERSION 3, ACCORDING TO RECIPIENTS CHOICE.
+ *
+ * The OpenModelica software and the Open Source Modelica
+ * Consortium (OSMC) Public License (OSMC-PL) are obtained
+ * from OSMC, either from the above address,
+ * from the URLs: http://www.ida.liu.se/projects/OpenModelica or
+ * http://www.openmodelica.org, and in the OpenModelica distribution.
+ * GNU version 3 is obtained from: http://www.gnu.org/copyleft/gpl.html.
+ *
+ * This program is distributed WITHOUT ANY WARRANTY; without
+ * even the implied warranty of  MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE, EXCEPT AS EXPRESSLY SET FORTH
+ * IN THE BY RECIPIENT SELECTED SUBSIDIARY LICENSE CONDITIONS OF OSMC-PL.
+ *
+ * See the full OSMC Public License conditions for more details.
+ *
+ */
+
+
+/*! \file test_fmu2_threads.c
+ * Description: Stress test for instances of one FMI 2.0 FMU that are stepped
+ *              on different threads. All instances are instantiated on the
+ *              main thread, stepped concurrently (one thread per instance)
+ *              and compared value by value against a serial run. Instances
+ *              are instantiated and freed again afterwards, so a stale
+ *              parent thread data would be installed by then.
+ *
+ *   cc -O2 -o test_fmu2_threads test_fmu2_threads.c -lpthread -ldl
+ *   ./test_fmu2_threads <unzipped FMU> [instances=8] [steps=1000] [stepSize=1e-3]
+ *
+ * Returns 0 if all concurrent trajectories match the serial one.
+ */
+
+#include <pthread.h>
+
+#include "fmu2_loader.h"
+
+typedef struct {
+  FMU2 *fmu;
+  fmi2Component c;
+  int steps;
+  double stepSize;
+  const double *reference; /* steps*nReals values of the serial run */
+  long mismatches;
+  int failed;
+} RUN;
+
+/* steps the instance and compares every step with the reference, or
+ * records it if there is no reference */
+static void* simulate(void *arg)
+{
+  RUN *run = (RUN*) arg;
+  FMU2 *fmu = run->fmu;
+  double *values = (double*) malloc((fmu->nReals ? fmu->nReals : 1)*sizeof(double));
+  int i;
+  size_t j;
+
+  for (i = 0; i < run->steps && !run->failed; i++) {
+    if (fmi2OK != fmu->doStep(run->c, i*run->stepSize, run->stepSize, fmi2True) ||
+        fmi2OK != fmu->getReal(run->c, fmu->realVRs, fmu->nReals, values)) {
+      run->failed = 1;
+      break;
+    }
+    for (j = 0; j < fmu->nReals; j++) {
+      if (run->reference[i*fmu->nReals + j] != values[j]) {
+        run->mismatches++;
+      }
+    }
+  }
+  free(values);
+  return NULL;
+}
+
+static int serialReference(FMU2 *fmu, int steps, double stepSize, double *reference)
+{
+  fmi2Component c = fmu2Start(fmu, "reference", steps*stepSize);
+  int i;
+  if (!c) {
+    return 1;
+  }
+  for (i = 0; i < steps; i++) {
+    if (fmi2OK != fmu->doStep(c, i*stepSize, stepSize, fmi2True) ||
+        fmi2OK != fmu->getReal(c, fmu->realVRs, fmu->nReals, reference + i*fmu->nReals)) {
+      fmu->freeInstance(c);
+      return 1;
+    }
+  }
+  fmu->terminate(c);
+  fmu->freeInstance(c);
+  return 0;
+}
+
+/* instantiates n instances on the calling thread and steps them concurrently */
+static int concurrentRound(FMU2 *fmu, int n, int steps, double stepSize, const double *reference, int round)
+{
+  RUN *runs = (RUN*) calloc(n, sizeof(RUN));
+  pthread_t *threads = (pthread_t*) malloc(n*sizeof(pthread_t));
+  char name[64];
+  long mismatches = 0;
+  int i, failed = 0;
+
+  for (i = 0; i < n; i++) {
+    snprintf(name, sizeof(name), "instance_%d_%d", round, i);
+    runs[i].fmu = fmu;
+    runs[i].steps = steps;
+    runs[i].stepSize = stepSize;
+    runs[i].reference = reference;
+    runs[i].c = fmu2Start(fmu, name, steps*stepSize);
+    if (!runs[i].c) {
+      fprintf(stderr, "round %d: could not instantiate %s\n", round, name);
+      n = i;
+      failed = 1;
+      break;
+    }
+  }
+  for (i = 0; i < n && !failed; i++) {
+    pthread_create(&threads[i], NULL, simulate, &runs[i]);
+  }
+  for (i = 0; i < n && !failed; i++) {
+    pthread_join(threads[i], NULL);
+    failed |= runs[i].failed;
+    mismatches += runs[i].mismatches;
+  }
+  /* free in a different order than instantiated */
+  for (i = n-1; i >= 0; i--) {
+    fmu->terminate(runs[i].c);
+    fmu->freeInstance(runs[i].c);
+  }
+  printf("round %d: %d instances, %ld mismatching values%s\n", round, n, mismatches, failed ? ", a step failed" : "");
+  free(threads);
+  free(runs);
+  return failed || mismatches;
+}
+
+int main(int argc, char **argv)
+{
+  FMU2 fmu;
+  int n = argc > 2 ? atoi(argv[2]) : 8;
+  int steps = argc > 3 ? atoi(argv[3]) : 1000;
+  double stepSize = argc > 4 ? atof(argv[4]) : 1e-3;
+  double *reference;
+  int rc = 0, round;
+
+  if (argc < 2) {
+    fprintf(stderr, "usage: %s <unzipped FMU> [instances] [steps] [stepSize]\n", argv[0]);
+    return 2;
+  }
+  if (fmu2Load(&fmu, argv[1])) {
+    return 2;
+  }
+  reference = (double*) malloc((size_t)steps*(fmu.nReals ? fmu.nReals : 1)*sizeof(double));
+  if (serialReference(&fmu, steps, stepSize, reference)) {
+    fprintf(stderr, "the serial reference run failed\n");
+    rc = 1;
+  }
+  for (round = 0; round < 2 && !rc; round++) {
+    rc = concurrentRound(&fmu, n, steps, stepSize, reference, round);
+  }
+  free(reference);
+  fmu2Unload(&fmu);
+  return rc;
+}